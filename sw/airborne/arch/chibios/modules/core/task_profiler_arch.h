@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file "arch/chibios/modules/core/task_profiler_arch.h"
+ * Cycle counter for the task profiler.
+ * Uses the DWT cycle counter of the Cortex-M core, one tick is one CPU cycle.
+ */
+
+#ifndef TASK_PROFILER_ARCH_H
+#define TASK_PROFILER_ARCH_H
+
+#include "std.h"
+#include <hal.h>
+
+#define TASK_PROFILER_TICKS_PER_USEC ((float)STM32_HCLK / 1e6f)
+
+static inline void task_profiler_arch_init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/** Get current CPU cycle counter */
+static inline uint32_t task_profiler_arch_ticks(void)
+{
+  return DWT->CYCCNT;
+}
+
+#endif /* TASK_PROFILER_ARCH_H */
+
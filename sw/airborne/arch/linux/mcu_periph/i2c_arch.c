@@ -28,20 +28,47 @@
 
 #include "mcu_periph/i2c.h"
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/ioctl.h>
 #include <linux/i2c.h>
 #include <linux/i2c-dev.h>
 #include <errno.h>
 
 #include <pthread.h>
+#include <semaphore.h>
 #include "rt_priority.h"
 
 #ifndef I2C_THREAD_PRIO
 #define I2C_THREAD_PRIO 10
 #endif
 
+/** Max number of queued transactions packed in a single I2C_RDWR ioctl.
+ * Set to 1 (default) to disable batching.
+ * When batching, transactions are separated by repeated starts instead of stop conditions,
+ * only enable it if all the devices on the bus support it.
+ * A failed batch fails all its transactions, which are retried by their drivers.
+ */
+#ifndef I2C_LINUX_BATCH_SIZE
+#define I2C_LINUX_BATCH_SIZE 1
+#endif
+
+#if I2C_LINUX_BATCH_SIZE < 1 || (2 * I2C_LINUX_BATCH_SIZE) > I2C_RDWR_IOCTL_MAX_MSGS
+#error "I2C_LINUX_BATCH_SIZE should be between 1 and I2C_RDWR_IOCTL_MAX_MSGS / 2"
+#endif
+
+#if (I2C_TRANSACTION_QUEUE_LEN & (I2C_TRANSACTION_QUEUE_LEN - 1)) != 0
+#error "I2C_TRANSACTION_QUEUE_LEN should be a power of 2 on Linux"
+#endif
+
+/** Size of the completion queue */
+#define I2C_LINUX_DONE_LEN (2 * I2C_TRANSACTION_QUEUE_LEN)
+
+/** Window for utilization computation in nanoseconds */
+#define I2C_LINUX_STATS_WINDOW 1000000000ULL
+
 
 static bool i2c_linux_idle(struct i2c_periph *p __attribute__((unused))) __attribute__((unused));
 static bool i2c_linux_submit(struct i2c_periph *p, struct i2c_transaction *t) __attribute__((unused));
@@ -50,14 +77,50 @@ static void i2c_linux_setbitrate(struct i2c_periph *p  __attribute__((unused)),
 
 static void *i2c_thread(void *thread_data);
 
+// completion callback of a transaction
+struct i2c_linux_done {
+  struct i2c_transaction *trans;
+  i2c_linux_callback cb;
+  void *data;
+};
+
 // private I2C init structure
 struct i2c_thread_t {
-  pthread_mutex_t mutex;
-  pthread_cond_t condition;
+  sem_t sem;                                            ///< number of queued transactions
+  uint32_t enqueue_pos;                                 ///< producers position
+  uint32_t dequeue_pos;                                 ///< consumer (thread) position
+  uint32_t seq[I2C_TRANSACTION_QUEUE_LEN];              ///< sequence number of each slot
+  struct i2c_linux_done cbs[I2C_TRANSACTION_QUEUE_LEN]; ///< callbacks of queued transactions
+  struct i2c_linux_done done[I2C_LINUX_DONE_LEN];       ///< finished transactions with callback
+  uint32_t done_insert;                                 ///< written by the thread
+  uint32_t done_extract;                                ///< written by i2c_event
+  struct i2c_linux_stats stats;
+  uint64_t window_start;
+  uint64_t window_busy;
 };
 
+static uint64_t i2c_linux_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 static void UNUSED i2c_arch_init(struct i2c_periph *p)
 {
+  struct i2c_thread_t *th = (struct i2c_thread_t *)(p->init_struct);
+  sem_init(&th->sem, 0, 0);
+  th->enqueue_pos = 0;
+  th->dequeue_pos = 0;
+  for (uint32_t i = 0; i < I2C_TRANSACTION_QUEUE_LEN; i++) {
+    th->seq[i] = i;
+  }
+  th->done_insert = 0;
+  th->done_extract = 0;
+  memset(&th->stats, 0, sizeof(th->stats));
+  th->window_start = i2c_linux_now();
+  th->window_busy = 0;
+
   pthread_t tid;
   if (pthread_create(&tid, NULL, i2c_thread, (void *)p) != 0) {
     fprintf(stderr, "i2c_arch_init: Could not create I2C thread.\n");
@@ -68,8 +131,34 @@ static void UNUSED i2c_arch_init(struct i2c_periph *p)
 #endif
 }
 
+/*
+ * Deliver completion callbacks in the main loop
+ */
+static void UNUSED i2c_linux_dispatch(struct i2c_periph *p)
+{
+  struct i2c_thread_t *th = (struct i2c_thread_t *)(p->init_struct);
+  uint32_t insert = __atomic_load_n(&th->done_insert, __ATOMIC_ACQUIRE);
+  while (th->done_extract != insert) {
+    struct i2c_linux_done *d = &th->done[th->done_extract % I2C_LINUX_DONE_LEN];
+    d->cb(d->trans, d->data);
+    __atomic_store_n(&th->done_extract, th->done_extract + 1, __ATOMIC_RELEASE);
+  }
+}
+
 void i2c_event(void)
 {
+#if USE_I2C0
+  i2c_linux_dispatch(&i2c0);
+#endif
+#if USE_I2C1
+  i2c_linux_dispatch(&i2c1);
+#endif
+#if USE_I2C2
+  i2c_linux_dispatch(&i2c2);
+#endif
+#if USE_I2C3
+  i2c_linux_dispatch(&i2c3);
+#endif
 }
 
 static void i2c_linux_setbitrate(struct i2c_periph *p  __attribute__((unused)), int bitrate __attribute__((unused)))
@@ -81,128 +170,290 @@ static bool i2c_linux_idle(struct i2c_periph *p __attribute__((unused)))
   return true;
 }
 
-static bool i2c_linux_submit(struct i2c_periph *p, struct i2c_transaction *t)
+/*
+ * Lock-free multi-producer submission (bounded queue with per slot sequence numbers)
+ */
+bool i2c_linux_submit_cb(struct i2c_periph *p, struct i2c_transaction *t, i2c_linux_callback cb, void *data)
 {
-  // get mutex lock and condition
-  pthread_mutex_t *mutex = &(((struct i2c_thread_t *)(p->init_struct))->mutex);
-  pthread_cond_t *condition = &(((struct i2c_thread_t *)(p->init_struct))->condition);
-
-  uint8_t next_idx;
-  pthread_mutex_lock(mutex);
-  next_idx = (p->trans_insert_idx + 1) % I2C_TRANSACTION_QUEUE_LEN;
-  if (next_idx == p->trans_extract_idx) {
-    // queue full
-    p->errors->queue_full_cnt++;
-    t->status = I2CTransFailed;
-    pthread_mutex_unlock(mutex);
-    return false;
+  struct i2c_thread_t *th = (struct i2c_thread_t *)(p->init_struct);
+  uint32_t pos = __atomic_load_n(&th->enqueue_pos, __ATOMIC_RELAXED);
+  uint32_t idx;
+  while (1) {
+    idx = pos & (I2C_TRANSACTION_QUEUE_LEN - 1);
+    uint32_t seq = __atomic_load_n(&th->seq[idx], __ATOMIC_ACQUIRE);
+    int32_t diff = (int32_t)(seq - pos);
+    if (diff == 0) {
+      // slot is free, try to reserve it
+      if (__atomic_compare_exchange_n(&th->enqueue_pos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // queue full
+      __atomic_fetch_add(&p->errors->queue_full_cnt, 1, __ATOMIC_RELAXED);
+      t->status = I2CTransFailed;
+      return false;
+    } else {
+      // another producer took this slot
+      pos = __atomic_load_n(&th->enqueue_pos, __ATOMIC_RELAXED);
+    }
   }
 
   t->status = I2CTransPending;
 
-  /* put transaction in queue */
-  p->trans[p->trans_insert_idx] = t;
-  p->trans_insert_idx = next_idx;
+  /* put transaction in queue and publish it */
+  p->trans[idx] = t;
+  th->cbs[idx].trans = t;
+  th->cbs[idx].cb = cb;
+  th->cbs[idx].data = data;
+  p->trans_insert_idx = (pos + 1) & (I2C_TRANSACTION_QUEUE_LEN - 1);
+  __atomic_store_n(&th->seq[idx], pos + 1, __ATOMIC_RELEASE);
 
   /* wake handler thread */
-  pthread_cond_signal(condition);
-  pthread_mutex_unlock(mutex);
+  sem_post(&th->sem);
 
   return true;
 }
 
+static bool i2c_linux_submit(struct i2c_periph *p, struct i2c_transaction *t)
+{
+  return i2c_linux_submit_cb(p, t, NULL, NULL);
+}
+
+void i2c_linux_get_stats(struct i2c_periph *p, struct i2c_linux_stats *stats)
+{
+  struct i2c_thread_t *th = (struct i2c_thread_t *)(p->init_struct);
+  // stats are only written by the I2C thread, values may be off by one transfer
+  memcpy(stats, &th->stats, sizeof(struct i2c_linux_stats));
+}
+
 /*
- * Transactions handler thread
+ * Get next transaction from the queue (only called by the I2C thread)
+ * A transaction is always available since the semaphore was taken
+ */
+static struct i2c_linux_done i2c_linux_dequeue(struct i2c_periph *p)
+{
+  struct i2c_thread_t *th = (struct i2c_thread_t *)(p->init_struct);
+  uint32_t pos = th->dequeue_pos;
+  uint32_t idx = pos & (I2C_TRANSACTION_QUEUE_LEN - 1);
+  // wait for the producer to publish the slot (reserved but not written yet)
+  while ((int32_t)(__atomic_load_n(&th->seq[idx], __ATOMIC_ACQUIRE) - (pos + 1)) < 0) {
+    sched_yield();
+  }
+  struct i2c_linux_done d = th->cbs[idx];
+  __atomic_store_n(&th->seq[idx], pos + I2C_TRANSACTION_QUEUE_LEN, __ATOMIC_RELEASE);
+  th->dequeue_pos = pos + 1;
+  p->trans_extract_idx = th->dequeue_pos & (I2C_TRANSACTION_QUEUE_LEN - 1);
+  return d;
+}
+
+/*
+ * Transaction is finished, update stats and queue callback
+ */
+static void i2c_linux_complete(struct i2c_periph *p, struct i2c_linux_done *d)
+{
+  struct i2c_thread_t *th = (struct i2c_thread_t *)(p->init_struct);
+  th->stats.nb_trans++;
+  if (d->trans->status == I2CTransFailed) {
+    th->stats.nb_failed++;
+  }
+  if (d->cb == NULL) {
+    return;
+  }
+  uint32_t extract = __atomic_load_n(&th->done_extract, __ATOMIC_ACQUIRE);
+  if (th->done_insert - extract >= I2C_LINUX_DONE_LEN) {
+    // main loop is not fast enough
+    th->stats.nb_cb_dropped++;
+    return;
+  }
+  th->done[th->done_insert % I2C_LINUX_DONE_LEN] = *d;
+  __atomic_store_n(&th->done_insert, th->done_insert + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Account time spent in the kernel
+ */
+static void i2c_linux_account(struct i2c_periph *p, uint64_t start)
+{
+  struct i2c_thread_t *th = (struct i2c_thread_t *)(p->init_struct);
+  uint64_t now = i2c_linux_now();
+  th->stats.nb_ioctl++;
+  th->stats.busy_ns += now - start;
+  th->window_busy += now - start;
+  if (now - th->window_start > I2C_LINUX_STATS_WINDOW) {
+    th->stats.utilization = (float)th->window_busy / (float)(now - th->window_start);
+    th->window_start = now;
+    th->window_busy = 0;
+  }
+}
+
+/*
+ * Fill I2C messages for a transaction, return number of messages
  */
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-qual"
-static void *i2c_thread(void *data)
+static int i2c_linux_fill_msgs(struct i2c_transaction *t, struct i2c_msg *msgs)
+{
+  switch (t->type) {
+    case I2CTransTx:
+      msgs[0].addr = t->slave_addr >> 1;
+      msgs[0].flags = 0; /* tx */
+      msgs[0].len = t->len_w;
+      msgs[0].buf = (void *) t->buf;
+      return 1;
+    case I2CTransRx:
+      msgs[0].addr = t->slave_addr >> 1;
+      msgs[0].flags = I2C_M_RD;
+      msgs[0].len = t->len_r;
+      msgs[0].buf = (void *) t->buf;
+      return 1;
+    case I2CTransTxRx:
+      msgs[0].addr = t->slave_addr >> 1;
+      msgs[0].flags = 0; /* tx */
+      msgs[0].len = t->len_w;
+      msgs[0].buf = (void *) t->buf;
+      msgs[1].addr = t->slave_addr >> 1;
+      msgs[1].flags = I2C_M_RD;
+      msgs[1].len = t->len_r;
+      msgs[1].buf = (void *) t->buf;
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+/*
+ * Run a single transaction
+ */
+static void i2c_linux_transfer(struct i2c_periph *p, struct i2c_transaction *t)
 {
   struct i2c_msg trx_msgs[2];
   struct i2c_rdwr_ioctl_data trx_data = {
     .msgs = trx_msgs,
     .nmsgs = 2
   };
+  int fd = (int)p->reg_addr;
+  uint64_t start = i2c_linux_now();
+
+  // Switch the different transaction types
+  switch (t->type) {
+    // Just transmitting
+    case I2CTransTx:
+      // Set the slave address, converted to 7 bit
+      ioctl(fd, I2C_SLAVE, t->slave_addr >> 1);
+      if (write(fd, (uint8_t *)t->buf, t->len_w) < 0) {
+        /* if write failed, increment error counter ack_fail_cnt */
+        __atomic_fetch_add(&p->errors->ack_fail_cnt, 1, __ATOMIC_RELAXED);
+        t->status = I2CTransFailed;
+      } else {
+        t->status = I2CTransSuccess;
+      }
+      break;
+    // Just reading
+    case I2CTransRx:
+      // Set the slave address, converted to 7 bit
+      ioctl(fd, I2C_SLAVE, t->slave_addr >> 1);
+      if (read(fd, (uint8_t *)t->buf, t->len_r) < 0) {
+        /* if read failed, increment error counter arb_lost_cnt */
+        __atomic_fetch_add(&p->errors->arb_lost_cnt, 1, __ATOMIC_RELAXED);
+        t->status = I2CTransFailed;
+      } else {
+        t->status = I2CTransSuccess;
+      }
+      break;
+    // First Transmit and then read with repeated start
+    case I2CTransTxRx:
+      i2c_linux_fill_msgs(t, trx_msgs);
+      if (ioctl(fd, I2C_RDWR, &trx_data) < 0) {
+        /* if write/read failed, increment error counter miss_start_stop_cnt */
+        __atomic_fetch_add(&p->errors->miss_start_stop_cnt, 1, __ATOMIC_RELAXED);
+        t->status = I2CTransFailed;
+      } else {
+        t->status = I2CTransSuccess;
+      }
+      break;
+    default:
+      t->status = I2CTransFailed;
+      return;
+  }
+  i2c_linux_account(p, start);
+}
+
+/*
+ * Run several transactions with a single I2C_RDWR ioctl
+ * On failure, all the transactions of the batch are failed and left to the
+ * drivers retry: the messages before the faulty one were already on the bus,
+ * running them again would repeat their writes and lose their reads
+ */
+static void i2c_linux_transfer_batch(struct i2c_periph *p, struct i2c_linux_done *batch, int nb)
+{
+  struct i2c_msg msgs[2 * I2C_LINUX_BATCH_SIZE];
+  struct i2c_rdwr_ioctl_data data = {
+    .msgs = msgs,
+    .nmsgs = 0
+  };
+  int fd = (int)p->reg_addr;
+  struct i2c_thread_t *th = (struct i2c_thread_t *)(p->init_struct);
+
+  for (int i = 0; i < nb; i++) {
+    batch[i].trans->status = I2CTransRunning;
+    data.nmsgs += i2c_linux_fill_msgs(batch[i].trans, &msgs[data.nmsgs]);
+  }
+
+  uint64_t start = i2c_linux_now();
+  int ret = ioctl(fd, I2C_RDWR, &data);
+  i2c_linux_account(p, start);
+
+  if (ret < 0) {
+    /* if write/read failed, increment error counter miss_start_stop_cnt */
+    __atomic_fetch_add(&p->errors->miss_start_stop_cnt, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < nb; i++) {
+      batch[i].trans->status = I2CTransFailed;
+    }
+  } else {
+    th->stats.nb_batched += nb;
+    for (int i = 0; i < nb; i++) {
+      batch[i].trans->status = I2CTransSuccess;
+    }
+  }
+}
+#pragma GCC diagnostic pop
+
+/*
+ * Transactions handler thread
+ */
+static void *i2c_thread(void *data)
+{
+  struct i2c_linux_done batch[I2C_LINUX_BATCH_SIZE];
 
   get_rt_prio(I2C_THREAD_PRIO);
 
   struct i2c_periph *p = (struct i2c_periph *)data;
-  pthread_mutex_t *mutex = &(((struct i2c_thread_t *)(p->init_struct))->mutex);
-  pthread_cond_t *condition = &(((struct i2c_thread_t *)(p->init_struct))->condition);
+  struct i2c_thread_t *th = (struct i2c_thread_t *)(p->init_struct);
 
   while (1) {
     /* wait for data to transfer */
-    pthread_mutex_lock(mutex);
-    if (p->trans_insert_idx == p->trans_extract_idx) {
-      pthread_cond_wait(condition, mutex);
+    if (sem_wait(&th->sem) != 0) {
+      continue;
+    }
+    int nb = 0;
+    batch[nb++] = i2c_linux_dequeue(p);
+    /* get all available transactions up to batch size */
+    while (nb < I2C_LINUX_BATCH_SIZE && sem_trywait(&th->sem) == 0) {
+      batch[nb++] = i2c_linux_dequeue(p);
     }
 
-    int fd = (int)p->reg_addr;
-    struct i2c_transaction *t = p->trans[p->trans_extract_idx];
-    pthread_mutex_unlock(mutex);
-
-    // Switch the different transaction types
-    switch (t->type) {
-      // Just transmitting
-      case I2CTransTx:
-        // Set the slave address, converted to 7 bit
-        ioctl(fd, I2C_SLAVE, t->slave_addr >> 1);
-        if (write(fd, (uint8_t *)t->buf, t->len_w) < 0) {
-          /* if write failed, increment error counter ack_fail_cnt */
-          pthread_mutex_lock(mutex);
-          p->errors->ack_fail_cnt++;
-          pthread_mutex_unlock(mutex);
-          t->status = I2CTransFailed;
-        } else {
-          t->status = I2CTransSuccess;
-        }
-        break;
-      // Just reading
-      case I2CTransRx:
-        // Set the slave address, converted to 7 bit
-        ioctl(fd, I2C_SLAVE, t->slave_addr >> 1);
-        if (read(fd, (uint8_t *)t->buf, t->len_r) < 0) {
-          /* if read failed, increment error counter arb_lost_cnt */
-          pthread_mutex_lock(mutex);
-          p->errors->arb_lost_cnt++;
-          pthread_mutex_unlock(mutex);
-          t->status = I2CTransFailed;
-        } else {
-          t->status = I2CTransSuccess;
-        }
-        break;
-      // First Transmit and then read with repeated start
-      case I2CTransTxRx:
-        trx_msgs[0].addr = t->slave_addr >> 1;
-        trx_msgs[0].flags = 0; /* tx */
-        trx_msgs[0].len = t->len_w;
-        trx_msgs[0].buf = (void *) t->buf;
-        trx_msgs[1].addr = t->slave_addr >> 1;
-        trx_msgs[1].flags = I2C_M_RD;
-        trx_msgs[1].len = t->len_r;
-        trx_msgs[1].buf = (void *) t->buf;
-        if (ioctl(fd, I2C_RDWR, &trx_data) < 0) {
-          /* if write/read failed, increment error counter miss_start_stop_cnt */
-          pthread_mutex_lock(mutex);
-          p->errors->miss_start_stop_cnt++;
-          pthread_mutex_unlock(mutex);
-          t->status = I2CTransFailed;
-        } else {
-          t->status = I2CTransSuccess;
-        }
-        break;
-      default:
-        t->status = I2CTransFailed;
-        break;
+    if (nb == 1) {
+      i2c_linux_transfer(p, batch[0].trans);
+    } else {
+      i2c_linux_transfer_batch(p, batch, nb);
     }
 
-    pthread_mutex_lock(mutex);
-    p->trans_extract_idx = (p->trans_extract_idx + 1) % I2C_TRANSACTION_QUEUE_LEN;
-    pthread_mutex_unlock(mutex);
+    for (int i = 0; i < nb; i++) {
+      i2c_linux_complete(p, &batch[i]);
+    }
   }
   return NULL;
 }
-#pragma GCC diagnostic pop
 
 #if USE_I2C0
 struct i2c_errors i2c0_errors;
@@ -220,8 +471,6 @@ void i2c0_hw_init(void)
   /* zeros error counter */
   ZEROS_ERR_COUNTER(i2c0_errors);
 
-  pthread_mutex_init(&i2c0_thread.mutex, NULL);
-  pthread_cond_init(&i2c0_thread.condition, NULL);
   i2c0.init_struct = (void *)(&i2c0_thread);
 
   i2c_arch_init(&i2c0);
@@ -244,8 +493,6 @@ void i2c1_hw_init(void)
   /* zeros error counter */
   ZEROS_ERR_COUNTER(i2c1_errors);
 
-  pthread_mutex_init(&i2c1_thread.mutex, NULL);
-  pthread_cond_init(&i2c1_thread.condition, NULL);
   i2c1.init_struct = (void *)(&i2c1_thread);
 
   i2c_arch_init(&i2c1);
@@ -268,8 +515,6 @@ void i2c2_hw_init(void)
   /* zeros error counter */
   ZEROS_ERR_COUNTER(i2c2_errors);
 
-  pthread_mutex_init(&i2c2_thread.mutex, NULL);
-  pthread_cond_init(&i2c2_thread.condition, NULL);
   i2c2.init_struct = (void *)(&i2c2_thread);
 
   i2c_arch_init(&i2c2);
@@ -292,8 +537,6 @@ void i2c3_hw_init(void)
   /* zeros error counter */
   ZEROS_ERR_COUNTER(i2c3_errors);
 
-  pthread_mutex_init(&i2c3_thread.mutex, NULL);
-  pthread_cond_init(&i2c3_thread.condition, NULL);
   i2c3.init_struct = (void *)(&i2c3_thread);
 
   i2c_arch_init(&i2c3);
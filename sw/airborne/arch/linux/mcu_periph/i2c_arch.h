@@ -28,6 +28,47 @@
 #ifndef LINUX_MCU_PERIPH_I2C_ARCH_H
 #define LINUX_MCU_PERIPH_I2C_ARCH_H
 
+#include "std.h"
+
+/** Deeper transaction queue than on MCUs, must be a power of 2 */
+#ifndef I2C_TRANSACTION_QUEUE_LEN
+#define I2C_TRANSACTION_QUEUE_LEN 32
+#endif
+
+struct i2c_periph;
+struct i2c_transaction;
+
+/** Completion callback, called from i2c_event() in the main loop */
+typedef void (*i2c_linux_callback)(struct i2c_transaction *t, void *data);
+
+/** Per bus statistics */
+struct i2c_linux_stats {
+  uint32_t nb_trans;        ///< number of finished transactions
+  uint32_t nb_failed;       ///< number of failed transactions
+  uint32_t nb_ioctl;        ///< number of transfers with the kernel
+  uint32_t nb_batched;      ///< number of transactions sent in a batch
+  uint32_t nb_cb_dropped;   ///< number of callbacks dropped because the completion queue was full
+  uint64_t busy_ns;         ///< total time spent in transfers
+  float utilization;        ///< ratio of time spent in transfers over the last second
+};
+
+/** Submit a transaction with a completion callback.
+ * Can be called from any thread, the callback is called
+ * from the main loop when the transaction is finished.
+ * @param p i2c peripheral to be used
+ * @param t i2c transaction
+ * @param cb completion callback (or NULL)
+ * @param data user data passed to the callback
+ * @return TRUE if insertion to the transaction queue succeeded
+ */
+extern bool i2c_linux_submit_cb(struct i2c_periph *p, struct i2c_transaction *t, i2c_linux_callback cb, void *data);
+
+/** Get bus statistics
+ * @param p i2c peripheral
+ * @param stats output statistics
+ */
+extern void i2c_linux_get_stats(struct i2c_periph *p, struct i2c_linux_stats *stats);
+
 #if USE_I2C0
 extern void i2c0_hw_init(void);
 #endif /* USE_I2C0 */
@@ -28,13 +28,63 @@
 #include <stdlib.h>
 #include <fcntl.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
 
 #include <sys/ioctl.h>
 #include <linux/spi/spidev.h>
 
 #include "mcu_periph/spi.h"
+#include "rt_priority.h"
 #include BOARD_CONFIG
 
+#ifndef SPI_THREAD_PRIO
+#define SPI_THREAD_PRIO 10
+#endif
+
+/** Max number of transactions sent in a single SPI_IOC_MESSAGE */
+#ifndef SPI_LINUX_BATCH_SIZE
+#define SPI_LINUX_BATCH_SIZE 8
+#endif
+
+/** Max number of bytes in a single SPI_IOC_MESSAGE
+ * should not be larger than the bufsiz parameter of the spidev kernel module
+ */
+#ifndef SPI_LINUX_MAX_MSG_LEN
+#define SPI_LINUX_MAX_MSG_LEN 4096
+#endif
+
+/** Private structure of a SPI bus */
+struct spi_linux_bus {
+  int fd;
+  uint32_t speed_hz;
+  bool async;                           ///< transactions are handled by the bus thread
+  pthread_mutex_t mutex;
+  pthread_cond_t condition;
+  uint8_t tx_zero[SPI_LINUX_MAX_MSG_LEN];     ///< zeros sent when output is shorter than input
+  uint8_t rx_scratch[SPI_LINUX_MAX_MSG_LEN];  ///< received bytes when input is shorter than output
+  struct spi_linux_stats stats;
+};
+
+static uint64_t spi_linux_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void spi_linux_account(struct spi_linux_bus *bus, uint64_t start, uint32_t nb_trans, uint32_t nb_bytes)
+{
+  uint32_t dt = (uint32_t)((spi_linux_now() - start) / 1000);
+  bus->stats.nb_trans += nb_trans;
+  bus->stats.nb_ioctl++;
+  bus->stats.nb_bytes += nb_bytes;
+  bus->stats.last_time_us = dt;
+  bus->stats.sum_time_us += dt;
+  if (dt > bus->stats.max_time_us) {
+    bus->stats.max_time_us = dt;
+  }
+}
 
 void spi_init_slaves(void)
 {
@@ -45,9 +95,9 @@ void spi_init_slaves(void)
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-qual"
-bool spi_submit(struct spi_periph *p, struct spi_transaction *t)
+static bool spi_linux_transfer(struct spi_periph *p, struct spi_transaction *t)
 {
-  int fd = (int)p->reg_addr;
+  struct spi_linux_bus *bus = (struct spi_linux_bus *)p->init_struct;
 
   struct spi_ioc_transfer xfer;
   memset(&xfer, 0, sizeof xfer);
@@ -77,7 +127,7 @@ bool spi_submit(struct spi_periph *p, struct spi_transaction *t)
 
   xfer.len = buf_len;
   /* fixed speed of 1Mhz for now, use SPIClockDiv?? */
-  xfer.speed_hz = (uint32_t)p->init_struct;
+  xfer.speed_hz = bus->speed_hz;
   xfer.delay_usecs = 0;
   if (t->dss == SPIDss16bit) {
     xfer.bits_per_word = 16;
@@ -88,10 +138,13 @@ bool spi_submit(struct spi_periph *p, struct spi_transaction *t)
     xfer.cs_change = 1;
   }
 
-  if (ioctl(fd, SPI_IOC_MESSAGE(1), &xfer) < 0) {
+  uint64_t start = spi_linux_now();
+  if (ioctl(bus->fd, SPI_IOC_MESSAGE(1), &xfer) < 0) {
+    bus->stats.nb_failed++;
     t->status = SPITransFailed;
     return false;
   }
+  spi_linux_account(bus, start, 1, buf_len);
 
   /* copy received data if we had to use an extra rx_buffer */
   if (buf_len > t->input_length) {
@@ -101,8 +154,201 @@ bool spi_submit(struct spi_periph *p, struct spi_transaction *t)
   t->status = SPITransSuccess;
   return true;
 }
+
+/**
+ * Send several transactions in a single SPI_IOC_MESSAGE.
+ * Input buffers are used directly when possible (e.g. IMU FIFO burst reads),
+ * zeros are sent from a static buffer when output is shorter than input
+ * and received bytes are discarded in a static buffer when input is shorter than output.
+ * Chip select is released between transactions that end with an unselect.
+ */
+static void spi_linux_transfer_batch(struct spi_periph *p, struct spi_transaction **trans, uint8_t nb)
+{
+  struct spi_linux_bus *bus = (struct spi_linux_bus *)p->init_struct;
+  struct spi_ioc_transfer xfer[2 * SPI_LINUX_BATCH_SIZE];
+  uint8_t nb_xfer = 0;
+  uint32_t nb_bytes = 0;
+  memset(xfer, 0, sizeof(xfer));
+
+  for (uint8_t i = 0; i < nb; i++) {
+    struct spi_transaction *t = trans[i];
+    uint16_t common = Min(t->input_length, t->output_length);
+    uint16_t buf_len = Max(t->input_length, t->output_length);
+    uint8_t bits = (t->dss == SPIDss16bit) ? 16 : 8;
+    uint8_t first = nb_xfer;
+
+    if (common > 0) {
+      // full duplex part
+      xfer[nb_xfer].tx_buf = (unsigned long)t->output_buf;
+      xfer[nb_xfer].rx_buf = (unsigned long)t->input_buf;
+      xfer[nb_xfer].len = common;
+      nb_xfer++;
+    }
+    if (buf_len > common) {
+      // remaining bytes in one direction only
+      if (t->input_length > common) {
+        xfer[nb_xfer].tx_buf = (unsigned long)bus->tx_zero;
+        xfer[nb_xfer].rx_buf = (unsigned long)(t->input_buf + common);
+      } else {
+        xfer[nb_xfer].tx_buf = (unsigned long)(t->output_buf + common);
+        xfer[nb_xfer].rx_buf = (unsigned long)bus->rx_scratch;
+      }
+      xfer[nb_xfer].len = buf_len - common;
+      nb_xfer++;
+    }
+    for (uint8_t j = first; j < nb_xfer; j++) {
+      xfer[j].speed_hz = bus->speed_hz;
+      xfer[j].bits_per_word = bits;
+    }
+    if (nb_xfer > first) {
+      // last transfer of the transaction: release CS before next transaction if needed,
+      // same behavior as a single transfer for the last one
+      if (t->select == SPISelectUnselect || t->select == SPIUnselect) {
+        xfer[nb_xfer - 1].cs_change = 1;
+      }
+    }
+    nb_bytes += buf_len;
+  }
+
+  uint64_t start = spi_linux_now();
+  int ret = ioctl(bus->fd, SPI_IOC_MESSAGE(nb_xfer), xfer);
+  if (ret < 0) {
+    bus->stats.nb_failed++;
+  } else {
+    spi_linux_account(bus, start, nb, nb_bytes);
+    bus->stats.nb_batched += nb;
+  }
+
+  for (uint8_t i = 0; i < nb; i++) {
+    trans[i]->status = (ret < 0) ? SPITransFailed : SPITransSuccess;
+    if (trans[i]->after_cb != 0) {
+      trans[i]->after_cb(trans[i]);
+    }
+  }
+}
 #pragma GCC diagnostic pop
 
+/*
+ * Asynchronous transactions handler thread
+ * get all queued transactions that fit in one message and send them with a single ioctl
+ */
+static void *spi_thread(void *data)
+{
+  struct spi_periph *p = (struct spi_periph *)data;
+  struct spi_linux_bus *bus = (struct spi_linux_bus *)p->init_struct;
+  struct spi_transaction *batch[SPI_LINUX_BATCH_SIZE];
+
+  get_rt_prio(SPI_THREAD_PRIO);
+
+  while (1) {
+    /* wait for transactions */
+    pthread_mutex_lock(&bus->mutex);
+    while (p->trans_insert_idx == p->trans_extract_idx) {
+      pthread_cond_wait(&bus->condition, &bus->mutex);
+    }
+    uint8_t nb = 0;
+    uint32_t len = 0;
+    uint8_t idx = p->trans_extract_idx;
+    while (idx != p->trans_insert_idx && nb < SPI_LINUX_BATCH_SIZE) {
+      struct spi_transaction *t = p->trans[idx];
+      uint16_t buf_len = Max(t->input_length, t->output_length);
+      if (nb > 0 && len + buf_len > SPI_LINUX_MAX_MSG_LEN) {
+        break;
+      }
+      batch[nb++] = t;
+      len += buf_len;
+      idx = (idx + 1) % SPI_TRANSACTION_QUEUE_LEN;
+    }
+    pthread_mutex_unlock(&bus->mutex);
+
+    for (uint8_t i = 0; i < nb; i++) {
+      batch[i]->status = SPITransRunning;
+      if (batch[i]->before_cb != 0) {
+        batch[i]->before_cb(batch[i]);
+      }
+    }
+    if (nb == 1 && len > SPI_LINUX_MAX_MSG_LEN) {
+      // too large for the static buffers
+      spi_linux_transfer(p, batch[0]);
+      if (batch[0]->after_cb != 0) {
+        batch[0]->after_cb(batch[0]);
+      }
+    } else {
+      spi_linux_transfer_batch(p, batch, nb);
+    }
+
+    /* free slots only when done, so that transactions stay valid in queue */
+    pthread_mutex_lock(&bus->mutex);
+    p->trans_extract_idx = idx;
+    pthread_mutex_unlock(&bus->mutex);
+  }
+  return NULL;
+}
+
+bool spi_submit(struct spi_periph *p, struct spi_transaction *t)
+{
+  struct spi_linux_bus *bus = (struct spi_linux_bus *)p->init_struct;
+  if (bus == NULL) {
+    t->status = SPITransFailed;
+    return false;
+  }
+
+  if (!bus->async) {
+    return spi_linux_transfer(p, t);
+  }
+
+  pthread_mutex_lock(&bus->mutex);
+  uint8_t next_idx = (p->trans_insert_idx + 1) % SPI_TRANSACTION_QUEUE_LEN;
+  if (next_idx == p->trans_extract_idx) {
+    // queue full
+    bus->stats.nb_queue_full++;
+    t->status = SPITransFailed;
+    pthread_mutex_unlock(&bus->mutex);
+    return false;
+  }
+  t->status = SPITransPending;
+  p->trans[p->trans_insert_idx] = t;
+  p->trans_insert_idx = next_idx;
+  pthread_cond_signal(&bus->condition);
+  pthread_mutex_unlock(&bus->mutex);
+  return true;
+}
+
+void spi_linux_get_stats(struct spi_periph *p, struct spi_linux_stats *stats)
+{
+  struct spi_linux_bus *bus = (struct spi_linux_bus *)p->init_struct;
+  if (bus != NULL) {
+    memcpy(stats, &bus->stats, sizeof(struct spi_linux_stats));
+  }
+}
+
+/*
+ * Common bus initialization, start the bus thread in asynchronous mode
+ */
+static void spi_linux_bus_init(struct spi_periph *p, struct spi_linux_bus *bus, int fd, uint32_t speed, bool async)
+{
+  bus->fd = fd;
+  bus->speed_hz = speed;
+  bus->async = async;
+  memset(bus->tx_zero, 0, sizeof(bus->tx_zero));
+  memset(&bus->stats, 0, sizeof(bus->stats));
+  pthread_mutex_init(&bus->mutex, NULL);
+  pthread_cond_init(&bus->condition, NULL);
+  p->init_struct = (void *)bus;
+
+  if (async) {
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, spi_thread, (void *)p) != 0) {
+      fprintf(stderr, "spi_linux_bus_init: Could not create SPI thread, using synchronous mode.\n");
+      bus->async = false;
+      return;
+    }
+#ifndef __APPLE__
+    pthread_setname_np(tid, "spi");
+#endif
+  }
+}
+
 bool spi_lock(struct spi_periph *p, uint8_t slave)
 {
   // not implemented
@@ -134,6 +380,13 @@ bool spi_resume(struct spi_periph *p, uint8_t slave)
 #define SPI0_MAX_SPEED_HZ 1000000
 #endif
 
+/** Use bus thread to send transactions asynchronously and in batches */
+#ifndef SPI0_ASYNC
+#define SPI0_ASYNC FALSE
+#endif
+
+static struct spi_linux_bus spi0_bus;
+
 void spi0_arch_init(void)
 {
   int fd = open("/dev/spidev1.0", O_RDWR);
@@ -141,6 +394,7 @@ void spi0_arch_init(void)
   if (fd < 0) {
     perror("Could not open SPI device /dev/spidev1.0");
     spi0.reg_addr = NULL;
+    spi0.init_struct = NULL;
     return;
   }
   spi0.reg_addr = (void *)fd;
@@ -168,7 +422,7 @@ void spi0_arch_init(void)
   if (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &spi_speed) < 0) {
     perror("SPI0: can't set max speed hz");
   }
-  spi0.init_struct = (void *)SPI0_MAX_SPEED_HZ;
+  spi_linux_bus_init(&spi0, &spi0_bus, fd, SPI0_MAX_SPEED_HZ, SPI0_ASYNC);
 }
 #endif /* USE_SPI0 */
 
@@ -190,6 +444,13 @@ void spi0_arch_init(void)
 #define SPI1_MAX_SPEED_HZ 1000000
 #endif
 
+/** Use bus thread to send transactions asynchronously and in batches */
+#ifndef SPI1_ASYNC
+#define SPI1_ASYNC FALSE
+#endif
+
+static struct spi_linux_bus spi1_bus;
+
 void spi1_arch_init(void)
 {
   int fd = open("/dev/spidev1.1", O_RDWR);
@@ -197,6 +458,7 @@ void spi1_arch_init(void)
   if (fd < 0) {
     perror("Could not open SPI device /dev/spidev1.1");
     spi1.reg_addr = NULL;
+    spi1.init_struct = NULL;
     return;
   }
   spi1.reg_addr = (void *)fd;
@@ -215,7 +477,7 @@ void spi1_arch_init(void)
 
   /* bits per word default to 8 */
   unsigned char spi_bits_per_word = SPI1_BITS_PER_WORD;
-  if (ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &spi_bits_per_word) < 0) {r
+  if (ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &spi_bits_per_word) < 0) {
     perror("SPI1: can't set bits per word");
   }
 
@@ -224,6 +486,6 @@ void spi1_arch_init(void)
   if (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &spi_speed) < 0) {
     perror("SPI1: can't set max speed hz");
   }
-  spi1.init_struct = (void *)SPI1_MAX_SPEED_HZ;
+  spi_linux_bus_init(&spi1, &spi1_bus, fd, SPI1_MAX_SPEED_HZ, SPI1_ASYNC);
 }
 #endif /* USE_SPI1 */
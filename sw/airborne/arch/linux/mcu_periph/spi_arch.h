@@ -26,5 +26,33 @@
 #ifndef SPI_ARCH_H
 #define SPI_ARCH_H
 
+#include "std.h"
+
+/** Deeper transaction queue for asynchronous mode */
+#ifndef SPI_TRANSACTION_QUEUE_LEN
+#define SPI_TRANSACTION_QUEUE_LEN 16
+#endif
+
+struct spi_periph;
+
+/** Per bus statistics */
+struct spi_linux_stats {
+  uint32_t nb_trans;        ///< number of successful transactions
+  uint32_t nb_failed;       ///< number of failed transfers
+  uint32_t nb_ioctl;        ///< number of successful transfers with the kernel
+  uint32_t nb_batched;      ///< number of transactions sent by the bus thread
+  uint32_t nb_queue_full;   ///< number of transactions rejected because the queue was full
+  uint32_t nb_bytes;        ///< number of bytes exchanged
+  uint32_t last_time_us;    ///< duration of the last transfer
+  uint32_t max_time_us;     ///< max duration of a transfer
+  uint64_t sum_time_us;     ///< total time spent in transfers
+};
+
+/** Get bus statistics
+ * @param p spi peripheral
+ * @param stats output statistics
+ */
+extern void spi_linux_get_stats(struct spi_periph *p, struct spi_linux_stats *stats);
+
 
 #endif // SPI_ARCH_H
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file "arch/linux/modules/core/task_profiler_arch.h"
+ * Cycle counter for the task profiler.
+ * Uses the monotonic clock of the host, one tick is one nanosecond.
+ */
+
+#ifndef TASK_PROFILER_ARCH_H
+#define TASK_PROFILER_ARCH_H
+
+#include "std.h"
+#include <time.h>
+
+#define TASK_PROFILER_TICKS_PER_USEC 1000.f
+
+static inline void task_profiler_arch_init(void) {}
+
+/** Get current tick counter (wraps every ~4.3 s) */
+static inline uint32_t task_profiler_arch_ticks(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+#endif /* TASK_PROFILER_ARCH_H */
+
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file "arch/stm32/modules/core/task_profiler_arch.h"
+ * Cycle counter for the task profiler.
+ * Uses the DWT cycle counter of the Cortex-M3/M4/M7 core, one tick is one CPU cycle.
+ */
+
+#ifndef TASK_PROFILER_ARCH_H
+#define TASK_PROFILER_ARCH_H
+
+#include "std.h"
+#include BOARD_CONFIG
+#include <libopencm3/cm3/dwt.h>
+
+#define TASK_PROFILER_TICKS_PER_USEC ((float)AHB_CLK / 1e6f)
+
+static inline void task_profiler_arch_init(void)
+{
+  dwt_enable_cycle_counter();
+}
+
+/** Get current CPU cycle counter */
+static inline uint32_t task_profiler_arch_ticks(void)
+{
+  return dwt_read_cycle_counter();
+}
+
+#endif /* TASK_PROFILER_ARCH_H */
+
@@ -242,6 +242,10 @@ void handle_periodic_tasks_ap(void)
 #if USE_GENERATED_AUTOPILOT
   if (sys_time_check_and_ack_timer(attitude_tid)) {
     autopilot_periodic();
+#if USE_STATE_SNAPSHOT
+    /* publish state for other threads */
+    stateSnapshotPublish();
+#endif
   }
 #else
   // static autopilot
@@ -252,6 +256,10 @@ void handle_periodic_tasks_ap(void)
 #ifndef AHRS_TRIGGERED_ATTITUDE_LOOP
   if (sys_time_check_and_ack_timer(attitude_tid)) {
     attitude_loop();
+#if USE_STATE_SNAPSHOT
+    /* publish state for other threads */
+    stateSnapshotPublish();
+#endif
   }
 #endif
 
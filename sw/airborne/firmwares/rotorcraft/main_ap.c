@@ -246,6 +246,11 @@ void main_periodic(void)
   /* set actuators     */
   //actuators_set(autopilot_get_motors_on());
 
+#if USE_STATE_SNAPSHOT
+  /* publish state for other threads */
+  stateSnapshotPublish();
+#endif
+
 #if USE_THROTTLE_CURVES
   throttle_curve_run(commands, autopilot_get_mode());
 #endif
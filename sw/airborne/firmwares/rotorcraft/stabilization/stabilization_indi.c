@@ -55,6 +55,11 @@ float indi_v[INDI_OUTPUTS];
 float *Bwls[INDI_OUTPUTS];
 int num_iter = 0;
 
+#if STABILIZATION_INDI_ALLOCATION_WARM_START
+/** Working set of the last allocation, -1 at min, 1 at max, 0 free */
+static float wls_working_set[INDI_NUM_ACT];
+#endif
+
 static void lms_estimation(void);
 static void get_actuator_state(void);
 static void calc_g1_element(float dx_error, int8_t i, int8_t j, float mu_extra);
@@ -436,8 +441,14 @@ void stabilization_indi_rate_run(struct FloatRates rate_sp, bool in_flight)
   }
 
   // WLS Control Allocator
+#if STABILIZATION_INDI_ALLOCATION_WARM_START
+  // start from the previous increment and saturations
+  num_iter =
+    wls_alloc_warm(indi_du, indi_v, du_min, du_max, Bwls, wls_working_set, Wv, 0, du_pref, 10000, 10);
+#else
   num_iter =
     wls_alloc(indi_du, indi_v, du_min, du_max, Bwls, 0, 0, Wv, 0, du_pref, 10000, 10);
+#endif
 #endif
 
   // Add the increments to the actuators
@@ -456,6 +467,9 @@ void stabilization_indi_rate_run(struct FloatRates rate_sp, bool in_flight)
   if (!in_flight) {
     float_vect_zero(indi_u, INDI_NUM_ACT);
     float_vect_zero(indi_du, INDI_NUM_ACT);
+#if STABILIZATION_INDI_ALLOCATION_WARM_START
+    float_vect_zero(wls_working_set, INDI_NUM_ACT);
+#endif
   }
 
   // Propagate actuator filters
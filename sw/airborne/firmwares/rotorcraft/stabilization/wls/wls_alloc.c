@@ -314,6 +314,246 @@ int wls_alloc(float* u, float* v, float* umin, float* umax, float** B,
   return -1;
 }
 
+/**
+ * QR factorization of the free columns of A, updated incrementally.
+ * Q is kept explicitly (n_c x n_c), column k of R corresponds to
+ * the control free_index[k].
+ */
+struct wls_qr {
+  float Q[CA_N_C][CA_N_C];
+  float R[CA_N_C][CA_N_U];
+  int free_index[CA_N_U];
+  int n_free;
+};
+
+/** Apply a Givens rotation on rows i and k of R (columns from j0) and columns i and k of Q
+ * such that R[k][j0] becomes zero
+ */
+static void wls_qr_givens(struct wls_qr *qr, float *x, float *y, int i, int k, int j0, int n_cols)
+{
+  float a = *x, b = *y;
+  if (fabsf(b) < FLT_MIN) {
+    return;
+  }
+  float r = hypotf(a, b);
+  float c = a / r, s = b / r;
+  for (int j = j0; j < n_cols; j++) {
+    float ri = qr->R[i][j], rk = qr->R[k][j];
+    qr->R[i][j] = c * ri + s * rk;
+    qr->R[k][j] = -s * ri + c * rk;
+  }
+  for (int l = 0; l < CA_N_C; l++) {
+    float qi = qr->Q[l][i], qk = qr->Q[l][k];
+    qr->Q[l][i] = c * qi + s * qk;
+    qr->Q[l][k] = -s * qi + c * qk;
+  }
+  *x = r;
+  *y = 0.f;
+}
+
+/** Add control id as last free column */
+static void wls_qr_add(struct wls_qr *qr, float A[CA_N_C][CA_N_U], int id)
+{
+  int n = qr->n_free;
+  // w = Q' * a, stored in column n of R
+  for (int i = 0; i < CA_N_C; i++) {
+    float w = 0.f;
+    for (int l = 0; l < CA_N_C; l++) {
+      w += qr->Q[l][i] * A[l][id];
+    }
+    qr->R[i][n] = w;
+  }
+  // zero column n below the diagonal, bottom up
+  for (int k = CA_N_C - 1; k > n; k--) {
+    wls_qr_givens(qr, &qr->R[k - 1][n], &qr->R[k][n], k - 1, k, n + 1, n + 1);
+  }
+  qr->free_index[n] = id;
+  qr->n_free++;
+}
+
+/** Remove free column at position pos */
+static void wls_qr_remove(struct wls_qr *qr, int pos)
+{
+  int n = --qr->n_free;
+  // shift the next columns left, R becomes upper Hessenberg from pos
+  for (int j = pos; j < n; j++) {
+    qr->free_index[j] = qr->free_index[j + 1];
+    for (int i = 0; i <= j + 1; i++) {
+      qr->R[i][j] = qr->R[i][j + 1];
+    }
+  }
+  // restore the triangular form
+  for (int k = pos; k < n; k++) {
+    wls_qr_givens(qr, &qr->R[k][k], &qr->R[k + 1][k], k, k + 1, k + 1, n);
+  }
+}
+
+/** Least squares solution of A_free * p_free = d */
+static void wls_qr_solve(struct wls_qr *qr, float *d, float *p_free)
+{
+  int n = qr->n_free;
+  float c[CA_N_U];
+  for (int i = 0; i < n; i++) {
+    c[i] = 0.f;
+    for (int l = 0; l < CA_N_C; l++) {
+      c[i] += qr->Q[l][i] * d[l];
+    }
+  }
+  for (int i = n - 1; i >= 0; i--) {
+    float s = c[i];
+    for (int j = i + 1; j < n; j++) {
+      s -= qr->R[i][j] * p_free[j];
+    }
+    p_free[i] = s / qr->R[i][i];
+  }
+}
+
+int wls_alloc_warm(float* u, float* v, float* umin, float* umax, float** B,
+                   float* W, float* Wv, float* Wu, float* up,
+                   float gamma_sq, int imax) {
+  // allocate variables, use defaults where parameters are set to 0
+  if(!gamma_sq) gamma_sq = 100000;
+  if(!imax) imax = 100;
+
+  int n_c = CA_N_C;
+  int n_u = CA_N_U;
+  int n_v = CA_N_V;
+
+  float A[CA_N_C][CA_N_U];
+  float d[CA_N_C];
+  float p_free[CA_N_U];
+  float lambda[CA_N_U];
+  struct wls_qr qr;
+  int iter = 0;
+
+  // start from the working set, controls in the working set are at their bound
+  for (int i = 0; i < n_u; i++) {
+    if (W[i] > 0.5f) {
+      W[i] = 1.f;
+      u[i] = umax[i];
+    } else if (W[i] < -0.5f) {
+      W[i] = -1.f;
+      u[i] = umin[i];
+    } else {
+      W[i] = 0.f;
+      Bound(u[i], umin[i], umax[i]);
+    }
+  }
+
+  // fill up A and d = b - A*u
+  for (int i = 0; i < n_v; i++) {
+    // If Wv is a NULL pointer, use Wv = identity
+    d[i] = Wv ? gamma_sq * Wv[i] * v[i] : gamma_sq * v[i];
+    for (int j = 0; j < n_u; j++) {
+      A[i][j] = Wv ? gamma_sq * Wv[i] * B[i][j] : gamma_sq * B[i][j];
+      d[i] -= A[i][j] * u[j];
+    }
+  }
+  for (int i = n_v; i < n_c; i++) {
+    memset(A[i], 0, n_u * sizeof(float));
+    A[i][i - n_v] = Wu ? Wu[i - n_v] : 1.0;
+    d[i] = up ? (Wu ? Wu[i-n_v] * up[i-n_v] : up[i-n_v]) : 0;
+    d[i] -= A[i][i - n_v] * u[i - n_v];
+  }
+
+  // QR factorization of the free columns
+  memset(qr.Q, 0, sizeof(qr.Q));
+  for (int i = 0; i < n_c; i++) {
+    qr.Q[i][i] = 1.f;
+  }
+  qr.n_free = 0;
+  for (int i = 0; i < n_u; i++) {
+    if (W[i] == 0) {
+      wls_qr_add(&qr, A, i);
+    }
+  }
+
+  // -------------- Start loop ------------
+  while (iter++ < imax) {
+    int n_free = qr.n_free;
+    if (n_free) {
+      wls_qr_solve(&qr, d, p_free);
+    }
+
+    // check limits
+    bool feasible = true;
+    for (int k = 0; k < n_free; k++) {
+      int i = qr.free_index[k];
+      float u_opt = u[i] + p_free[k];
+      if (u_opt >= (umax[i] + 1.0) || u_opt <= (umin[i] - 1.0)) {
+        feasible = false;
+        break;
+      }
+    }
+
+    if (feasible) {
+      // u = u + p, d = d - A_free*p_free
+      for (int k = 0; k < n_free; k++) {
+        int id = qr.free_index[k];
+        u[id] += p_free[k];
+        for (int i = 0; i < n_c; i++) {
+          d[i] -= A[i][id] * p_free[k];
+        }
+      }
+      // lambda = W x A'*d, only for the controls in the working set
+      int id_lambda = -1;
+      float lambda_min = -FLT_EPSILON;
+      for (int j = 0; j < n_u; j++) {
+        lambda[j] = 0.f;
+        if (W[j] != 0) {
+          for (int i = 0; i < n_c; i++) {
+            lambda[j] += A[i][j] * d[i];
+          }
+          lambda[j] *= W[j];
+          if (lambda[j] < lambda_min) {
+            lambda_min = lambda[j];
+            id_lambda = j;
+          }
+        }
+      }
+      if (id_lambda < 0) {
+        // optimal, return number of iterations
+        return iter;
+      }
+      // free the control with the most negative multiplier
+      W[id_lambda] = 0;
+      wls_qr_add(&qr, A, id_lambda);
+    } else {
+      float alpha = INFINITY;
+      int pos_alpha = 0;
+
+      // find the lowest distance from the limit among the free variables
+      for (int k = 0; k < n_free; k++) {
+        int id = qr.free_index[k];
+        float alpha_tmp = INFINITY;
+        if (fabsf(p_free[k]) > FLT_EPSILON) {
+          alpha_tmp = (p_free[k] < 0) ? (umin[id] - u[id]) / p_free[k]
+                      : (umax[id] - u[id]) / p_free[k];
+        }
+        if (alpha_tmp < alpha) {
+          alpha = alpha_tmp;
+          pos_alpha = k;
+        }
+      }
+
+      // update input u = u + alpha*p and d = d - alpha*A_free*p_free
+      for (int k = 0; k < n_free; k++) {
+        int id = qr.free_index[k];
+        u[id] += alpha * p_free[k];
+        for (int i = 0; i < n_c; i++) {
+          d[i] -= A[i][id] * alpha * p_free[k];
+        }
+      }
+      // the blocking control enters the working set at its bound
+      int id_alpha = qr.free_index[pos_alpha];
+      W[id_alpha] = (p_free[pos_alpha] > 0) ? 1.0 : -1.0;
+      wls_qr_remove(&qr, pos_alpha);
+    }
+  }
+  // solution failed, return negative one to indicate failure
+  return -1;
+}
+
 #if WLS_VERBOSE
 void print_in_and_outputs(int n_c, int n_free, float** A_free_ptr, float* d, float* p_free) {
 
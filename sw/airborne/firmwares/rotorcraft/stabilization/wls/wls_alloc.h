@@ -59,3 +59,34 @@ void qr_solve_wrapper(int m, int n, float** A, float* b, float* x);
 int wls_alloc(float* u, float* v, float* umin, float* umax, float** B,
               float* u_guess, float* W_init, float* Wv, float* Wu,
               float* ud, float gamma, int imax);
+
+/**
+ * @brief warm started active set algorithm for control allocation
+ *
+ * Solves the same problem as wls_alloc, starting from the working set of
+ * the previous call. The QR factorization of the free columns is kept
+ * during the iterations and updated with Givens rotations when a control
+ * enters or leaves the working set, instead of being recomputed.
+ * When the saturations don't change between cycles, the solution is
+ * usually found in one iteration.
+ *
+ * @param u The control output vector, the input values are used as initial
+ * guess for the free controls (bounded by umin and umax)
+ * @param v The control objective
+ * @param umin The minimum u vector
+ * @param umax The maximum u vector
+ * @param B The control effectiveness matrix
+ * @param W Working set (-1 at umin, 1 at umax, 0 free), input from the previous
+ * call (all zeros to start cold), output for the next one
+ * @param Wv Weighting on different control objectives
+ * @param Wu Weighting on different controls
+ * @param up Preferred control vector
+ * @param gamma_sq Preference of satisfying control objective over desired
+ * control vector (sqare root of gamma)
+ * @param imax Max number of iterations
+ *
+ * @return Number of iterations, -1 upon failure
+ */
+int wls_alloc_warm(float* u, float* v, float* umin, float* umax, float** B,
+                   float* W, float* Wv, float* Wu, float* up,
+                   float gamma_sq, int imax);
@@ -227,6 +227,10 @@ void main_periodic(void)
   autopilot_periodic();
   /* set actuators     */
   //actuators_set(autopilot_get_motors_on());
+#if USE_STATE_SNAPSHOT
+  /* publish state for other threads */
+  stateSnapshotPublish();
+#endif
   SetActuatorsFromCommands(commands, autopilot_get_mode());
 
   if (autopilot_in_flight()) {
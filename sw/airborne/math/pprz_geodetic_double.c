@@ -333,3 +333,212 @@ void lla_of_utm_d(struct LlaCoor_d *lla, struct UtmCoor_d *utm)
   // copy alt above reference ellipsoid
   lla->alt = utm->alt;
 }
+
+
+/*******************************************************************************
+ * Batch conversions
+ *
+ * Same conversions as the single point functions, for arrays of points in a
+ * structure of arrays layout. The constants and the local frame terms are
+ * computed once per call instead of once per point. The loops still call
+ * the math library per element (sqrt, cbrt, atan2, ...).
+ ******************************************************************************/
+
+void lla_of_ecef_points_d(struct LlaArray_d *lla, struct Vect3Array_d *ecef, int n)
+{
+  static const double a = 6378137.0;           /* earth semimajor axis in meters */
+  static const double f = 1. / 298.257223563;  /* reciprocal flattening          */
+  const double b = a * (1. - f);               /* semi-minor axis                */
+  const double b2 = b * b;
+  const double e2 = 2.*f - (f * f);            /* first eccentricity squared     */
+  const double ep2 = f * (2. - f) / ((1. - f) * (1. - f)); /* second eccentricity squared    */
+  const double E2 = a * a - b2;
+  const double e4 = e2 * e2;
+  const double a2_2 = a * a / 2.;
+  const double b2_a = b2 / a;
+
+  const double *restrict x = ecef->x;
+  const double *restrict y = ecef->y;
+  const double *restrict z = ecef->z;
+  double *restrict lat = lla->lat;
+  double *restrict lon = lla->lon;
+  double *restrict alt = lla->alt;
+
+  int i;
+  for (i = 0; i < n; i++) {
+    const double z2 = z[i] * z[i];
+    const double r2 = x[i] * x[i] + y[i] * y[i];
+    const double r = sqrt(r2);
+    const double F = 54.*b2 * z2;
+    const double G = r2 + (1 - e2) * z2 - e2 * E2;
+    const double c = (e4 * F * r2) / (G * G * G);
+    const double s = cbrt(1 + c + sqrt(c * c + 2 * c));
+    const double s1 = 1 + s + 1 / s;
+    const double P = F / (3 * s1 * s1 * G * G);
+    const double Q = sqrt(1 + 2 * e4 * P);
+    const double ro = -(e2 * P * r) / (1 + Q) + sqrt(a2_2 * (1 + 1 / Q) - ((1 - e2) * P * z2) / (Q * (1 + Q)) - P * r2 / 2);
+    const double tmp = (r - e2 * ro) * (r - e2 * ro);
+    const double U = sqrt(tmp + z2);
+    const double V = sqrt(tmp + (1 - e2) * z2);
+    const double zo = (b2_a * z[i]) / V;
+
+    alt[i] = U * (1 - b2_a / V);
+    lat[i] = atan2(z[i] + ep2 * zo, r);
+    lon[i] = atan2(y[i], x[i]);
+  }
+}
+
+void ecef_of_lla_points_d(struct Vect3Array_d *ecef, struct LlaArray_d *lla, int n)
+{
+  static const double a = 6378137.0;           /* earth semimajor axis in meters */
+  static const double f = 1. / 298.257223563;  /* reciprocal flattening          */
+  const double e2 = 2.*f - (f * f);            /* first eccentricity squared     */
+
+  const double *restrict lat = lla->lat;
+  const double *restrict lon = lla->lon;
+  const double *restrict alt = lla->alt;
+  double *restrict x = ecef->x;
+  double *restrict y = ecef->y;
+  double *restrict z = ecef->z;
+
+  int i;
+  for (i = 0; i < n; i++) {
+    const double sin_lat = sin(lat[i]);
+    const double cos_lat = cos(lat[i]);
+    const double sin_lon = sin(lon[i]);
+    const double cos_lon = cos(lon[i]);
+    const double a_chi = a / sqrt(1. - e2 * sin_lat * sin_lat);
+    const double rc = (a_chi + alt[i]) * cos_lat;
+    x[i] = rc * cos_lon;
+    y[i] = rc * sin_lon;
+    z[i] = (a_chi * (1. - e2) + alt[i]) * sin_lat;
+  }
+}
+
+/** rotation to local frame, sign of the third row (1 for ENU, -1 for NED) */
+static inline void ltp_of_ecef_points_d(struct Vect3Array_d *ltp, struct LtpDef_d *def,
+    struct Vect3Array_d *ecef, int n, double up)
+{
+  /* third element of the first row is always zero */
+  const double m0 = def->ltp_of_ecef.m[0], m1 = def->ltp_of_ecef.m[1];
+  const double m3 = def->ltp_of_ecef.m[3], m4 = def->ltp_of_ecef.m[4], m5 = def->ltp_of_ecef.m[5];
+  const double m6 = up * def->ltp_of_ecef.m[6], m7 = up * def->ltp_of_ecef.m[7], m8 = up * def->ltp_of_ecef.m[8];
+  const double x0 = def->ecef.x, y0 = def->ecef.y, z0 = def->ecef.z;
+
+  const double *restrict x = ecef->x;
+  const double *restrict y = ecef->y;
+  const double *restrict z = ecef->z;
+  double *restrict e = ltp->x;
+  double *restrict nn = ltp->y;
+  double *restrict u = ltp->z;
+
+  int i;
+  for (i = 0; i < n; i++) {
+    const double dx = x[i] - x0;
+    const double dy = y[i] - y0;
+    const double dz = z[i] - z0;
+    e[i] = m0 * dx + m1 * dy;
+    nn[i] = m3 * dx + m4 * dy + m5 * dz;
+    u[i] = m6 * dx + m7 * dy + m8 * dz;
+  }
+}
+
+void enu_of_ecef_points_d(struct Vect3Array_d *enu, struct LtpDef_d *def, struct Vect3Array_d *ecef, int n)
+{
+  ltp_of_ecef_points_d(enu, def, ecef, n, 1.);
+}
+
+void ned_of_ecef_points_d(struct Vect3Array_d *ned, struct LtpDef_d *def, struct Vect3Array_d *ecef, int n)
+{
+  /* same as ENU with north/east swapped and down = -up */
+  struct Vect3Array_d enu = { ned->y, ned->x, ned->z };
+  ltp_of_ecef_points_d(&enu, def, ecef, n, -1.);
+}
+
+/** rotation from local frame, sign of the third column (1 for ENU, -1 for NED) */
+static inline void ecef_of_ltp_points_d(struct Vect3Array_d *ecef, struct LtpDef_d *def,
+    struct Vect3Array_d *ltp, int n, double up)
+{
+  const double m0 = def->ltp_of_ecef.m[0], m1 = def->ltp_of_ecef.m[1];
+  const double m3 = def->ltp_of_ecef.m[3], m4 = def->ltp_of_ecef.m[4], m5 = def->ltp_of_ecef.m[5];
+  const double m6 = up * def->ltp_of_ecef.m[6], m7 = up * def->ltp_of_ecef.m[7], m8 = up * def->ltp_of_ecef.m[8];
+  const double x0 = def->ecef.x, y0 = def->ecef.y, z0 = def->ecef.z;
+
+  const double *restrict e = ltp->x;
+  const double *restrict nn = ltp->y;
+  const double *restrict u = ltp->z;
+  double *restrict x = ecef->x;
+  double *restrict y = ecef->y;
+  double *restrict z = ecef->z;
+
+  int i;
+  for (i = 0; i < n; i++) {
+    x[i] = x0 + m0 * e[i] + m3 * nn[i] + m6 * u[i];
+    y[i] = y0 + m1 * e[i] + m4 * nn[i] + m7 * u[i];
+    z[i] = z0 + m5 * nn[i] + m8 * u[i];
+  }
+}
+
+void ecef_of_enu_points_d(struct Vect3Array_d *ecef, struct LtpDef_d *def, struct Vect3Array_d *enu, int n)
+{
+  ecef_of_ltp_points_d(ecef, def, enu, n, 1.);
+}
+
+void ecef_of_ned_points_d(struct Vect3Array_d *ecef, struct LtpDef_d *def, struct Vect3Array_d *ned, int n)
+{
+  struct Vect3Array_d enu = { ned->y, ned->x, ned->z };
+  ecef_of_ltp_points_d(ecef, def, &enu, n, -1.);
+}
+
+/**
+ * LLA to local frame without going through ECEF coordinates.
+ * Points are expressed in the ECEF frame rotated by the origin longitude,
+ * so only the longitude difference is needed and the local frame
+ * is obtained with a single rotation around the east axis.
+ */
+static inline void ltp_of_lla_points_d(struct Vect3Array_d *ltp, struct LtpDef_d *def,
+    struct LlaArray_d *lla, int n, double up)
+{
+  static const double a = 6378137.0;           /* earth semimajor axis in meters */
+  static const double f = 1. / 298.257223563;  /* reciprocal flattening          */
+  const double e2 = 2.*f - (f * f);            /* first eccentricity squared     */
+
+  const double sin_lat0 = sin(def->lla.lat);
+  const double cos_lat0 = cos(def->lla.lat);
+  const double lon0 = def->lla.lon;
+  /* origin in rotated frame */
+  const double x0 = cos(lon0) * def->ecef.x + sin(lon0) * def->ecef.y;
+  const double z0 = def->ecef.z;
+
+  const double *restrict lat = lla->lat;
+  const double *restrict lon = lla->lon;
+  const double *restrict alt = lla->alt;
+  double *restrict e = ltp->x;
+  double *restrict nn = ltp->y;
+  double *restrict u = ltp->z;
+
+  int i;
+  for (i = 0; i < n; i++) {
+    const double sin_lat = sin(lat[i]);
+    const double cos_lat = cos(lat[i]);
+    const double dlon = lon[i] - lon0;
+    const double a_chi = a / sqrt(1. - e2 * sin_lat * sin_lat);
+    const double rc = (a_chi + alt[i]) * cos_lat;
+    const double dx = rc * cos(dlon) - x0;
+    const double dz = (a_chi * (1. - e2) + alt[i]) * sin_lat - z0;
+    e[i] = rc * sin(dlon);
+    nn[i] = cos_lat0 * dz - sin_lat0 * dx;
+    u[i] = up * (cos_lat0 * dx + sin_lat0 * dz);
+  }
+}
+
+void enu_of_lla_points_d(struct Vect3Array_d *enu, struct LtpDef_d *def, struct LlaArray_d *lla, int n)
+{
+  ltp_of_lla_points_d(enu, def, lla, n, 1.);
+}
+
+void ned_of_lla_points_d(struct Vect3Array_d *ned, struct LtpDef_d *def, struct LlaArray_d *lla, int n)
+{
+  struct Vect3Array_d enu = { ned->y, ned->x, ned->z };
+  ltp_of_lla_points_d(&enu, def, lla, n, -1.);
+}
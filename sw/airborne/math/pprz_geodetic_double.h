@@ -101,6 +101,25 @@ struct LtpDef_d {
   double hmsl; ///< height in meters above mean sea level
 };
 
+/**
+ * @brief arrays of 3D points (ECEF, ENU or NED), structure of arrays layout
+ * @details Used by the batch conversion functions (*_points_d),
+ * units and frame are the ones of the corresponding single point type. */
+struct Vect3Array_d {
+  double *x;
+  double *y;
+  double *z;
+};
+
+/**
+ * @brief arrays of Latitude, Longitude and Altitude, structure of arrays layout
+ * Units: radians and meters */
+struct LlaArray_d {
+  double *lat; ///< in radians
+  double *lon; ///< in radians
+  double *alt; ///< in meters above WGS84 reference ellipsoid
+};
+
 extern void lla_of_utm_d(struct LlaCoor_d *lla, struct UtmCoor_d *utm);
 extern void utm_of_lla_d(struct UtmCoor_d *utm, struct LlaCoor_d *lla);
 extern void ltp_def_from_ecef_d(struct LtpDef_d *def, struct EcefCoor_d *ecef);
@@ -125,6 +144,17 @@ extern void ned_of_lla_point_d(struct NedCoor_d *ned, struct LtpDef_d *def, stru
 
 extern double gc_of_gd_lat_d(double gd_lat, double hmsl);
 
+/* batch conversions of n points sharing the same local frame,
+ * output arrays must not overlap the input arrays */
+extern void lla_of_ecef_points_d(struct LlaArray_d *lla, struct Vect3Array_d *ecef, int n);
+extern void ecef_of_lla_points_d(struct Vect3Array_d *ecef, struct LlaArray_d *lla, int n);
+extern void enu_of_ecef_points_d(struct Vect3Array_d *enu, struct LtpDef_d *def, struct Vect3Array_d *ecef, int n);
+extern void ned_of_ecef_points_d(struct Vect3Array_d *ned, struct LtpDef_d *def, struct Vect3Array_d *ecef, int n);
+extern void ecef_of_enu_points_d(struct Vect3Array_d *ecef, struct LtpDef_d *def, struct Vect3Array_d *enu, int n);
+extern void ecef_of_ned_points_d(struct Vect3Array_d *ecef, struct LtpDef_d *def, struct Vect3Array_d *ned, int n);
+extern void enu_of_lla_points_d(struct Vect3Array_d *enu, struct LtpDef_d *def, struct LlaArray_d *lla, int n);
+extern void ned_of_lla_points_d(struct Vect3Array_d *ned, struct LtpDef_d *def, struct LlaArray_d *lla, int n);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -366,3 +366,212 @@ void lla_of_utm_f(struct LlaCoor_f *lla, struct UtmCoor_f *utm)
   // copy alt above reference ellipsoid
   lla->alt = utm->alt;
 }
+
+
+/*******************************************************************************
+ * Batch conversions
+ *
+ * Same conversions as the single point functions, for arrays of points in a
+ * structure of arrays layout. The constants and the local frame terms are
+ * computed once per call instead of once per point. The loops still call
+ * the math library per element (sqrt, cbrt, atan2, ...).
+ ******************************************************************************/
+
+void lla_of_ecef_points_f(struct LlaArray_f *lla, struct Vect3Array_f *ecef, int n)
+{
+  static const float a = 6378137.0;           /* earth semimajor axis in meters */
+  static const float f = 1. / 298.257223563;  /* reciprocal flattening          */
+  const float b = a * (1. - f);               /* semi-minor axis                */
+  const float b2 = b * b;
+  const float e2 = 2.*f - (f * f);            /* first eccentricity squared     */
+  const float ep2 = f * (2. - f) / ((1. - f) * (1. - f)); /* second eccentricity squared    */
+  const float E2 = a * a - b2;
+  const float e4 = e2 * e2;
+  const float a2_2 = a * a / 2.;
+  const float b2_a = b2 / a;
+
+  const float *restrict x = ecef->x;
+  const float *restrict y = ecef->y;
+  const float *restrict z = ecef->z;
+  float *restrict lat = lla->lat;
+  float *restrict lon = lla->lon;
+  float *restrict alt = lla->alt;
+
+  int i;
+  for (i = 0; i < n; i++) {
+    const float z2 = z[i] * z[i];
+    const float r2 = x[i] * x[i] + y[i] * y[i];
+    const float r = sqrtf(r2);
+    const float F = 54.*b2 * z2;
+    const float G = r2 + (1 - e2) * z2 - e2 * E2;
+    const float c = (e4 * F * r2) / (G * G * G);
+    const float s = cbrtf(1 + c + sqrtf(c * c + 2 * c));
+    const float s1 = 1 + s + 1 / s;
+    const float P = F / (3 * s1 * s1 * G * G);
+    const float Q = sqrtf(1 + 2 * e4 * P);
+    const float ro = -(e2 * P * r) / (1 + Q) + sqrtf(a2_2 * (1 + 1 / Q) - ((1 - e2) * P * z2) / (Q * (1 + Q)) - P * r2 / 2);
+    const float tmp = (r - e2 * ro) * (r - e2 * ro);
+    const float U = sqrtf(tmp + z2);
+    const float V = sqrtf(tmp + (1 - e2) * z2);
+    const float zo = (b2_a * z[i]) / V;
+
+    alt[i] = U * (1 - b2_a / V);
+    lat[i] = atan2f(z[i] + ep2 * zo, r);
+    lon[i] = atan2f(y[i], x[i]);
+  }
+}
+
+void ecef_of_lla_points_f(struct Vect3Array_f *ecef, struct LlaArray_f *lla, int n)
+{
+  static const float a = 6378137.0;           /* earth semimajor axis in meters */
+  static const float f = 1. / 298.257223563;  /* reciprocal flattening          */
+  const float e2 = 2.*f - (f * f);            /* first eccentricity squared     */
+
+  const float *restrict lat = lla->lat;
+  const float *restrict lon = lla->lon;
+  const float *restrict alt = lla->alt;
+  float *restrict x = ecef->x;
+  float *restrict y = ecef->y;
+  float *restrict z = ecef->z;
+
+  int i;
+  for (i = 0; i < n; i++) {
+    const float sin_lat = sinf(lat[i]);
+    const float cos_lat = cosf(lat[i]);
+    const float sin_lon = sinf(lon[i]);
+    const float cos_lon = cosf(lon[i]);
+    const float a_chi = a / sqrtf(1. - e2 * sin_lat * sin_lat);
+    const float rc = (a_chi + alt[i]) * cos_lat;
+    x[i] = rc * cos_lon;
+    y[i] = rc * sin_lon;
+    z[i] = (a_chi * (1. - e2) + alt[i]) * sin_lat;
+  }
+}
+
+/** rotation to local frame, sign of the third row (1 for ENU, -1 for NED) */
+static inline void ltp_of_ecef_points_f(struct Vect3Array_f *ltp, struct LtpDef_f *def,
+    struct Vect3Array_f *ecef, int n, float up)
+{
+  /* third element of the first row is always zero */
+  const float m0 = def->ltp_of_ecef.m[0], m1 = def->ltp_of_ecef.m[1];
+  const float m3 = def->ltp_of_ecef.m[3], m4 = def->ltp_of_ecef.m[4], m5 = def->ltp_of_ecef.m[5];
+  const float m6 = up * def->ltp_of_ecef.m[6], m7 = up * def->ltp_of_ecef.m[7], m8 = up * def->ltp_of_ecef.m[8];
+  const float x0 = def->ecef.x, y0 = def->ecef.y, z0 = def->ecef.z;
+
+  const float *restrict x = ecef->x;
+  const float *restrict y = ecef->y;
+  const float *restrict z = ecef->z;
+  float *restrict e = ltp->x;
+  float *restrict nn = ltp->y;
+  float *restrict u = ltp->z;
+
+  int i;
+  for (i = 0; i < n; i++) {
+    const float dx = x[i] - x0;
+    const float dy = y[i] - y0;
+    const float dz = z[i] - z0;
+    e[i] = m0 * dx + m1 * dy;
+    nn[i] = m3 * dx + m4 * dy + m5 * dz;
+    u[i] = m6 * dx + m7 * dy + m8 * dz;
+  }
+}
+
+void enu_of_ecef_points_f(struct Vect3Array_f *enu, struct LtpDef_f *def, struct Vect3Array_f *ecef, int n)
+{
+  ltp_of_ecef_points_f(enu, def, ecef, n, 1.);
+}
+
+void ned_of_ecef_points_f(struct Vect3Array_f *ned, struct LtpDef_f *def, struct Vect3Array_f *ecef, int n)
+{
+  /* same as ENU with north/east swapped and down = -up */
+  struct Vect3Array_f enu = { ned->y, ned->x, ned->z };
+  ltp_of_ecef_points_f(&enu, def, ecef, n, -1.);
+}
+
+/** rotation from local frame, sign of the third column (1 for ENU, -1 for NED) */
+static inline void ecef_of_ltp_points_f(struct Vect3Array_f *ecef, struct LtpDef_f *def,
+    struct Vect3Array_f *ltp, int n, float up)
+{
+  const float m0 = def->ltp_of_ecef.m[0], m1 = def->ltp_of_ecef.m[1];
+  const float m3 = def->ltp_of_ecef.m[3], m4 = def->ltp_of_ecef.m[4], m5 = def->ltp_of_ecef.m[5];
+  const float m6 = up * def->ltp_of_ecef.m[6], m7 = up * def->ltp_of_ecef.m[7], m8 = up * def->ltp_of_ecef.m[8];
+  const float x0 = def->ecef.x, y0 = def->ecef.y, z0 = def->ecef.z;
+
+  const float *restrict e = ltp->x;
+  const float *restrict nn = ltp->y;
+  const float *restrict u = ltp->z;
+  float *restrict x = ecef->x;
+  float *restrict y = ecef->y;
+  float *restrict z = ecef->z;
+
+  int i;
+  for (i = 0; i < n; i++) {
+    x[i] = x0 + m0 * e[i] + m3 * nn[i] + m6 * u[i];
+    y[i] = y0 + m1 * e[i] + m4 * nn[i] + m7 * u[i];
+    z[i] = z0 + m5 * nn[i] + m8 * u[i];
+  }
+}
+
+void ecef_of_enu_points_f(struct Vect3Array_f *ecef, struct LtpDef_f *def, struct Vect3Array_f *enu, int n)
+{
+  ecef_of_ltp_points_f(ecef, def, enu, n, 1.);
+}
+
+void ecef_of_ned_points_f(struct Vect3Array_f *ecef, struct LtpDef_f *def, struct Vect3Array_f *ned, int n)
+{
+  struct Vect3Array_f enu = { ned->y, ned->x, ned->z };
+  ecef_of_ltp_points_f(ecef, def, &enu, n, -1.);
+}
+
+/**
+ * LLA to local frame without going through ECEF coordinates.
+ * Points are expressed in the ECEF frame rotated by the origin longitude,
+ * so only the longitude difference is needed and the local frame
+ * is obtained with a single rotation around the east axis.
+ */
+static inline void ltp_of_lla_points_f(struct Vect3Array_f *ltp, struct LtpDef_f *def,
+    struct LlaArray_f *lla, int n, float up)
+{
+  static const float a = 6378137.0;           /* earth semimajor axis in meters */
+  static const float f = 1. / 298.257223563;  /* reciprocal flattening          */
+  const float e2 = 2.*f - (f * f);            /* first eccentricity squared     */
+
+  const float sin_lat0 = sinf(def->lla.lat);
+  const float cos_lat0 = cosf(def->lla.lat);
+  const float lon0 = def->lla.lon;
+  /* origin in rotated frame */
+  const float x0 = cosf(lon0) * def->ecef.x + sinf(lon0) * def->ecef.y;
+  const float z0 = def->ecef.z;
+
+  const float *restrict lat = lla->lat;
+  const float *restrict lon = lla->lon;
+  const float *restrict alt = lla->alt;
+  float *restrict e = ltp->x;
+  float *restrict nn = ltp->y;
+  float *restrict u = ltp->z;
+
+  int i;
+  for (i = 0; i < n; i++) {
+    const float sin_lat = sinf(lat[i]);
+    const float cos_lat = cosf(lat[i]);
+    const float dlon = lon[i] - lon0;
+    const float a_chi = a / sqrtf(1. - e2 * sin_lat * sin_lat);
+    const float rc = (a_chi + alt[i]) * cos_lat;
+    const float dx = rc * cosf(dlon) - x0;
+    const float dz = (a_chi * (1. - e2) + alt[i]) * sin_lat - z0;
+    e[i] = rc * sinf(dlon);
+    nn[i] = cos_lat0 * dz - sin_lat0 * dx;
+    u[i] = up * (cos_lat0 * dx + sin_lat0 * dz);
+  }
+}
+
+void enu_of_lla_points_f(struct Vect3Array_f *enu, struct LtpDef_f *def, struct LlaArray_f *lla, int n)
+{
+  ltp_of_lla_points_f(enu, def, lla, n, 1.);
+}
+
+void ned_of_lla_points_f(struct Vect3Array_f *ned, struct LtpDef_f *def, struct LlaArray_f *lla, int n)
+{
+  struct Vect3Array_f enu = { ned->y, ned->x, ned->z };
+  ltp_of_lla_points_f(&enu, def, lla, n, -1.);
+}
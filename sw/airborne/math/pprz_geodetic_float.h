@@ -97,6 +97,25 @@ struct LtpDef_f {
   float hmsl; ///< Height above mean sea level in meters
 };
 
+/**
+ * @brief arrays of 3D points (ECEF, ENU or NED), structure of arrays layout
+ * @details Used by the batch conversion functions (*_points_f),
+ * units and frame are the ones of the corresponding single point type. */
+struct Vect3Array_f {
+  float *x;
+  float *y;
+  float *z;
+};
+
+/**
+ * @brief arrays of Latitude, Longitude and Altitude, structure of arrays layout
+ * Units: radians and meters */
+struct LlaArray_f {
+  float *lat; ///< in radians
+  float *lon; ///< in radians
+  float *alt; ///< in meters above WGS84 reference ellipsoid
+};
+
 extern void lla_of_utm_f(struct LlaCoor_f *lla, struct UtmCoor_f *utm);
 extern void utm_of_lla_f(struct UtmCoor_f *utm, struct LlaCoor_f *lla);
 extern void ltp_def_from_ecef_f(struct LtpDef_f *def, struct EcefCoor_f *ecef);
@@ -117,6 +136,17 @@ extern void ecef_of_enu_vect_f(struct EcefCoor_f *ecef, struct LtpDef_f *def, st
 extern void ecef_of_ned_vect_f(struct EcefCoor_f *ecef, struct LtpDef_f *def, struct NedCoor_f *ned);
 /* end use double versions */
 
+/* batch conversions of n points sharing the same local frame,
+ * output arrays must not overlap the input arrays */
+extern void lla_of_ecef_points_f(struct LlaArray_f *lla, struct Vect3Array_f *ecef, int n);
+extern void ecef_of_lla_points_f(struct Vect3Array_f *ecef, struct LlaArray_f *lla, int n);
+extern void enu_of_ecef_points_f(struct Vect3Array_f *enu, struct LtpDef_f *def, struct Vect3Array_f *ecef, int n);
+extern void ned_of_ecef_points_f(struct Vect3Array_f *ned, struct LtpDef_f *def, struct Vect3Array_f *ecef, int n);
+extern void ecef_of_enu_points_f(struct Vect3Array_f *ecef, struct LtpDef_f *def, struct Vect3Array_f *enu, int n);
+extern void ecef_of_ned_points_f(struct Vect3Array_f *ecef, struct LtpDef_f *def, struct Vect3Array_f *ned, int n);
+extern void enu_of_lla_points_f(struct Vect3Array_f *enu, struct LtpDef_f *def, struct LlaArray_f *lla, int n);
+extern void ned_of_lla_points_f(struct Vect3Array_f *ned, struct LtpDef_f *def, struct LlaArray_f *lla, int n);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
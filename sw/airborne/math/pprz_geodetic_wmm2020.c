@@ -256,3 +256,187 @@ int16_t mag_calc(int16_t igdgc, double flat, double flon, double elev, int16_t n
   *geo_mag_z = *geo_mag_z * cd - aa * sd;
   return (ios);
 }
+
+void wmm2020_cache_init(struct Wmm2020Cache *cache, double date)
+{
+  cache->date = date;
+  cache->nmax = extrapsh(date, GEO_EPOCH, NMAX_1, NMAX_2, cache->gh);
+  cache->valid = false;
+  cache->next.done = 0;
+}
+
+/** set the index of a cell, no corner computed */
+static void wmm2020_cell_set(struct Wmm2020Cell *c, int32_t lat, int32_t lon, int32_t alt)
+{
+  c->lat = lat;
+  c->lon = lon;
+  c->alt = alt;
+  c->done = 0;
+}
+
+static bool wmm2020_cell_is(struct Wmm2020Cell *c, int32_t lat, int32_t lon, int32_t alt)
+{
+  return c->lat == lat && c->lon == lon && c->alt == alt;
+}
+
+/** copy the corners of cell src that are also corners of cell dst */
+static void wmm2020_cell_share(struct Wmm2020Cell *dst, struct Wmm2020Cell *src)
+{
+  int i, j, k;
+  for (i = 0; i < 2; i++) {
+    for (j = 0; j < 2; j++) {
+      for (k = 0; k < 2; k++) {
+        int32_t si = dst->lat + i - src->lat;
+        int32_t sj = dst->lon + j - src->lon;
+        int32_t sk = dst->alt + k - src->alt;
+        uint8_t bit = 1 << (4 * i + 2 * j + k);
+        if (!(dst->done & bit) && si >= 0 && si < 2 && sj >= 0 && sj < 2 && sk >= 0 && sk < 2 &&
+            (src->done & (1 << (4 * si + 2 * sj + sk)))) {
+          dst->h[i][j][k] = src->h[si][sj][sk];
+          dst->done |= bit;
+        }
+      }
+    }
+  }
+}
+
+/** compute the first missing corner of a cell
+ * @return true if a corner was computed
+ */
+static bool wmm2020_cell_step(struct Wmm2020Cache *cache, struct Wmm2020Cell *c)
+{
+  int n;
+  for (n = 0; n < 8; n++) {
+    if (!(c->done & (1 << n))) {
+      int i = n >> 2, j = (n >> 1) & 1, k = n & 1;
+      double x, y, z;
+      mag_calc(1, (c->lat + i) * (double)WMM2020_CACHE_DLAT, (c->lon + j) * (double)WMM2020_CACHE_DLON,
+               (c->alt + k) * (double)WMM2020_CACHE_DALT, cache->nmax, cache->gh,
+               &x, &y, &z, IEXT, EXT_COEFF1, EXT_COEFF2, EXT_COEFF3);
+      VECT3_ASSIGN(c->h[i][j][k], x, y, z);
+      c->done |= 1 << n;
+      return true;
+    }
+  }
+  return false;
+}
+
+/** neighbour cell the vehicle is heading to
+ * Cell where the last displacement d leaves the current cell, or cell behind
+ * the closest face when not moving. pos is in cell units.
+ */
+static void wmm2020_cache_target(struct Wmm2020Cache *cache, float pos[3], float d[3], int32_t target[3])
+{
+  int32_t cell[3] = { cache->cell.lat, cache->cell.lon, cache->cell.alt };
+  int axis = 0, dir = 0;
+  float best = 0.f;
+  int a;
+  for (a = 0; a < 3; a++) {
+    float u = pos[a] - cell[a];
+    float t;
+    int s;
+    if (d[a] > 0.f) {
+      t = (1.f - u) / d[a];   // number of calls before leaving through the upper face
+      s = 1;
+    } else if (d[a] < 0.f) {
+      t = -u / d[a];
+      s = -1;
+    } else {
+      continue;
+    }
+    if (dir == 0 || t < best) {
+      best = t;
+      axis = a;
+      dir = s;
+    }
+  }
+  if (dir == 0) {
+    // not moving, closest face
+    for (a = 0; a < 3; a++) {
+      float u = pos[a] - cell[a];
+      float t = Min(u, 1.f - u);
+      if (dir == 0 || t < best) {
+        best = t;
+        axis = a;
+        dir = u < 0.5f ? -1 : 1;
+      }
+    }
+  }
+  for (a = 0; a < 3; a++) {
+    target[a] = cell[a];
+  }
+  target[axis] += dir;
+}
+
+/** linear interpolation between two vectors, t between 0 and 1 */
+static inline void wmm2020_lerp(struct FloatVect3 *o, struct FloatVect3 *a, struct FloatVect3 *b, float t)
+{
+  struct FloatVect3 d;
+  VECT3_DIFF(d, *b, *a);
+  VECT3_SUM_SCALED(*o, *a, d, t);
+}
+
+uint8_t wmm2020_cache_get(struct Wmm2020Cache *cache, struct FloatVect3 *h, float lat, float lon, float alt)
+{
+  uint8_t nb_eval = 0;
+  /* keep a valid cell at the poles */
+  BoundAbs(lat, 90.f - WMM2020_CACHE_DLAT);
+  float pos[3] = { lat / WMM2020_CACHE_DLAT, lon / WMM2020_CACHE_DLON, alt / WMM2020_CACHE_DALT };
+  int32_t ilat = (int32_t)floorf(pos[0]);
+  int32_t ilon = (int32_t)floorf(pos[1]);
+  int32_t ialt = (int32_t)floorf(pos[2]);
+
+  if (!cache->valid || !wmm2020_cell_is(&cache->cell, ilat, ilon, ialt)) {
+    if (cache->valid && wmm2020_cell_is(&cache->next, ilat, ilon, ialt)) {
+      /* prepared cell, only the missing corners if it was reached early */
+      struct Wmm2020Cell old = cache->cell;
+      cache->cell = cache->next;
+      wmm2020_cell_share(&cache->cell, &old);
+    } else {
+      struct Wmm2020Cell old = cache->cell;
+      wmm2020_cell_set(&cache->cell, ilat, ilon, ialt);
+      if (cache->valid) {
+        wmm2020_cell_share(&cache->cell, &old);
+        wmm2020_cell_share(&cache->cell, &cache->next);
+      }
+    }
+    while (wmm2020_cell_step(cache, &cache->cell)) {
+      nb_eval++;
+    }
+    // no target yet, chosen at next call from the direction of motion
+    wmm2020_cell_set(&cache->next, ilat, ilon, ialt);
+  } else {
+    /* prepare the next cell, one corner per call */
+    float d[3] = { pos[0] - cache->last[0], pos[1] - cache->last[1], pos[2] - cache->last[2] };
+    int32_t target[3];
+    wmm2020_cache_target(cache, pos, d, target);
+    if (!wmm2020_cell_is(&cache->next, target[0], target[1], target[2])) {
+      wmm2020_cell_set(&cache->next, target[0], target[1], target[2]);
+      wmm2020_cell_share(&cache->next, &cache->cell);
+    }
+    if (wmm2020_cell_step(cache, &cache->next)) {
+      nb_eval++;
+    }
+  }
+  cache->valid = true;
+  cache->last[0] = pos[0];
+  cache->last[1] = pos[1];
+  cache->last[2] = pos[2];
+
+  /* position in the cell, between 0 and 1 */
+  float u = pos[0] - ilat;
+  float v = pos[1] - ilon;
+  float w = pos[2] - ialt;
+
+  struct FloatVect3 h0, h1, a, b;
+  struct FloatVect3 (*c)[2][2] = cache->cell.h;
+  wmm2020_lerp(&a, &c[0][0][0], &c[0][0][1], w);
+  wmm2020_lerp(&b, &c[0][1][0], &c[0][1][1], w);
+  wmm2020_lerp(&h0, &a, &b, v);
+  wmm2020_lerp(&a, &c[1][0][0], &c[1][0][1], w);
+  wmm2020_lerp(&b, &c[1][1][0], &c[1][1][1], w);
+  wmm2020_lerp(&h1, &a, &b, v);
+  wmm2020_lerp(h, &h0, &h1, u);
+
+  return nb_eval;
+}
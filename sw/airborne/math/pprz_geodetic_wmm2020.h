@@ -34,6 +34,9 @@
 #ifndef WMM2020_H
 #define WMM2020_H
 
+#include "std.h"
+#include "math/pprz_algebra_float.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -74,6 +77,71 @@ int16_t mag_calc(int16_t igdgc, double flat, double flon, double elev, int16_t n
                  double *gh, double *geo_mag_x, double *geo_mag_y, double *geo_mag_z,
                  int16_t iext, double ext1, double ext2, double ext3);
 
+/** Latitude step of the cached grid in degrees */
+#ifndef WMM2020_CACHE_DLAT
+#define WMM2020_CACHE_DLAT 0.5f
+#endif
+
+/** Longitude step of the cached grid in degrees */
+#ifndef WMM2020_CACHE_DLON
+#define WMM2020_CACHE_DLON 0.5f
+#endif
+
+/** Altitude step of the cached grid in km */
+#ifndef WMM2020_CACHE_DALT
+#define WMM2020_CACHE_DALT 2.f
+#endif
+
+/** Grid cell of the cached model */
+struct Wmm2020Cell {
+  int32_t lat;                  ///< cell index in latitude
+  int32_t lon;                  ///< cell index in longitude
+  int32_t alt;                  ///< cell index in altitude
+  struct FloatVect3 h[2][2][2]; ///< field (nT) at the corners, indexed by [lat][lon][alt]
+  uint8_t done;                 ///< computed corners, one bit per corner
+};
+
+/**
+ * Cached evaluation of the model.
+ *
+ * The coefficients are extrapolated once for the given date and the field
+ * is computed at the 8 corners of the lat/lon/alt grid cell containing
+ * the current position. Inside the cell, the field is trilinearly
+ * interpolated.
+ *
+ * While inside a cell, the neighbour cell the vehicle is heading to is
+ * prepared one corner per call, the corners shared with the current cell
+ * being copied. Reaching that cell costs no evaluation, reaching another
+ * one only evaluates the corners that are not shared with the current cell.
+ */
+struct Wmm2020Cache {
+  double gh[MAXCOEFF];          ///< coefficients extrapolated at date
+  double date;                  ///< date of the coefficients in decimal year
+  int16_t nmax;                 ///< max degree of the coefficients
+  bool valid;                   ///< current cell and last position are set
+  struct Wmm2020Cell cell;      ///< current cell, all corners computed
+  struct Wmm2020Cell next;      ///< neighbour cell being prepared
+  float last[3];                ///< last position in cell units, for the direction of motion
+};
+
+/** Init cache and extrapolate coefficients
+ * @param cache cache structure
+ * @param date date in decimal year
+ */
+extern void wmm2020_cache_init(struct Wmm2020Cache *cache, double date);
+
+/** Get field from cache
+ * At most one corner is evaluated per call, except when the vehicle
+ * reaches a cell that was not prepared.
+ * @param cache cache structure
+ * @param h output field in nT (north, east, down)
+ * @param lat latitude in degrees
+ * @param lon longitude in degrees
+ * @param alt altitude in km
+ * @return number of model evaluations done during this call
+ */
+extern uint8_t wmm2020_cache_get(struct Wmm2020Cache *cache, struct FloatVect3 *h, float lat, float lon, float alt);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_matrix_fixed_float.h
+ * @brief Small matrix operations with compile time sizes.
+ *
+ * Matrices are stored as contiguous row major arrays (float A[n][m],
+ * passed as &A[0][0]), no row pointer table is needed.
+ * All functions are static inline: called with constant sizes, the loops
+ * have known trip counts and are unrolled by the compiler.
+ * No dynamic allocation and no VLA, stack use is known at compile time.
+ *
+ * Output matrices must not overlap the inputs, except when specified.
+ *
+ * @addtogroup math_algebra
+ * @{
+ * @addtogroup math_algebra_fixed_float Fixed size float matrices
+ * @{
+ */
+
+#ifndef PPRZ_MATRIX_FIXED_FLOAT_H
+#define PPRZ_MATRIX_FIXED_FLOAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "std.h"
+#include <math.h>
+
+/** Ask the compiler to unroll the next loop (gcc >= 8) */
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 8)
+#define PPRZ_UNROLL _Pragma("GCC unroll 16")
+#else
+#define PPRZ_UNROLL
+#endif
+
+/** Element (i, j) of a row major matrix with m columns */
+#define FMAT_ELMT(_a, _m, _i, _j) ((_a)[(_i) * (_m) + (_j)])
+
+/** o = a + b, o can be a or b
+ * @param o output [n x m]
+ * @param a [n x m]
+ * @param b [n x m]
+ */
+static inline void float_mat_fixed_add(float *o, const float *a, const float *b, const int n, const int m)
+{
+  int i;
+  PPRZ_UNROLL
+  for (i = 0; i < n * m; i++) {
+    o[i] = a[i] + b[i];
+  }
+}
+
+/** o = a - b, o can be a or b
+ * @param o output [n x m]
+ * @param a [n x m]
+ * @param b [n x m]
+ */
+static inline void float_mat_fixed_sub(float *o, const float *a, const float *b, const int n, const int m)
+{
+  int i;
+  PPRZ_UNROLL
+  for (i = 0; i < n * m; i++) {
+    o[i] = a[i] - b[i];
+  }
+}
+
+/** o = a * b
+ * @param o output [n x m]
+ * @param a [n x k]
+ * @param b [k x m]
+ */
+static inline void float_mat_fixed_mul(float *o, const float *a, const float *b, const int n, const int k, const int m)
+{
+  int i, j, l;
+  for (i = 0; i < n; i++) {
+    PPRZ_UNROLL
+    for (j = 0; j < m; j++) {
+      float s = 0.f;
+      PPRZ_UNROLL
+      for (l = 0; l < k; l++) {
+        s += FMAT_ELMT(a, k, i, l) * FMAT_ELMT(b, m, l, j);
+      }
+      FMAT_ELMT(o, m, i, j) = s;
+    }
+  }
+}
+
+/** o = a * b'
+ * @param o output [n x m]
+ * @param a [n x k]
+ * @param b [m x k]
+ */
+static inline void float_mat_fixed_mul_t(float *o, const float *a, const float *b, const int n, const int k, const int m)
+{
+  int i, j, l;
+  for (i = 0; i < n; i++) {
+    PPRZ_UNROLL
+    for (j = 0; j < m; j++) {
+      float s = 0.f;
+      PPRZ_UNROLL
+      for (l = 0; l < k; l++) {
+        s += FMAT_ELMT(a, k, i, l) * FMAT_ELMT(b, k, j, l);
+      }
+      FMAT_ELMT(o, m, i, j) = s;
+    }
+  }
+}
+
+/** o = a' * b
+ * @param o output [n x m]
+ * @param a [k x n]
+ * @param b [k x m]
+ */
+static inline void float_mat_fixed_tmul(float *o, const float *a, const float *b, const int n, const int k, const int m)
+{
+  int i, j, l;
+  for (i = 0; i < n; i++) {
+    PPRZ_UNROLL
+    for (j = 0; j < m; j++) {
+      float s = 0.f;
+      PPRZ_UNROLL
+      for (l = 0; l < k; l++) {
+        s += FMAT_ELMT(a, n, l, i) * FMAT_ELMT(b, m, l, j);
+      }
+      FMAT_ELMT(o, m, i, j) = s;
+    }
+  }
+}
+
+/** o = a * v
+ * @param o output vector [n]
+ * @param a [n x m]
+ * @param v vector [m]
+ */
+static inline void float_mat_fixed_vmul(float *o, const float *a, const float *v, const int n, const int m)
+{
+  int i, j;
+  for (i = 0; i < n; i++) {
+    float s = 0.f;
+    PPRZ_UNROLL
+    for (j = 0; j < m; j++) {
+      s += FMAT_ELMT(a, m, i, j) * v[j];
+    }
+    o[i] = s;
+  }
+}
+
+/** Cholesky decomposition a = l * l'
+ * Only the lower part of a is used, the upper part of l is set to zero.
+ * l and a can be the same matrix.
+ * @param l output lower triangular matrix [n x n]
+ * @param a symmetric positive definite matrix [n x n]
+ * @return false if a is not positive definite
+ */
+static inline bool float_mat_fixed_cholesky(float *l, const float *a, const int n)
+{
+  int i, j, k;
+  for (j = 0; j < n; j++) {
+    float d = FMAT_ELMT(a, n, j, j);
+    PPRZ_UNROLL
+    for (k = 0; k < j; k++) {
+      d -= FMAT_ELMT(l, n, j, k) * FMAT_ELMT(l, n, j, k);
+    }
+    if (d <= 0.f) {
+      return false;
+    }
+    d = sqrtf(d);
+    FMAT_ELMT(l, n, j, j) = d;
+    const float inv_d = 1.f / d;
+    for (i = j + 1; i < n; i++) {
+      float s = FMAT_ELMT(a, n, i, j);
+      PPRZ_UNROLL
+      for (k = 0; k < j; k++) {
+        s -= FMAT_ELMT(l, n, i, k) * FMAT_ELMT(l, n, j, k);
+      }
+      FMAT_ELMT(l, n, i, j) = s * inv_d;
+      FMAT_ELMT(l, n, j, i) = 0.f;
+    }
+  }
+  return true;
+}
+
+/** LDL' decomposition a = l * diag(d) * l'
+ * Square root free, also works for semi definite matrices.
+ * Only the lower part of a is used, l is unit lower triangular
+ * (upper part set to zero). l and a can be the same matrix.
+ * @param l output unit lower triangular matrix [n x n]
+ * @param d output diagonal [n]
+ * @param a symmetric matrix [n x n]
+ * @return false if a zero pivot is found
+ */
+static inline bool float_mat_fixed_ldlt(float *l, float *d, const float *a, const int n)
+{
+  int i, j, k;
+  for (j = 0; j < n; j++) {
+    float dj = FMAT_ELMT(a, n, j, j);
+    PPRZ_UNROLL
+    for (k = 0; k < j; k++) {
+      dj -= FMAT_ELMT(l, n, j, k) * FMAT_ELMT(l, n, j, k) * d[k];
+    }
+    if (fabsf(dj) < 1e-20f) {
+      return false;
+    }
+    d[j] = dj;
+    FMAT_ELMT(l, n, j, j) = 1.f;
+    const float inv_d = 1.f / dj;
+    for (i = j + 1; i < n; i++) {
+      float s = FMAT_ELMT(a, n, i, j);
+      PPRZ_UNROLL
+      for (k = 0; k < j; k++) {
+        s -= FMAT_ELMT(l, n, i, k) * FMAT_ELMT(l, n, j, k) * d[k];
+      }
+      FMAT_ELMT(l, n, i, j) = s * inv_d;
+      FMAT_ELMT(l, n, j, i) = 0.f;
+    }
+  }
+  return true;
+}
+
+/** Solve l * x = b by forward substitution, x and b can be the same vector
+ * @param x output vector [n]
+ * @param l lower triangular matrix [n x n]
+ * @param b vector [n]
+ * @param unit true if l has a unit diagonal (from LDL')
+ */
+static inline void float_mat_fixed_solve_lower(float *x, const float *l, const float *b, const int n, const bool unit)
+{
+  int i, k;
+  for (i = 0; i < n; i++) {
+    float s = b[i];
+    PPRZ_UNROLL
+    for (k = 0; k < i; k++) {
+      s -= FMAT_ELMT(l, n, i, k) * x[k];
+    }
+    x[i] = unit ? s : s / FMAT_ELMT(l, n, i, i);
+  }
+}
+
+/** Solve l' * x = b by backward substitution, x and b can be the same vector
+ * @param x output vector [n]
+ * @param l lower triangular matrix [n x n]
+ * @param b vector [n]
+ * @param unit true if l has a unit diagonal (from LDL')
+ */
+static inline void float_mat_fixed_solve_lower_t(float *x, const float *l, const float *b, const int n, const bool unit)
+{
+  int i, k;
+  for (i = n - 1; i >= 0; i--) {
+    float s = b[i];
+    PPRZ_UNROLL
+    for (k = i + 1; k < n; k++) {
+      s -= FMAT_ELMT(l, n, k, i) * x[k];
+    }
+    x[i] = unit ? s : s / FMAT_ELMT(l, n, i, i);
+  }
+}
+
+/** Solve a * x = b with the Cholesky factor of a, x and b can be the same vector
+ * @param x output vector [n]
+ * @param l Cholesky factor of a [n x n]
+ * @param b vector [n]
+ */
+static inline void float_mat_fixed_cholesky_solve(float *x, const float *l, const float *b, const int n)
+{
+  float_mat_fixed_solve_lower(x, l, b, n, false);
+  float_mat_fixed_solve_lower_t(x, l, x, n, false);
+}
+
+/** Solve a * x = b with the LDL' factors of a, x and b can be the same vector
+ * @param x output vector [n]
+ * @param l unit lower triangular factor [n x n]
+ * @param d diagonal factor [n]
+ * @param b vector [n]
+ */
+static inline void float_mat_fixed_ldlt_solve(float *x, const float *l, const float *d, const float *b, const int n)
+{
+  int i;
+  float_mat_fixed_solve_lower(x, l, b, n, true);
+  PPRZ_UNROLL
+  for (i = 0; i < n; i++) {
+    x[i] /= d[i];
+  }
+  float_mat_fixed_solve_lower_t(x, l, x, n, true);
+}
+
+/** Solve a * X = B for m right hand sides with the Cholesky factor of a
+ * Columns of B are solved in place.
+ * @param b input [n x m], output X
+ * @param l Cholesky factor of a [n x n]
+ */
+static inline void float_mat_fixed_cholesky_solve_mat(float *b, const float *l, const int n, const int m)
+{
+  int i, j, k;
+  for (j = 0; j < m; j++) {
+    for (i = 0; i < n; i++) {
+      float s = FMAT_ELMT(b, m, i, j);
+      PPRZ_UNROLL
+      for (k = 0; k < i; k++) {
+        s -= FMAT_ELMT(l, n, i, k) * FMAT_ELMT(b, m, k, j);
+      }
+      FMAT_ELMT(b, m, i, j) = s / FMAT_ELMT(l, n, i, i);
+    }
+    for (i = n - 1; i >= 0; i--) {
+      float s = FMAT_ELMT(b, m, i, j);
+      PPRZ_UNROLL
+      for (k = i + 1; k < n; k++) {
+        s -= FMAT_ELMT(l, n, k, i) * FMAT_ELMT(b, m, k, j);
+      }
+      FMAT_ELMT(b, m, i, j) = s / FMAT_ELMT(l, n, i, i);
+    }
+  }
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PPRZ_MATRIX_FIXED_FLOAT_H */
+/** @}*/
+/** @}*/
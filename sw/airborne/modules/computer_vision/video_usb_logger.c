@@ -93,8 +93,14 @@ static void save_shot_on_disk(struct image_t *img, struct image_t *img_jpeg)
 
     static uint32_t counter = 0;
     struct pose_t pose = get_rotation_at_timestamp(img->pprz_ts);
-    struct NedCoor_i *ned = stateGetPositionNed_i();
-    struct NedCoor_i *accel = stateGetAccelNed_i();
+    // running in the video thread, use a snapshot of the state
+    // no line until the autopilot has published one
+    struct StateSnapshot snap;
+    if (!stateSnapshotRead(&snap)) {
+      return;
+    }
+    struct NedCoor_i *ned = &snap.state.ned_pos_i;
+    struct NedCoor_i *accel = &snap.state.ned_accel_i;
     static uint32_t sonar = 0;
 
 
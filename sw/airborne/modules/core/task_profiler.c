@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/** @file "modules/core/task_profiler.c"
+ *
+ * Per-task execution time profiler.
+ */
+
+#include "modules/core/task_profiler.h"
+#include "generated/modules.h"
+#include "subsystems/abi.h"
+#include "pprzlink/messages.h"
+#include "subsystems/datalink/downlink.h"
+#include <string.h>
+
+#ifndef MODULES_PROFILER_NB
+#error "task_profiler: MODULES_PROFILER_NB not defined, the modules header was not generated with profiling support"
+#endif
+
+#if MODULES_PROFILER_NB > TASK_PROFILER_NB_SLOTS
+#error "task_profiler: not enough slots for all periodic functions, increase TASK_PROFILER_NB_SLOTS"
+#endif
+
+/** Enable trace capture (Linux and NPS only) */
+#ifndef TASK_PROFILER_TRACE
+#define TASK_PROFILER_TRACE FALSE
+#endif
+
+#if TASK_PROFILER_TRACE
+#include <stdio.h>
+
+/** Number of events in the trace buffer */
+#ifndef TASK_PROFILER_TRACE_SIZE
+#define TASK_PROFILER_TRACE_SIZE 8192
+#endif
+
+/** Directory where trace files are written */
+#ifndef TASK_PROFILER_TRACE_PATH
+#define TASK_PROFILER_TRACE_PATH /tmp
+#endif
+
+struct TaskProfilerEvent {
+  uint64_t start;     ///< start time in ticks, unwrapped
+  uint32_t duration;  ///< duration in ticks
+  uint8_t slot;
+};
+
+static struct TaskProfilerEvent trace_buf[TASK_PROFILER_TRACE_SIZE];
+static uint32_t trace_idx;
+static bool trace_capturing;
+static uint64_t trace_base;
+static uint32_t trace_last;
+static uint16_t trace_counter;
+#endif
+
+/** Slots are allocated statically, ABI callbacks of modules initialized
+ * before the profiler may already have registered theirs.
+ * The periodic functions use the first slots in generated order.
+ */
+struct TaskProfiler task_profiler = { .nb_slots = MODULES_PROFILER_NB };
+
+static const char *periodic_names[] = MODULES_PROFILER_NAMES;
+static const char *abi_names[ABI_MESSAGE_NB] = ABI_MESSAGES_NAMES;
+
+static void reset_slot(struct TaskProfilerStats *s)
+{
+  s->count = 0;
+  s->min = UINT32_MAX;
+  s->max = 0;
+  s->sum = 0;
+  memset(s->hist, 0, sizeof(s->hist));
+}
+
+static const char *slot_name(struct TaskProfilerStats *s)
+{
+  if (s->kind == TASK_PROFILER_PERIODIC) {
+    return periodic_names[s->id];
+  } else if (s->id < ABI_MESSAGE_NB && abi_names[s->id] != NULL) {
+    return abi_names[s->id];
+  }
+  return "unknown";
+}
+
+void task_profiler_init(void)
+{
+  task_profiler_arch_init();
+  // only the periodic slots are set here, ABI slots may already be in use
+  for (uint16_t i = 0; i < MODULES_PROFILER_NB; i++) {
+    struct TaskProfilerStats *s = &task_profiler.stats[i];
+    s->kind = TASK_PROFILER_PERIODIC;
+    s->id = i;
+    s->cb = NULL;
+    reset_slot(s);
+  }
+}
+
+void task_profiler_reset(void)
+{
+  for (uint8_t i = 0; i < task_profiler.nb_slots; i++) {
+    reset_slot(&task_profiler.stats[i]);
+  }
+}
+
+uint8_t task_profiler_register(uint8_t kind, uint16_t id, void *cb)
+{
+  if (task_profiler.nb_slots >= TASK_PROFILER_NB_SLOTS) {
+    return TASK_PROFILER_NO_SLOT;
+  }
+  struct TaskProfilerStats *s = &task_profiler.stats[task_profiler.nb_slots];
+  s->kind = kind;
+  s->id = id;
+  s->cb = cb;
+  reset_slot(s);
+  task_profiler.nb_slots++;
+  return task_profiler.nb_slots;
+}
+
+void task_profiler_record(uint8_t slot, uint32_t start)
+{
+  uint32_t dt = task_profiler_now() - start;
+  if (slot >= task_profiler.nb_slots) {
+    return;
+  }
+  struct TaskProfilerStats *s = &task_profiler.stats[slot];
+  s->count++;
+  s->sum += dt;
+  if (dt < s->min) { s->min = dt; }
+  if (dt > s->max) { s->max = dt; }
+  // log4 histogram on usec
+  uint32_t us = (uint32_t)(dt / TASK_PROFILER_TICKS_PER_USEC);
+  uint8_t bin = 0;
+  while (us > 0 && bin < TASK_PROFILER_HIST_NB - 1) {
+    bin++;
+    us >>= 2;
+  }
+  s->hist[bin]++;
+
+#if TASK_PROFILER_TRACE
+  if (trace_capturing) {
+    // unwrap tick counter, assuming tasks are executed more often than the counter period
+    if (start < trace_last && (trace_last - start) > (UINT32_MAX / 2)) {
+      trace_base += ((uint64_t)1 << 32);
+    }
+    trace_last = start;
+    trace_buf[trace_idx].start = trace_base + start;
+    trace_buf[trace_idx].duration = dt;
+    trace_buf[trace_idx].slot = slot;
+    trace_idx++;
+    if (trace_idx >= TASK_PROFILER_TRACE_SIZE) {
+      trace_capturing = false;
+    }
+  }
+#endif
+}
+
+int task_profiler_dump_trace(const char *filename)
+{
+#if TASK_PROFILER_TRACE
+  FILE *f = fopen(filename, "w");
+  if (f == NULL) {
+    return -1;
+  }
+  fprintf(f, "{\"traceEvents\":[\n");
+  uint64_t t0 = trace_idx > 0 ? trace_buf[0].start : 0;
+  for (uint32_t i = 0; i < trace_idx; i++) {
+    // events are recorded when they end, nested ones may start before the first recorded one
+    if (trace_buf[i].start < t0) { t0 = trace_buf[i].start; }
+  }
+  for (uint32_t i = 0; i < trace_idx; i++) {
+    struct TaskProfilerEvent *e = &trace_buf[i];
+    struct TaskProfilerStats *s = &task_profiler.stats[e->slot];
+    fprintf(f, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,"
+            "\"args\":{\"slot\":%d,\"cb\":\"%p\"}}%s\n",
+            slot_name(s), s->kind == TASK_PROFILER_PERIODIC ? "periodic" : "abi",
+            (double)(e->start - t0) / TASK_PROFILER_TICKS_PER_USEC,
+            (double)e->duration / TASK_PROFILER_TICKS_PER_USEC,
+            e->slot, s->cb, i + 1 < trace_idx ? "," : "");
+  }
+  fprintf(f, "],\"displayTimeUnit\":\"ns\"}\n");
+  fclose(f);
+  return (int)trace_idx;
+#else
+  (void) filename;
+  return -1;
+#endif
+}
+
+void task_profiler_report(void)
+{
+#if TASK_PROFILER_TRACE
+  if (task_profiler.trace && !trace_capturing) {
+    if (trace_idx == 0) {
+      // start a new capture
+      trace_capturing = true;
+    } else {
+      // capture is over, write it
+      char filename[256];
+      snprintf(filename, sizeof(filename), "%s/task_profile_%03d.json",
+               STRINGIFY(TASK_PROFILER_TRACE_PATH), trace_counter++);
+      if (task_profiler_dump_trace(filename) < 0) {
+        printf("[task_profiler] ERROR writing trace file %s\n", filename);
+      } else {
+        printf("[task_profiler] Trace written to %s\n", filename);
+      }
+      trace_idx = 0;
+      task_profiler.trace = false;
+    }
+  }
+#endif
+
+  if (task_profiler.nb_slots == 0) {
+    return;
+  }
+  if (task_profiler.report_idx >= task_profiler.nb_slots) {
+    task_profiler.report_idx = 0;
+  }
+  struct TaskProfilerStats *s = &task_profiler.stats[task_profiler.report_idx];
+  // slot, kind, id, count, min, avg, max (in usec) and histogram
+  float msg[7 + TASK_PROFILER_HIST_NB];
+  msg[0] = task_profiler.report_idx;
+  msg[1] = s->kind;
+  msg[2] = s->id;
+  msg[3] = s->count;
+  msg[4] = s->count > 0 ? s->min / TASK_PROFILER_TICKS_PER_USEC : 0.f;
+  msg[5] = s->count > 0 ? (float)s->sum / (s->count * TASK_PROFILER_TICKS_PER_USEC) : 0.f;
+  msg[6] = s->max / TASK_PROFILER_TICKS_PER_USEC;
+  for (uint8_t i = 0; i < TASK_PROFILER_HIST_NB; i++) {
+    msg[7 + i] = s->hist[i];
+  }
+  DOWNLINK_SEND_PAYLOAD_FLOAT(DefaultChannel, DefaultDevice, 7 + TASK_PROFILER_HIST_NB, msg);
+  reset_slot(s);
+  task_profiler.report_idx++;
+}
+
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/** @file "modules/core/task_profiler.h"
+ *
+ * Per-task execution time profiler.
+ *
+ * When the task_profiler module is loaded, the code generators wrap every
+ * periodic function of the modules and every ABI callback with the
+ * TaskProfilerPeriodic and TaskProfilerAbi macros. Execution times are
+ * measured with the arch cycle counter and accumulated per task
+ * (min/avg/max and a log4 histogram). Times are inclusive: an ABI callback
+ * triggered from a periodic function is also counted in the periodic function.
+ */
+
+#ifndef TASK_PROFILER_H
+#define TASK_PROFILER_H
+
+#include "std.h"
+#include "modules/core/task_profiler_arch.h"
+
+/** Max number of profiled tasks (periodic functions + ABI callbacks) */
+#ifndef TASK_PROFILER_NB_SLOTS
+#define TASK_PROFILER_NB_SLOTS 64
+#endif
+
+/** Number of histogram bins
+ * bin i counts executions in [4^(i-1), 4^i[ usec, first bin is below 1 usec
+ * and last bin is above 4096 usec
+ */
+#define TASK_PROFILER_HIST_NB 8
+
+/** Invalid slot, returned when no more slots are available */
+#define TASK_PROFILER_NO_SLOT 0xFF
+
+enum TaskProfilerKind {
+  TASK_PROFILER_PERIODIC = 0,
+  TASK_PROFILER_ABI = 1
+};
+
+struct TaskProfilerStats {
+  uint8_t kind;                             ///< task kind, see #TaskProfilerKind
+  uint16_t id;                              ///< periodic function index or ABI message id
+  void *cb;                                 ///< callback address for ABI tasks, NULL otherwise
+  uint32_t count;                           ///< number of calls since last report
+  uint32_t min;                             ///< min execution time in ticks
+  uint32_t max;                             ///< max execution time in ticks
+  uint64_t sum;                             ///< total execution time in ticks
+  uint32_t hist[TASK_PROFILER_HIST_NB];     ///< histogram of execution times
+};
+
+struct TaskProfiler {
+  struct TaskProfilerStats stats[TASK_PROFILER_NB_SLOTS];
+  uint8_t nb_slots;                         ///< number of used slots
+  uint8_t report_idx;                       ///< next slot to report
+  bool trace;                               ///< set to true to start a trace capture
+};
+
+extern struct TaskProfiler task_profiler;
+
+extern void task_profiler_init(void);
+
+/** Send stats of one task and reset them.
+ * All tasks are reported in a round-robin fashion.
+ */
+extern void task_profiler_report(void);
+
+/** Reset all stats */
+extern void task_profiler_reset(void);
+
+/** Register a new task
+ * @param kind task kind
+ * @param id periodic function index or ABI message id
+ * @param cb callback address (for ABI tasks)
+ * @return slot index plus one, or TASK_PROFILER_NO_SLOT if full
+ */
+extern uint8_t task_profiler_register(uint8_t kind, uint16_t id, void *cb);
+
+/** Record the execution of a task
+ * @param slot slot index
+ * @param start tick counter at start of execution
+ */
+extern void task_profiler_record(uint8_t slot, uint32_t start);
+
+/** Dump the trace buffer in Chrome trace format (Linux only)
+ * @param filename output file name
+ * @return number of events written, -1 on error
+ */
+extern int task_profiler_dump_trace(const char *filename);
+
+/** Get current tick counter */
+static inline uint32_t task_profiler_now(void)
+{
+  return task_profiler_arch_ticks();
+}
+
+/** Profile a periodic function call.
+ * Slot of the periodic functions are allocated at init in generated order.
+ */
+#define TaskProfilerPeriodic(_idx, _call) {       \
+    uint32_t _tp_start = task_profiler_now();     \
+    _call;                                        \
+    task_profiler_record(_idx, _tp_start);        \
+  }
+
+/** Profile an ABI callback call.
+ * A slot is allocated when the callback is called for the first time.
+ */
+#define TaskProfilerAbi(_msg_id, _ev, _call) {                                                \
+    if ((_ev)->prof_slot == 0) {                                                              \
+      (_ev)->prof_slot = task_profiler_register(TASK_PROFILER_ABI, _msg_id, (void *)(_ev)->cb); \
+    }                                                                                         \
+    uint32_t _tp_start = task_profiler_now();                                                 \
+    _call;                                                                                    \
+    task_profiler_record((_ev)->prof_slot - 1, _tp_start);                                   \
+  }
+
+#endif /* TASK_PROFILER_H */
+
@@ -27,7 +27,6 @@
  */
 
 #include "modules/geo_mag/geo_mag.h"
-#include "math/pprz_geodetic_wmm2020.h"
 #include "math/pprz_algebra_double.h"
 #include "subsystems/gps.h"
 #include "subsystems/abi.h"
@@ -42,6 +41,38 @@
 
 struct GeoMag geo_mag;
 
+/** Current date in decimal year, for example 2015.68 */
+static double geo_mag_date(void)
+{
+  return GPS_EPOCH_BEGIN +
+         (double)gps.week / WEEKS_IN_YEAR +
+         (double)gps.tow / 1000 / SECS_IN_YEAR;
+}
+
+/** Send normalized field via ABI */
+static void geo_mag_send(void)
+{
+  struct FloatVect3 h = { .x = geo_mag.vect.x,
+                          .y = geo_mag.vect.y,
+                          .z = geo_mag.vect.z };
+  float_vect3_normalize(&h);
+  AbiSendMsgGEO_MAG(GEO_MAG_SENDER_ID, &h);
+}
+
+#if GEO_MAG_CACHED
+/** Update field from the cached model at the current position */
+static void geo_mag_update_cached(void)
+{
+  struct FloatVect3 h;
+  wmm2020_cache_get(&geo_mag.cache, &h,
+                    (float)gps.lla_pos.lat / 1e7f,
+                    (float)gps.lla_pos.lon / 1e7f,
+                    (float)gps.lla_pos.alt / 1e6f);
+  VECT3_COPY(geo_mag.vect, h);
+  geo_mag_send();
+}
+#endif
+
 void geo_mag_init(void)
 {
   geo_mag.calc_once = false;
@@ -54,18 +85,30 @@ void geo_mag_periodic(void)
   if (!geo_mag.ready && GpsFixValid() && autopilot_throttle_killed()) {
     geo_mag.calc_once = true;
   }
+#if GEO_MAG_CACHED
+  /* follow the position, at most one model evaluation per call in flight */
+  if (geo_mag.ready && GpsFixValid()) {
+    geo_mag_update_cached();
+  }
+#endif
 }
 
 void geo_mag_event(void)
 {
+#if GEO_MAG_CACHED
+  if (geo_mag.calc_once) {
+    // coefficients are extrapolated once, corners computed on first update
+    wmm2020_cache_init(&geo_mag.cache, geo_mag_date());
+    geo_mag_update_cached();
+    geo_mag.ready = true;
+  }
+#else
   if (geo_mag.calc_once) {
     double gha[MAXCOEFF]; // Geomag global variables
     int32_t nmax;
 
     /* Current date in decimal year, for example 2015.68 */
-    double sdate = GPS_EPOCH_BEGIN +
-                   (double)gps.week / WEEKS_IN_YEAR +
-                   (double)gps.tow / 1000 / SECS_IN_YEAR;
+    double sdate = geo_mag_date();
 
     /* LLA Position in decimal degrees and altitude in km */
     double latitude = (double)gps.lla_pos.lat / 1e7;
@@ -80,13 +123,10 @@ void geo_mag_event(void)
              IEXT, EXT_COEFF1, EXT_COEFF2, EXT_COEFF3);
 
     // send as normalized float vector via ABI
-    struct FloatVect3 h = { .x = geo_mag.vect.x,
-                            .y = geo_mag.vect.y,
-                            .z = geo_mag.vect.z };
-    float_vect3_normalize(&h);
-    AbiSendMsgGEO_MAG(GEO_MAG_SENDER_ID, &h);
+    geo_mag_send();
 
     geo_mag.ready = true;
   }
+#endif
   geo_mag.calc_once = false;
 }
@@ -31,11 +31,20 @@
 
 #include "std.h"
 #include "math/pprz_algebra_double.h"
+#include "math/pprz_geodetic_wmm2020.h"
+
+/** Use the cached and interpolated model, updated periodically with the position */
+#ifndef GEO_MAG_CACHED
+#define GEO_MAG_CACHED FALSE
+#endif
 
 struct GeoMag {
   struct DoubleVect3 vect;
   bool calc_once;
   bool ready;
+#if GEO_MAG_CACHED
+  struct Wmm2020Cache cache;
+#endif
 };
 
 extern void geo_mag_init(void);
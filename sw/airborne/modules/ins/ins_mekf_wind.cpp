@@ -60,6 +60,8 @@ enum MekfWindCovVar {
 };
 
 typedef Matrix<float, MEKF_WIND_COV_SIZE, MEKF_WIND_COV_SIZE> MEKFWCov;
+typedef Matrix<float, MEKF_WIND_COV_SIZE, 1> MEKFWErr;
+typedef Matrix<float, 1, MEKF_WIND_COV_SIZE> MEKFWObs;
 
 /** Process noise elements and size
  */
@@ -213,6 +215,12 @@ struct InsMekfWindPrivate {
 #define INS_MEKF_WIND_DISABLE_WIND true
 #endif
 
+// Covariance propagation using the block structure of the jacobians,
+// set to false to use the generic dense matrix products
+#ifndef INS_MEKF_WIND_SPARSE_PROPAGATION
+#define INS_MEKF_WIND_SPARSE_PROPAGATION true
+#endif
+
 // paramters
 struct ins_mekf_wind_parameters ins_mekf_wind_params;
 
@@ -302,6 +310,107 @@ static Matrix3f skew_sym(const Vector3f& v) {
   return m;
 }
 
+/**
+ * Copy the upper triangle of the covariance to the lower triangle
+ */
+static void cov_sym_from_upper(MEKFWCov &P) {
+  P.triangularView<StrictlyLower>() = P.transpose();
+}
+
+/**
+ * Sequential scalar measurement update
+ *
+ * Measurement noises are uncorrelated (R is diagonal), so a vector measurement
+ * can be processed as a sequence of scalar updates, without matrix inversion.
+ * The error state correction is accumulated in dx and only the upper triangle
+ * of P is updated, call cov_sym_from_upper after the last update.
+ *
+ * @param dx accumulated error state correction
+ * @param H observation row
+ * @param res residual z - h(x) computed before the first update
+ * @param r measurement noise variance
+ */
+static void scalar_update(MEKFWErr &dx, const MEKFWObs &H, float res, float r) {
+  // P*Ht, S = H*P*Ht + r
+  const MEKFWErr PHt = mwp.P.selfadjointView<Upper>() * H.transpose();
+  const float S = H.dot(PHt) + r;
+  // K = P*Ht/S
+  const MEKFWErr K = PHt / S;
+  dx += K * (res - H.dot(dx));
+  // P = P - K*H*P = P - P*Ht*H*P/S
+  mwp.P.selfadjointView<Upper>().rankUpdate(PHt, -1.f / S);
+}
+
+/**
+ * Apply error state correction
+ *
+ * @param dx error state correction
+ * @param attitude_only only correct quaternion and gyro bias
+ */
+static void correct_state(const MEKFWErr &dx, bool attitude_only) {
+  Quaternionf q_tmp;
+  q_tmp.w() = 1.f;
+  q_tmp.vec() = 0.5f * dx.segment<3>(MEKF_WIND_qx);
+  q_tmp.normalize();
+  mwp.state.quat = q_tmp * mwp.state.quat;
+  mwp.state.quat.normalize();
+  mwp.state.rates_bias  += dx.segment<3>(MEKF_WIND_rbp);
+  if (attitude_only) {
+    return;
+  }
+  mwp.state.speed       += dx.segment<3>(MEKF_WIND_vx);
+  mwp.state.pos         += dx.segment<3>(MEKF_WIND_px);
+  mwp.state.accel_bias  += dx.segment<3>(MEKF_WIND_abx);
+  mwp.state.baro_bias   += dx(MEKF_WIND_bb);
+  if (!ins_mekf_wind_params.disable_wind) {
+    mwp.state.wind      += dx.segment<3>(MEKF_WIND_wx);
+  }
+}
+
+#if INS_MEKF_WIND_SPARSE_PROPAGATION
+/**
+ * Covariance propagation P = A*P*At + An*Q*Ant*dt
+ * using the structure of A = I + E, where E is only non-zero
+ * on the attitude, speed and position rows, and the position rows
+ * are dt times the speed rows (plus dt*I on the speed columns).
+ * An*Q*Ant is block diagonal.
+ */
+static void propagate_cov_sparse(const Matrix3f &Rq, const Matrix3f &RqA, float dt) {
+  MEKFWCov &P = mwp.P;
+  const Matrix3f G = -Rq * dt;          // dq/drb and dv/dab
+  const Matrix3f Avq = -RqA * dt;       // dv/dq
+  const Matrix3f Avrb = RqA * dt * dt;  // dv/drb
+
+  // M = A*P, only the first 9 rows are modified
+  Matrix<float, 9, MEKF_WIND_COV_SIZE> M;
+  M.middleRows<3>(MEKF_WIND_qx) = P.middleRows<3>(MEKF_WIND_qx) + G * P.middleRows<3>(MEKF_WIND_rbp);
+  M.middleRows<3>(MEKF_WIND_vx) = P.middleRows<3>(MEKF_WIND_vx) + Avq * P.middleRows<3>(MEKF_WIND_qx)
+    + Avrb * P.middleRows<3>(MEKF_WIND_rbp) + G * P.middleRows<3>(MEKF_WIND_abx);
+  M.middleRows<3>(MEKF_WIND_px) = P.middleRows<3>(MEKF_WIND_px) + dt * M.middleRows<3>(MEKF_WIND_vx);
+
+  // P = M*At, only the first 9 columns are modified
+  // upper right block is M, lower right block is unchanged
+  Matrix<float, 9, 9> B;
+  B.middleCols<3>(MEKF_WIND_qx) = M.middleCols<3>(MEKF_WIND_qx) + M.middleCols<3>(MEKF_WIND_rbp) * G.transpose();
+  B.middleCols<3>(MEKF_WIND_vx) = M.middleCols<3>(MEKF_WIND_vx) + M.middleCols<3>(MEKF_WIND_qx) * Avq.transpose()
+    + M.middleCols<3>(MEKF_WIND_rbp) * Avrb.transpose() + M.middleCols<3>(MEKF_WIND_abx) * G.transpose();
+  B.middleCols<3>(MEKF_WIND_px) = M.middleCols<3>(MEKF_WIND_px) + dt * B.middleCols<3>(MEKF_WIND_vx);
+  P.topLeftCorner<9, 9>().triangularView<Upper>() = B;
+  P.topRightCorner<9, MEKF_WIND_COV_SIZE - 9>() = M.rightCols<MEKF_WIND_COV_SIZE - 9>();
+
+  // process noise
+  P.block<3,3>(MEKF_WIND_qx,MEKF_WIND_qx).triangularView<Upper>() +=
+    Rq * mwp.Q.block<3,3>(MEKF_WIND_qgp,MEKF_WIND_qgp) * Rq.transpose() * dt;
+  P.block<3,3>(MEKF_WIND_vx,MEKF_WIND_vx).triangularView<Upper>() +=
+    Rq * mwp.Q.block<3,3>(MEKF_WIND_qax,MEKF_WIND_qax) * Rq.transpose() * dt;
+  for (int i = 0; i < MEKF_WIND_COV_SIZE - MEKF_WIND_rbp; i++) {
+    P(MEKF_WIND_rbp + i, MEKF_WIND_rbp + i) += mwp.Q(MEKF_WIND_qrbp + i, MEKF_WIND_qrbp + i) * dt;
+  }
+
+  cov_sym_from_upper(P);
+}
+#endif
+
 /**
  * Init function
  */
@@ -376,11 +485,13 @@ void ins_mekf_wind_propagate(struct FloatRates *gyro, struct FloatVect3 *acc, fl
 
   // propagate covariance
   const Matrix3f Rq = mwp.state.quat.toRotationMatrix();
-  const Matrix3f Rqdt = Rq * dt;
   const Matrix3f RqA = skew_sym(Rq * accel_unbiased);
+#if INS_MEKF_WIND_SPARSE_PROPAGATION
+  propagate_cov_sparse(Rq, RqA, dt);
+#else
+  const Matrix3f Rqdt = Rq * dt;
   const Matrix3f RqAdt = RqA * dt;
   const Matrix3f RqAdt2 = RqAdt * dt;
-
   MEKFWCov A = MEKFWCov::Identity();
   A.block<3,3>(MEKF_WIND_qx,MEKF_WIND_rbp) = -Rqdt;
   A.block<3,3>(MEKF_WIND_vx,MEKF_WIND_qx) = -RqAdt;
@@ -406,6 +517,7 @@ void ins_mekf_wind_propagate(struct FloatRates *gyro, struct FloatVect3 *acc, fl
   Ant = An.transpose();
 
   mwp.P = A * mwp.P * At + An * mwp.Q * Ant * dt;
+#endif
 
   if (ins_mekf_wind_params.disable_wind) {
     mwp.P.block<3,MEKF_WIND_COV_SIZE>(MEKF_WIND_wx,0) = Matrix<float,3,MEKF_WIND_COV_SIZE>::Zero();
@@ -444,6 +556,18 @@ void ins_mekf_wind_propagate_ahrs(struct FloatRates *gyro, struct FloatVect3 *ac
   const Matrix3f Rq = mwp.state.quat.toRotationMatrix();
   const Matrix3f Rqdt = Rq * dt;
 
+#if INS_MEKF_WIND_SPARSE_PROPAGATION
+  // only attitude and gyro bias rows/columns of A are non-zero
+  const Matrix3f Pqrb = mwp.P.block<3,3>(MEKF_WIND_qx,MEKF_WIND_rbp) - Rqdt * mwp.P.block<3,3>(MEKF_WIND_rbp,MEKF_WIND_rbp);
+  const Matrix3f Pqq = mwp.P.block<3,3>(MEKF_WIND_qx,MEKF_WIND_qx) - Rqdt * mwp.P.block<3,3>(MEKF_WIND_rbp,MEKF_WIND_qx)
+    - Pqrb * Rqdt.transpose() + Rq * mwp.Q.block<3,3>(MEKF_WIND_qgp,MEKF_WIND_qgp) * Rq.transpose() * dt;
+  const Matrix3f Prbrb = mwp.P.block<3,3>(MEKF_WIND_rbp,MEKF_WIND_rbp) + mwp.Q.block<3,3>(MEKF_WIND_qrbp,MEKF_WIND_qrbp) * dt;
+  mwp.P.setZero();
+  mwp.P.block<3,3>(MEKF_WIND_qx,MEKF_WIND_qx) = Pqq;
+  mwp.P.block<3,3>(MEKF_WIND_qx,MEKF_WIND_rbp) = Pqrb;
+  mwp.P.block<3,3>(MEKF_WIND_rbp,MEKF_WIND_qx) = Pqrb.transpose();
+  mwp.P.block<3,3>(MEKF_WIND_rbp,MEKF_WIND_rbp) = Prbrb;
+#else
   MEKFWCov A = MEKFWCov::Zero();
   A.block<3,3>(MEKF_WIND_qx,MEKF_WIND_qx) = Matrix3f::Identity();
   A.block<3,3>(MEKF_WIND_qx,MEKF_WIND_rbp) = -Rqdt;
@@ -460,30 +584,25 @@ void ins_mekf_wind_propagate_ahrs(struct FloatRates *gyro, struct FloatVect3 *ac
   Ant = An.transpose();
 
   mwp.P = A * mwp.P * At + An * mwp.Q * Ant * dt;
+#endif
 
   // correction from accel measurements
   const Matrix3f Rqt = Rq.transpose();
-  Matrix<float, 3, MEKF_WIND_COV_SIZE> H = Matrix<float, 3, MEKF_WIND_COV_SIZE>::Zero();
-  H.block<3,3>(0,0) = - Rqt * skew_sym(gravity);
-  Matrix<float, MEKF_WIND_COV_SIZE, 3> Ht = H.transpose();
-  // S = H*P*Ht + Hn*N*Hnt
-  Matrix3f S = H * mwp.P * Ht + mwp.R.block<3,3>(MEKF_WIND_rmx,MEKF_WIND_rmx); // FIXME currently abusing mag noise ????
-  // K = P*Ht*S^-1
-  Matrix<float, MEKF_WIND_COV_SIZE, 3> K = mwp.P * Ht * S.inverse();
+  const Matrix3f H = - Rqt * skew_sym(gravity);
   // Residual z_a - h(z)
-  Vector3f res = accel_unbiased + (Rqt * gravity);
+  const Vector3f res = accel_unbiased + (Rqt * gravity);
+  // sequential update, FIXME currently abusing mag noise ????
+  MEKFWErr dx = MEKFWErr::Zero();
+  MEKFWObs Hi = MEKFWObs::Zero();
+  for (int i = 0; i < 3; i++) {
+    Hi.segment<3>(MEKF_WIND_qx) = H.row(i);
+    scalar_update(dx, Hi, res(i), mwp.R(MEKF_WIND_rmx + i, MEKF_WIND_rmx + i));
+  }
+  cov_sym_from_upper(mwp.P);
   // Update state
-  q_tmp.w() = 1.f;
-  q_tmp.vec() = 0.5f * K.block<3,3>(MEKF_WIND_qx,0) * res;
-  q_tmp.normalize();
-  mwp.state.quat = q_tmp * mwp.state.quat;
-  mwp.state.quat.normalize();
-  mwp.state.rates_bias  += K.block<3,3>(MEKF_WIND_rbp,0) * res;
-  // Update covariance
-  mwp.P = (MEKFWCov::Identity() - K * H) * mwp.P;
+  correct_state(dx, true);
 }
 
-
 void ins_mekf_wind_align(struct FloatRates *gyro_bias, struct FloatQuat *quat)
 {
   /* Compute an initial orientation from accel and mag directly as quaternion */
@@ -504,72 +623,38 @@ void ins_mekf_wind_update_mag(struct FloatVect3* mag, bool attitude_only)
   mwp.measurements.mag(1) = mag->y;
   mwp.measurements.mag(2) = mag->z;
 
-  // H and Ht matrices
+  // H matrix, only attitude part is non-zero
   const Matrix3f Rqt = mwp.state.quat.toRotationMatrix().transpose();
-  Matrix<float, 3, MEKF_WIND_COV_SIZE> H = Matrix<float, 3, MEKF_WIND_COV_SIZE>::Zero();
-  H.block<3,3>(0,0) = Rqt * skew_sym(mwp.mag_h);
-  Matrix<float, MEKF_WIND_COV_SIZE, 3> Ht = H.transpose();
-  // S = H*P*Ht + Hn*N*Hnt
-  Matrix3f S = H * mwp.P * Ht + mwp.R.block<3,3>(MEKF_WIND_rmx,MEKF_WIND_rmx);
-  // K = P*Ht*S^-1
-  Matrix<float, MEKF_WIND_COV_SIZE, 3> K = mwp.P * Ht * S.inverse();
+  const Matrix3f H = Rqt * skew_sym(mwp.mag_h);
   // Residual z_m - h(z)
-  Vector3f res = mwp.measurements.mag - (Rqt * mwp.mag_h);
-  // Update state
-  Quaternionf q_tmp;
-  q_tmp.w() = 1.f;
-  q_tmp.vec() = 0.5f * K.block<3,3>(MEKF_WIND_qx,0) * res;
-  q_tmp.normalize();
-  mwp.state.quat = q_tmp * mwp.state.quat;
-  mwp.state.quat.normalize();
-  if (attitude_only) {
-    mwp.state.rates_bias  += K.block<3,3>(MEKF_WIND_rbp,0) * res;
-  } else {
-    mwp.state.speed       += K.block<3,3>(MEKF_WIND_vx,0) * res;
-    mwp.state.pos         += K.block<3,3>(MEKF_WIND_px,0) * res;
-    mwp.state.rates_bias  += K.block<3,3>(MEKF_WIND_rbp,0) * res;
-    mwp.state.accel_bias  += K.block<3,3>(MEKF_WIND_abx,0) * res;
-    mwp.state.baro_bias   += K.block<1,3>(MEKF_WIND_bb,0) * res;
-    if (!ins_mekf_wind_params.disable_wind) {
-      mwp.state.wind        += K.block<3,3>(MEKF_WIND_wx,0) * res;
-    }
+  const Vector3f res = mwp.measurements.mag - (Rqt * mwp.mag_h);
+  // sequential update
+  MEKFWErr dx = MEKFWErr::Zero();
+  MEKFWObs Hi = MEKFWObs::Zero();
+  for (int i = 0; i < 3; i++) {
+    Hi.segment<3>(MEKF_WIND_qx) = H.row(i);
+    scalar_update(dx, Hi, res(i), mwp.R(MEKF_WIND_rmx + i, MEKF_WIND_rmx + i));
   }
-  // Update covariance
-  mwp.P = (MEKFWCov::Identity() - K * H) * mwp.P;
+  cov_sym_from_upper(mwp.P);
+  // Update state
+  correct_state(dx, attitude_only);
 }
 
 void ins_mekf_wind_update_baro(float baro_alt)
 {
   mwp.measurements.baro_alt = baro_alt;
 
-  // H and Ht matrices
-  Matrix<float, 1, MEKF_WIND_COV_SIZE> H = Matrix<float, 1, MEKF_WIND_COV_SIZE>::Zero();
-  H(0,MEKF_WIND_pz) = 1.0f; // TODO check index
-  H(0,MEKF_WIND_bb) = -1.0f;
-  Matrix<float, MEKF_WIND_COV_SIZE, 1> Ht = H.transpose();
-  // S = H*P*Ht + Hn*N*Hnt -> only pos.z component
-  float S = mwp.P(MEKF_WIND_pz,MEKF_WIND_pz) - mwp.P(MEKF_WIND_bb,MEKF_WIND_bb) + mwp.R(MEKF_WIND_rb,MEKF_WIND_rb);
-  // K = P*Ht*S^-1
-  Matrix<float, MEKF_WIND_COV_SIZE, 1> K = mwp.P * Ht / S;
+  // H matrix
+  MEKFWObs H = MEKFWObs::Zero();
+  H(MEKF_WIND_pz) = 1.0f; // TODO check index
+  H(MEKF_WIND_bb) = -1.0f;
   // Residual z_m - h(z)
-  float res = mwp.measurements.baro_alt - (mwp.state.pos(2) - mwp.state.baro_bias);
+  const float res = mwp.measurements.baro_alt - (mwp.state.pos(2) - mwp.state.baro_bias);
+  MEKFWErr dx = MEKFWErr::Zero();
+  scalar_update(dx, H, res, mwp.R(MEKF_WIND_rb,MEKF_WIND_rb));
+  cov_sym_from_upper(mwp.P);
   // Update state
-  Quaternionf q_tmp;
-  q_tmp.w() = 1.f;
-  q_tmp.vec() = 0.5f * K.block<3,1>(MEKF_WIND_qx,0) * res;
-  q_tmp.normalize();
-  mwp.state.quat = q_tmp * mwp.state.quat;
-  mwp.state.quat.normalize();
-  mwp.state.speed       += K.block<3,1>(MEKF_WIND_vx,0) * res;
-  mwp.state.pos         += K.block<3,1>(MEKF_WIND_px,0) * res;
-  mwp.state.rates_bias  += K.block<3,1>(MEKF_WIND_rbp,0) * res;
-  mwp.state.accel_bias  += K.block<3,1>(MEKF_WIND_abx,0) * res;
-  mwp.state.baro_bias   += K(MEKF_WIND_bb,0) * res;
-  if (!ins_mekf_wind_params.disable_wind) {
-    mwp.state.wind        += K.block<3,1>(MEKF_WIND_wx,0) * res;
-  }
-  // Update covariance
-  mwp.P = (MEKFWCov::Identity() - K * H) * mwp.P;
+  correct_state(dx, false);
 }
 
 void ins_mekf_wind_update_pos_speed(struct FloatVect3 *pos, struct FloatVect3 *speed)
@@ -581,34 +666,20 @@ void ins_mekf_wind_update_pos_speed(struct FloatVect3 *pos, struct FloatVect3 *s
   mwp.measurements.speed(1) = speed->y;
   mwp.measurements.speed(2) = speed->z;
 
-  // H and Ht matrices
-  Matrix<float, 6, MEKF_WIND_COV_SIZE> H = Matrix<float, 6, MEKF_WIND_COV_SIZE>::Zero();
-  H.block<6,6>(0,MEKF_WIND_vx) = Matrix<float,6,6>::Identity();
-  Matrix<float, MEKF_WIND_COV_SIZE, 6> Ht = H.transpose();
-  // S = H*P*Ht + Hn*N*Hnt
-  Matrix<float, 6, 6> S = mwp.P.block<6,6>(MEKF_WIND_vx,MEKF_WIND_vx) + mwp.R.block<6,6>(MEKF_WIND_rvx,MEKF_WIND_rvx);
-  // K = P*Ht*S^-1
-  Matrix<float, MEKF_WIND_COV_SIZE, 6> K = mwp.P * Ht * S.inverse();
   // Residual z_m - h(z)
-  Matrix<float, 6, 1> res = Matrix<float, 6, 1>::Zero();
-  res.block<3,1>(0,0) = mwp.measurements.speed - mwp.state.speed;
-  res.block<3,1>(3,0) = mwp.measurements.pos - mwp.state.pos;
-  // Update state
-  Quaternionf q_tmp;
-  q_tmp.w() = 1.f;
-  q_tmp.vec() = 0.5f * K.block<3,6>(MEKF_WIND_qx,0) * res;
-  q_tmp.normalize();
-  mwp.state.quat = q_tmp * mwp.state.quat;
-  mwp.state.speed       += K.block<3,6>(MEKF_WIND_vx,0) * res;
-  mwp.state.pos         += K.block<3,6>(MEKF_WIND_px,0) * res;
-  mwp.state.rates_bias  += K.block<3,6>(MEKF_WIND_rbp,0) * res;
-  mwp.state.accel_bias  += K.block<3,6>(MEKF_WIND_abx,0) * res;
-  mwp.state.baro_bias   += K.block<1,6>(MEKF_WIND_bb,0) * res;
-  if (!ins_mekf_wind_params.disable_wind) {
-    mwp.state.wind        += K.block<3,6>(MEKF_WIND_wx,0) * res;
+  Matrix<float, 6, 1> res;
+  res.segment<3>(0) = mwp.measurements.speed - mwp.state.speed;
+  res.segment<3>(3) = mwp.measurements.pos - mwp.state.pos;
+  // sequential update, H is identity on speed and position
+  MEKFWErr dx = MEKFWErr::Zero();
+  for (int i = 0; i < 6; i++) {
+    MEKFWObs H = MEKFWObs::Zero();
+    H(MEKF_WIND_vx + i) = 1.f;
+    scalar_update(dx, H, res(i), mwp.R(MEKF_WIND_rvx + i, MEKF_WIND_rvx + i));
   }
-  // Update covariance
-  mwp.P = (MEKFWCov::Identity() - K * H) * mwp.P;
+  cov_sym_from_upper(mwp.P);
+  // Update state
+  correct_state(dx, false);
 }
 
 void ins_mekf_wind_update_airspeed(float airspeed)
@@ -616,37 +687,20 @@ void ins_mekf_wind_update_airspeed(float airspeed)
   mwp.measurements.airspeed = airspeed;
 
   if (ins_mekf_wind_params.disable_wind) return;
-  // H and Ht matrices
+  // H matrix
   const RowVector3f IuRqt = mwp.state.quat.toRotationMatrix().transpose().block<1,3>(0,0);
   const Vector3f va = mwp.state.speed - mwp.state.wind;
-  Matrix<float, 1, MEKF_WIND_COV_SIZE> H = Matrix<float, 1, MEKF_WIND_COV_SIZE>::Zero();
-  H.block<1,3>(0,MEKF_WIND_qx) = IuRqt * skew_sym(va);
-  H.block<1,3>(0,MEKF_WIND_vx) = IuRqt;
-  H.block<1,3>(0,MEKF_WIND_wx) = -IuRqt;
-  Matrix<float, MEKF_WIND_COV_SIZE, 1> Ht = H.transpose();
-  // S = H*P*Ht + Hn*N*Hnt
-  float S = H * mwp.P * Ht + mwp.R(MEKF_WIND_ras,MEKF_WIND_ras);
-  // K = P*Ht*S^-1
-  Matrix<float, MEKF_WIND_COV_SIZE, 1> K = mwp.P * Ht / S;
+  MEKFWObs H = MEKFWObs::Zero();
+  H.segment<3>(MEKF_WIND_qx) = IuRqt * skew_sym(va);
+  H.segment<3>(MEKF_WIND_vx) = IuRqt;
+  H.segment<3>(MEKF_WIND_wx) = -IuRqt;
   // Residual z_m - h(z)
-  float res = mwp.measurements.airspeed - IuRqt * va;
+  const float res = mwp.measurements.airspeed - IuRqt * va;
+  MEKFWErr dx = MEKFWErr::Zero();
+  scalar_update(dx, H, res, mwp.R(MEKF_WIND_ras,MEKF_WIND_ras));
+  cov_sym_from_upper(mwp.P);
   // Update state
-  Quaternionf q_tmp;
-  q_tmp.w() = 1.f;
-  q_tmp.vec() = 0.5f * K.block<3,1>(MEKF_WIND_qx,0) * res;
-  q_tmp.normalize();
-  mwp.state.quat = q_tmp * mwp.state.quat;
-  mwp.state.quat.normalize();
-  mwp.state.speed       += K.block<3,1>(MEKF_WIND_vx,0) * res;
-  mwp.state.pos         += K.block<3,1>(MEKF_WIND_px,0) * res;
-  mwp.state.rates_bias  += K.block<3,1>(MEKF_WIND_rbp,0) * res;
-  mwp.state.accel_bias  += K.block<3,1>(MEKF_WIND_abx,0) * res;
-  mwp.state.baro_bias   += K(MEKF_WIND_bb,0) * res;
-  if (!ins_mekf_wind_params.disable_wind) {
-    mwp.state.wind        += K.block<3,1>(MEKF_WIND_wx,0) * res;
-  }
-  // Update covariance
-  mwp.P = (MEKFWCov::Identity() - K * H) * mwp.P;
+  correct_state(dx, false);
 }
 
 void ins_mekf_wind_update_incidence(float aoa, float aos)
@@ -655,7 +709,7 @@ void ins_mekf_wind_update_incidence(float aoa, float aos)
   mwp.measurements.aos = aos;
 
   if (ins_mekf_wind_params.disable_wind) return;
-  // H and Ht matrices
+  // H matrix
   const Matrix3f Rqt = mwp.state.quat.toRotationMatrix().transpose();
   const Vector3f va = Rqt * (mwp.state.speed - mwp.state.wind); // airspeed in body frame
   // check if data in valid range
@@ -674,45 +728,28 @@ void ins_mekf_wind_update_incidence(float aoa, float aos)
   const float c_aos = cosf(aos);
   const Matrix3f B = Vector3f(s_aos * s_aos, - c_aos * c_aos, 0.f).asDiagonal();
   const RowVector3f vBRqt = 2.f * va.transpose() * B * Rqt;
-  Matrix<float, 2, MEKF_WIND_COV_SIZE> H = Matrix<float, 2, MEKF_WIND_COV_SIZE>::Zero();
-  H.block<1,3>(0,MEKF_WIND_qx) = CRqt * skew_sym(mwp.state.speed - mwp.state.wind);
-  H.block<1,3>(0,MEKF_WIND_vx) = CRqt;
-  H.block<1,3>(0,MEKF_WIND_wx) = -CRqt;
-  H.block<1,3>(1,MEKF_WIND_qx) = vBRqt * skew_sym(mwp.state.speed - mwp.state.wind);
-  H.block<1,3>(1,MEKF_WIND_vx) = vBRqt;
-  H.block<1,3>(1,MEKF_WIND_wx) = -vBRqt;
-  Matrix<float, MEKF_WIND_COV_SIZE, 2> Ht = H.transpose();
-  // Hn and Hnt matrices
-  Matrix2f Hn = Matrix2f::Identity();
-  Hn(0,0) = C(2) * va(0) - C(0) * va(2);
+  MEKFWObs H_aoa = MEKFWObs::Zero();
+  H_aoa.segment<3>(MEKF_WIND_qx) = CRqt * skew_sym(mwp.state.speed - mwp.state.wind);
+  H_aoa.segment<3>(MEKF_WIND_vx) = CRqt;
+  H_aoa.segment<3>(MEKF_WIND_wx) = -CRqt;
+  MEKFWObs H_aos = MEKFWObs::Zero();
+  H_aos.segment<3>(MEKF_WIND_qx) = vBRqt * skew_sym(mwp.state.speed - mwp.state.wind);
+  H_aos.segment<3>(MEKF_WIND_vx) = vBRqt;
+  H_aos.segment<3>(MEKF_WIND_wx) = -vBRqt;
+  // Hn is diagonal, so Hn*N*Hnt is diagonal
+  const float hn_aoa = C(2) * va(0) - C(0) * va(2);
   const float s_2aos = sinf(2.0f * aos);
-  Hn(1,1) = (RowVector3f(-s_2aos, 0.f, s_2aos) * va.asDiagonal()) * va;
-  Matrix2f Hnt = Hn.transpose();
-  // S = H*P*Ht + Hn*N*Hnt
-  Matrix2f S = H * mwp.P * Ht + Hn * mwp.R.block<2,2>(MEKF_WIND_raoa,MEKF_WIND_raoa) * Hnt;
-  // K = P*Ht*S^-1
-  Matrix<float, MEKF_WIND_COV_SIZE, 2> K = mwp.P * Ht * S.inverse();
+  const float hn_aos = (RowVector3f(-s_2aos, 0.f, s_2aos) * va.asDiagonal()) * va;
   // Residual z_m - h(z)
-  Vector2f res = Vector2f::Zero();
-  res(0) = - C * va;
-  res(1) = - va.transpose() * B * va;
+  const float res_aoa = - C * va;
+  const float res_aos = - va.transpose() * B * va;
+  // sequential update
+  MEKFWErr dx = MEKFWErr::Zero();
+  scalar_update(dx, H_aoa, res_aoa, hn_aoa * hn_aoa * mwp.R(MEKF_WIND_raoa,MEKF_WIND_raoa));
+  scalar_update(dx, H_aos, res_aos, hn_aos * hn_aos * mwp.R(MEKF_WIND_raos,MEKF_WIND_raos));
+  cov_sym_from_upper(mwp.P);
   // Update state
-  Quaternionf q_tmp;
-  q_tmp.w() = 1.f;
-  q_tmp.vec() = 0.5f * K.block<3,2>(MEKF_WIND_qx,0) * res;
-  q_tmp.normalize();
-  mwp.state.quat = q_tmp * mwp.state.quat;
-  mwp.state.quat.normalize();
-  mwp.state.speed       += K.block<3,2>(MEKF_WIND_vx,0) * res;
-  mwp.state.pos         += K.block<3,2>(MEKF_WIND_px,0) * res;
-  mwp.state.rates_bias  += K.block<3,2>(MEKF_WIND_rbp,0) * res;
-  mwp.state.accel_bias  += K.block<3,2>(MEKF_WIND_abx,0) * res;
-  mwp.state.baro_bias   += K.block<1,2>(MEKF_WIND_bb,0) * res;
-  if (!ins_mekf_wind_params.disable_wind) {
-    mwp.state.wind        += K.block<3,2>(MEKF_WIND_wx,0) * res;
-  }
-  // Update covariance
-  mwp.P = (MEKFWCov::Identity() - K * H) * mwp.P;
+  correct_state(dx, false);
 }
 
 /**
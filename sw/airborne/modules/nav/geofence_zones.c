@@ -0,0 +1,528 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file modules/nav/geofence_zones.c
+ *
+ * Runtime polygon geofence with keep-in and keep-out zones.
+ *
+ * The grid covers the bounding box of all zones. For each cell, an entry is
+ * stored for every zone overlapping the cell, with the inside status of the
+ * cell center and the list of the zone edges crossing the cell.
+ * A point is inside a zone if the segment from the cell center to the point
+ * crosses the zone boundary an even number of times and the center is inside
+ * (or odd and outside). Only the edges of the cell need to be tested.
+ *
+ * If the index storage is full, queries fall back to a ray casting over all
+ * edges (with bounding box rejection).
+ *
+ * Zone ids are slots in the zone table, a removed zone frees its slot and
+ * the edges of the following zones are moved down.
+ */
+
+#include "modules/nav/geofence_zones.h"
+#if defined(FIXEDWING_FIRMWARE)
+#include "subsystems/navigation/common_nav.h"
+#else
+#include "subsystems/navigation/waypoints.h"
+#endif
+#include "state.h"
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+/** Max number of zones */
+#ifndef GEOFENCE_ZONES_MAX
+#define GEOFENCE_ZONES_MAX 32
+#endif
+
+/** Max number of vertices, for all zones */
+#ifndef GEOFENCE_ZONES_MAX_POINTS
+#define GEOFENCE_ZONES_MAX_POINTS 256
+#endif
+
+/** Number of grid cells in each direction */
+#ifndef GEOFENCE_ZONES_GRID
+#define GEOFENCE_ZONES_GRID 16
+#endif
+
+/** Max number of (cell, zone) entries in the grid */
+#ifndef GEOFENCE_ZONES_MAX_ENTRIES
+#define GEOFENCE_ZONES_MAX_ENTRIES 1024
+#endif
+
+/** Max number of edge references in the grid */
+#ifndef GEOFENCE_ZONES_MAX_CELL_EDGES
+#define GEOFENCE_ZONES_MAX_CELL_EDGES 2048
+#endif
+
+#if GEOFENCE_ZONES_MAX > 32767
+#error "GEOFENCE_ZONES_MAX must be lower than 32768"
+#endif
+
+#define GEOFENCE_ZONES_NB_CELLS (GEOFENCE_ZONES_GRID * GEOFENCE_ZONES_GRID)
+
+/** Edge from a to a + d */
+struct GeofenceZonesEdge {
+  float ax, ay;
+  float dx, dy;
+  float inv_len2;   ///< 1 / |d|^2, 0 for a null edge
+  float slope;      ///< dx / dy, 0 for an horizontal edge
+};
+
+struct GeofenceZonesZone {
+  uint16_t first_edge;
+  uint8_t nb_edges; ///< 0 for a free slot
+  uint8_t type;
+  float xmin, xmax, ymin, ymax;
+};
+
+/** Zone overlapping a grid cell */
+struct GeofenceZonesEntry {
+  uint16_t zone;
+  bool center_inside;
+  uint16_t first;   ///< first index in cell_edges
+  uint16_t nb;      ///< number of edges crossing the cell
+};
+
+struct GeofenceZones geofence_zones;
+
+static struct GeofenceZonesEdge edges[GEOFENCE_ZONES_MAX_POINTS];
+static struct GeofenceZonesZone zones[GEOFENCE_ZONES_MAX];
+static uint16_t nb_edges;
+static uint16_t nb_slots; ///< zone slots in use, the last one is not free
+static uint16_t nb_keep_in;
+
+/** Uniform grid */
+static struct {
+  bool valid;
+  float x0, y0;           ///< south-west corner
+  float cell_w, cell_h;
+  float inv_w, inv_h;
+  uint16_t cell_first[GEOFENCE_ZONES_NB_CELLS];
+  uint16_t cell_nb[GEOFENCE_ZONES_NB_CELLS];
+  struct GeofenceZonesEntry entries[GEOFENCE_ZONES_MAX_ENTRIES];
+  uint16_t cell_edges[GEOFENCE_ZONES_MAX_CELL_EDGES];
+} grid;
+
+/** Last full evaluation, for the incremental tracking */
+static struct {
+  bool valid;
+  float x, y;
+  float margin;
+} last_eval;
+
+/** Ray casting over all the edges of a zone */
+static bool zone_contains(const struct GeofenceZonesZone *z, float x, float y)
+{
+  if (x < z->xmin || x > z->xmax || y < z->ymin || y > z->ymax) {
+    return false;
+  }
+  bool inside = false;
+  const struct GeofenceZonesEdge *e = &edges[z->first_edge];
+  for (int i = 0; i < z->nb_edges; i++, e++) {
+    if ((e->ay > y) != (e->ay + e->dy > y) && x < e->ax + (y - e->ay) * e->slope) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+/** Inside test from the cell center (cx, cy), only with the edges of the cell */
+static bool entry_contains(const struct GeofenceZonesEntry *en, float cx, float cy, float x, float y)
+{
+  bool inside = en->center_inside;
+  const float sx = x - cx;
+  const float sy = y - cy;
+  const uint16_t *idx = &grid.cell_edges[en->first];
+  for (int i = 0; i < en->nb; i++) {
+    const struct GeofenceZonesEdge *e = &edges[idx[i]];
+    // edge end points on each side of the line center-point
+    const float sa = sx * (e->ay - cy) - sy * (e->ax - cx);
+    const float sb = sx * (e->ay + e->dy - cy) - sy * (e->ax + e->dx - cx);
+    if ((sa > 0.f) == (sb > 0.f)) {
+      continue;
+    }
+    // center and point on each side of the edge
+    const float oc = e->dx * (cy - e->ay) - e->dy * (cx - e->ax);
+    const float op = e->dx * (y - e->ay) - e->dy * (x - e->ax);
+    if ((oc > 0.f) != (op > 0.f)) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+static float edge_dist2(const struct GeofenceZonesEdge *e, float x, float y)
+{
+  const float px = x - e->ax;
+  const float py = y - e->ay;
+  float t = (px * e->dx + py * e->dy) * e->inv_len2;
+  Bound(t, 0.f, 1.f);
+  const float ex = px - t * e->dx;
+  const float ey = py - t * e->dy;
+  return ex * ex + ey * ey;
+}
+
+/** Cell of a point
+ * @return false if outside of the grid
+ */
+static bool grid_cell(float x, float y, int *i, int *j)
+{
+  const float u = (x - grid.x0) * grid.inv_w;
+  const float v = (y - grid.y0) * grid.inv_h;
+  if (u < 0.f || v < 0.f || u >= GEOFENCE_ZONES_GRID || v >= GEOFENCE_ZONES_GRID) {
+    return false;
+  }
+  *i = (int)u;
+  *j = (int)v;
+  return true;
+}
+
+static void grid_build(void)
+{
+  grid.valid = false;
+  if (geofence_zones.nb_zones == 0) {
+    return;
+  }
+
+  float xmin = FLT_MAX, xmax = -FLT_MAX;
+  float ymin = FLT_MAX, ymax = -FLT_MAX;
+  for (int z = 0; z < nb_slots; z++) {
+    if (zones[z].nb_edges == 0) {
+      continue;
+    }
+    xmin = Min(xmin, zones[z].xmin);
+    xmax = Max(xmax, zones[z].xmax);
+    ymin = Min(ymin, zones[z].ymin);
+    ymax = Max(ymax, zones[z].ymax);
+  }
+  // small border so that all vertices are strictly inside the grid
+  grid.x0 = xmin - 1.f;
+  grid.y0 = ymin - 1.f;
+  grid.cell_w = (xmax - xmin + 2.f) / GEOFENCE_ZONES_GRID;
+  grid.cell_h = (ymax - ymin + 2.f) / GEOFENCE_ZONES_GRID;
+  grid.inv_w = 1.f / grid.cell_w;
+  grid.inv_h = 1.f / grid.cell_h;
+
+  uint16_t nb_entries = 0;
+  uint16_t nb_idx = 0;
+  for (int j = 0; j < GEOFENCE_ZONES_GRID; j++) {
+    const float cy0 = grid.y0 + j * grid.cell_h;
+    const float cy1 = cy0 + grid.cell_h;
+    for (int i = 0; i < GEOFENCE_ZONES_GRID; i++) {
+      const float cx0 = grid.x0 + i * grid.cell_w;
+      const float cx1 = cx0 + grid.cell_w;
+      const int c = j * GEOFENCE_ZONES_GRID + i;
+      grid.cell_first[c] = nb_entries;
+      grid.cell_nb[c] = 0;
+      for (int z = 0; z < nb_slots; z++) {
+        const struct GeofenceZonesZone *zn = &zones[z];
+        if (zn->nb_edges == 0) {
+          continue;
+        }
+        if (zn->xmax < cx0 || zn->xmin > cx1 || zn->ymax < cy0 || zn->ymin > cy1) {
+          continue;
+        }
+        if (nb_entries >= GEOFENCE_ZONES_MAX_ENTRIES) {
+          return;
+        }
+        struct GeofenceZonesEntry *en = &grid.entries[nb_entries];
+        en->zone = z;
+        en->first = nb_idx;
+        en->nb = 0;
+        for (int k = zn->first_edge; k < zn->first_edge + zn->nb_edges; k++) {
+          const struct GeofenceZonesEdge *e = &edges[k];
+          // conservative test with the edge bounding box
+          if (Max(e->ax, e->ax + e->dx) < cx0 || Min(e->ax, e->ax + e->dx) > cx1 ||
+              Max(e->ay, e->ay + e->dy) < cy0 || Min(e->ay, e->ay + e->dy) > cy1) {
+            continue;
+          }
+          if (nb_idx >= GEOFENCE_ZONES_MAX_CELL_EDGES) {
+            return;
+          }
+          grid.cell_edges[nb_idx++] = k;
+          en->nb++;
+        }
+        en->center_inside = zone_contains(zn, cx0 + 0.5f * grid.cell_w, cy0 + 0.5f * grid.cell_h);
+        if (en->nb == 0 && !en->center_inside) {
+          // cell outside of the zone
+          continue;
+        }
+        nb_entries++;
+        grid.cell_nb[c]++;
+      }
+    }
+  }
+  grid.valid = true;
+}
+
+/** Evaluate the geofence at a position
+ * @param zone violated keep-out zone or -1
+ * @return true on violation
+ */
+static bool geofence_zones_eval(float x, float y, int16_t *zone)
+{
+  bool in_keep_in = false;
+  *zone = -1;
+  if (geofence_zones.nb_zones == 0) {
+    return false;
+  }
+
+  if (grid.valid) {
+    int i, j;
+    if (grid_cell(x, y, &i, &j)) {
+      const int c = j * GEOFENCE_ZONES_GRID + i;
+      const float cx = grid.x0 + (i + 0.5f) * grid.cell_w;
+      const float cy = grid.y0 + (j + 0.5f) * grid.cell_h;
+      for (int k = grid.cell_first[c]; k < grid.cell_first[c] + grid.cell_nb[c]; k++) {
+        const struct GeofenceZonesEntry *en = &grid.entries[k];
+        if (!entry_contains(en, cx, cy, x, y)) {
+          continue;
+        }
+        if (zones[en->zone].type == GEOFENCE_ZONES_KEEP_OUT) {
+          *zone = en->zone;
+          return true;
+        }
+        in_keep_in = true;
+      }
+    }
+  } else {
+    for (int z = 0; z < nb_slots; z++) {
+      // free slots have no edges and are never inside
+      if (!zone_contains(&zones[z], x, y)) {
+        continue;
+      }
+      if (zones[z].type == GEOFENCE_ZONES_KEEP_OUT) {
+        *zone = z;
+        return true;
+      }
+      in_keep_in = true;
+    }
+  }
+  return nb_keep_in > 0 && !in_keep_in;
+}
+
+/** Lower bound of the distance to the nearest zone boundary
+ * Edges of the 3x3 cells around the point are tested, the others are
+ * farther than the border of this block.
+ */
+static float geofence_zones_margin(float x, float y)
+{
+  float d2 = FLT_MAX;
+  if (!grid.valid) {
+    for (int k = 0; k < nb_edges; k++) {
+      d2 = Min(d2, edge_dist2(&edges[k], x, y));
+    }
+    return sqrtf(d2);
+  }
+
+  int i, j;
+  if (!grid_cell(x, y, &i, &j)) {
+    // all edges are inside the grid
+    const float ex = Max(Max(grid.x0 - x, x - grid.x0 - GEOFENCE_ZONES_GRID * grid.cell_w), 0.f);
+    const float ey = Max(Max(grid.y0 - y, y - grid.y0 - GEOFENCE_ZONES_GRID * grid.cell_h), 0.f);
+    return sqrtf(ex * ex + ey * ey);
+  }
+
+  const int i0 = Max(i - 1, 0), i1 = Min(i + 1, GEOFENCE_ZONES_GRID - 1);
+  const int j0 = Max(j - 1, 0), j1 = Min(j + 1, GEOFENCE_ZONES_GRID - 1);
+  float d = FLT_MAX;
+  if (i0 > 0) { d = Min(d, x - (grid.x0 + i0 * grid.cell_w)); }
+  if (i1 < GEOFENCE_ZONES_GRID - 1) { d = Min(d, grid.x0 + (i1 + 1) * grid.cell_w - x); }
+  if (j0 > 0) { d = Min(d, y - (grid.y0 + j0 * grid.cell_h)); }
+  if (j1 < GEOFENCE_ZONES_GRID - 1) { d = Min(d, grid.y0 + (j1 + 1) * grid.cell_h - y); }
+
+  for (int cj = j0; cj <= j1; cj++) {
+    for (int ci = i0; ci <= i1; ci++) {
+      const int c = cj * GEOFENCE_ZONES_GRID + ci;
+      for (int k = grid.cell_first[c]; k < grid.cell_first[c] + grid.cell_nb[c]; k++) {
+        const struct GeofenceZonesEntry *en = &grid.entries[k];
+        for (int l = en->first; l < en->first + en->nb; l++) {
+          d2 = Min(d2, edge_dist2(&edges[grid.cell_edges[l]], x, y));
+        }
+      }
+    }
+  }
+  return Min(d, sqrtf(d2));
+}
+
+void geofence_zones_init(void)
+{
+  geofence_zones_clear();
+}
+
+void geofence_zones_clear(void)
+{
+  geofence_zones.nb_zones = 0;
+  geofence_zones.violation = false;
+  geofence_zones.zone = -1;
+  geofence_zones.margin = FLT_MAX;
+  nb_edges = 0;
+  nb_slots = 0;
+  nb_keep_in = 0;
+  for (int z = 0; z < GEOFENCE_ZONES_MAX; z++) {
+    zones[z].nb_edges = 0;
+  }
+  grid.valid = false;
+  last_eval.valid = false;
+}
+
+/** First free zone slot, zone_fits must be true */
+static int zone_free_slot(void)
+{
+  int id = 0;
+  while (zones[id].nb_edges != 0) {
+    id++;
+  }
+  return id;
+}
+
+/** Finalize a zone whose vertices are stored in the edges a points
+ * @return zone id
+ */
+static int zone_finalize(uint8_t n, uint8_t type)
+{
+  const int id = zone_free_slot();
+  struct GeofenceZonesZone *z = &zones[id];
+  z->first_edge = nb_edges;
+  z->nb_edges = n;
+  z->type = type;
+  z->xmin = z->xmax = edges[nb_edges].ax;
+  z->ymin = z->ymax = edges[nb_edges].ay;
+  for (int i = 0; i < n; i++) {
+    struct GeofenceZonesEdge *e = &edges[nb_edges + i];
+    const struct GeofenceZonesEdge *next = &edges[nb_edges + (i + 1) % n];
+    e->dx = next->ax - e->ax;
+    e->dy = next->ay - e->ay;
+    const float len2 = e->dx * e->dx + e->dy * e->dy;
+    e->inv_len2 = len2 > 0.f ? 1.f / len2 : 0.f;
+    e->slope = e->dy != 0.f ? e->dx / e->dy : 0.f;
+    z->xmin = Min(z->xmin, e->ax);
+    z->xmax = Max(z->xmax, e->ax);
+    z->ymin = Min(z->ymin, e->ay);
+    z->ymax = Max(z->ymax, e->ay);
+  }
+  nb_edges += n;
+  if (type == GEOFENCE_ZONES_KEEP_IN) {
+    nb_keep_in++;
+  }
+
+  geofence_zones.nb_zones++;
+  nb_slots = Max(nb_slots, id + 1);
+  grid_build();
+  last_eval.valid = false;
+  return id;
+}
+
+static bool zone_fits(uint8_t n)
+{
+  return n >= 3 && geofence_zones.nb_zones < GEOFENCE_ZONES_MAX && nb_edges + n <= GEOFENCE_ZONES_MAX_POINTS;
+}
+
+int geofence_zones_add(const float *x, const float *y, uint8_t n, uint8_t type)
+{
+  if (!zone_fits(n)) {
+    return -1;
+  }
+  for (int i = 0; i < n; i++) {
+    edges[nb_edges + i].ax = x[i];
+    edges[nb_edges + i].ay = y[i];
+  }
+  return zone_finalize(n, type);
+}
+
+bool geofence_zones_add_waypoints(uint8_t first_wp, uint8_t n, uint8_t type)
+{
+  if (zone_fits(n)) {
+    for (int i = 0; i < n; i++) {
+      edges[nb_edges + i].ax = WaypointX(first_wp + i);
+      edges[nb_edges + i].ay = WaypointY(first_wp + i);
+    }
+    zone_finalize(n, type);
+  }
+  return false;
+}
+
+bool geofence_zones_remove(int id)
+{
+  if (id < 0 || id >= nb_slots || zones[id].nb_edges == 0) {
+    return false;
+  }
+  struct GeofenceZonesZone *z = &zones[id];
+  const uint16_t first = z->first_edge;
+  const uint8_t n = z->nb_edges;
+  // move down the edges of the zones stored after this one
+  memmove(&edges[first], &edges[first + n], (nb_edges - first - n) * sizeof(struct GeofenceZonesEdge));
+  nb_edges -= n;
+  for (int k = 0; k < nb_slots; k++) {
+    if (zones[k].nb_edges != 0 && zones[k].first_edge > first) {
+      zones[k].first_edge -= n;
+    }
+  }
+  if (z->type == GEOFENCE_ZONES_KEEP_IN) {
+    nb_keep_in--;
+  }
+  z->nb_edges = 0;
+  while (nb_slots > 0 && zones[nb_slots - 1].nb_edges == 0) {
+    nb_slots--;
+  }
+  geofence_zones.nb_zones--;
+  if (geofence_zones.nb_zones == 0) {
+    geofence_zones.violation = false;
+    geofence_zones.zone = -1;
+    geofence_zones.margin = FLT_MAX;
+  }
+  grid_build();
+  last_eval.valid = false;
+  return true;
+}
+
+bool geofence_zones_check(float x, float y)
+{
+  int16_t zone;
+  return geofence_zones_eval(x, y, &zone);
+}
+
+void geofence_zones_periodic(void)
+{
+  if (geofence_zones.nb_zones == 0) {
+    return;
+  }
+  struct EnuCoor_f *pos = stateGetPositionEnu_f();
+
+  if (last_eval.valid) {
+    const float dx = pos->x - last_eval.x;
+    const float dy = pos->y - last_eval.y;
+    const float moved = sqrtf(dx * dx + dy * dy);
+    if (moved < last_eval.margin) {
+      // no boundary crossed since the last evaluation
+      geofence_zones.margin = last_eval.margin - moved;
+      return;
+    }
+  }
+
+  geofence_zones.violation = geofence_zones_eval(pos->x, pos->y, &geofence_zones.zone);
+  geofence_zones.margin = geofence_zones_margin(pos->x, pos->y);
+  last_eval.x = pos->x;
+  last_eval.y = pos->y;
+  last_eval.margin = geofence_zones.margin;
+  last_eval.valid = true;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file modules/nav/geofence_zones.h
+ *
+ * Runtime polygon geofence with keep-in and keep-out zones.
+ *
+ * Unlike the flight plan sectors, zones can be added and removed in flight.
+ * Polygons are stored as edges with precomputed coefficients and indexed
+ * with a uniform grid: a query only tests the edges crossing the cell of
+ * the point, against the precomputed inside status of the cell center.
+ * The periodic function also keeps a lower bound of the distance to the
+ * nearest zone boundary and skips the evaluation while the vehicle moved
+ * less than this margin.
+ *
+ * Coordinates are local ENU positions in meters, as the waypoints.
+ */
+
+#ifndef GEOFENCE_ZONES_H
+#define GEOFENCE_ZONES_H
+
+#include "std.h"
+
+/** Zone types */
+#define GEOFENCE_ZONES_KEEP_IN  0 ///< vehicle must stay inside one of the keep-in zones
+#define GEOFENCE_ZONES_KEEP_OUT 1 ///< vehicle must stay outside of all keep-out zones
+
+/** Geofence status, updated by geofence_zones_periodic */
+struct GeofenceZones {
+  bool violation;   ///< true if outside of the keep-in zones or inside a keep-out zone
+  int16_t zone;     ///< violated keep-out zone, -1 if none or outside of the keep-in zones
+  float margin;     ///< lower bound of the distance to the nearest zone boundary (m)
+  uint16_t nb_zones; ///< number of zones
+};
+
+extern struct GeofenceZones geofence_zones;
+
+extern void geofence_zones_init(void);
+extern void geofence_zones_periodic(void);
+
+/** Add a polygon zone
+ * @param x east coordinates of the vertices
+ * @param y north coordinates of the vertices
+ * @param n number of vertices, at least 3
+ * @param type GEOFENCE_ZONES_KEEP_IN or GEOFENCE_ZONES_KEEP_OUT
+ * @return zone id, -1 if the zone or vertex storage is full
+ */
+extern int geofence_zones_add(const float *x, const float *y, uint8_t n, uint8_t type);
+
+/** Add a zone from consecutive waypoints
+ * Waypoint positions are copied, remove and add the zone again
+ * if the waypoints are moved.
+ * @param first_wp first waypoint/corner of the polygon
+ * @param n number of waypoints/corners
+ * @param type GEOFENCE_ZONES_KEEP_IN or GEOFENCE_ZONES_KEEP_OUT
+ * @return false, to be used as a flight plan call
+ */
+extern bool geofence_zones_add_waypoints(uint8_t first_wp, uint8_t n, uint8_t type);
+
+/** Remove a zone
+ * The ids of the other zones are unchanged, the slot is reused by the next add.
+ * @param id zone id returned by geofence_zones_add
+ * @return false if there is no such zone
+ */
+extern bool geofence_zones_remove(int id);
+
+/** Remove all zones */
+extern void geofence_zones_clear(void);
+
+/** Check a position against the zones
+ * @param x east position (m)
+ * @param y north position (m)
+ * @return true if the position violates the geofence
+ */
+extern bool geofence_zones_check(float x, float y);
+
+#endif /* GEOFENCE_ZONES_H */
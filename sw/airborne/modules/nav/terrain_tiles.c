@@ -0,0 +1,426 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file modules/nav/terrain_tiles.c
+ *
+ * Onboard terrain elevation from preprocessed SRTM tiles.
+ *
+ * Tile file format (little endian), see sw/tools/srtm/srtm_terrain.py:
+ *  - header (struct TerrainTilesHeader)
+ *  - blocks x blocks square blocks of samples x samples int16 heights,
+ *    starting at block_offset, every block_stride bytes (page aligned).
+ *    Blocks and rows are stored from south-west to north-east, the last
+ *    row and column of a block are shared with the next block so that
+ *    bilinear interpolation never needs two blocks.
+ *
+ * A few tile files are kept open and at most TERRAIN_TILES_CACHE_SIZE blocks
+ * are mapped, the least recently used block is unmapped when a new one is
+ * needed. Prefetching maps the blocks and asks the kernel to read them
+ * ahead (madvise), so that the lookups in the control loop do not wait
+ * for the storage.
+ */
+
+#include "modules/nav/terrain_tiles.h"
+#if defined(FIXEDWING_FIRMWARE)
+#include "subsystems/navigation/common_nav.h"
+#else
+#include "subsystems/navigation/waypoints.h"
+#endif
+#include "state.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/** Directory of the tile files */
+#ifndef TERRAIN_TILES_PATH
+#define TERRAIN_TILES_PATH "terrain"
+#endif
+
+/** Max number of mapped blocks */
+#ifndef TERRAIN_TILES_CACHE_SIZE
+#define TERRAIN_TILES_CACHE_SIZE 16
+#endif
+
+/** Max number of open tile files */
+#ifndef TERRAIN_TILES_MAX_FILES
+#define TERRAIN_TILES_MAX_FILES 4
+#endif
+
+/** Prefetch the terrain along the velocity vector for this time (s) */
+#ifndef TERRAIN_TILES_LOOKAHEAD
+#define TERRAIN_TILES_LOOKAHEAD 30.f
+#endif
+
+#define TERRAIN_TILES_MAGIC "PPRZTER1"
+
+/** Tile file header */
+struct TerrainTilesHeader {
+  char magic[8];
+  int16_t lat;            ///< south-west corner latitude (deg)
+  int16_t lon;            ///< south-west corner longitude (deg)
+  uint16_t samples;       ///< samples per block side, including the shared border
+  uint16_t blocks;        ///< blocks per tile side
+  uint32_t block_offset;  ///< file offset of the first block, page aligned
+  uint32_t block_stride;  ///< bytes between two blocks, page aligned
+  int16_t nodata;         ///< value of the missing samples
+  uint8_t pad[6];
+};
+
+struct TerrainTilesFile {
+  bool used;
+  bool missing;           ///< file not found or invalid, not opened again
+  int fd;
+  uint32_t last_use;
+  struct TerrainTilesHeader hdr;
+};
+
+struct TerrainTilesBlock {
+  bool used;
+  int16_t lat, lon;       ///< tile
+  uint16_t bi, bj;        ///< block in the tile (east, north)
+  uint16_t samples;
+  uint16_t nb_blocks;     ///< blocks per tile side
+  int16_t nodata;
+  const int16_t *data;
+  size_t len;
+  uint32_t last_use;
+};
+
+struct TerrainTiles terrain_tiles;
+
+static struct TerrainTilesFile files[TERRAIN_TILES_MAX_FILES];
+static struct TerrainTilesBlock blocks[TERRAIN_TILES_CACHE_SIZE];
+static struct TerrainTilesBlock *last_block;
+static uint32_t use_counter;
+
+/** Local flat earth conversion from ENU, scales computed for the origin */
+static struct {
+  int32_t lat0, lon0;
+  float lat_of_y;         ///< 1e7 deg per meter north
+  float lon_of_x;         ///< 1e7 deg per meter east
+} local;
+
+/** Floor division by 1e7, to get the tile of a coordinate */
+static inline int16_t tile_of_deg7(int32_t v)
+{
+  return (int16_t)(v >= 0 ? v / 10000000 : -((-v + 9999999) / 10000000));
+}
+
+static struct TerrainTilesFile *file_get(int16_t lat, int16_t lon)
+{
+  struct TerrainTilesFile *f = NULL;
+  struct TerrainTilesFile *lru = &files[0];
+  for (int i = 0; i < TERRAIN_TILES_MAX_FILES; i++) {
+    if (files[i].used && files[i].hdr.lat == lat && files[i].hdr.lon == lon) {
+      f = &files[i];
+      break;
+    }
+    if (!files[i].used || (lru->used && files[i].last_use < lru->last_use)) {
+      lru = &files[i];
+    }
+  }
+
+  if (f == NULL) {
+    // open the tile file in place of the least recently used one
+    f = lru;
+    if (f->used && !f->missing) {
+      close(f->fd);
+    }
+    memset(f, 0, sizeof(*f));
+    f->used = true;
+    f->hdr.lat = lat;
+    f->hdr.lon = lon;
+    char name[128];
+    snprintf(name, sizeof(name), "%s/%c%02d%c%03d.ter", TERRAIN_TILES_PATH,
+             lat >= 0 ? 'N' : 'S', abs(lat), lon >= 0 ? 'E' : 'W', abs(lon));
+    struct TerrainTilesHeader hdr;
+    const long page = sysconf(_SC_PAGESIZE);
+    f->fd = open(name, O_RDONLY);
+    if (f->fd < 0 || pread(f->fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+        memcmp(hdr.magic, TERRAIN_TILES_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.lat != lat || hdr.lon != lon || hdr.samples < 2 || hdr.blocks == 0 ||
+        hdr.block_offset % page != 0 || hdr.block_stride % page != 0) {
+      if (f->fd >= 0) {
+        close(f->fd);
+      }
+      f->missing = true;
+    } else {
+      f->hdr = hdr;
+    }
+  }
+  f->last_use = ++use_counter;
+  return f->missing ? NULL : f;
+}
+
+static struct TerrainTilesBlock *block_get(struct TerrainTilesFile *f, uint16_t bi, uint16_t bj, bool *mapped)
+{
+  struct TerrainTilesBlock *lru = &blocks[0];
+  *mapped = false;
+  for (int i = 0; i < TERRAIN_TILES_CACHE_SIZE; i++) {
+    struct TerrainTilesBlock *b = &blocks[i];
+    if (b->used && b->bi == bi && b->bj == bj && b->lat == f->hdr.lat && b->lon == f->hdr.lon) {
+      b->last_use = ++use_counter;
+      return b;
+    }
+    if (!b->used || (lru->used && b->last_use < lru->last_use)) {
+      lru = b;
+    }
+  }
+
+  // map the block in place of the least recently used one
+  if (lru->used) {
+    munmap((void *)lru->data, lru->len);
+    lru->used = false;
+    if (last_block == lru) {
+      last_block = NULL;
+    }
+  }
+  const size_t len = (size_t)f->hdr.samples * f->hdr.samples * sizeof(int16_t);
+  const off_t offset = f->hdr.block_offset + (off_t)(bj * f->hdr.blocks + bi) * f->hdr.block_stride;
+  void *data = mmap(NULL, len, PROT_READ, MAP_SHARED, f->fd, offset);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+  lru->used = true;
+  lru->lat = f->hdr.lat;
+  lru->lon = f->hdr.lon;
+  lru->bi = bi;
+  lru->bj = bj;
+  lru->samples = f->hdr.samples;
+  lru->nb_blocks = f->hdr.blocks;
+  lru->nodata = f->hdr.nodata;
+  lru->data = (const int16_t *)data;
+  lru->len = len;
+  lru->last_use = ++use_counter;
+  *mapped = true;
+  return lru;
+}
+
+/** Position in samples from the south-west corner of the tile */
+static inline void tile_position(float *x, float *y, struct LlaCoor_i *lla, int16_t lat, int16_t lon,
+                                 uint16_t samples, uint16_t nb_blocks)
+{
+  const float per_deg7 = (float)((samples - 1) * nb_blocks) * 1e-7f;
+  *x = (float)(lla->lon - (int32_t)lon * 10000000) * per_deg7;
+  *y = (float)(lla->lat - (int32_t)lat * 10000000) * per_deg7;
+}
+
+/** Block containing a position and position in the block (in samples)
+ * @param mapped set to true if the block has just been mapped
+ */
+static struct TerrainTilesBlock *block_locate(struct LlaCoor_i *lla, float *u, float *v, bool *mapped)
+{
+  const int16_t lat = tile_of_deg7(lla->lat);
+  const int16_t lon = tile_of_deg7(lla->lon);
+  float x, y;
+  *mapped = false;
+
+  // fast path, same block as the previous lookup
+  struct TerrainTilesBlock *b = last_block;
+  if (b != NULL && b->lat == lat && b->lon == lon) {
+    const uint16_t step = b->samples - 1;
+    tile_position(&x, &y, lla, lat, lon, b->samples, b->nb_blocks);
+    *u = x - b->bi * step;
+    *v = y - b->bj * step;
+    if (*u >= 0.f && *u <= step && *v >= 0.f && *v <= step) {
+      b->last_use = ++use_counter;
+      return b;
+    }
+  }
+
+  struct TerrainTilesFile *f = file_get(lat, lon);
+  if (f == NULL) {
+    return NULL;
+  }
+  const uint16_t step = f->hdr.samples - 1;
+  tile_position(&x, &y, lla, lat, lon, f->hdr.samples, f->hdr.blocks);
+  uint16_t bi = (uint16_t)(x / step);
+  uint16_t bj = (uint16_t)(y / step);
+  if (bi >= f->hdr.blocks) { bi = f->hdr.blocks - 1; }
+  if (bj >= f->hdr.blocks) { bj = f->hdr.blocks - 1; }
+  *u = x - bi * step;
+  *v = y - bj * step;
+  return block_get(f, bi, bj, mapped);
+}
+
+bool terrain_tiles_height(float *h, struct LlaCoor_i *lla)
+{
+  float u, v;
+  bool mapped;
+  struct TerrainTilesBlock *b = block_locate(lla, &u, &v, &mapped);
+  if (b == NULL) {
+    return false;
+  }
+  last_block = b;
+
+  const int s = b->samples;
+  int c = (int)u;
+  int r = (int)v;
+  if (c > s - 2) { c = s - 2; }
+  if (r > s - 2) { r = s - 2; }
+  const float tx = u - c;
+  const float ty = v - r;
+  const int16_t *p = &b->data[r * s + c];
+  const int16_t h00 = p[0], h01 = p[1], h10 = p[s], h11 = p[s + 1];
+  if (h00 == b->nodata || h01 == b->nodata || h10 == b->nodata || h11 == b->nodata) {
+    return false;
+  }
+  const float h0 = h00 + tx * (h01 - h00);
+  const float h1 = h10 + tx * (h11 - h10);
+  *h = h0 + ty * (h1 - h0);
+  return true;
+}
+
+/** Local ENU to LLA, flat earth with the WGS84 radii at the origin */
+static bool lla_of_enu(struct LlaCoor_i *lla, struct EnuCoor_f *pos)
+{
+  if (!stateIsLocalCoordinateValid()) {
+    return false;
+  }
+  struct LlaCoor_i *o = &state.ned_origin_i.lla;
+  if (o->lat != local.lat0 || o->lon != local.lon0 || local.lat_of_y == 0.f) {
+    const float a = 6378137.f;
+    const float e2 = 0.00669437999014f;
+    const float sl = sinf(state.ned_origin_f.lla.lat);
+    const float w2 = 1.f - e2 * sl * sl;
+    const float rn = a / sqrtf(w2);              // prime vertical radius
+    const float rm = rn * (1.f - e2) / w2;       // meridian radius
+    local.lat0 = o->lat;
+    local.lon0 = o->lon;
+    local.lat_of_y = 1e7f * (180.f / M_PI) / rm;
+    local.lon_of_x = 1e7f * (180.f / M_PI) / (rn * cosf(state.ned_origin_f.lla.lat));
+  }
+  lla->lat = local.lat0 + (int32_t)(pos->y * local.lat_of_y);
+  lla->lon = local.lon0 + (int32_t)(pos->x * local.lon_of_x);
+  lla->alt = 0;
+  return true;
+}
+
+bool terrain_tiles_height_enu(float *h, struct EnuCoor_f *pos)
+{
+  struct LlaCoor_i lla;
+  return lla_of_enu(&lla, pos) && terrain_tiles_height(h, &lla);
+}
+
+/** Prefetch the blocks crossed by a segment
+ * The block grid is walked from one block boundary crossing to the next
+ * (as a voxel traversal), so that blocks only clipped by a corner are not
+ * skipped. The block size of the first tile is used for the whole segment.
+ */
+void terrain_tiles_prefetch_segment(struct LlaCoor_i *from, struct LlaCoor_i *to)
+{
+  // size of a block in 1e7 deg, 8 blocks per tile if the tile is not known
+  double cell = 1e7 / 8.;
+  struct TerrainTilesFile *f = file_get(tile_of_deg7(from->lat), tile_of_deg7(from->lon));
+  if (f != NULL) {
+    cell = 1e7 / f->hdr.blocks;
+  }
+  // positions in blocks
+  const double x0 = from->lon / cell, y0 = from->lat / cell;
+  const double dx = to->lon / cell - x0, dy = to->lat / cell - y0;
+  int i = (int)floor(x0), j = (int)floor(y0);
+  const int i1 = (int)floor(x0 + dx), j1 = (int)floor(y0 + dy);
+  const int si = dx > 0. ? 1 : -1, sj = dy > 0. ? 1 : -1;
+  // segment parameter of the next vertical and horizontal block boundaries
+  const double ti_step = dx != 0. ? fabs(1. / dx) : INFINITY;
+  const double tj_step = dy != 0. ? fabs(1. / dy) : INFINITY;
+  double ti = dx != 0. ? (dx > 0. ? i + 1 - x0 : x0 - i) * ti_step : INFINITY;
+  double tj = dy != 0. ? (dy > 0. ? j + 1 - y0 : y0 - j) * tj_step : INFINITY;
+
+  int nb_mapped = 0;
+  int nb = abs(i1 - i) + abs(j1 - j) + 1;
+  while (nb-- > 0 && nb_mapped < TERRAIN_TILES_CACHE_SIZE / 2) {
+    // block center, never on a tile boundary
+    struct LlaCoor_i p = {
+      .lat = (int32_t)((j + 0.5) * cell),
+      .lon = (int32_t)((i + 0.5) * cell),
+      .alt = 0
+    };
+    float u, v;
+    bool mapped;
+    struct TerrainTilesBlock *b = block_locate(&p, &u, &v, &mapped);
+    if (b != NULL && mapped) {
+      madvise((void *)b->data, b->len, MADV_WILLNEED);
+      nb_mapped++;
+    }
+    if (ti < tj) {
+      ti += ti_step;
+      i += si;
+    } else {
+      tj += tj_step;
+      j += sj;
+    }
+  }
+}
+
+bool terrain_tiles_prefetch_wp(uint8_t wp_from, uint8_t wp_to)
+{
+  // local waypoint positions, available with all the navigation modules
+  struct EnuCoor_f from_enu = { WaypointX(wp_from), WaypointY(wp_from), 0.f };
+  struct EnuCoor_f to_enu = { WaypointX(wp_to), WaypointY(wp_to), 0.f };
+  struct LlaCoor_i from, to;
+  if (lla_of_enu(&from, &from_enu) && lla_of_enu(&to, &to_enu)) {
+    terrain_tiles_prefetch_segment(&from, &to);
+  }
+  return false;
+}
+
+void terrain_tiles_init(void)
+{
+  memset(files, 0, sizeof(files));
+  memset(blocks, 0, sizeof(blocks));
+  last_block = NULL;
+  use_counter = 0;
+  local.lat_of_y = 0.f;
+  terrain_tiles.valid = false;
+  terrain_tiles.height = 0.f;
+  terrain_tiles.agl = 0.f;
+}
+
+void terrain_tiles_periodic(void)
+{
+  struct EnuCoor_f *pos = stateGetPositionEnu_f();
+  struct LlaCoor_i here, ahead;
+  if (!lla_of_enu(&here, pos)) {
+    terrain_tiles.valid = false;
+    return;
+  }
+
+  terrain_tiles.valid = terrain_tiles_height(&terrain_tiles.height, &here);
+  if (terrain_tiles.valid) {
+    terrain_tiles.agl = state.ned_origin_f.hmsl + pos->z - terrain_tiles.height;
+  }
+
+  // prefetch the terrain ahead of the vehicle
+  struct EnuCoor_f *speed = stateGetSpeedEnu_f();
+  struct EnuCoor_f next = {
+    pos->x + TERRAIN_TILES_LOOKAHEAD * speed->x,
+    pos->y + TERRAIN_TILES_LOOKAHEAD * speed->y,
+    pos->z
+  };
+  lla_of_enu(&ahead, &next);
+  terrain_tiles_prefetch_segment(&here, &ahead);
+}
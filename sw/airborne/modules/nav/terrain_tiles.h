@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file modules/nav/terrain_tiles.h
+ *
+ * Onboard terrain elevation from preprocessed SRTM tiles (Linux targets and NPS).
+ *
+ * Tiles are generated on the ground with sw/tools/srtm/srtm_terrain.py,
+ * one file per 1x1 degree SRTM tile, split in square blocks aligned on
+ * pages. Only a small working set of blocks is memory mapped (LRU),
+ * blocks around the vehicle and along the planned path are prefetched.
+ *
+ * Heights are above mean sea level (SRTM reference).
+ */
+
+#ifndef TERRAIN_TILES_H
+#define TERRAIN_TILES_H
+
+#include "std.h"
+#include "math/pprz_geodetic_int.h"
+#include "math/pprz_geodetic_float.h"
+
+/** Terrain under the vehicle, updated by terrain_tiles_periodic */
+struct TerrainTiles {
+  bool valid;     ///< true if the terrain height under the vehicle is known
+  float height;   ///< terrain height above MSL (m)
+  float agl;      ///< vehicle height above terrain (m)
+};
+
+extern struct TerrainTiles terrain_tiles;
+
+extern void terrain_tiles_init(void);
+extern void terrain_tiles_periodic(void);
+
+/** Terrain height at a position
+ * @param h output height above MSL (m)
+ * @param lla position (lat/lon in 1e7 deg)
+ * @return false if no data is available
+ */
+extern bool terrain_tiles_height(float *h, struct LlaCoor_i *lla);
+
+/** Terrain height at a local ENU position
+ * @param h output height above MSL (m)
+ * @param pos position relative to the local frame origin (m)
+ * @return false if no data is available or the local frame is not set
+ */
+extern bool terrain_tiles_height_enu(float *h, struct EnuCoor_f *pos);
+
+/** Map and prefetch the terrain blocks along a segment
+ * The number of prefetched blocks is limited to half of the cache.
+ * @param from start position
+ * @param to end position
+ */
+extern void terrain_tiles_prefetch_segment(struct LlaCoor_i *from, struct LlaCoor_i *to);
+
+/** Prefetch the terrain between two waypoints
+ * @return false, to be used as a flight plan call
+ */
+extern bool terrain_tiles_prefetch_wp(uint8_t wp_from, uint8_t wp_to);
+
+#endif /* TERRAIN_TILES_H */
@@ -20,63 +20,144 @@
 /**
  * @file "modules/pose_history/pose_history.c"
  * @author Roland Meertens
- * Ask this module for the pose the drone had closest to a given timestamp
+ * Ask this module for the pose the drone had at a given timestamp
+ *
+ * The poses are stored in a ring buffer written by the autopilot thread only.
+ * Readers (vision threads) do not lock: they find the poses around the
+ * requested time by binary search, interpolate them, and check afterwards
+ * that the writer did not overwrite the entries they used.
+ * Timestamps are compared with signed differences, so the wrap around
+ * of get_sys_time_usec is handled.
  */
 
 #include "modules/pose_history/pose_history.h"
-#include <sys/time.h>
 #include "mcu_periph/sys_time.h"
 #include "state.h"
-#ifdef __linux__
-#include <pthread.h>
-#endif
+#include <string.h>
 
 #ifndef POSE_HISTORY_SIZE
 #define POSE_HISTORY_SIZE 1024
 #endif
 
-struct rotation_history_ring_buffer_t {
-  uint32_t ring_index;
-  uint32_t ring_size;
-  struct pose_t ring_data[POSE_HISTORY_SIZE];
-};
-
-struct rotation_history_ring_buffer_t location_history;
+#if (POSE_HISTORY_SIZE & (POSE_HISTORY_SIZE - 1))
+#error "POSE_HISTORY_SIZE must be a power of 2"
+#endif
 
-#ifdef __linux__
-pthread_mutex_t pose_mutex;
+/** Number of oldest entries not used by readers, as they may be overwritten during a lookup */
+#ifndef POSE_HISTORY_GUARD
+#define POSE_HISTORY_GUARD 8
 #endif
 
+#define POSE_HISTORY_MASK (POSE_HISTORY_SIZE - 1)
+
+static struct pose_t pose_ring[POSE_HISTORY_SIZE];
+/** Number of poses written since init, the last one is at (pose_head - 1) & POSE_HISTORY_MASK */
+static volatile uint32_t pose_head;
+
+/** signed time difference, valid across timer wrap around */
+static inline int32_t pose_dt(uint32_t a, uint32_t b)
+{
+  return (int32_t)(a - b);
+}
+
+/** spherical linear interpolation between two unit quaternions */
+static void pose_quat_slerp(struct FloatQuat *q, struct FloatQuat *q0, struct FloatQuat *q1, float t)
+{
+  struct FloatQuat q1s = *q1;
+  float dot = q0->qi * q1->qi + q0->qx * q1->qx + q0->qy * q1->qy + q0->qz * q1->qz;
+  // take the shortest path
+  if (dot < 0.f) {
+    QUAT_EXPLEMENTARY(q1s, *q1);
+    dot = -dot;
+  }
+  float s0, s1;
+  if (dot > 0.9995f) {
+    // very close, linear interpolation
+    s0 = 1.f - t;
+    s1 = t;
+  } else {
+    float theta = acosf(dot);
+    float sin_theta = sinf(theta);
+    s0 = sinf((1.f - t) * theta) / sin_theta;
+    s1 = sinf(t * theta) / sin_theta;
+  }
+  QUAT_ASSIGN(*q, s0 * q0->qi + s1 * q1s.qi, s0 * q0->qx + s1 * q1s.qx,
+              s0 * q0->qy + s1 * q1s.qy, s0 * q0->qz + s1 * q1s.qz);
+  float_quat_normalize(q);
+}
+
 /**
- * Given a pprz timestamp in used (obtained with get_sys_time_usec) we return the pose in FloatEulers closest to that time.
+ * Interpolated pose at timestamp from the entries [first, head[.
+ * Timestamps outside of the history get the oldest or newest pose.
  */
-struct pose_t get_rotation_at_timestamp(uint32_t timestamp)
+static void pose_lookup(struct pose_t *pose, uint32_t timestamp, uint32_t first, uint32_t head)
 {
-#ifdef __linux__
-  pthread_mutex_lock(&pose_mutex);
-#endif
-  uint32_t index_history = 0;
-  uint32_t closestTimeDiff = abs(timestamp - location_history.ring_data[0].timestamp);
-  uint32_t closestIndex = 0;
-
-  // Seach for the timestamp closes to the timestamp argument of this function.
-  for (index_history = 0; index_history < location_history.ring_size; index_history++) {
-    uint32_t diff = abs(timestamp - location_history.ring_data[index_history].timestamp);
-    if (diff < closestTimeDiff) {
-      closestIndex = index_history;
-      closestTimeDiff = diff;
+  struct pose_t *oldest = &pose_ring[first & POSE_HISTORY_MASK];
+  struct pose_t *newest = &pose_ring[(head - 1) & POSE_HISTORY_MASK];
+  if (pose_dt(timestamp, oldest->timestamp) <= 0) {
+    *pose = *oldest;
+  } else if (pose_dt(timestamp, newest->timestamp) >= 0) {
+    *pose = *newest;
+  } else {
+    // last entry before timestamp, oldest is before and newest after
+    uint32_t lo = first, hi = head - 1;
+    while (hi - lo > 1) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      if (pose_dt(pose_ring[mid & POSE_HISTORY_MASK].timestamp, timestamp) <= 0) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    struct pose_t *p0 = &pose_ring[lo & POSE_HISTORY_MASK];
+    struct pose_t *p1 = &pose_ring[hi & POSE_HISTORY_MASK];
+    float t = (float)pose_dt(timestamp, p0->timestamp) / (float)pose_dt(p1->timestamp, p0->timestamp);
+    pose_quat_slerp(&pose->quat, &p0->quat, &p1->quat, t);
+    float_eulers_of_quat(&pose->eulers, &pose->quat);
+    pose->rates.p = p0->rates.p + t * (p1->rates.p - p0->rates.p);
+    pose->rates.q = p0->rates.q + t * (p1->rates.q - p0->rates.q);
+    pose->rates.r = p0->rates.r + t * (p1->rates.r - p0->rates.r);
+  }
+  pose->timestamp = timestamp;
+}
+
+int pose_history_get_batch(struct pose_t *poses, uint32_t *timestamps, int n)
+{
+  while (true) {
+    uint32_t head = pose_head;
+    __sync_synchronize();
+    if (head == 0) {
+      return 0;
+    }
+    uint32_t first = head - Min(head, POSE_HISTORY_SIZE - POSE_HISTORY_GUARD);
+    int i;
+    for (i = 0; i < n; i++) {
+      pose_lookup(&poses[i], timestamps[i], first, head);
+    }
+    __sync_synchronize();
+    // the writer only overwrites entry pose_head - POSE_HISTORY_SIZE
+    if (pose_head - first < POSE_HISTORY_SIZE) {
+      return n;
     }
   }
+}
 
-  // Save the pose closest to the given timestamp and return this
-  struct pose_t closest_pose;
-  closest_pose.eulers = location_history.ring_data[closestIndex].eulers;
-  closest_pose.rates = location_history.ring_data[closestIndex].rates;
+bool pose_history_get(struct pose_t *pose, uint32_t timestamp)
+{
+  return pose_history_get_batch(pose, &timestamp, 1) == 1;
+}
 
-#ifdef __linux__
-  pthread_mutex_unlock(&pose_mutex);
-#endif
-  return closest_pose;
+/**
+ * Given a pprz timestamp in usec (obtained with get_sys_time_usec) we return the pose interpolated at that time.
+ */
+struct pose_t get_rotation_at_timestamp(uint32_t timestamp)
+{
+  struct pose_t pose;
+  if (!pose_history_get(&pose, timestamp)) {
+    memset(&pose, 0, sizeof(pose));
+    float_quat_identity(&pose.quat);
+  }
+  return pose;
 }
 
 /**
@@ -84,8 +165,7 @@ struct pose_t get_rotation_at_timestamp(uint32_t timestamp)
  */
 void pose_init()
 {
-  location_history.ring_index = 0;
-  location_history.ring_size = POSE_HISTORY_SIZE;
+  pose_head = 0;
 }
 
 
@@ -94,22 +174,13 @@ void pose_init()
  */
 void pose_periodic()
 {
-  uint32_t now_ts = get_sys_time_usec();
-#ifdef __linux__
-  pthread_mutex_lock(&pose_mutex);
-#endif
-  struct pose_t *current_time_and_rotation = &location_history.ring_data[location_history.ring_index];
+  struct pose_t *current_time_and_rotation = &pose_ring[pose_head & POSE_HISTORY_MASK];
+  current_time_and_rotation->quat = *stateGetNedToBodyQuat_f();
   current_time_and_rotation->eulers = *stateGetNedToBodyEulers_f();
   current_time_and_rotation->rates = *stateGetBodyRates_f();
+  current_time_and_rotation->timestamp = get_sys_time_usec();
 
-  current_time_and_rotation->timestamp = now_ts;
-
-  // increase index location history
-  location_history.ring_index = (location_history.ring_index + 1) % location_history.ring_size;
-
-#ifdef __linux__
-  pthread_mutex_unlock(&pose_mutex);
-#endif
+  // publish entry
+  __sync_synchronize();
+  pose_head = pose_head + 1;
 }
-
-
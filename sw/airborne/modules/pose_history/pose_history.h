@@ -20,16 +20,18 @@
 /**
  * @file "modules/pose_history/pose_history.h"
  * @author Roland Meertens
- * Ask this module for the pose the drone had closest to a given timestamp
+ * Ask this module for the pose the drone had at a given timestamp
  */
 
 #ifndef POSE_HISTORY_H
 #define POSE_HISTORY_H
 
+#include "std.h"
 #include "math/pprz_algebra_float.h"
 
 struct pose_t {
   uint32_t timestamp;
+  struct FloatQuat quat;
   struct FloatEulers eulers;
   struct FloatRates rates;
 };
@@ -37,5 +39,18 @@ struct pose_t {
 extern void pose_init(void);
 extern void pose_periodic(void);
 extern struct pose_t get_rotation_at_timestamp(uint32_t timestamp);
+
+/** Get pose interpolated at timestamp (pprz usec)
+ * Attitude is interpolated with slerp and rates linearly,
+ * timestamps outside of the history get the oldest or newest pose.
+ * Can be called from other threads without locking.
+ * @return false if the history is empty
+ */
+extern bool pose_history_get(struct pose_t *pose, uint32_t timestamp);
+
+/** Get poses interpolated at several timestamps (pprz usec)
+ * @return number of poses, 0 if the history is empty
+ */
+extern int pose_history_get_batch(struct pose_t *poses, uint32_t *timestamps, int n);
 #endif
 
@@ -25,6 +25,7 @@
 
 #include "modules/relative_localization_filter/discrete_ekf.h"
 #include "math/pprz_algebra_float.h"
+#include "math/pprz_matrix_fixed_float.h"
 #include <math.h>
 #include <stdio.h> // needed for the printf statements
 
@@ -78,7 +79,7 @@ void discrete_ekf_predict(struct discrete_ekf *filter)
   MAKE_MATRIX_PTR(_tmp1, filter->tmp1, EKF_N);
   MAKE_MATRIX_PTR(_tmp2, filter->tmp2, EKF_N);
   MAKE_MATRIX_PTR(_tmp3, filter->tmp3, EKF_N);
-  MAKE_MATRIX_PTR(_H,    filter->H,    EKF_N);
+  MAKE_MATRIX_PTR(_H,    filter->H,    EKF_M);
   MAKE_MATRIX_PTR(_P,    filter->P,    EKF_N);
   MAKE_MATRIX_PTR(_Q,    filter->Q,    EKF_N);
 
@@ -112,35 +113,35 @@ void discrete_ekf_predict(struct discrete_ekf *filter)
 */
 void discrete_ekf_update(struct discrete_ekf *filter, float *Z)
 {
-  MAKE_MATRIX_PTR(_tmp1, filter->tmp1, EKF_N);
-  MAKE_MATRIX_PTR(_tmp2, filter->tmp2, EKF_N);
-  MAKE_MATRIX_PTR(_tmp3, filter->tmp3, EKF_N);
-  MAKE_MATRIX_PTR(_P,    filter->P,    EKF_N);
-  MAKE_MATRIX_PTR(_H,    filter->H,    EKF_M);
-  MAKE_MATRIX_PTR(_Ht,   filter->Ht,   EKF_N);
-  MAKE_MATRIX_PTR(_R,    filter->R,    EKF_M);
+  float HP[EKF_M][EKF_N];
+  float E[EKF_M][EKF_M];
+  float KHP[EKF_N][EKF_N];
 
   //  E = H * P * H' + R
-  float_mat_transpose(_Ht, _H, EKF_M, EKF_N); // Ht = H'
-  float_mat_mul(_tmp2, _P, _Ht, EKF_N, EKF_N, EKF_M); // tmp2 = P*Ht = P*H'
-  float_mat_mul(_tmp1, _H, _tmp2, EKF_M, EKF_N, EKF_M); // tmp1 = H*P*H'
-  float_mat_sum(_tmp3, _tmp1, _R, EKF_M, EKF_M); // E = tmp1(=H*P*H') + R
-
-  // K = P * H' * inv(E)
-  float_mat_invert(_tmp1, _tmp3, EKF_M); // tmp1 = inv(E)
-  float_mat_mul(_tmp3, _tmp2, _tmp1, EKF_N, EKF_M, EKF_M); // K(tmp3) = tmp2*tmp1
+  float_mat_fixed_mul(&HP[0][0], &filter->H[0][0], &filter->P[0][0], EKF_M, EKF_N, EKF_N); // HP = H*P
+  float_mat_fixed_mul_t(&E[0][0], &HP[0][0], &filter->H[0][0], EKF_M, EKF_N, EKF_M); // E = H*P*H'
+  float_mat_fixed_add(&E[0][0], &E[0][0], &filter->R[0][0], EKF_M, EKF_M);
+
+  // K' = inv(E) * H * P (P and E symmetric), solved in place with the Cholesky factor of E
+  if (!float_mat_fixed_cholesky(&E[0][0], &E[0][0], EKF_M)) {
+    // E not positive definite, skip the correction but keep the prediction
+    memcpy(filter->X, filter->Xp, sizeof(filter->X));
+    return;
+  }
+  float Kt[EKF_M][EKF_N];
+  memcpy(Kt, HP, sizeof(Kt));
+  float_mat_fixed_cholesky_solve_mat(&Kt[0][0], &E[0][0], EKF_M, EKF_N);
 
   // P = P - K * H * P
-  float_mat_mul(_tmp1, _tmp3, _H, EKF_N, EKF_M, EKF_N); // tmp1 = K*H
-  float_mat_mul(_tmp2, _tmp1, _P, EKF_N, EKF_N, EKF_N); // tmp3 = K*H*P
-  float_mat_diff(_P, _P, _tmp2, EKF_N, EKF_N); // P - K*H*P
+  float_mat_fixed_tmul(&KHP[0][0], &Kt[0][0], &HP[0][0], EKF_N, EKF_M, EKF_N);
+  float_mat_fixed_sub(&filter->P[0][0], &filter->P[0][0], &KHP[0][0], EKF_N, EKF_N);
 
   //  X = X + K * err
   float err[EKF_M];
   float dx_err[EKF_N];
 
   float_vect_diff(err, Z, filter->Zp, EKF_M); // err = Z - Zp
-  float_mat_vect_mul(dx_err, _tmp3, err, EKF_N, EKF_M); // dx_err = K*err
+  float_mat_fixed_tmul(dx_err, &Kt[0][0], err, EKF_N, EKF_M, 1); // dx_err = K*err
   float_vect_sum(filter->X, filter->Xp, dx_err, EKF_N); // X = Xp + dx_err
 }
 
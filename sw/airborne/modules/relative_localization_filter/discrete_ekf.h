@@ -41,7 +41,6 @@ struct discrete_ekf {
   float Q[EKF_N][EKF_N]; // proces covariance noise
   float R[EKF_M][EKF_M]; // measurement covariance noise
   float H[EKF_M][EKF_N]; // jacobian of the measure wrt X
-  float Ht[EKF_N][EKF_M]; // transpose of H
 
   float tmp1[EKF_N][EKF_N];
   float tmp2[EKF_N][EKF_N];
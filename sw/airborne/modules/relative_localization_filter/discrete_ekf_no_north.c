@@ -28,6 +28,7 @@
 
 #include "modules/relative_localization_filter/discrete_ekf_no_north.h"
 #include "math/pprz_algebra_float.h"
+#include "math/pprz_matrix_fixed_float.h"
 #include <math.h>
 #include <stdio.h> // needed for the printf statements
 
@@ -78,8 +79,8 @@ void c2d(int m, int nA, int nB, float **Fx, float **G, float dt, float **phi, fl
   float combmat[totalsize][totalsize];
   float expm[totalsize][totalsize];
 
-  MAKE_MATRIX_PTR(_Fx, Fx, EKF_N);
-  MAKE_MATRIX_PTR(_G, G, EKF_M);
+  MAKE_MATRIX_PTR(_Fx, Fx, m);
+  MAKE_MATRIX_PTR(_G, G, m);
   MAKE_MATRIX_PTR(_phi, phi, m);
   MAKE_MATRIX_PTR(_gamma, gamma, m);
   MAKE_MATRIX_PTR(_combmat, combmat, totalsize);
@@ -167,7 +168,7 @@ void discrete_ekf_no_north_G(float *statein, float **output)
 
 void discrete_ekf_no_north_Hx(float *statein, float **output)
 {
-  MAKE_MATRIX_PTR(_output, output, EKF_N);
+  MAKE_MATRIX_PTR(_output, output, EKF_M);
   float_mat_zero(_output, EKF_M, EKF_N);
   output[0][0] = statein[x12] / (powf(powf(statein[z1] - statein[z2], 2.0) + powf(statein[x12], 2.0) + powf(statein[y12],
                                       2.0), 0.5));
@@ -226,7 +227,7 @@ void discrete_ekf_no_north_predict(struct discrete_ekf_no_north *filter, float *
   MAKE_MATRIX_PTR(_tmp4, filter->tmp4, EKF_N);
   MAKE_MATRIX_PTR(_P,    filter->P,    EKF_N);
   MAKE_MATRIX_PTR(_Q,    filter->Q,    EKF_N);
-  MAKE_MATRIX_PTR(_H,    filter->H,    EKF_N);
+  MAKE_MATRIX_PTR(_H,    filter->H,    EKF_M);
   MAKE_MATRIX_PTR(_G,    filter->G,    EKF_N);
   MAKE_MATRIX_PTR(_Gamma, filter->Gamma, EKF_N);
   MAKE_MATRIX_PTR(_Phi,  filter->Phi,  EKF_N);
@@ -269,34 +270,34 @@ void discrete_ekf_no_north_predict(struct discrete_ekf_no_north *filter, float *
 */
 void discrete_ekf_no_north_update(struct discrete_ekf_no_north *filter, float *Z)
 {
-  MAKE_MATRIX_PTR(_tmp1, filter->tmp1, EKF_N);
-  MAKE_MATRIX_PTR(_tmp2, filter->tmp2, EKF_N);
-  MAKE_MATRIX_PTR(_tmp3, filter->tmp3, EKF_N);
-  MAKE_MATRIX_PTR(_P,    filter->P,    EKF_N);
-  MAKE_MATRIX_PTR(_H,    filter->H,    EKF_M);
-  MAKE_MATRIX_PTR(_Ht,   filter->Ht,   EKF_N);
-  MAKE_MATRIX_PTR(_R,    filter->R,    EKF_M);
+  float HP[EKF_M][EKF_N];
+  float E[EKF_M][EKF_M];
+  float KHP[EKF_N][EKF_N];
 
   //  E = H * P * H' + R
-  float_mat_transpose(_Ht, _H, EKF_M, EKF_N); // Ht = H'
-  float_mat_mul(_tmp2, _P, _Ht, EKF_N, EKF_N, EKF_M); // tmp2 = P*Ht = P*H'
-  float_mat_mul(_tmp1, _H, _tmp2, EKF_M, EKF_N, EKF_M); // tmp1 = H*P*H'
-  float_mat_sum(_tmp3, _tmp1, _R, EKF_M, EKF_M); // E = tmp1(=H*P*H') + R
-
-  // K = P * H' * inv(E)
-  float_mat_invert(_tmp1, _tmp3, EKF_M); // tmp1 = inv(E)
-  float_mat_mul(_tmp3, _tmp2, _tmp1, EKF_N, EKF_M, EKF_M); // K(tmp3) = tmp2*tmp1
+  float_mat_fixed_mul(&HP[0][0], &filter->H[0][0], &filter->P[0][0], EKF_M, EKF_N, EKF_N); // HP = H*P
+  float_mat_fixed_mul_t(&E[0][0], &HP[0][0], &filter->H[0][0], EKF_M, EKF_N, EKF_M); // E = H*P*H'
+  float_mat_fixed_add(&E[0][0], &E[0][0], &filter->R[0][0], EKF_M, EKF_M);
+
+  // K' = inv(E) * H * P (P and E symmetric), solved in place with the Cholesky factor of E
+  if (!float_mat_fixed_cholesky(&E[0][0], &E[0][0], EKF_M)) {
+    // E not positive definite, skip the correction but keep the prediction
+    memcpy(filter->X, filter->Xp, sizeof(filter->X));
+    return;
+  }
+  float Kt[EKF_M][EKF_N];
+  memcpy(Kt, HP, sizeof(Kt));
+  float_mat_fixed_cholesky_solve_mat(&Kt[0][0], &E[0][0], EKF_M, EKF_N);
 
   // P = P - K * H * P
-  float_mat_mul(_tmp1, _tmp3, _H, EKF_N, EKF_M, EKF_N); // tmp1 = K*H
-  float_mat_mul(_tmp2, _tmp1, _P, EKF_N, EKF_N, EKF_N); // tmp3 = K*H*P
-  float_mat_diff(_P, _P, _tmp2, EKF_N, EKF_N); // P - K*H*P
+  float_mat_fixed_tmul(&KHP[0][0], &Kt[0][0], &HP[0][0], EKF_N, EKF_M, EKF_N);
+  float_mat_fixed_sub(&filter->P[0][0], &filter->P[0][0], &KHP[0][0], EKF_N, EKF_N);
 
   //  X = X + K * err
   float err[EKF_M];
   float dx_err[EKF_N];
 
   float_vect_diff(err, Z, filter->Zp, EKF_M); // err = Z - Zp
-  float_mat_vect_mul(dx_err, _tmp3, err, EKF_N, EKF_M); // dx_err = K*err
+  float_mat_fixed_tmul(dx_err, &Kt[0][0], err, EKF_N, EKF_M, 1); // dx_err = K*err
   float_vect_sum(filter->X, filter->Xp, dx_err, EKF_N); // X = Xp + dx_err
 }
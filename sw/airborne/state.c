@@ -57,6 +57,100 @@ void stateInit(void)
 }
 
 
+#if USE_STATE_SNAPSHOT
+#include "mcu_periph/sys_time.h"
+
+/**
+ * Snapshot buffers.
+ * The writer always fills the buffer which is not the last published one,
+ * the sequence number of a buffer is odd while it is written (seqlock).
+ */
+static struct StateSnapshot state_snapshot[2];
+static volatile uint32_t state_snapshot_seq[2];
+static volatile uint8_t state_snapshot_last;
+static uint32_t state_snapshot_cycle;
+
+/** Compute the representations commonly used by snapshot readers */
+static void stateSnapshotConvert(void)
+{
+  if (stateIsLocalCoordinateValid()) {
+    stateCalcPositionNed_i();
+    stateCalcPositionNed_f();
+    stateCalcPositionEnu_i();
+    stateCalcPositionEnu_f();
+  }
+  if (stateIsGlobalCoordinateValid()) {
+    stateCalcPositionLla_i();
+    stateCalcPositionLla_f();
+  }
+  if (state.speed_status) {
+    stateCalcSpeedNed_i();
+    stateCalcSpeedNed_f();
+    stateCalcSpeedEnu_f();
+    stateCalcHorizontalSpeedNorm_f();
+    stateCalcHorizontalSpeedDir_f();
+  }
+  if (state.accel_status) {
+    stateCalcAccelNed_i();
+    stateCalcAccelNed_f();
+  }
+  if (stateIsAttitudeValid()) {
+    orientationGetQuat_i(&state.ned_to_body_orientation);
+    orientationGetRMat_i(&state.ned_to_body_orientation);
+    orientationGetEulers_i(&state.ned_to_body_orientation);
+    orientationGetQuat_f(&state.ned_to_body_orientation);
+    orientationGetRMat_f(&state.ned_to_body_orientation);
+    orientationGetEulers_f(&state.ned_to_body_orientation);
+  }
+  if (state.rate_status) {
+    stateCalcBodyRates_i();
+    stateCalcBodyRates_f();
+  }
+  if (state.wind_air_status & ((1 << WINDSPEED_I) | (1 << WINDSPEED_F))) {
+    stateCalcHorizontalWindspeed_f();
+  }
+  if (state.wind_air_status & ((1 << AIRSPEED_I) | (1 << AIRSPEED_F))) {
+    stateCalcAirspeed_f();
+  }
+}
+
+void stateSnapshotPublish(void)
+{
+  stateSnapshotConvert();
+
+  uint8_t idx = state_snapshot_last ^ 1;
+  state_snapshot_seq[idx]++;
+  __sync_synchronize();
+  state_snapshot[idx].state = state;
+  state_snapshot[idx].stamp = get_sys_time_usec();
+  state_snapshot[idx].cycle = ++state_snapshot_cycle;
+  __sync_synchronize();
+  state_snapshot_seq[idx]++;
+  state_snapshot_last = idx;
+}
+
+bool stateSnapshotRead(struct StateSnapshot *snap)
+{
+  while (true) {
+    uint8_t idx = state_snapshot_last;
+    uint32_t seq = state_snapshot_seq[idx];
+    __sync_synchronize();
+    if (seq == 0) {
+      return false;
+    }
+    if (seq & 1) {
+      continue;
+    }
+    memcpy(snap, &state_snapshot[idx], sizeof(struct StateSnapshot));
+    __sync_synchronize();
+    if (state_snapshot_seq[idx] == seq) {
+      return true;
+    }
+  }
+}
+#endif
+
+
 /*******************************************************************************
  *                                                                             *
  * transformation functions for the POSITION representations                   *
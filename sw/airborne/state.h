@@ -450,6 +450,51 @@ extern struct State state;
 
 extern void stateInit(void);
 
+/**
+ * @defgroup state_snapshot State snapshots
+ *
+ * Consistent copies of the state for other threads (Linux targets),
+ * enabled with USE_STATE_SNAPSHOT.
+ *
+ * The global #state is only meant to be used by the autopilot thread:
+ * the stateGet* functions convert representations on the fly and modify it.
+ * Instead, the autopilot publishes a snapshot once per control cycle with
+ * stateSnapshotPublish(), where the common float and int representations are
+ * already computed. Any thread can then get a copy with stateSnapshotRead()
+ * without locking and without side effects on the state:
+ * @code
+ * struct StateSnapshot snap;
+ * if (stateSnapshotRead(&snap) && bit_is_set(snap.state.pos_status, POS_NED_F)) {
+ *   use(snap.state.ned_pos_f);
+ * }
+ * @endcode
+ * Only the representations with their status bit set are valid.
+ * @{
+ */
+
+struct StateSnapshot {
+  struct State state; ///< copy of the state with converted representations
+  uint32_t stamp;     ///< publication time in usec
+  uint32_t cycle;     ///< publication counter, starts at 1
+};
+
+/**
+ * Convert the state representations and publish a snapshot.
+ * Must be called from the thread owning the state (single writer).
+ */
+extern void stateSnapshotPublish(void);
+
+/**
+ * Get a copy of the last published snapshot.
+ * Never blocks the writer, only retries if two snapshots are published
+ * while copying.
+ * @param snap pointer to the snapshot to fill
+ * @return false if no snapshot was published yet
+ */
+extern bool stateSnapshotRead(struct StateSnapshot *snap);
+
+/** @}*/
+
 /** @addtogroup state_position
  *  @{ */
 
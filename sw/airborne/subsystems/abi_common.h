@@ -67,6 +67,9 @@ struct abi_struct {
   uint8_t id;
   abi_callback cb;
   struct abi_struct *next;
+#if USE_TASK_PROFILER
+  uint8_t prof_slot;  ///< task profiler slot (index + 1), 0 if not allocated yet
+#endif
 };
 typedef struct abi_struct abi_event;
 
@@ -74,5 +77,13 @@ typedef struct abi_struct abi_event;
 #define ABI_FOREACH(head,el) for(el=head; el; el=el->next)
 #define ABI_PREPEND(head,add) { (add)->next = head; head = add; }
 
+/** Call a callback, with execution time profiling if enabled */
+#if USE_TASK_PROFILER
+#include "modules/core/task_profiler.h"
+#define ABI_CALLBACK(_msg_id, _ev, _call) TaskProfilerAbi(_msg_id, _ev, _call)
+#else
+#define ABI_CALLBACK(_msg_id, _ev, _call) { _call; }
+#endif
+
 #endif /* ABI_COMMON_H */
 
@@ -66,6 +66,166 @@ int8_t register_periodic_telemetry(struct periodic_telemetry *_pt, uint8_t _id,
   return -1;
 }
 
+#if USE_TELEMETRY_SCHEDULER
+
+/** Max burst duration in milliseconds (caps the accumulated credit) */
+#ifndef TELEMETRY_SCHEDULER_BURST_MS
+#define TELEMETRY_SCHEDULER_BURST_MS 100
+#endif
+
+/** Min rate in percent of max rate when congestion is detected */
+#ifndef TELEMETRY_SCHEDULER_MIN_RATE_PCT
+#define TELEMETRY_SCHEDULER_MIN_RATE_PCT 20
+#endif
+
+/** Max number of link devices with a budget, processes on other links are not limited */
+#ifndef TELEMETRY_SCHEDULER_NB_LINKS
+#define TELEMETRY_SCHEDULER_NB_LINKS 4
+#endif
+
+/** Default size estimation of a message before first send */
+#define TELEMETRY_SCHEDULER_DEFAULT_SIZE 32
+
+static struct telemetry_sched_link telemetry_sched_links[TELEMETRY_SCHEDULER_NB_LINKS];
+
+/** Budget of a link device, allocated by the first process sending on it */
+static struct telemetry_sched_link *telemetry_sched_link_get(struct telemetry_scheduler *_sched,
+    struct link_device *_dev)
+{
+  uint8_t i;
+  for (i = 0; i < TELEMETRY_SCHEDULER_NB_LINKS; i++) {
+    struct telemetry_sched_link *link = &telemetry_sched_links[i];
+    if (link->dev == _dev) {
+      return link;
+    }
+    if (link->dev == NULL) {
+      link->dev = _dev;
+      link->owner = _sched;
+      link->max_rate = _sched->max_rate;
+      link->rate = _sched->max_rate;
+      link->credit = 0;
+      link->last_ovrn = _dev->nb_ovrn;
+      return link;
+    }
+  }
+  return NULL;
+}
+
+static uint8_t telemetry_send_msg(struct periodic_telemetry *_pt, uint8_t _idx,
+                                  struct transport_tx *_trans, struct link_device *_dev)
+{
+  uint8_t j;
+  for (j = 0; j < TELEMETRY_NB_CBS; j++) {
+    if (_pt->cbs[_idx].slots[j] != NULL) {
+      _pt->cbs[_idx].slots[j](_trans, _dev);
+    } else {
+      break;
+    }
+  }
+  return j;
+}
+
+uint8_t telemetry_scheduler_push(struct telemetry_scheduler *_sched, struct periodic_telemetry *_pt, uint8_t _idx)
+{
+  uint8_t j;
+  for (j = 0; j < TELEMETRY_NB_CBS; j++) {
+    if (_pt->cbs[_idx].slots[j] == NULL) {
+      break;
+    }
+  }
+  if (j == 0 || _idx >= _sched->nb) {
+    return j;
+  }
+  struct telemetry_sched_msg *msg = &_sched->msgs[_idx];
+  if (msg->pending) {
+    // previous occurence not sent yet, keep the oldest due time
+    _sched->nb_skipped++;
+  } else {
+    msg->pending = true;
+    msg->due = _sched->tick;
+    if (msg->size == 0) {
+      msg->size = TELEMETRY_SCHEDULER_DEFAULT_SIZE;
+    }
+  }
+  return j;
+}
+
+void telemetry_scheduler_run(struct telemetry_scheduler *_sched, struct periodic_telemetry *_pt,
+                             struct transport_tx *_trans, struct link_device *_dev)
+{
+  uint8_t i;
+
+  if (_dev != NULL && (_sched->link == NULL || _sched->link->dev != _dev)) {
+    _sched->link = telemetry_sched_link_get(_sched, _dev);
+  }
+  struct telemetry_sched_link *link = _dev != NULL ? _sched->link : NULL;
+
+  // no byte counter on this link or no budget left for it, send everything
+  if (link == NULL) {
+    for (i = 0; i < _sched->nb; i++) {
+      if (_sched->msgs[i].pending) {
+        telemetry_send_msg(_pt, i, _trans, _dev);
+        _sched->msgs[i].pending = false;
+      }
+    }
+    _sched->tick++;
+    return;
+  }
+
+  // the budget is updated once per tick, by the first process on the link
+  if (link->owner == _sched) {
+    // adapt rate: multiplicative decrease on overrun, additive increase once per second otherwise
+    uint16_t min_rate = (uint16_t)(((uint32_t)link->max_rate * TELEMETRY_SCHEDULER_MIN_RATE_PCT) / 100);
+    if (_dev->nb_ovrn != link->last_ovrn) {
+      link->last_ovrn = _dev->nb_ovrn;
+      link->rate = Max((uint16_t)(((uint32_t)link->rate * 3) / 4), min_rate);
+      link->credit = 0;
+    } else if (_sched->freq > 0 && (_sched->tick % _sched->freq) == 0) {
+      link->rate = Min(link->rate + Max(link->max_rate / 20, 1), link->max_rate);
+    }
+
+    // credit is counted in bytes * freq to avoid fractional bytes per tick
+    // the burst holds at least one message of maximum size, so none can starve
+    int32_t max_credit = (int32_t)Max(((int64_t)link->rate * _sched->freq * TELEMETRY_SCHEDULER_BURST_MS) / 1000,
+                                      (int64_t)Max(link->rate, 255 * _sched->freq));
+    link->credit = Min(link->credit + link->rate, max_credit);
+  }
+
+  // send oldest pending messages first while credit is available
+  while (true) {
+    uint8_t best = _sched->nb;
+    for (i = 0; i < _sched->nb; i++) {
+      if (_sched->msgs[i].pending &&
+          (best == _sched->nb || (int32_t)(_sched->msgs[i].due - _sched->msgs[best].due) < 0)) {
+        best = i;
+      }
+    }
+    if (best == _sched->nb) {
+      break;
+    }
+    struct telemetry_sched_msg *msg = &_sched->msgs[best];
+    // wait for enough credit, messages are sent whole
+    if (link->credit < (int32_t)msg->size * _sched->freq) {
+      break;
+    }
+    uint32_t nb_bytes = _dev->nb_bytes;
+    telemetry_send_msg(_pt, best, _trans, _dev);
+    uint32_t size = (uint32_t)_dev->nb_bytes - nb_bytes;
+    if (size > 0) {
+      msg->size = (uint8_t)Min(size, 255);
+    }
+    link->credit -= (int32_t)msg->size * _sched->freq;
+    if (msg->due != _sched->tick) {
+      _sched->nb_deferred++;
+    }
+    msg->pending = false;
+  }
+
+  _sched->tick++;
+}
+
+#endif
+
 #if USE_PERIODIC_TELEMETRY_REPORT
 
 #include "subsystems/datalink/downlink.h"
@@ -78,6 +78,75 @@ static inline int8_t register_periodic_telemetry(struct periodic_telemetry *_pt
     uint8_t _id __attribute__((unused)), telemetry_cb _cb __attribute__((unused))) { return -1; }
 #endif
 
+#if USE_TELEMETRY_SCHEDULER
+
+/** Default link bandwidth in bytes per second */
+#ifndef TELEMETRY_SCHEDULER_BANDWIDTH
+#define TELEMETRY_SCHEDULER_BANDWIDTH 4800
+#endif
+
+/** Scheduling state of a periodic message */
+struct telemetry_sched_msg {
+  bool pending;       ///< message is due but not sent yet
+  uint8_t size;       ///< last measured size in bytes (including transport)
+  uint32_t due;       ///< tick at which the message became due
+};
+
+/** Byte budget of a link device, shared by the processes sending on it.
+ * Token bucket refilled once per tick by the first process using the link.
+ * The budget is reduced when the link device reports overruns
+ * and slowly increased back to max_rate otherwise.
+ */
+struct telemetry_sched_link {
+  struct link_device *dev;          ///< link device, NULL if the slot is free
+  struct telemetry_scheduler *owner; ///< first process on this link, updates the budget
+  uint16_t max_rate;                ///< link bandwidth in bytes/s
+  uint16_t rate;                    ///< current budget in bytes/s
+  int32_t credit;                   ///< available credit in bytes * freq
+  uint8_t last_ovrn;                ///< last overrun counter of the device
+};
+
+/** Telemetry scheduler for one process.
+ * Periodic messages are marked as due by the generated code,
+ * then sent according to the budget of the link device.
+ * Messages that can't be sent are deferred to the next ticks,
+ * a message that is due again before being sent is skipped once.
+ */
+struct telemetry_scheduler {
+  struct telemetry_sched_msg *msgs; ///< per message state, same index as callbacks
+  uint8_t nb;                       ///< number of messages
+  uint16_t freq;                    ///< scheduler tick frequency (TELEMETRY_FREQUENCY)
+  uint16_t max_rate;                ///< bandwidth of the link if this process is the first on it, in bytes/s
+  struct telemetry_sched_link *link; ///< budget of the link device, found on first run
+  uint32_t tick;                    ///< tick counter
+  uint32_t nb_deferred;             ///< number of messages delayed by at least one tick
+  uint32_t nb_skipped;              ///< number of messages skipped because of congestion
+};
+
+#define TELEMETRY_SCHEDULER_INIT(_msgs, _nb, _freq, _rate) { \
+    .msgs = _msgs, .nb = _nb, .freq = _freq, .max_rate = _rate, .link = NULL, \
+    .tick = 0, .nb_deferred = 0, .nb_skipped = 0 }
+
+/** Mark a periodic message as due
+ * @param _sched scheduler structure
+ * @param _pt periodic telemetry structure
+ * @param _idx index of the message
+ * @return number of registered callbacks for this message
+ */
+extern uint8_t telemetry_scheduler_push(struct telemetry_scheduler *_sched, struct periodic_telemetry *_pt, uint8_t _idx);
+
+/** Send the due messages within the link budget
+ * Should be called once per telemetry tick, after all messages are pushed
+ * @param _sched scheduler structure
+ * @param _pt periodic telemetry structure
+ * @param _trans transport
+ * @param _dev link device
+ */
+extern void telemetry_scheduler_run(struct telemetry_scheduler *_sched, struct periodic_telemetry *_pt,
+                                    struct transport_tx *_trans, struct link_device *_dev);
+
+#endif
+
 #if USE_PERIODIC_TELEMETRY_REPORT
 /** Send an error report when trying to send message that as not been register
  * @param _process telemetry process id
@@ -0,0 +1,26 @@
+/* fake generated airframe file for estimator replay */
+
+#ifndef AIRFRAME_H
+#define AIRFRAME_H
+
+#define AC_ID 1
+
+#define SECTION_IMU 1
+#define IMU_BODY_TO_IMU_PHI 0.
+#define IMU_BODY_TO_IMU_THETA 0.
+#define IMU_BODY_TO_IMU_PSI 0.
+
+/* local magnetic field (Toulouse), can be changed from the log with GEO_MAG samples
+ * defined as AHRS_H or INS_H depending on the estimator type
+ */
+#if REPLAY_INS
+#define INS_H_X 0.51562740288882
+#define INS_H_Y -0.05707735220832
+#define INS_H_Z 0.85490967783446
+#else
+#define AHRS_H_X 0.51562740288882
+#define AHRS_H_Y -0.05707735220832
+#define AHRS_H_Z 0.85490967783446
+#endif
+
+#endif // AIRFRAME_H
@@ -0,0 +1,20 @@
+/* fake generated flight plan file for estimator replay
+ * the navigation origin is set at runtime from the ORIGIN sample of the log
+ */
+
+#ifndef FLIGHT_PLAN_H
+#define FLIGHT_PLAN_H
+
+#include "std.h"
+
+extern int32_t replay_nav_lat0;  ///< deg * 1e7
+extern int32_t replay_nav_lon0;  ///< deg * 1e7
+extern int32_t replay_nav_alt0;  ///< mm above MSL
+
+#define NAV_LAT0 replay_nav_lat0
+#define NAV_LON0 replay_nav_lon0
+#define NAV_ALT0 replay_nav_alt0
+#define NAV_MSL0 0
+#define GROUND_ALT (replay_nav_alt0 / 1000.f)
+
+#endif // FLIGHT_PLAN_H
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/** @file test/estimators/mcu_periph/sys_time_arch.h
+ * Replay clock: system time follows the timestamps of the replayed samples.
+ */
+
+#ifndef SYS_TIME_ARCH_H
+#define SYS_TIME_ARCH_H
+
+#include "std.h"
+
+/** Time of the last replayed sample in usec, set by the replay plugin */
+extern uint32_t replay_time_usec;
+
+static inline uint32_t get_sys_time_usec(void)
+{
+  return replay_time_usec;
+}
+
+static inline uint32_t get_sys_time_msec(void)
+{
+  return replay_time_usec / 1000;
+}
+
+static inline void sys_time_usleep(uint32_t us __attribute__((unused))) {}
+
+#endif /* SYS_TIME_ARCH_H */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test/estimators/replay.h
+ *
+ * Offline replay of recorded sensor data through the AHRS/INS estimators.
+ *
+ * Each estimator is compiled with its ABI wrapper in a shared object (plugin)
+ * linked with -Bsymbolic, so that every plugin has its own copy of the global
+ * state (state interface, ABI queues, estimator structures) and several
+ * estimators can run in parallel threads of the same process.
+ *
+ * Log format (text, one sample per line, '#' for comments):
+ *   t ORIGIN lat lon alt       reference point (deg, deg, m above MSL), first line
+ *   t GYRO p q r               IMU frame, rad/s
+ *   t ACCEL x y z              IMU frame, m/s^2
+ *   t MAG x y z                IMU frame, normalized
+ *   t BARO pressure            Pa
+ *   t GPS lat lon alt vn ve vd deg, deg, m above MSL, m/s
+ *   t GEO_MAG x y z            local magnetic field, normalized
+ *   t REF qi qx qy qz x y z    reference NED to body quaternion and NED position (m)
+ * with t the time in seconds.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "std.h"
+#include "math/pprz_algebra_float.h"
+#include "math/pprz_geodetic_float.h"
+
+enum replay_type {
+  REPLAY_GYRO,
+  REPLAY_ACCEL,
+  REPLAY_MAG,
+  REPLAY_BARO,
+  REPLAY_GPS,
+  REPLAY_GEO_MAG,
+  REPLAY_REF,
+  REPLAY_ORIGIN,
+  REPLAY_NB_TYPES
+};
+
+#define REPLAY_TYPE_NAMES { "GYRO", "ACCEL", "MAG", "BARO", "GPS", "GEO_MAG", "REF", "ORIGIN" }
+
+/** Max number of values in a sample */
+#define REPLAY_NB_VALUES 7
+
+/** One recorded sample */
+struct replay_sample {
+  double t;                         ///< time in seconds
+  enum replay_type type;            ///< sample type
+  double v[REPLAY_NB_VALUES];       ///< values, see log format
+};
+
+/** Estimator output */
+struct replay_estimate {
+  struct FloatQuat quat;            ///< NED to body quaternion
+  struct NedCoor_f pos;             ///< NED position in m
+  bool att_valid;                   ///< attitude is valid
+  bool pos_valid;                   ///< position is valid
+};
+
+/** Interface exported by each estimator plugin */
+struct replay_plugin {
+  const char *name;
+  /** init estimator, origin is the ORIGIN sample or NULL */
+  void (*init)(struct replay_sample *origin);
+  /** feed one sensor sample */
+  void (*feed)(struct replay_sample *sample);
+  /** get current estimate */
+  void (*get)(struct replay_estimate *est);
+};
+
+/** Name of the replay_plugin structure in the shared objects */
+#define REPLAY_PLUGIN_SYMBOL "replay_plugin"
+
+#endif /* REPLAY_H */
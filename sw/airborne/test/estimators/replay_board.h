@@ -0,0 +1,6 @@
+/* fake board file for estimator replay */
+
+#ifndef REPLAY_BOARD_H
+#define REPLAY_BOARD_H
+
+#endif // REPLAY_BOARD_H
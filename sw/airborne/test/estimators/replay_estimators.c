@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test/estimators/replay_estimators.c
+ *
+ * Replay a sensor log through several estimator plugins and compare them.
+ *
+ * The log is loaded in memory, then each plugin replays it as fast as possible
+ * in its own thread (or one after the other with -s).
+ * For each estimator, the CPU time of every update is measured per sample type,
+ * and the estimate is compared with the REF samples of the log:
+ * attitude error angle and NED position error.
+ *
+ * usage: replay_estimators [-s] [-o prefix] log_file plugin.so [plugin.so ...]
+ *   -s         run estimators sequentially (less noise on timings)
+ *   -o prefix  write estimates and errors in prefix_<estimator>.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+
+#include "test/estimators/replay.h"
+
+/** Max number of estimators */
+#define REPLAY_MAX_PLUGINS 16
+
+/** Timing stats for one sample type */
+struct replay_timing {
+  uint32_t nb;
+  double sum;   ///< total CPU time in usec
+  double max;   ///< max CPU time in usec
+};
+
+/** Error stats against reference */
+struct replay_error {
+  uint32_t nb;
+  double sum2;
+  double max;
+};
+
+struct replay_run {
+  const char *filename;
+  void *handle;
+  const struct replay_plugin *plugin;
+  pthread_t thread;
+  FILE *out;
+  double first_valid;                           ///< time of first valid attitude, -1 if never
+  struct replay_timing timing[REPLAY_NB_TYPES];
+  struct replay_error att_err;                  ///< attitude error in deg
+  struct replay_error pos_err;                  ///< position error in m
+};
+
+static struct replay_sample *samples;
+static uint32_t nb_samples;
+static struct replay_sample *origin;
+static double clock_overhead;
+
+static const char *type_names[REPLAY_NB_TYPES] = REPLAY_TYPE_NAMES;
+static const int type_nb_values[REPLAY_NB_TYPES] = { 3, 3, 3, 1, 6, 3, 7, 3 };
+
+static int load_log(const char *filename)
+{
+  FILE *f = fopen(filename, "r");
+  if (f == NULL) {
+    return -1;
+  }
+  uint32_t size = 0;
+  char line[512];
+  while (fgets(line, sizeof(line), f) != NULL) {
+    char type[16];
+    struct replay_sample s;
+    int n;
+    if (line[0] == '#' || sscanf(line, "%lf %15s%n", &s.t, type, &n) != 2) {
+      continue;
+    }
+    int i;
+    for (i = 0; i < REPLAY_NB_TYPES; i++) {
+      if (strcmp(type, type_names[i]) == 0) { break; }
+    }
+    if (i == REPLAY_NB_TYPES) {
+      continue;
+    }
+    s.type = i;
+    char *p = line + n;
+    int j;
+    for (j = 0; j < type_nb_values[i]; j++) {
+      char *end;
+      s.v[j] = strtod(p, &end);
+      if (end == p) { break; }
+      p = end;
+    }
+    if (j < type_nb_values[i]) {
+      fprintf(stderr, "%s: invalid %s sample at t=%f\n", filename, type, s.t);
+      continue;
+    }
+    if (nb_samples == size) {
+      size = size ? size * 2 : 4096;
+      samples = realloc(samples, size * sizeof(struct replay_sample));
+    }
+    samples[nb_samples++] = s;
+  }
+  fclose(f);
+
+  uint32_t k;
+  for (k = 0; k < nb_samples; k++) {
+    if (samples[k].type == REPLAY_ORIGIN) {
+      origin = &samples[k];
+      break;
+    }
+  }
+  return nb_samples;
+}
+
+static inline double cpu_time_usec(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+/** Mean cost of a pair of clock reads, removed from the measurements */
+static double measure_clock_overhead(void)
+{
+  int i;
+  double start = cpu_time_usec();
+  for (i = 0; i < 10000; i++) {
+    cpu_time_usec();
+  }
+  return (cpu_time_usec() - start) / 10000.;
+}
+
+static void update_error(struct replay_error *err, double e)
+{
+  err->nb++;
+  err->sum2 += e * e;
+  if (e > err->max) {
+    err->max = e;
+  }
+}
+
+static void compare(struct replay_run *run, struct replay_sample *ref)
+{
+  struct replay_estimate est;
+  memset(&est, 0, sizeof(est));
+  run->plugin->get(&est);
+  if (!est.att_valid) {
+    return;
+  }
+  if (run->first_valid < 0.) {
+    run->first_valid = ref->t;
+  }
+
+  struct FloatQuat q_ref = { ref->v[0], ref->v[1], ref->v[2], ref->v[3] };
+  struct FloatQuat q_err;
+  float_quat_inv_comp_norm_shortest(&q_err, &est.quat, &q_ref);
+  double att_err = DegOfRad(2. * acos(Min(fabs(q_err.qi), 1.)));
+  update_error(&run->att_err, att_err);
+
+  double pos_err = 0.;
+  if (est.pos_valid) {
+    double dx = est.pos.x - ref->v[4];
+    double dy = est.pos.y - ref->v[5];
+    double dz = est.pos.z - ref->v[6];
+    pos_err = sqrt(dx * dx + dy * dy + dz * dz);
+    update_error(&run->pos_err, pos_err);
+  }
+
+  if (run->out != NULL) {
+    struct FloatEulers e;
+    float_eulers_of_quat(&e, &est.quat);
+    fprintf(run->out, "%f,%f,%f,%f,", ref->t, DegOfRad(e.phi), DegOfRad(e.theta), DegOfRad(e.psi));
+    // position columns are left empty when the estimator has no position
+    if (est.pos_valid) {
+      fprintf(run->out, "%f,%f,%f,%f,%f\n", est.pos.x, est.pos.y, est.pos.z, att_err, pos_err);
+    } else {
+      fprintf(run->out, ",,,%f,\n", att_err);
+    }
+  }
+}
+
+static void *replay_thread(void *arg)
+{
+  struct replay_run *run = (struct replay_run *)arg;
+  uint32_t i;
+
+  run->plugin->init(origin);
+  for (i = 0; i < nb_samples; i++) {
+    struct replay_sample *s = &samples[i];
+    if (s->type == REPLAY_REF) {
+      compare(run, s);
+    } else if (s->type != REPLAY_ORIGIN) {
+      double start = cpu_time_usec();
+      run->plugin->feed(s);
+      double dt = cpu_time_usec() - start - clock_overhead;
+      struct replay_timing *tm = &run->timing[s->type];
+      tm->nb++;
+      tm->sum += dt;
+      if (dt > tm->max) {
+        tm->max = dt;
+      }
+    }
+  }
+  return NULL;
+}
+
+static void print_report(struct replay_run *runs, int nb_runs)
+{
+  int i, t;
+
+  printf("\nCPU time per update (usec, mean / max)\n");
+  printf("%-16s", "estimator");
+  for (t = 0; t < REPLAY_NB_TYPES; t++) {
+    if (runs[0].timing[t].nb > 0) {
+      printf(" %18s", type_names[t]);
+    }
+  }
+  printf(" %10s\n", "total ms");
+  for (i = 0; i < nb_runs; i++) {
+    double total = 0.;
+    printf("%-16s", runs[i].plugin->name);
+    for (t = 0; t < REPLAY_NB_TYPES; t++) {
+      struct replay_timing *tm = &runs[i].timing[t];
+      if (runs[0].timing[t].nb > 0) {
+        printf(" %8.3f / %7.2f", tm->nb ? tm->sum / tm->nb : 0., tm->max);
+      }
+      total += tm->sum;
+    }
+    printf(" %10.2f\n", total / 1000.);
+  }
+
+  printf("\nError against reference\n");
+  printf("%-16s %10s %10s %10s %10s %10s\n", "estimator", "valid at", "att rms", "att max", "pos rms", "pos max");
+  for (i = 0; i < nb_runs; i++) {
+    struct replay_run *r = &runs[i];
+    printf("%-16s", r->plugin->name);
+    if (r->first_valid < 0.) {
+      printf(" %10s\n", "never");
+      continue;
+    }
+    printf(" %9.2fs %9.3fd %9.3fd", r->first_valid,
+           sqrt(r->att_err.sum2 / r->att_err.nb), r->att_err.max);
+    if (r->pos_err.nb > 0) {
+      printf(" %9.3fm %9.3fm\n", sqrt(r->pos_err.sum2 / r->pos_err.nb), r->pos_err.max);
+    } else {
+      printf(" %10s %10s\n", "-", "-");
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  bool sequential = false;
+  const char *prefix = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "so:")) != -1) {
+    switch (opt) {
+      case 's': sequential = true; break;
+      case 'o': prefix = optarg; break;
+      default:
+        fprintf(stderr, "usage: %s [-s] [-o prefix] log_file plugin.so [plugin.so ...]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (argc - optind < 2) {
+    fprintf(stderr, "usage: %s [-s] [-o prefix] log_file plugin.so [plugin.so ...]\n", argv[0]);
+    return 2;
+  }
+
+  if (load_log(argv[optind]) <= 0) {
+    fprintf(stderr, "can't load samples from %s\n", argv[optind]);
+    return 1;
+  }
+  printf("%u samples loaded from %s (%.1f s)\n", nb_samples, argv[optind],
+         samples[nb_samples - 1].t - samples[0].t);
+  if (origin == NULL) {
+    printf("no ORIGIN sample, INS will use a null origin\n");
+  }
+  clock_overhead = measure_clock_overhead();
+
+  struct replay_run runs[REPLAY_MAX_PLUGINS];
+  int nb_runs = 0;
+  int i;
+  memset(runs, 0, sizeof(runs));
+  for (i = optind + 1; i < argc && nb_runs < REPLAY_MAX_PLUGINS; i++) {
+    struct replay_run *r = &runs[nb_runs];
+    r->filename = argv[i];
+    r->handle = dlopen(argv[i], RTLD_NOW | RTLD_LOCAL);
+    if (r->handle == NULL) {
+      fprintf(stderr, "can't load %s: %s\n", argv[i], dlerror());
+      continue;
+    }
+    r->plugin = (const struct replay_plugin *)dlsym(r->handle, REPLAY_PLUGIN_SYMBOL);
+    if (r->plugin == NULL) {
+      fprintf(stderr, "%s is not an estimator plugin\n", argv[i]);
+      dlclose(r->handle);
+      continue;
+    }
+    r->first_valid = -1.;
+    if (prefix != NULL) {
+      char filename[512];
+      snprintf(filename, sizeof(filename), "%s_%s.csv", prefix, r->plugin->name);
+      r->out = fopen(filename, "w");
+      if (r->out != NULL) {
+        fprintf(r->out, "t,phi,theta,psi,x,y,z,att_err,pos_err\n");
+      }
+    }
+    nb_runs++;
+  }
+  if (nb_runs == 0) {
+    return 1;
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < nb_runs; i++) {
+    if (sequential) {
+      replay_thread(&runs[i]);
+    } else {
+      pthread_create(&runs[i].thread, NULL, replay_thread, &runs[i]);
+    }
+  }
+  if (!sequential) {
+    for (i = 0; i < nb_runs; i++) {
+      pthread_join(runs[i].thread, NULL);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("%d estimators replayed in %.3f s\n", nb_runs,
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9);
+
+  print_report(runs, nb_runs);
+
+  for (i = 0; i < nb_runs; i++) {
+    if (runs[i].out != NULL) {
+      fclose(runs[i].out);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test/estimators/replay_plugin.c
+ *
+ * Glue between the replay harness and one estimator.
+ *
+ * Compiled once per estimator with:
+ *  - REPLAY_EST_NAME: name of the estimator
+ *  - REPLAY_EST_HEADER: header of the estimator wrapper
+ *  - REPLAY_EST_INIT: init function (ahrs_init for AHRS using PRIMARY_AHRS)
+ *  - REPLAY_EST_PERIODIC (optional): function called after each gyro sample
+ *
+ * Samples are converted to the fixed point representation of the IMU
+ * and sent with ABI, as the IMU and GPS drivers would do.
+ */
+
+#define ABI_C 1
+
+#include "test/estimators/replay.h"
+#include "subsystems/abi.h"
+#include "subsystems/imu.h"
+#include "subsystems/gps.h"
+#include "mcu_periph/sys_time.h"
+#include "math/pprz_geodetic_int.h"
+#include "math/pprz_geodetic_double.h"
+#include "state.h"
+#include "generated/flight_plan.h"
+#include REPLAY_EST_HEADER
+
+#ifndef REPLAY_IMU_ID
+#define REPLAY_IMU_ID IMU_BOARD_ID
+#endif
+
+#ifndef REPLAY_BARO_ID
+#define REPLAY_BARO_ID BARO_BOARD_SENDER_ID
+#endif
+
+#ifndef REPLAY_GPS_ID
+#define REPLAY_GPS_ID GPS_MULTI_ID
+#endif
+
+/* globals normally provided by the firmware */
+uint32_t replay_time_usec;
+int32_t replay_nav_lat0;
+int32_t replay_nav_lon0;
+int32_t replay_nav_alt0;
+struct sys_time sys_time;
+struct Imu imu;
+struct GpsState gps;
+
+static void replay_init(struct replay_sample *origin)
+{
+  if (origin != NULL) {
+    replay_nav_lat0 = (int32_t)(origin->v[0] * 1e7);
+    replay_nav_lon0 = (int32_t)(origin->v[1] * 1e7);
+    replay_nav_alt0 = (int32_t)(origin->v[2] * 1e3);
+  }
+
+  stateInit();
+  REPLAY_EST_INIT();
+
+  /* body and IMU frames are the same in the log */
+  struct FloatQuat body_to_imu;
+  float_quat_identity(&body_to_imu);
+  orientationSetQuat_f(&imu.body_to_imu, &body_to_imu);
+  AbiSendMsgBODY_TO_IMU_QUAT(REPLAY_IMU_ID, &body_to_imu);
+}
+
+static void replay_feed_gps(struct replay_sample *s, uint32_t stamp)
+{
+  struct LlaCoor_d lla_d = { RadOfDeg(s->v[0]), RadOfDeg(s->v[1]), s->v[2] };
+  struct EcefCoor_d ecef_d;
+  ecef_of_lla_d(&ecef_d, &lla_d);
+
+  gps.lla_pos.lat = (int32_t)(s->v[0] * 1e7);
+  gps.lla_pos.lon = (int32_t)(s->v[1] * 1e7);
+  gps.lla_pos.alt = (int32_t)(s->v[2] * 1e3);
+  gps.hmsl = gps.lla_pos.alt;
+  gps.ecef_pos.x = (int32_t)CM_OF_M(ecef_d.x);
+  gps.ecef_pos.y = (int32_t)CM_OF_M(ecef_d.y);
+  gps.ecef_pos.z = (int32_t)CM_OF_M(ecef_d.z);
+
+  gps.ned_vel.x = (int32_t)CM_OF_M(s->v[3]);
+  gps.ned_vel.y = (int32_t)CM_OF_M(s->v[4]);
+  gps.ned_vel.z = (int32_t)CM_OF_M(s->v[5]);
+  struct LtpDef_i ltp;
+  ltp_def_from_ecef_i(&ltp, &gps.ecef_pos);
+  ecef_of_ned_vect_i(&gps.ecef_vel, &ltp, &gps.ned_vel);
+  gps.gspeed = (uint16_t)CM_OF_M(sqrt(s->v[3] * s->v[3] + s->v[4] * s->v[4]));
+  gps.speed_3d = (uint16_t)CM_OF_M(sqrt(s->v[3] * s->v[3] + s->v[4] * s->v[4] + s->v[5] * s->v[5]));
+  gps.course = (int32_t)(atan2(s->v[4], s->v[3]) * 1e7);
+  if (gps.course < 0) {
+    gps.course += (int32_t)(2. * M_PI * 1e7);
+  }
+
+  gps.valid_fields = (1 << GPS_VALID_POS_ECEF_BIT) | (1 << GPS_VALID_POS_LLA_BIT) |
+                     (1 << GPS_VALID_VEL_ECEF_BIT) | (1 << GPS_VALID_VEL_NED_BIT) |
+                     (1 << GPS_VALID_HMSL_BIT) | (1 << GPS_VALID_COURSE_BIT);
+  gps.fix = GPS_FIX_3D;
+  gps.num_sv = 10;
+  gps.pacc = 100;
+  gps.hacc = 100;
+  gps.vacc = 150;
+  gps.sacc = 20;
+  gps.pdop = 150;
+  gps.tow = stamp / 1000;
+  gps.last_msg_time = stamp / 1000000;
+  gps.last_3dfix_time = gps.last_msg_time;
+
+  AbiSendMsgGPS(REPLAY_GPS_ID, stamp, &gps);
+}
+
+static void replay_feed(struct replay_sample *s)
+{
+  uint32_t stamp = (uint32_t)(s->t * 1e6);
+  replay_time_usec = stamp;
+
+  switch (s->type) {
+    case REPLAY_GYRO: {
+      struct FloatRates gyro = { s->v[0], s->v[1], s->v[2] };
+      RATES_BFP_OF_REAL(imu.gyro, gyro);
+      AbiSendMsgIMU_GYRO_INT32(REPLAY_IMU_ID, stamp, &imu.gyro);
+#ifdef REPLAY_EST_PERIODIC
+      REPLAY_EST_PERIODIC();
+#endif
+      break;
+    }
+    case REPLAY_ACCEL: {
+      struct FloatVect3 accel = { s->v[0], s->v[1], s->v[2] };
+      ACCELS_BFP_OF_REAL(imu.accel, accel);
+      AbiSendMsgIMU_ACCEL_INT32(REPLAY_IMU_ID, stamp, &imu.accel);
+      break;
+    }
+    case REPLAY_MAG: {
+      struct FloatVect3 mag = { s->v[0], s->v[1], s->v[2] };
+      MAGS_BFP_OF_REAL(imu.mag, mag);
+      AbiSendMsgIMU_MAG_INT32(REPLAY_IMU_ID, stamp, &imu.mag);
+      break;
+    }
+    case REPLAY_BARO: {
+      float pressure = s->v[0];
+      AbiSendMsgBARO_ABS(REPLAY_BARO_ID, stamp, pressure);
+      break;
+    }
+    case REPLAY_GPS:
+      replay_feed_gps(s, stamp);
+      break;
+    case REPLAY_GEO_MAG: {
+      struct FloatVect3 h = { s->v[0], s->v[1], s->v[2] };
+      AbiSendMsgGEO_MAG(REPLAY_IMU_ID, &h);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static void replay_get(struct replay_estimate *est)
+{
+  est->att_valid = stateIsAttitudeValid();
+  if (est->att_valid) {
+    est->quat = *stateGetNedToBodyQuat_f();
+  }
+  est->pos_valid = stateIsLocalCoordinateValid();
+  if (est->pos_valid) {
+    est->pos = *stateGetPositionNed_f();
+  }
+}
+
+const struct replay_plugin replay_plugin = {
+  .name = REPLAY_EST_NAME,
+  .init = replay_init,
+  .feed = replay_feed,
+  .get = replay_get,
+};
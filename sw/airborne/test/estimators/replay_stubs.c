@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test/estimators/replay_stubs.c
+ *
+ * Firmware functions and variables used by the fixedwing estimators,
+ * replaced by minimal versions for the replay.
+ */
+
+#include "test/estimators/replay_stubs.h"
+#include "subsystems/gps.h"
+#include "subsystems/navigation/common_nav.h"
+#include "modules/air_data/air_data.h"
+#include "math/pprz_geodetic_double.h"
+#include "math/pprz_isa.h"
+#include "generated/flight_plan.h"
+
+int32_t nav_utm_east0;
+int32_t nav_utm_north0;
+uint8_t nav_utm_zone0;
+float ground_alt;
+
+void replay_mekf_wind_init(void)
+{
+  struct LlaCoor_d lla0 = { RadOfDeg(NAV_LAT0 / 1e7), RadOfDeg(NAV_LON0 / 1e7), NAV_ALT0 / 1000. };
+  struct UtmCoor_d utm0 = { .zone = 0 };
+  utm_of_lla_d(&utm0, &lla0);
+  nav_utm_east0 = (int32_t)utm0.east;
+  nav_utm_north0 = (int32_t)utm0.north;
+  nav_utm_zone0 = utm0.zone;
+  ground_alt = GROUND_ALT;
+
+  ins_mekf_wind_wrapper_init();
+}
+
+struct UtmCoor_f utm_float_from_gps(struct GpsState *gps_s, uint8_t zone)
+{
+  struct UtmCoor_i utm_i = { .zone = zone };
+  struct UtmCoor_f utm;
+  utm_of_lla_i(&utm_i, &gps_s->lla_pos);
+  UTM_FLOAT_OF_BFP(utm, utm_i);
+  utm.alt = gps_s->hmsl / 1000.f;
+  return utm;
+}
+
+/* air data in standard atmosphere at sea level */
+
+float eas_from_dynamic_pressure(float q)
+{
+  return sqrtf(2.f * fabsf(q) / PPRZ_ISA_AIR_DENSITY);
+}
+
+float tas_from_eas(float eas)
+{
+  return eas;
+}
+
+float tas_from_dynamic_pressure(float q)
+{
+  return tas_from_eas(eas_from_dynamic_pressure(q));
+}
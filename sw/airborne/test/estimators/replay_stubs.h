@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test/estimators/replay_stubs.h
+ *
+ * Firmware functions and variables used by the fixedwing estimators
+ * (UTM navigation origin, air data), replaced by minimal versions for the replay.
+ */
+
+#ifndef REPLAY_STUBS_H
+#define REPLAY_STUBS_H
+
+#include "modules/ins/ins_mekf_wind_wrapper.h"
+
+/** Set UTM navigation origin from flight plan origin and init MEKF wind */
+extern void replay_mekf_wind_init(void);
+
+#endif /* REPLAY_STUBS_H */
@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2021 The Paparazzi Team
+#
+# This file is part of paparazzi.
+#
+# paparazzi is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# paparazzi is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with paparazzi; see the file COPYING.  If not, see
+# <http://www.gnu.org/licenses/>.
+#
+
+"""
+Generate a synthetic replay log (see replay.h for the format).
+
+The vehicle stays still for the alignment, then flies circles while
+rolling, pitching and climbing. Sensors are computed from the exact
+trajectory with white noise and a constant gyro bias; REF samples give
+the exact attitude and position.
+"""
+
+from __future__ import print_function
+
+import argparse
+import math
+import random
+
+# WGS84
+A = 6378137.0
+E2 = 6.69437999014e-3
+G = 9.81
+
+# normalized magnetic field, same as the replay airframe
+H = (0.51562740288882, -0.05707735220832, 0.85490967783446)
+
+
+def ecef_of_lla(lat, lon, alt):
+    n = A / math.sqrt(1. - E2 * math.sin(lat) ** 2)
+    return ((n + alt) * math.cos(lat) * math.cos(lon),
+            (n + alt) * math.cos(lat) * math.sin(lon),
+            (n * (1. - E2) + alt) * math.sin(lat))
+
+
+def lla_of_ecef(x, y, z):
+    lon = math.atan2(y, x)
+    p = math.hypot(x, y)
+    lat = math.atan2(z, p * (1. - E2))
+    for _ in range(5):
+        n = A / math.sqrt(1. - E2 * math.sin(lat) ** 2)
+        alt = p / math.cos(lat) - n
+        lat = math.atan2(z, p * (1. - E2 * n / (n + alt)))
+    n = A / math.sqrt(1. - E2 * math.sin(lat) ** 2)
+    return lat, lon, p / math.cos(lat) - n
+
+
+def lla_of_ned(origin, ned):
+    lat0, lon0, alt0 = origin
+    x0, y0, z0 = ecef_of_lla(lat0, lon0, alt0)
+    sl, cl = math.sin(lat0), math.cos(lat0)
+    so, co = math.sin(lon0), math.cos(lon0)
+    n, e, d = ned
+    dx = -sl * co * n - so * e - cl * co * d
+    dy = -sl * so * n + co * e - cl * so * d
+    dz = cl * n - sl * d
+    return lla_of_ecef(x0 + dx, y0 + dy, z0 + dz)
+
+
+def rmat_of_eulers(phi, theta, psi):
+    """ NED to body rotation matrix (ZYX) """
+    sphi, cphi = math.sin(phi), math.cos(phi)
+    sthe, cthe = math.sin(theta), math.cos(theta)
+    spsi, cpsi = math.sin(psi), math.cos(psi)
+    return ((cthe * cpsi, cthe * spsi, -sthe),
+            (sphi * sthe * cpsi - cphi * spsi, sphi * sthe * spsi + cphi * cpsi, sphi * cthe),
+            (cphi * sthe * cpsi + sphi * spsi, cphi * sthe * spsi - sphi * cpsi, cphi * cthe))
+
+
+def quat_of_eulers(phi, theta, psi):
+    sp, cp = math.sin(phi / 2.), math.cos(phi / 2.)
+    st, ct = math.sin(theta / 2.), math.cos(theta / 2.)
+    ss, cs = math.sin(psi / 2.), math.cos(psi / 2.)
+    return (cp * ct * cs + sp * st * ss,
+            -cp * st * ss + sp * ct * cs,
+            cp * st * cs + sp * ct * ss,
+            cp * ct * ss - sp * st * cs)
+
+
+def mult(m, v):
+    return tuple(sum(m[i][j] * v[j] for j in range(3)) for i in range(3))
+
+
+class Trajectory(object):
+    """ Analytic trajectory: still during t_align, then circles """
+
+    def __init__(self, t_align, radius, speed):
+        self.t_align = t_align
+        self.radius = radius
+        self.omega = speed / radius
+
+    def state(self, t):
+        """ return eulers, euler rates, NED pos, vel, accel """
+        if t < self.t_align:
+            return (0., 0., 0.), (0., 0., 0.), (0., 0., 0.), (0., 0., 0.), (0., 0., 0.)
+        tau = t - self.t_align
+        w, r = self.omega, self.radius
+        # ramp to avoid steps in rates and accelerations
+        k = min(tau / 5., 1.) if tau < 5. else 1.
+        dk = 0.2 if tau < 5. else 0.
+        # attitude
+        phi = k * math.radians(20.) * math.sin(0.3 * tau)
+        dphi = dk * math.radians(20.) * math.sin(0.3 * tau) + k * math.radians(20.) * 0.3 * math.cos(0.3 * tau)
+        theta = k * math.radians(10.) * math.sin(0.2 * tau)
+        dtheta = dk * math.radians(10.) * math.sin(0.2 * tau) + k * math.radians(10.) * 0.2 * math.cos(0.2 * tau)
+        psi = w * tau
+        dpsi = w
+        # position, circle in the horizontal plane, altitude oscillation
+        pos = (r * math.sin(w * tau), r * (1. - math.cos(w * tau)), -10. * (1. - math.cos(0.1 * tau)))
+        vel = (r * w * math.cos(w * tau), r * w * math.sin(w * tau), -1. * math.sin(0.1 * tau))
+        acc = (-r * w * w * math.sin(w * tau), r * w * w * math.cos(w * tau), -0.1 * math.cos(0.1 * tau))
+        return (phi, theta, psi), (dphi, dtheta, dpsi), pos, vel, acc
+
+
+def body_rates(eulers, deulers):
+    phi, theta, _ = eulers
+    dphi, dtheta, dpsi = deulers
+    p = dphi - dpsi * math.sin(theta)
+    q = dtheta * math.cos(phi) + dpsi * math.sin(phi) * math.cos(theta)
+    r = -dtheta * math.sin(phi) + dpsi * math.cos(phi) * math.cos(theta)
+    return p, q, r
+
+
+def pressure_of_alt(alt):
+    return 101325. * (1. - 2.25577e-5 * alt) ** 5.25588
+
+
+def noisy(v, sigma, bias=(0., 0., 0.)):
+    return tuple(x + b + random.gauss(0., sigma) for x, b in zip(v, bias))
+
+
+def fmt(t, name, values):
+    return "%.4f %s %s" % (t, name, " ".join("%.7f" % v for v in values))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('-d', '--duration', type=float, default=120., help="log duration (s)")
+    parser.add_argument('-a', '--align', type=float, default=10., help="still time for alignment (s)")
+    parser.add_argument('-f', '--freq', type=int, default=500, help="IMU frequency (Hz)")
+    parser.add_argument('-s', '--seed', type=int, default=1, help="random seed")
+    parser.add_argument('--lat', type=float, default=43.4622, help="origin latitude (deg)")
+    parser.add_argument('--lon', type=float, default=1.2729, help="origin longitude (deg)")
+    parser.add_argument('--alt', type=float, default=185., help="origin altitude (m)")
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    traj = Trajectory(args.align, 50., 10.)
+    origin = (math.radians(args.lat), math.radians(args.lon), args.alt)
+    gyro_bias = (0.01, -0.005, 0.003)
+
+    print("# synthetic log, seed %d" % args.seed)
+    print(fmt(0., "ORIGIN", (args.lat, args.lon, args.alt)))
+    print(fmt(0., "GEO_MAG", H))
+
+    nb = int(args.duration * args.freq)
+    for i in range(1, nb + 1):
+        t = float(i) / args.freq
+        eulers, deulers, pos, vel, acc = traj.state(t)
+        rmat = rmat_of_eulers(*eulers)
+
+        gyro = body_rates(eulers, deulers)
+        print(fmt(t, "GYRO", noisy(gyro, 0.002, gyro_bias)))
+        specific_force = mult(rmat, (acc[0], acc[1], acc[2] - G))
+        print(fmt(t, "ACCEL", noisy(specific_force, 0.05)))
+
+        if i % (args.freq // 50) == 0:
+            print(fmt(t, "MAG", noisy(mult(rmat, H), 0.005)))
+            print(fmt(t, "BARO", (pressure_of_alt(args.alt - pos[2]) + random.gauss(0., 1.),)))
+        if i % (args.freq // 5) == 0:
+            lat, lon, alt = lla_of_ned(origin, noisy(pos, 0.5))
+            gps = (math.degrees(lat), math.degrees(lon), alt) + noisy(vel, 0.1)
+            print(fmt(t, "GPS", gps))
+        if i % (args.freq // 10) == 0:
+            print(fmt(t, "REF", quat_of_eulers(*eulers) + pos))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test/math/pprz_math_bench.c
+ *
+ * Timing benchmarks of the pprz math functions used in every control cycle.
+ */
+
+#include "test/math/pprz_math_bench.h"
+
+#include "math/pprz_algebra_float.h"
+#include "math/pprz_algebra_int.h"
+#include "math/pprz_trig_int.h"
+#include "math/pprz_geodetic_float.h"
+#include "math/pprz_geodetic_int.h"
+#include "math/pprz_geodetic_double.h"
+
+/** Number of input samples, must be a power of 2 */
+#define BENCH_NB_INPUTS 16
+#define BENCH_INPUT(_i) ((_i) & (BENCH_NB_INPUTS - 1))
+
+volatile float pprz_math_bench_sink;
+
+static struct FloatQuat bench_quat_f[BENCH_NB_INPUTS];
+static struct FloatRates bench_rates_f[BENCH_NB_INPUTS];
+static struct Int32RMat bench_rmat_i[BENCH_NB_INPUTS];
+static int32_t bench_angle_i[BENCH_NB_INPUTS];
+
+static struct LlaCoor_f bench_lla_f[BENCH_NB_INPUTS];
+static struct LlaCoor_i bench_lla_i[BENCH_NB_INPUTS];
+static struct LlaCoor_d bench_lla_d[BENCH_NB_INPUTS];
+static struct EcefCoor_f bench_ecef_f[BENCH_NB_INPUTS];
+static struct EcefCoor_i bench_ecef_i[BENCH_NB_INPUTS];
+static struct EcefCoor_d bench_ecef_d[BENCH_NB_INPUTS];
+static struct LtpDef_f bench_ltp_f;
+static struct LtpDef_i bench_ltp_i;
+static struct LtpDef_d bench_ltp_d;
+
+void pprz_math_bench_init(void)
+{
+  uint8_t i;
+  for (i = 0; i < BENCH_NB_INPUTS; i++) {
+    float s = (float)i / BENCH_NB_INPUTS;
+    struct FloatEulers e = { 0.6f * s - 0.3f, 0.4f - 0.8f * s, 2.f * M_PI * s - M_PI };
+    float_quat_of_eulers(&bench_quat_f[i], &e);
+    bench_rates_f[i].p = 1.f - 2.f * s;
+    bench_rates_f[i].q = 0.5f * s;
+    bench_rates_f[i].r = -0.2f + s;
+    struct Int32Eulers e_i = { ANGLE_BFP_OF_REAL(e.phi), ANGLE_BFP_OF_REAL(e.theta), ANGLE_BFP_OF_REAL(e.psi) };
+    int32_rmat_of_eulers_321(&bench_rmat_i[i], &e_i);
+    bench_angle_i[i] = e_i.psi;
+
+    // points around Toulouse, up to a few km from the reference
+    bench_lla_d[i].lat = RadOfDeg(43.6052765 + 0.05 * s);
+    bench_lla_d[i].lon = RadOfDeg(1.4427764 - 0.05 * s);
+    bench_lla_d[i].alt = 180. + 500. * s;
+    LLA_COPY(bench_lla_f[i], bench_lla_d[i]);
+    bench_lla_i[i].lat = (int32_t)EM7DEG_OF_RAD(bench_lla_d[i].lat);
+    bench_lla_i[i].lon = (int32_t)EM7DEG_OF_RAD(bench_lla_d[i].lon);
+    bench_lla_i[i].alt = (int32_t)MM_OF_M(bench_lla_d[i].alt);
+    ecef_of_lla_d(&bench_ecef_d[i], &bench_lla_d[i]);
+    ecef_of_lla_f(&bench_ecef_f[i], &bench_lla_f[i]);
+    ecef_of_lla_i(&bench_ecef_i[i], &bench_lla_i[i]);
+  }
+  ltp_def_from_lla_d(&bench_ltp_d, &bench_lla_d[0]);
+  ltp_def_from_lla_f(&bench_ltp_f, &bench_lla_f[0]);
+  ltp_def_from_lla_i(&bench_ltp_i, &bench_lla_i[0]);
+}
+
+/*
+ * Benchmark functions
+ * Each one calls the benchmarked function n times on the input set
+ * and accumulates a result in the sink.
+ * Integer results are summed as unsigned, so that wrapping is defined.
+ */
+
+static void bench_empty(uint32_t n)
+{
+  float acc = 0.f;
+  uint32_t i;
+  for (i = 0; i < n; i++) {
+    acc += bench_quat_f[BENCH_INPUT(i)].qi;
+  }
+  pprz_math_bench_sink = acc;
+}
+
+static void bench_float_quat_integrate(uint32_t n)
+{
+  float acc = 0.f;
+  uint32_t i;
+  for (i = 0; i < n; i++) {
+    struct FloatQuat q = bench_quat_f[BENCH_INPUT(i)];
+    float_quat_integrate(&q, &bench_rates_f[BENCH_INPUT(i)], 1.f / 512.f);
+    acc += q.qi;
+  }
+  pprz_math_bench_sink = acc;
+}
+
+static void bench_float_rmat_of_quat(uint32_t n)
+{
+  float acc = 0.f;
+  uint32_t i;
+  struct FloatRMat rm;
+  for (i = 0; i < n; i++) {
+    float_rmat_of_quat(&rm, &bench_quat_f[BENCH_INPUT(i)]);
+    acc += rm.m[0];
+  }
+  pprz_math_bench_sink = acc;
+}
+
+static void bench_int32_quat_of_rmat(uint32_t n)
+{
+  uint32_t acc = 0;
+  uint32_t i;
+  struct Int32Quat q;
+  for (i = 0; i < n; i++) {
+    int32_quat_of_rmat(&q, &bench_rmat_i[BENCH_INPUT(i)]);
+    acc += (uint32_t)q.qi;
+  }
+  pprz_math_bench_sink = (float)acc;
+}
+
+static void bench_pprz_itrig_sin(uint32_t n)
+{
+  uint32_t acc = 0;
+  uint32_t i;
+  for (i = 0; i < n; i++) {
+    acc += (uint32_t)pprz_itrig_sin(bench_angle_i[BENCH_INPUT(i)]);
+  }
+  pprz_math_bench_sink = (float)acc;
+}
+
+static void bench_pprz_itrig_cos(uint32_t n)
+{
+  uint32_t acc = 0;
+  uint32_t i;
+  for (i = 0; i < n; i++) {
+    acc += (uint32_t)pprz_itrig_cos(bench_angle_i[BENCH_INPUT(i)]);
+  }
+  pprz_math_bench_sink = (float)acc;
+}
+
+static void bench_ecef_of_lla_f(uint32_t n)
+{
+  float acc = 0.f;
+  uint32_t i;
+  struct EcefCoor_f ecef;
+  for (i = 0; i < n; i++) {
+    ecef_of_lla_f(&ecef, &bench_lla_f[BENCH_INPUT(i)]);
+    acc += ecef.x;
+  }
+  pprz_math_bench_sink = acc;
+}
+
+static void bench_ecef_of_lla_i(uint32_t n)
+{
+  uint32_t acc = 0;
+  uint32_t i;
+  struct EcefCoor_i ecef;
+  for (i = 0; i < n; i++) {
+    ecef_of_lla_i(&ecef, &bench_lla_i[BENCH_INPUT(i)]);
+    acc += (uint32_t)ecef.x;
+  }
+  pprz_math_bench_sink = (float)acc;
+}
+
+static void bench_ecef_of_lla_d(uint32_t n)
+{
+  double acc = 0.;
+  uint32_t i;
+  struct EcefCoor_d ecef;
+  for (i = 0; i < n; i++) {
+    ecef_of_lla_d(&ecef, &bench_lla_d[BENCH_INPUT(i)]);
+    acc += ecef.x;
+  }
+  pprz_math_bench_sink = (float)acc;
+}
+
+static void bench_ned_of_ecef_point_f(uint32_t n)
+{
+  float acc = 0.f;
+  uint32_t i;
+  struct NedCoor_f ned;
+  for (i = 0; i < n; i++) {
+    ned_of_ecef_point_f(&ned, &bench_ltp_f, &bench_ecef_f[BENCH_INPUT(i)]);
+    acc += ned.x;
+  }
+  pprz_math_bench_sink = acc;
+}
+
+static void bench_ned_of_ecef_point_i(uint32_t n)
+{
+  uint32_t acc = 0;
+  uint32_t i;
+  struct NedCoor_i ned;
+  for (i = 0; i < n; i++) {
+    ned_of_ecef_point_i(&ned, &bench_ltp_i, &bench_ecef_i[BENCH_INPUT(i)]);
+    acc += (uint32_t)ned.x;
+  }
+  pprz_math_bench_sink = (float)acc;
+}
+
+static void bench_ned_of_ecef_point_d(uint32_t n)
+{
+  double acc = 0.;
+  uint32_t i;
+  struct NedCoor_d ned;
+  for (i = 0; i < n; i++) {
+    ned_of_ecef_point_d(&ned, &bench_ltp_d, &bench_ecef_d[BENCH_INPUT(i)]);
+    acc += ned.x;
+  }
+  pprz_math_bench_sink = (float)acc;
+}
+
+const struct pprz_math_bench pprz_math_bench_list[] = {
+  { "float_quat_integrate", bench_float_quat_integrate },
+  { "float_rmat_of_quat", bench_float_rmat_of_quat },
+  { "int32_quat_of_rmat", bench_int32_quat_of_rmat },
+  { "pprz_itrig_sin", bench_pprz_itrig_sin },
+  { "pprz_itrig_cos", bench_pprz_itrig_cos },
+  { "ecef_of_lla_f", bench_ecef_of_lla_f },
+  { "ecef_of_lla_i", bench_ecef_of_lla_i },
+  { "ecef_of_lla_d", bench_ecef_of_lla_d },
+  { "ned_of_ecef_point_f", bench_ned_of_ecef_point_f },
+  { "ned_of_ecef_point_i", bench_ned_of_ecef_point_i },
+  { "ned_of_ecef_point_d", bench_ned_of_ecef_point_d },
+};
+
+const uint8_t pprz_math_bench_nb = sizeof(pprz_math_bench_list) / sizeof(pprz_math_bench_list[0]);
+
+static uint32_t bench_min_ticks(void (*run)(uint32_t n), uint32_t n, pprz_math_bench_ticks ticks)
+{
+  uint32_t best = UINT32_MAX;
+  uint8_t k;
+  run(n); // warm up caches and branch predictors
+  for (k = 0; k < PPRZ_MATH_BENCH_REPEAT; k++) {
+    uint32_t start = ticks();
+    run(n);
+    uint32_t dt = ticks() - start;
+    if (dt < best) {
+      best = dt;
+    }
+  }
+  return best;
+}
+
+float pprz_math_bench_measure(uint8_t idx, uint32_t n, pprz_math_bench_ticks ticks)
+{
+  if (idx >= pprz_math_bench_nb || n == 0) {
+    return 0.f;
+  }
+  uint32_t overhead = bench_min_ticks(bench_empty, n, ticks);
+  uint32_t total = bench_min_ticks(pprz_math_bench_list[idx].run, n, ticks);
+  if (total < overhead) {
+    return 0.f;
+  }
+  return (float)(total - overhead) / (float)n;
+}
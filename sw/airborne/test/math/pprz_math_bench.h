@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test/math/pprz_math_bench.h
+ *
+ * Timing benchmarks of the pprz math functions used in every control cycle.
+ *
+ * The benchmark list is shared between the native runner (tests/math/bench_pprz_math.c)
+ * and the MCU test program (test/test_math_bench.c).
+ * Time is measured with a caller supplied tick counter
+ * (monotonic clock or TSC on host, DWT cycle counter on STM32).
+ */
+
+#ifndef PPRZ_MATH_BENCH_H
+#define PPRZ_MATH_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "std.h"
+
+/** Number of measurement runs, the fastest one is kept */
+#ifndef PPRZ_MATH_BENCH_REPEAT
+#define PPRZ_MATH_BENCH_REPEAT 5
+#endif
+
+/** Tick counter function, must be monotonic (wrapping allowed) */
+typedef uint32_t (*pprz_math_bench_ticks)(void);
+
+/** Benchmark definition */
+struct pprz_math_bench {
+  const char *name;           ///< name of the benchmarked function
+  void (*run)(uint32_t n);    ///< run n calls of the function
+};
+
+/** List of benchmarks */
+extern const struct pprz_math_bench pprz_math_bench_list[];
+/** Number of benchmarks in #pprz_math_bench_list */
+extern const uint8_t pprz_math_bench_nb;
+
+/** Output of the benchmarked functions, prevents the calls from being optimized out */
+extern volatile float pprz_math_bench_sink;
+
+/** Init input data sets */
+extern void pprz_math_bench_init(void);
+
+/** Measure one benchmark.
+ * The loop overhead is measured with an empty benchmark and removed.
+ * @param idx index of the benchmark in #pprz_math_bench_list
+ * @param n number of calls per run
+ * @param ticks tick counter function
+ * @return number of ticks per call (fastest of #PPRZ_MATH_BENCH_REPEAT runs)
+ */
+extern float pprz_math_bench_measure(uint8_t idx, uint32_t n, pprz_math_bench_ticks ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PPRZ_MATH_BENCH_H */
+
@@ -29,18 +29,22 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 #include "std.h"
 #include "firmwares/rotorcraft/stabilization/wls/wls_alloc.h"
 
 #define INDI_OUTPUTS 4
 
 void test_overdetermined(void);
+void test_warm_start(void);
 void calc_nu_out(float** Bwls, float* du, float* nu_out);
 
 int main(int argc, char **argv)
 {
 #define INDI_NUM_ACT 6
   test_overdetermined();
+  test_warm_start();
 /*#define INDI_NUM_ACT 4*/
   /*test_four_by_four();*/
 }
@@ -166,3 +170,49 @@ void calc_nu_out(float** Bwls, float* du, float* nu_out) {
   }
 }
 
+/*
+ * compare the warm started allocation with the default one
+ * on a sequence of slowly varying control objectives
+ */
+void test_warm_start(void)
+{
+  float g1g2[INDI_OUTPUTS][INDI_NUM_ACT] = {
+    {  0.0,  -0.015,  0.015,  0.0,  -0.015,   0.015 },
+    {  0.015,   -0.010, -0.010,   0.015,  -0.010,   -0.010 },
+    {   0.103,   0.103,    0.103,   -0.103,    -0.103,    -0.103 },
+    {-0.0009, -0.0009, -0.0009, -0.0009, -0.0009, -0.0009 }
+  };
+  float *Bwls[INDI_OUTPUTS];
+  for (int i = 0; i < INDI_OUTPUTS; i++) {
+    Bwls[i] = g1g2[i];
+  }
+  static float Wv[INDI_OUTPUTS] = {100, 100, 1, 10};
+  float u_c[INDI_NUM_ACT] = {4614, 4210, 4210, 4614, 4210, 4210};
+  float du_min[INDI_NUM_ACT], du_max[INDI_NUM_ACT], du_pref[INDI_NUM_ACT];
+  for (int k = 0; k < INDI_NUM_ACT; k++) {
+    du_min[k] = -u_c[k];
+    du_max[k] = 9600 - u_c[k];
+    du_pref[k] = -u_c[k];
+  }
+
+  float du_cold[INDI_NUM_ACT], du_warm[INDI_NUM_ACT] = {0};
+  float W[INDI_NUM_ACT] = {0};
+  int it_cold = 0, it_warm = 0, fail_cold = 0, fail_warm = 0;
+  float max_diff = 0;
+  for (int n = 0; n < 1000; n++) {
+    float t = n * 0.002f;
+    float indi_v[INDI_OUTPUTS] = {300 * sinf(3 * t), 300 * cosf(2 * t), 800 * sinf(t), 2 * sinf(5 * t)};
+    int ic = wls_alloc(du_cold, indi_v, du_min, du_max, Bwls, 0, 0, Wv, 0, du_pref, 10000, 10);
+    int iw = wls_alloc_warm(du_warm, indi_v, du_min, du_max, Bwls, W, Wv, 0, du_pref, 10000, 10);
+    if (ic < 0) { fail_cold++; } else { it_cold += ic; }
+    if (iw < 0) { fail_warm++; } else { it_warm += iw; }
+    if (ic >= 0 && iw >= 0) {
+      for (int k = 0; k < INDI_NUM_ACT; k++) {
+        max_diff = Max(max_diff, fabsf(du_cold[k] - du_warm[k]));
+      }
+    }
+  }
+  printf("\nwarm start on 1000 cycles:\n");
+  printf("iterations cold %d (%d failed), warm %d (%d failed)\n", it_cold, fail_cold, it_warm, fail_warm);
+  printf("max difference between solutions %f\n", max_diff);
+}
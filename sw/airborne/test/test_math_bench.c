@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file test_math_bench.c
+ *
+ * Run the math library timing benchmarks (see test/math/pprz_math_bench.h)
+ * with the DWT cycle counter.
+ *
+ * One benchmark is run at each periodic call (round-robin) and the result
+ * is sent in a PAYLOAD_FLOAT message: index, cycles/call, ns/call.
+ * Names of the benchmarks are listed in pprz_math_bench_list, the same values
+ * can be compared with the native results of tests/math (make bench).
+ */
+
+#define DATALINK_C
+
+#include BOARD_CONFIG
+#include "mcu.h"
+#include "mcu_periph/sys_time.h"
+#include "subsystems/datalink/downlink.h"
+#include "led.h"
+#include "test/math/pprz_math_bench.h"
+
+/* cycle counter only exists for STM32 architecture */
+#if defined(STM32F1) || defined(STM32F4)
+#include <libopencm3/cm3/dwt.h>
+#define BENCH_CYCLES_PER_NSEC ((float)AHB_CLK / 1e9f)
+#else
+#define dwt_read_cycle_counter() 0
+#define dwt_enable_cycle_counter() 0
+#define BENCH_CYCLES_PER_NSEC 1.f
+#endif
+
+/** Number of calls per measurement */
+#ifndef TEST_MATH_BENCH_NB_CALLS
+#define TEST_MATH_BENCH_NB_CALLS 100
+#endif
+
+static inline void main_init(void);
+static inline void main_periodic(void);
+static inline void main_event(void);
+
+static uint32_t bench_cycles(void)
+{
+  return dwt_read_cycle_counter();
+}
+
+int main(void)
+{
+  main_init();
+
+  dwt_enable_cycle_counter();
+
+  while (1) {
+    if (sys_time_check_and_ack_timer(0)) {
+      main_periodic();
+    }
+    main_event();
+  }
+  return 0;
+}
+
+static inline void main_init(void)
+{
+  mcu_init();
+  sys_time_register_timer((1. / PERIODIC_FREQUENCY), NULL);
+  mcu_int_enable();
+
+  downlink_init();
+  pprz_math_bench_init();
+}
+
+static inline void main_periodic(void)
+{
+  static uint8_t idx = 0;
+
+  RunOnceEvery(10, {DOWNLINK_SEND_ALIVE(DefaultChannel, DefaultDevice, 16, MD5SUM);});
+  LED_PERIODIC();
+
+  RunOnceEvery(10, {
+    float result[3];
+    result[0] = idx;
+    result[1] = pprz_math_bench_measure(idx, TEST_MATH_BENCH_NB_CALLS, bench_cycles);
+    result[2] = result[1] / BENCH_CYCLES_PER_NSEC;
+    DOWNLINK_SEND_PAYLOAD_FLOAT(DefaultChannel, DefaultDevice, 3, result);
+    idx = (idx + 1) % pprz_math_bench_nb;
+  });
+}
+
+static inline void main_event(void)
+{
+  mcu_event();
+}
@@ -0,0 +1,913 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file log2plb.c
+ * Convert a flight log to the binary columnar format (see plb.h).
+ *
+ * Inputs:
+ *  - ground logs: the .data text file and its .log, which holds the schema
+ *    of the messages (protocol section)
+ *  - SD logs: the .tlm file of pprzlog frames, with the messages.xml used to
+ *    build the aircraft (default $PAPARAZZI_HOME/var/messages.xml)
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plb.h"
+
+#define PPRZLOG_STX 0x99
+#define NB_CLASSES 16
+
+/** Field of a message definition */
+struct DefField {
+  char name[PLB_NAME_LEN];
+  int type;
+  uint16_t array_len;   ///< 1 for scalars
+  bool variable;        ///< arrays without size and strings
+};
+
+/** Message definition from the schema */
+struct Def {
+  char name[PLB_NAME_LEN];
+  int class_id;         ///< 0 telemetry, 1 datalink, order of the other classes
+  int link_class;       ///< class id in the pprzlink v2 header, -1 if not given
+  int id;
+  int nb_fields;
+  struct DefField *fields;
+};
+
+static struct {
+  struct Def *defs;
+  int nb;
+  int *by_name;         ///< hash table of the telemetry and datalink messages
+  int by_name_size;
+  int by_id[NB_CLASSES][256];
+  const char *text;     ///< protocol section
+  size_t text_len;
+} schema;
+
+struct Buf {
+  uint8_t *data;
+  size_t len;
+  size_t cap;
+};
+
+struct StreamBuild {
+  int def;
+  uint8_t ac_id;
+  uint64_t nb;
+  bool sorted;
+  struct Buf times;
+  struct Buf seqs;      ///< record number in the source log
+  struct Buf *cols;
+  struct Buf *index;    ///< first element of each record, variable fields only
+};
+
+static struct StreamBuild *streams;
+static int nb_streams;
+static int *stream_of[256];     ///< stream of each definition per aircraft, -1 if none
+static uint64_t nb_errors;
+static uint64_t nb_records;     ///< records of all the streams, numbered in the order of the log
+
+static void buf_add(struct Buf *b, const void *data, size_t len)
+{
+  if (b->len + len > b->cap) {
+    b->cap = b->cap ? 2 * b->cap : 256;
+    while (b->cap < b->len + len) {
+      b->cap *= 2;
+    }
+    b->data = realloc(b->data, b->cap);
+    if (b->data == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
+  }
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+}
+
+/*
+ * Schema
+ */
+
+/** Value of an attribute inside a tag, case insensitive name */
+static bool xml_attrib(const char *tag, const char *end, const char *name, const char **value, size_t *len)
+{
+  size_t n = strlen(name);
+  for (const char *p = tag + 1; p + n + 2 < end; p++) {
+    if (isspace((unsigned char)p[-1]) && strncasecmp(p, name, n) == 0) {
+      const char *q = p + n;
+      while (q < end && isspace((unsigned char)*q)) { q++; }
+      if (q >= end || *q != '=') {
+        continue;
+      }
+      q++;
+      while (q < end && isspace((unsigned char)*q)) { q++; }
+      if (q >= end || (*q != '"' && *q != '\'')) {
+        continue;
+      }
+      char quote = *q++;
+      const char *e = memchr(q, quote, end - q);
+      if (e == NULL) {
+        return false;
+      }
+      *value = q;
+      *len = e - q;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void copy_name(char *dst, const char *src, size_t len)
+{
+  if (len >= PLB_NAME_LEN) {
+    len = PLB_NAME_LEN - 1;
+  }
+  memcpy(dst, src, len);
+  dst[len] = '\0';
+}
+
+static uint32_t hash_name(const char *name)
+{
+  uint32_t h = 2166136261u;
+  for (; *name; name++) {
+    h = (h ^ (uint8_t)*name) * 16777619u;
+  }
+  return h;
+}
+
+static void add_field(struct Def *d, const char *tag, const char *end)
+{
+  const char *name, *type;
+  size_t name_len, type_len;
+  if (!xml_attrib(tag, end, "name", &name, &name_len) || !xml_attrib(tag, end, "type", &type, &type_len)) {
+    return;
+  }
+  struct DefField f;
+  copy_name(f.name, name, name_len);
+  f.array_len = 1;
+  f.variable = false;
+  const char *bracket = memchr(type, '[', type_len);
+  size_t base_len = bracket ? (size_t)(bracket - type) : type_len;
+  f.type = plb_type_of_name(type, base_len);
+  if (f.type < 0) {
+    fprintf(stderr, "Unknown type %.*s of %s.%s, skipping the message\n", (int)type_len, type, d->name, f.name);
+    d->nb_fields = -1;
+    return;
+  }
+  if (bracket) {
+    int n = atoi(bracket + 1);
+    if (n > 0) {
+      f.array_len = n;
+    } else {
+      f.variable = true;
+    }
+  }
+  if (f.type == PLB_CHAR && !bracket) {
+    f.variable = true;   // string
+  }
+  if (d->nb_fields >= 0) {
+    d->fields = realloc(d->fields, (d->nb_fields + 1) * sizeof(struct DefField));
+    d->fields[d->nb_fields++] = f;
+  }
+}
+
+/**
+ * Read the message definitions of a protocol xml (messages.xml or the
+ * protocol section of a .log). Only the class, message and field tags are
+ * needed, a tag scanner is enough.
+ */
+static bool schema_parse(const char *text, size_t len)
+{
+  const char *start = strstr(text, "<protocol");
+  const char *stop = start ? strstr(start, "</protocol>") : NULL;
+  if (start && stop) {
+    schema.text = start;
+    schema.text_len = stop + strlen("</protocol>") - start;
+  } else {
+    schema.text = text;
+    schema.text_len = len;
+  }
+  memset(schema.by_id, -1, sizeof(schema.by_id));
+
+  const char *p = schema.text;
+  const char *end = schema.text + schema.text_len;
+  int class_id = -1, link_class = -1, nb_classes = 0;
+  struct Def *cur = NULL;
+  while ((p = memchr(p, '<', end - p)) != NULL) {
+    if (strncmp(p, "<!--", 4) == 0) {
+      const char *e = strstr(p, "-->");
+      p = e ? e + 3 : end;
+      continue;
+    }
+    const char *tag_end = memchr(p, '>', end - p);
+    if (tag_end == NULL) {
+      break;
+    }
+    const char *value;
+    size_t value_len;
+    if (strncmp(p, "<msg_class", 10) == 0 || strncmp(p, "<class", 6) == 0) {
+      link_class = xml_attrib(p, tag_end, "id", &value, &value_len) ? atoi(value) : -1;
+      if (xml_attrib(p, tag_end, "name", &value, &value_len) && value_len == 9 &&
+          strncmp(value, "telemetry", 9) == 0) {
+        class_id = 0;
+      } else if (xml_attrib(p, tag_end, "name", &value, &value_len) && value_len == 8 &&
+                 strncmp(value, "datalink", 8) == 0) {
+        class_id = 1;
+      } else {
+        class_id = 2 + nb_classes;
+      }
+      nb_classes++;
+      cur = NULL;
+    } else if (strncmp(p, "<message", 8) == 0 && isspace((unsigned char)p[8]) && class_id >= 0) {
+      schema.defs = realloc(schema.defs, (schema.nb + 1) * sizeof(struct Def));
+      cur = &schema.defs[schema.nb++];
+      memset(cur, 0, sizeof(*cur));
+      cur->class_id = class_id;
+      cur->link_class = link_class;
+      cur->id = xml_attrib(p, tag_end, "id", &value, &value_len) ? (int)strtol(value, NULL, 0) : -1;
+      if (xml_attrib(p, tag_end, "name", &value, &value_len)) {
+        copy_name(cur->name, value, value_len);
+      }
+      if (tag_end[-1] == '/') {
+        cur = NULL;
+      }
+    } else if (strncmp(p, "<field", 6) == 0 && cur) {
+      add_field(cur, p, tag_end);
+    } else if (strncmp(p, "</message", 9) == 0) {
+      cur = NULL;
+    }
+    p = tag_end + 1;
+  }
+  if (schema.nb == 0) {
+    return false;
+  }
+
+  // lookup tables, telemetry first for the names shared with datalink
+  schema.by_name_size = 1;
+  while (schema.by_name_size < 4 * schema.nb) {
+    schema.by_name_size *= 2;
+  }
+  schema.by_name = malloc(schema.by_name_size * sizeof(int));
+  memset(schema.by_name, -1, schema.by_name_size * sizeof(int));
+  for (int c = 0; c < 2; c++) {
+    for (int i = 0; i < schema.nb; i++) {
+      struct Def *d = &schema.defs[i];
+      if (d->class_id != c || d->nb_fields < 0) {
+        continue;
+      }
+      uint32_t h = hash_name(d->name) & (schema.by_name_size - 1);
+      while (schema.by_name[h] >= 0 && strcmp(schema.defs[schema.by_name[h]].name, d->name) != 0) {
+        h = (h + 1) & (schema.by_name_size - 1);
+      }
+      if (schema.by_name[h] < 0) {
+        schema.by_name[h] = i;
+      }
+      if (d->id >= 0 && d->id < 256) {
+        schema.by_id[c][d->id] = i;
+      }
+    }
+  }
+  return true;
+}
+
+static int def_of_name(const char *name)
+{
+  uint32_t h = hash_name(name) & (schema.by_name_size - 1);
+  while (schema.by_name[h] >= 0) {
+    if (strcmp(schema.defs[schema.by_name[h]].name, name) == 0) {
+      return schema.by_name[h];
+    }
+    h = (h + 1) & (schema.by_name_size - 1);
+  }
+  return -1;
+}
+
+/*
+ * Streams
+ */
+
+static struct StreamBuild *stream_get(int def, uint8_t ac_id)
+{
+  if (stream_of[ac_id] == NULL) {
+    stream_of[ac_id] = malloc(schema.nb * sizeof(int));
+    memset(stream_of[ac_id], -1, schema.nb * sizeof(int));
+  }
+  if (stream_of[ac_id][def] < 0) {
+    streams = realloc(streams, (nb_streams + 1) * sizeof(struct StreamBuild));
+    struct StreamBuild *s = &streams[nb_streams];
+    memset(s, 0, sizeof(*s));
+    s->def = def;
+    s->ac_id = ac_id;
+    s->sorted = true;
+    int n = schema.defs[def].nb_fields;
+    s->cols = calloc(n > 0 ? n : 1, sizeof(struct Buf));
+    s->index = calloc(n > 0 ? n : 1, sizeof(struct Buf));
+    uint64_t zero = 0;
+    for (int i = 0; i < n; i++) {
+      if (schema.defs[def].fields[i].variable) {
+        buf_add(&s->index[i], &zero, sizeof(zero));
+      }
+    }
+    stream_of[ac_id][def] = nb_streams++;
+  }
+  return &streams[stream_of[ac_id][def]];
+}
+
+/** Values of a record being parsed, committed to the stream when complete */
+static struct Buf rec_vals[256];
+static uint64_t rec_count[256];
+
+static void record_commit(struct StreamBuild *s, double time)
+{
+  const struct Def *d = &schema.defs[s->def];
+  if (s->nb > 0 && time < ((double *)s->times.data)[s->nb - 1]) {
+    s->sorted = false;
+  }
+  buf_add(&s->times, &time, sizeof(time));
+  buf_add(&s->seqs, &nb_records, sizeof(nb_records));
+  nb_records++;
+  for (int i = 0; i < d->nb_fields; i++) {
+    buf_add(&s->cols[i], rec_vals[i].data, rec_vals[i].len);
+    if (d->fields[i].variable) {
+      uint64_t next = ((uint64_t *)s->index[i].data)[s->nb] + rec_count[i];
+      buf_add(&s->index[i], &next, sizeof(next));
+    }
+  }
+  s->nb++;
+}
+
+/** Store a number in the record as the field type
+ * @return false if the token is not a number or is out of the range of the type
+ */
+static bool store_number(int field, int type, const char *token, char **end)
+{
+  union {
+    uint8_t u8; int8_t i8; uint16_t u16; int16_t i16; uint32_t u32; int32_t i32;
+    uint64_t u64; int64_t i64; float f; double d; char c;
+  } v;
+  bool in_range = true;
+  errno = 0;
+  switch (type) {
+    case PLB_FLOAT: v.f = strtof(token, end); break;
+    case PLB_DOUBLE: v.d = strtod(token, end); break;
+    case PLB_UINT64: v.u64 = strtoull(token, end, 10); in_range = *token != '-'; break;
+    case PLB_INT64: v.i64 = strtoll(token, end, 10); break;
+    default: {
+      long long n = strtoll(token, end, 10);
+      if (**end == '.' || **end == 'e') {
+        double x = strtod(token, end);  // integer printed as float
+        n = x > -1e18 && x < 1e18 ? (long long)x : LLONG_MAX;
+      }
+      switch (type) {
+        case PLB_UINT8: in_range = n >= 0 && n <= UINT8_MAX; v.u8 = n; break;
+        case PLB_INT8: in_range = n >= INT8_MIN && n <= INT8_MAX; v.i8 = n; break;
+        case PLB_UINT16: in_range = n >= 0 && n <= UINT16_MAX; v.u16 = n; break;
+        case PLB_INT16: in_range = n >= INT16_MIN && n <= INT16_MAX; v.i16 = n; break;
+        case PLB_UINT32: in_range = n >= 0 && n <= UINT32_MAX; v.u32 = n; break;
+        case PLB_INT32: in_range = n >= INT32_MIN && n <= INT32_MAX; v.i32 = n; break;
+        default: in_range = n >= CHAR_MIN && n <= CHAR_MAX; v.c = n; break;
+      }
+    }
+  }
+  // overflows of the integer types are not truncated, floats saturate
+  if (*end == token || !in_range || (errno == ERANGE && type != PLB_FLOAT && type != PLB_DOUBLE)) {
+    return false;
+  }
+  buf_add(&rec_vals[field], &v, plb_type_size[type]);
+  rec_count[field]++;
+  return true;
+}
+
+/*
+ * Ground logs: .data text lines "time ac_id MESSAGE field ..."
+ */
+
+/** Next space separated token, quotes for strings with spaces */
+static char *next_token(char **p)
+{
+  char *s = *p;
+  while (*s == ' ' || *s == '\t') { s++; }
+  if (*s == '\0' || *s == '\n' || *s == '\r') {
+    return NULL;
+  }
+  char *tok = s;
+  if (*s == '"') {
+    tok = ++s;
+    while (*s && *s != '"') { s++; }
+  } else {
+    while (*s && *s != ' ' && *s != '\t' && *s != '\n' && *s != '\r') { s++; }
+  }
+  if (*s) {
+    *s++ = '\0';
+  }
+  *p = s;
+  return tok;
+}
+
+static bool parse_data_line(char *line)
+{
+  char *p = line;
+  char *tok_time = next_token(&p);
+  char *tok_ac = next_token(&p);
+  char *tok_name = next_token(&p);
+  if (tok_time == NULL || tok_ac == NULL || tok_name == NULL) {
+    return false;
+  }
+  double time = strtod(tok_time, NULL);
+  int ac_id = atoi(tok_ac);
+  int def = def_of_name(tok_name);
+  if (def < 0 || ac_id < 0 || ac_id > 255) {
+    return false;
+  }
+  const struct Def *d = &schema.defs[def];
+  for (int i = 0; i < d->nb_fields; i++) {
+    const struct DefField *f = &d->fields[i];
+    rec_vals[i].len = 0;
+    rec_count[i] = 0;
+    char *tok = next_token(&p);
+    if (tok == NULL) {
+      return false;
+    }
+    if (f->type == PLB_CHAR) {
+      size_t n = strlen(tok);
+      if (!f->variable) {
+        n = n < f->array_len ? n : f->array_len;
+      }
+      buf_add(&rec_vals[i], tok, n);
+      rec_count[i] = n;
+      // fixed size char arrays are padded
+      for (; !f->variable && rec_count[i] < f->array_len; rec_count[i]++) {
+        buf_add(&rec_vals[i], "", 1);
+      }
+      continue;
+    }
+    char *end = tok;
+    while (*end) {
+      if (!store_number(i, f->type, end, &end)) {
+        return false;
+      }
+      if (*end == ',') {
+        end++;
+      } else if (*end != '\0') {
+        return false;
+      }
+    }
+    if (!f->variable && rec_count[i] != f->array_len) {
+      return false;
+    }
+  }
+  // more fields than the message definition
+  if (next_token(&p) != NULL) {
+    return false;
+  }
+  record_commit(stream_get(def, ac_id), time);
+  return true;
+}
+
+static bool convert_data(const char *path)
+{
+  FILE *in = fopen(path, "r");
+  if (in == NULL) {
+    perror(path);
+    return false;
+  }
+  char *line = NULL;
+  size_t cap = 0;
+  while (getline(&line, &cap, in) > 0) {
+    if (!parse_data_line(line)) {
+      nb_errors++;
+    }
+  }
+  free(line);
+  fclose(in);
+  return true;
+}
+
+/*
+ * SD logs: pprzlog frames
+ * STX, length, source, timestamp (4 bytes, 1e-4 s), pprzlink payload, checksum
+ */
+
+static bool decode_payload(const uint8_t *payload, int len, int source, bool pprzlink_v1, double time)
+{
+  int ac_id, link_class = -1, msg_id, pos;
+  if (pprzlink_v1) {
+    if (len < 2) {
+      return false;
+    }
+    ac_id = payload[0];
+    msg_id = payload[1];
+    pos = 2;
+  } else {
+    if (len < 4) {
+      return false;
+    }
+    ac_id = payload[0];
+    link_class = payload[2] & 0x0F;
+    msg_id = payload[3];
+    pos = 4;
+  }
+  int def = -1;
+  if (link_class >= 0) {
+    for (int i = 0; i < schema.nb && def < 0; i++) {
+      if (schema.defs[i].link_class == link_class && schema.defs[i].id == msg_id && schema.defs[i].nb_fields >= 0) {
+        def = i;
+      }
+    }
+  }
+  if (def < 0 && source < 2) {
+    def = schema.by_id[source][msg_id];
+  }
+  if (def < 0) {
+    return false;
+  }
+  const struct Def *d = &schema.defs[def];
+  for (int i = 0; i < d->nb_fields; i++) {
+    const struct DefField *f = &d->fields[i];
+    int n = f->array_len;
+    if (f->variable) {
+      if (pos >= len) {
+        return false;
+      }
+      n = payload[pos++];
+    }
+    int size = n * plb_type_size[f->type];
+    if (pos + size > len) {
+      return false;
+    }
+    rec_vals[i].len = 0;
+    buf_add(&rec_vals[i], payload + pos, size);
+    rec_count[i] = n;
+    pos += size;
+  }
+  record_commit(stream_get(def, ac_id), time);
+  return true;
+}
+
+static bool convert_tlm(const char *path, bool pprzlink_v1)
+{
+  FILE *in = fopen(path, "rb");
+  if (in == NULL) {
+    perror(path);
+    return false;
+  }
+  struct Buf file = { NULL, 0, 0 };
+  uint8_t chunk[65536];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    buf_add(&file, chunk, n);
+  }
+  fclose(in);
+
+  const uint8_t *b = file.data;
+  size_t i = 0;
+  while (i + 8 <= file.len) {
+    if (b[i] != PPRZLOG_STX) {
+      i++;
+      continue;
+    }
+    int len = b[i + 1];
+    if (i + 8 + len > file.len) {
+      break;
+    }
+    uint8_t ck = 0;
+    for (int k = 1; k < 7 + len; k++) {
+      ck += b[i + k];
+    }
+    if (ck != b[i + 7 + len]) {
+      nb_errors++;
+      i++;
+      continue;
+    }
+    int source = b[i + 2];
+    uint32_t ts = b[i + 3] | (b[i + 4] << 8) | (b[i + 5] << 16) | ((uint32_t)b[i + 6] << 24);
+    if (!decode_payload(b + i + 7, len, source, pprzlink_v1, ts * 1e-4)) {
+      nb_errors++;
+    }
+    i += 8 + len;
+  }
+  free(file.data);
+  return true;
+}
+
+/*
+ * Output
+ */
+
+static const double *sort_times;
+
+static int cmp_records(const void *a, const void *b)
+{
+  uint64_t i = *(const uint64_t *)a, j = *(const uint64_t *)b;
+  if (sort_times[i] != sort_times[j]) {
+    return sort_times[i] < sort_times[j] ? -1 : 1;
+  }
+  return i < j ? -1 : (i > j);
+}
+
+static int cmp_streams(const void *a, const void *b)
+{
+  const struct StreamBuild *s = a, *t = b;
+  if (s->ac_id != t->ac_id) {
+    return s->ac_id - t->ac_id;
+  }
+  return strcmp(schema.defs[s->def].name, schema.defs[t->def].name);
+}
+
+static uint64_t align8(uint64_t x)
+{
+  return (x + 7) & ~(uint64_t)7;
+}
+
+static void write_pad(FILE *out, uint64_t *pos)
+{
+  static const uint8_t zeros[8];
+  uint64_t aligned = align8(*pos);
+  fwrite(zeros, 1, aligned - *pos, out);
+  *pos = aligned;
+}
+
+static bool write_plb(const char *path)
+{
+  qsort(streams, nb_streams, sizeof(struct StreamBuild), cmp_streams);
+
+  struct PlbHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, PLB_MAGIC, 4);
+  h.version = PLB_VERSION;
+  h.nb_streams = nb_streams;
+  h.start_time = 0.;
+  h.end_time = 0.;
+  for (int i = 0; i < nb_streams; i++) {
+    h.nb_fields += schema.defs[streams[i].def].nb_fields;
+  }
+
+  // layout
+  uint64_t pos = sizeof(h);
+  h.schema_offset = pos;
+  h.schema_size = schema.text_len;
+  pos = align8(pos + h.schema_size);
+  h.streams_offset = pos;
+  pos += (uint64_t)nb_streams * sizeof(struct PlbStream);
+  h.fields_offset = pos;
+  pos += (uint64_t)h.nb_fields * sizeof(struct PlbField);
+
+  struct PlbStream *ps = calloc(nb_streams ? nb_streams : 1, sizeof(struct PlbStream));
+  struct PlbField *pf = calloc(h.nb_fields ? h.nb_fields : 1, sizeof(struct PlbField));
+  uint32_t field = 0;
+  bool first = true;
+  for (int i = 0; i < nb_streams; i++) {
+    struct StreamBuild *s = &streams[i];
+    const struct Def *d = &schema.defs[s->def];
+    memcpy(ps[i].name, d->name, PLB_NAME_LEN);
+    ps[i].ac_id = s->ac_id;
+    ps[i].class_id = d->class_id;
+    ps[i].nb_fields = d->nb_fields;
+    ps[i].first_field = field;
+    ps[i].nb_records = s->nb;
+    pos = align8(pos);
+    ps[i].times_offset = pos;
+    pos += s->nb * sizeof(double);
+    ps[i].seqs_offset = pos;
+    pos += s->nb * sizeof(uint64_t);
+    const double *times = (const double *)s->times.data;
+    for (uint64_t r = 0; r < s->nb; r++) {
+      if (first || times[r] < h.start_time) {
+        h.start_time = times[r];
+      }
+      if (first || times[r] > h.end_time) {
+        h.end_time = times[r];
+      }
+      first = false;
+    }
+    h.nb_records += s->nb;
+    for (int j = 0; j < d->nb_fields; j++, field++) {
+      struct PlbField *f = &pf[field];
+      memcpy(f->name, d->fields[j].name, PLB_NAME_LEN);
+      f->type = d->fields[j].type;
+      f->variable = d->fields[j].variable;
+      f->array_len = d->fields[j].variable ? 0 : d->fields[j].array_len;
+      f->nb_elements = s->cols[j].len / plb_type_size[f->type];
+      pos = align8(pos);
+      f->data_offset = pos;
+      pos += s->cols[j].len;
+      if (f->variable) {
+        pos = align8(pos);
+        f->index_offset = pos;
+        pos += (s->nb + 1) * sizeof(uint64_t);
+      }
+    }
+  }
+
+  FILE *out = fopen(path, "wb");
+  if (out == NULL) {
+    perror(path);
+    return false;
+  }
+  pos = 0;
+  fwrite(&h, sizeof(h), 1, out);
+  fwrite(schema.text, 1, schema.text_len, out);
+  pos = sizeof(h) + schema.text_len;
+  write_pad(out, &pos);
+  fwrite(ps, sizeof(struct PlbStream), nb_streams, out);
+  fwrite(pf, sizeof(struct PlbField), h.nb_fields, out);
+  pos += (uint64_t)nb_streams * sizeof(struct PlbStream) + (uint64_t)h.nb_fields * sizeof(struct PlbField);
+
+  // columns, records in time order
+  for (int i = 0; i < nb_streams; i++) {
+    struct StreamBuild *s = &streams[i];
+    const struct Def *d = &schema.defs[s->def];
+    uint64_t *order = NULL;
+    if (!s->sorted) {
+      order = malloc(s->nb * sizeof(uint64_t));
+      for (uint64_t r = 0; r < s->nb; r++) {
+        order[r] = r;
+      }
+      sort_times = (const double *)s->times.data;
+      qsort(order, s->nb, sizeof(uint64_t), cmp_records);
+    }
+    write_pad(out, &pos);
+    for (uint64_t r = 0; r < s->nb; r++) {
+      fwrite(&((double *)s->times.data)[order ? order[r] : r], sizeof(double), 1, out);
+    }
+    for (uint64_t r = 0; r < s->nb; r++) {
+      fwrite(&((uint64_t *)s->seqs.data)[order ? order[r] : r], sizeof(uint64_t), 1, out);
+    }
+    pos += s->nb * (sizeof(double) + sizeof(uint64_t));
+    for (int j = 0; j < d->nb_fields; j++) {
+      const struct DefField *df = &d->fields[j];
+      size_t size = plb_type_size[df->type];
+      write_pad(out, &pos);
+      if (order == NULL) {
+        fwrite(s->cols[j].data, 1, s->cols[j].len, out);
+      } else {
+        const uint64_t *index = (const uint64_t *)s->index[j].data;
+        for (uint64_t r = 0; r < s->nb; r++) {
+          uint64_t k = order[r];
+          uint64_t first_elt = df->variable ? index[k] : k * df->array_len;
+          uint64_t n = df->variable ? index[k + 1] - index[k] : df->array_len;
+          fwrite(s->cols[j].data + first_elt * size, size, n, out);
+        }
+      }
+      pos += s->cols[j].len;
+      if (df->variable) {
+        write_pad(out, &pos);
+        const uint64_t *index = (const uint64_t *)s->index[j].data;
+        uint64_t next = 0;
+        for (uint64_t r = 0; r <= s->nb; r++) {
+          if (order == NULL) {
+            next = index[r];
+          } else if (r > 0) {
+            uint64_t k = order[r - 1];
+            next += index[k + 1] - index[k];
+          }
+          fwrite(&next, sizeof(next), 1, out);
+        }
+        pos += (s->nb + 1) * sizeof(uint64_t);
+      }
+    }
+    free(order);
+  }
+  bool ok = !ferror(out);
+  ok = (fclose(out) == 0) && ok;
+  if (!ok) {
+    fprintf(stderr, "%s: write error\n", path);
+  }
+  printf("%s: %llu messages in %d streams, %.3f s to %.3f s, %llu lines or frames skipped\n", path,
+         (unsigned long long)h.nb_records, nb_streams, h.start_time, h.end_time,
+         (unsigned long long)nb_errors);
+  free(ps);
+  free(pf);
+  return ok;
+}
+
+static char *read_file(const char *path, size_t *len)
+{
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    perror(path);
+    return NULL;
+  }
+  struct Buf b = { NULL, 0, 0 };
+  char chunk[65536];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    buf_add(&b, chunk, n);
+  }
+  fclose(f);
+  buf_add(&b, "", 1);
+  *len = b.len - 1;
+  return (char *)b.data;
+}
+
+/** Path with another extension */
+static char *with_ext(const char *path, const char *ext)
+{
+  const char *dot = strrchr(path, '.');
+  const char *slash = strrchr(path, '/');
+  size_t base = (dot && (!slash || dot > slash)) ? (size_t)(dot - path) : strlen(path);
+  char *s = malloc(base + strlen(ext) + 1);
+  memcpy(s, path, base);
+  strcpy(s + base, ext);
+  return s;
+}
+
+int main(int argc, char **argv)
+{
+  static const char *usage =
+    "Usage: %s [options] <file.data|file.log|file.tlm>\n"
+    " Options :\n"
+    "   -h                  Display this help\n"
+    "   -o <file.plb>       output file (default: input with .plb extension)\n"
+    "   -m <messages.xml>   schema of a .tlm log (default: $PAPARAZZI_HOME/var/messages.xml)\n"
+    "   -1                  .tlm log with pprzlink 1.0 messages\n";
+
+  char *output = NULL;
+  char *messages = NULL;
+  bool pprzlink_v1 = false;
+  int c;
+  while ((c = getopt(argc, argv, "ho:m:1")) != -1) {
+    switch (c) {
+      case 'o': output = optarg; break;
+      case 'm': messages = optarg; break;
+      case '1': pprzlink_v1 = true; break;
+      case 'h':
+        fprintf(stderr, usage, argv[0]);
+        return 0;
+      default:
+        fprintf(stderr, usage, argv[0]);
+        return 1;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, usage, argv[0]);
+    return 1;
+  }
+  const char *input = argv[optind];
+  const char *ext = strrchr(input, '.');
+  bool tlm = ext && strcasecmp(ext, ".tlm") == 0;
+
+  char *schema_path;
+  if (tlm) {
+    if (messages) {
+      schema_path = messages;
+    } else {
+      const char *home = getenv("PAPARAZZI_HOME");
+      schema_path = malloc(strlen(home ? home : ".") + strlen("/var/messages.xml") + 1);
+      sprintf(schema_path, "%s/var/messages.xml", home ? home : ".");
+    }
+  } else {
+    schema_path = with_ext(input, ".log");
+  }
+  size_t schema_len;
+  char *schema_text = read_file(schema_path, &schema_len);
+  if (schema_text == NULL) {
+    return 1;
+  }
+  if (!schema_parse(schema_text, schema_len)) {
+    fprintf(stderr, "%s: no message definition found\n", schema_path);
+    return 1;
+  }
+
+  bool ok;
+  if (tlm) {
+    ok = convert_tlm(input, pprzlink_v1);
+  } else {
+    char *data = with_ext(input, ".data");
+    ok = convert_data(data);
+    free(data);
+  }
+  if (!ok) {
+    return 1;
+  }
+  if (output == NULL) {
+    output = with_ext(input, ".plb");
+  }
+  return write_plb(output) ? 0 : 1;
+}
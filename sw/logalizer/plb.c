@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file plb.c
+ * Paparazzi binary log reader, see plb.h.
+ */
+
+#include "plb.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t plb_type_size[PLB_TYPE_NB] = { 1, 1, 2, 2, 4, 4, 8, 8, 4, 8, 1 };
+
+const char *plb_type_name[PLB_TYPE_NB] = {
+  "uint8", "int8", "uint16", "int16", "uint32", "int32", "uint64", "int64", "float", "double", "char"
+};
+
+int plb_type_of_name(const char *name, size_t len)
+{
+  if (len == 6 && strncmp(name, "string", 6) == 0) {
+    return PLB_CHAR;
+  }
+  for (int i = 0; i < PLB_TYPE_NB; i++) {
+    if (strlen(plb_type_name[i]) == len && strncmp(name, plb_type_name[i], len) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/** Check that a section is inside the file */
+static bool plb_in_file(const struct PlbFile *f, uint64_t offset, uint64_t size)
+{
+  return offset <= f->size && size <= f->size - offset;
+}
+
+/** Check the data and index columns of a field of stream s */
+static bool plb_field_ok(const struct PlbFile *f, const struct PlbStream *s, const struct PlbField *fd)
+{
+  if (fd->type >= PLB_TYPE_NB || fd->nb_elements > f->size ||
+      !plb_in_file(f, fd->data_offset, fd->nb_elements * plb_type_size[fd->type])) {
+    return false;
+  }
+  if (!fd->variable) {
+    return fd->nb_elements == s->nb_records * fd->array_len;
+  }
+  if (fd->index_offset % sizeof(uint64_t) != 0 ||
+      !plb_in_file(f, fd->index_offset, (s->nb_records + 1) * sizeof(uint64_t))) {
+    return false;
+  }
+  // records are contiguous slices of the data column
+  const uint64_t *index = (const uint64_t *)(f->map + fd->index_offset);
+  if (index[0] != 0 || index[s->nb_records] > fd->nb_elements) {
+    return false;
+  }
+  for (uint64_t r = 0; r < s->nb_records; r++) {
+    if (index[r + 1] < index[r]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int plb_open(struct PlbFile *f, const char *path)
+{
+  memset(f, 0, sizeof(*f));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(struct PlbHeader)) {
+    fprintf(stderr, "%s: not a binary log\n", path);
+    close(fd);
+    return -1;
+  }
+  f->size = st.st_size;
+  void *map = mmap(NULL, f->size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror(path);
+    return -1;
+  }
+  f->map = map;
+  f->header = (const struct PlbHeader *)f->map;
+
+  const struct PlbHeader *h = f->header;
+  if (memcmp(h->magic, PLB_MAGIC, 4) != 0 || h->version != PLB_VERSION ||
+      !plb_in_file(f, h->schema_offset, h->schema_size) ||
+      !plb_in_file(f, h->streams_offset, (uint64_t)h->nb_streams * sizeof(struct PlbStream)) ||
+      !plb_in_file(f, h->fields_offset, (uint64_t)h->nb_fields * sizeof(struct PlbField))) {
+    fprintf(stderr, "%s: not a binary log or unsupported version\n", path);
+    plb_close(f);
+    return -1;
+  }
+  f->schema = (const char *)(f->map + h->schema_offset);
+  f->streams = (const struct PlbStream *)(f->map + h->streams_offset);
+  f->fields = (const struct PlbField *)(f->map + h->fields_offset);
+
+  // check the columns once, so that the accessors don't have to
+  for (uint32_t i = 0; i < h->nb_streams; i++) {
+    const struct PlbStream *s = &f->streams[i];
+    bool ok = (uint64_t)s->first_field + s->nb_fields <= h->nb_fields && s->nb_records < f->size &&
+              plb_in_file(f, s->times_offset, s->nb_records * sizeof(double)) &&
+              s->seqs_offset % sizeof(uint64_t) == 0 &&
+              plb_in_file(f, s->seqs_offset, s->nb_records * sizeof(uint64_t));
+    for (uint16_t j = 0; ok && j < s->nb_fields; j++) {
+      ok = plb_field_ok(f, s, &f->fields[s->first_field + j]);
+    }
+    if (!ok) {
+      fprintf(stderr, "%s: corrupted stream %.*s\n", path, PLB_NAME_LEN, s->name);
+      plb_close(f);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void plb_close(struct PlbFile *f)
+{
+  if (f->map) {
+    munmap((void *)f->map, f->size);
+  }
+  memset(f, 0, sizeof(*f));
+}
+
+const struct PlbStream *plb_find_stream(const struct PlbFile *f, int ac_id, const char *name)
+{
+  for (uint32_t i = 0; i < f->header->nb_streams; i++) {
+    const struct PlbStream *s = &f->streams[i];
+    if ((ac_id < 0 || s->ac_id == ac_id) && strncmp(s->name, name, PLB_NAME_LEN) == 0) {
+      return s;
+    }
+  }
+  return NULL;
+}
+
+const struct PlbField *plb_find_field(const struct PlbFile *f, const struct PlbStream *s,
+                                      const char *name)
+{
+  for (uint16_t i = 0; i < s->nb_fields; i++) {
+    const struct PlbField *fd = &f->fields[s->first_field + i];
+    if (strncmp(fd->name, name, PLB_NAME_LEN) == 0) {
+      return fd;
+    }
+  }
+  return NULL;
+}
+
+uint64_t plb_lower_bound(const struct PlbFile *f, const struct PlbStream *s, double t)
+{
+  const double *times = plb_times(f, s);
+  uint64_t lo = 0, hi = s->nb_records;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    if (times[mid] < t) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+uint64_t plb_elements(const struct PlbFile *f, const struct PlbField *fd, uint64_t record,
+                      uint64_t *first)
+{
+  if (fd->variable) {
+    const uint64_t *index = (const uint64_t *)(f->map + fd->index_offset);
+    *first = index[record];
+    return index[record + 1] - index[record];
+  }
+  *first = record * fd->array_len;
+  return fd->array_len;
+}
+
+double plb_value(const struct PlbFile *f, const struct PlbField *fd, uint64_t element)
+{
+  const uint8_t *p = f->map + fd->data_offset + element * plb_type_size[fd->type];
+  // columns are aligned on their element size, see log2plb
+  switch (fd->type) {
+    case PLB_UINT8: return *p;
+    case PLB_INT8: return *(const int8_t *)p;
+    case PLB_UINT16: return *(const uint16_t *)p;
+    case PLB_INT16: return *(const int16_t *)p;
+    case PLB_UINT32: return *(const uint32_t *)p;
+    case PLB_INT32: return *(const int32_t *)p;
+    case PLB_UINT64: return (double) * (const uint64_t *)p;
+    case PLB_INT64: return (double) * (const int64_t *)p;
+    case PLB_FLOAT: return *(const float *)p;
+    case PLB_DOUBLE: return *(const double *)p;
+    case PLB_CHAR: return *(const char *)p;
+    default: return 0.;
+  }
+}
+
+/** Print one element, exactly (floats with enough digits to be read back) */
+static void plb_print_element(FILE *out, const struct PlbFile *f, const struct PlbField *fd, uint64_t element)
+{
+  const uint8_t *p = f->map + fd->data_offset + element * plb_type_size[fd->type];
+  switch (fd->type) {
+    case PLB_UINT64: fprintf(out, "%llu", (unsigned long long) * (const uint64_t *)p); break;
+    case PLB_INT64: fprintf(out, "%lld", (long long) * (const int64_t *)p); break;
+    case PLB_FLOAT: fprintf(out, "%.9g", *(const float *)p); break;
+    case PLB_DOUBLE: fprintf(out, "%.17g", *(const double *)p); break;
+    default: fprintf(out, "%.0f", plb_value(f, fd, element)); break;
+  }
+}
+
+void plb_print_field(FILE *out, const struct PlbFile *f, const struct PlbField *fd, uint64_t record)
+{
+  uint64_t first;
+  uint64_t n = plb_elements(f, fd, record, &first);
+  if (fd->type == PLB_CHAR) {
+    const char *str = (const char *)(f->map + fd->data_offset + first);
+    fwrite(str, 1, n, out);
+    return;
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    if (i > 0) {
+      fputc(',', out);
+    }
+    plb_print_element(out, f, fd, first + i);
+  }
+}
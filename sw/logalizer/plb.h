@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file plb.h
+ * Paparazzi binary log (.plb): columnar container for flight logs.
+ *
+ * A log is split in streams, one per aircraft and message. Each stream
+ * stores its timestamps (the time index, sorted), the number of each record
+ * in the source log, which keeps the order of the records with the same
+ * timestamp across streams, and one column per field,
+ * so that a time slice of a few fields is read with a binary search and
+ * contiguous copies from the memory mapped file, whatever the log length.
+ *
+ * Layout, little endian, all sections aligned on 8 bytes:
+ * @verbatim
+ * PlbHeader
+ * schema          protocol xml of the messages, as in the .log file
+ * PlbStream[nb_streams]
+ * PlbField[nb_fields]   of all the streams
+ * columns         times (double), record numbers (uint64), values, and for
+ *                 arrays and strings the index of the first element of each
+ *                 record (uint64[nb + 1])
+ * @endverbatim
+ *
+ * Created by log2plb from .log/.data ground logs or .tlm SD logs, read by
+ * plbquery or any program using plb_open.
+ */
+
+#ifndef PLB_H
+#define PLB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define PLB_MAGIC "PLB1"
+#define PLB_VERSION 2
+#define PLB_NAME_LEN 32
+
+/** Type of the elements of a field */
+enum PlbType {
+  PLB_UINT8,
+  PLB_INT8,
+  PLB_UINT16,
+  PLB_INT16,
+  PLB_UINT32,
+  PLB_INT32,
+  PLB_UINT64,
+  PLB_INT64,
+  PLB_FLOAT,
+  PLB_DOUBLE,
+  PLB_CHAR,     ///< strings
+  PLB_TYPE_NB
+};
+
+struct PlbHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t schema_offset;
+  uint64_t schema_size;
+  uint64_t streams_offset;
+  uint64_t fields_offset;
+  uint32_t nb_streams;
+  uint32_t nb_fields;
+  uint64_t nb_records;    ///< total number of messages
+  double start_time;      ///< first timestamp (s)
+  double end_time;        ///< last timestamp (s)
+};
+
+/** Messages of one aircraft with the same name */
+struct PlbStream {
+  char name[PLB_NAME_LEN];
+  uint8_t ac_id;
+  uint8_t class_id;       ///< 0 telemetry, 1 datalink (source of the .tlm logs)
+  uint16_t nb_fields;
+  uint32_t first_field;   ///< index in the field table
+  uint64_t nb_records;
+  uint64_t times_offset;  ///< double[nb_records], sorted
+  uint64_t seqs_offset;   ///< uint64[nb_records], record number in the source log
+};
+
+struct PlbField {
+  char name[PLB_NAME_LEN];
+  uint8_t type;           ///< enum PlbType
+  uint8_t variable;       ///< true for arrays and strings, which have an index column
+  uint16_t array_len;     ///< number of elements of fixed size arrays, 1 for scalars
+  uint32_t reserved;
+  uint64_t data_offset;   ///< elements of all the records
+  uint64_t index_offset;  ///< uint64[nb_records + 1], first element of each record, 0 if not variable
+  uint64_t nb_elements;
+};
+
+/** Memory mapped log */
+struct PlbFile {
+  const uint8_t *map;
+  size_t size;
+  const struct PlbHeader *header;
+  const char *schema;
+  const struct PlbStream *streams;
+  const struct PlbField *fields;
+};
+
+/** Size of the elements of each type */
+extern const size_t plb_type_size[PLB_TYPE_NB];
+/** Names of the types, as in messages.xml */
+extern const char *plb_type_name[PLB_TYPE_NB];
+
+/** Type from its name in messages.xml ("uint8", "float", ...), -1 if unknown */
+extern int plb_type_of_name(const char *name, size_t len);
+
+/** Map a log and check its layout, including the record indexes
+ * @return 0 on success, -1 on error (message printed)
+ */
+extern int plb_open(struct PlbFile *f, const char *path);
+extern void plb_close(struct PlbFile *f);
+
+/** Stream by aircraft and message name, ac_id < 0 for the first aircraft found */
+extern const struct PlbStream *plb_find_stream(const struct PlbFile *f, int ac_id, const char *name);
+/** Field of a stream by name, NULL if not found */
+extern const struct PlbField *plb_find_field(const struct PlbFile *f, const struct PlbStream *s,
+    const char *name);
+
+static inline const double *plb_times(const struct PlbFile *f, const struct PlbStream *s)
+{
+  return (const double *)(f->map + s->times_offset);
+}
+
+/** Record numbers in the source log, to merge the streams in the original order */
+static inline const uint64_t *plb_seqs(const struct PlbFile *f, const struct PlbStream *s)
+{
+  return (const uint64_t *)(f->map + s->seqs_offset);
+}
+
+/** First record of a stream at or after time t */
+extern uint64_t plb_lower_bound(const struct PlbFile *f, const struct PlbStream *s, double t);
+
+/** Number of elements of a field in a record, and index of the first one */
+extern uint64_t plb_elements(const struct PlbFile *f, const struct PlbField *fd, uint64_t record,
+                             uint64_t *first);
+
+/** Element of a numeric field as a double */
+extern double plb_value(const struct PlbFile *f, const struct PlbField *fd, uint64_t element);
+
+/** Print a field of a record as in the .data files (arrays comma separated) */
+extern void plb_print_field(FILE *out, const struct PlbFile *f, const struct PlbField *fd, uint64_t record);
+
+#endif /* PLB_H */
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file plbquery.c
+ * Query binary logs made by log2plb.
+ *
+ *  - info: streams and fields of a log
+ *  - schema: message definitions embedded in a log
+ *  - slice: time slice of some fields of a message, as CSV
+ *  - merge: messages of several logs ordered by time, as .data lines, the
+ *    messages with the same time in the order of their log
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plb.h"
+
+#define MAX_FIELDS 64
+
+static const char *usage =
+  "Usage: %s <command> [options] <file.plb>...\n"
+  " Commands :\n"
+  "   info <file.plb>                     list the streams and fields\n"
+  "   schema <file.plb>                   print the message definitions\n"
+  "   slice [options] <file.plb>          print fields of a message as CSV\n"
+  "     -m <message>                      message name (mandatory)\n"
+  "     -a <ac_id>                        aircraft (default: first one found)\n"
+  "     -f <field,field,...>              fields (default: all)\n"
+  "     -t <start>:<end>                  time slice in seconds, each bound optional\n"
+  "   merge [-t <start>:<end>] <file.plb>...   print all messages as .data lines\n";
+
+static int cmd_info(const char *path)
+{
+  struct PlbFile f;
+  if (plb_open(&f, path) < 0) {
+    return 1;
+  }
+  const struct PlbHeader *h = f.header;
+  printf("%s: %llu messages, %u streams, %.4f s to %.4f s\n", path,
+         (unsigned long long)h->nb_records, h->nb_streams, h->start_time, h->end_time);
+  for (uint32_t i = 0; i < h->nb_streams; i++) {
+    const struct PlbStream *s = &f.streams[i];
+    printf("%3d %-32.32s %10llu", s->ac_id, s->name, (unsigned long long)s->nb_records);
+    for (uint16_t j = 0; j < s->nb_fields; j++) {
+      const struct PlbField *fd = &f.fields[s->first_field + j];
+      printf(" %.32s:%s", fd->name, fd->type == PLB_CHAR && fd->variable ? "string" : plb_type_name[fd->type]);
+      if (fd->variable && fd->type != PLB_CHAR) {
+        printf("[]");
+      } else if (fd->array_len > 1) {
+        printf("[%d]", fd->array_len);
+      }
+    }
+    printf("\n");
+  }
+  plb_close(&f);
+  return 0;
+}
+
+static int cmd_schema(const char *path)
+{
+  struct PlbFile f;
+  if (plb_open(&f, path) < 0) {
+    return 1;
+  }
+  fwrite(f.schema, 1, f.header->schema_size, stdout);
+  printf("\n");
+  plb_close(&f);
+  return 0;
+}
+
+/** Parse "start:end", missing bounds are infinite */
+static void parse_slice(const char *arg, double *start, double *end)
+{
+  char *sep;
+  *start = -1e300;
+  *end = 1e300;
+  if (arg[0] != ':') {
+    *start = strtod(arg, &sep);
+  } else {
+    sep = (char *)arg;
+  }
+  if (*sep == ':' && sep[1] != '\0') {
+    *end = strtod(sep + 1, NULL);
+  }
+}
+
+static int cmd_slice(int argc, char **argv)
+{
+  const char *msg = NULL;
+  char *fields = NULL;
+  int ac_id = -1;
+  double start = -1e300, end = 1e300;
+  int c;
+  while ((c = getopt(argc, argv, "m:a:f:t:")) != -1) {
+    switch (c) {
+      case 'm': msg = optarg; break;
+      case 'a': ac_id = atoi(optarg); break;
+      case 'f': fields = optarg; break;
+      case 't': parse_slice(optarg, &start, &end); break;
+      default:
+        fprintf(stderr, usage, "plbquery");
+        return 1;
+    }
+  }
+  if (msg == NULL || optind != argc - 1) {
+    fprintf(stderr, usage, "plbquery");
+    return 1;
+  }
+
+  struct PlbFile f;
+  if (plb_open(&f, argv[optind]) < 0) {
+    return 1;
+  }
+  const struct PlbStream *s = plb_find_stream(&f, ac_id, msg);
+  if (s == NULL) {
+    fprintf(stderr, "%s: no message %s\n", argv[optind], msg);
+    plb_close(&f);
+    return 1;
+  }
+  const struct PlbField *sel[MAX_FIELDS];
+  int nb_sel = 0;
+  if (fields) {
+    for (char *name = strtok(fields, ","); name && nb_sel < MAX_FIELDS; name = strtok(NULL, ",")) {
+      sel[nb_sel] = plb_find_field(&f, s, name);
+      if (sel[nb_sel] == NULL) {
+        fprintf(stderr, "%s: no field %s in %s\n", argv[optind], name, msg);
+        plb_close(&f);
+        return 1;
+      }
+      nb_sel++;
+    }
+  } else {
+    for (uint16_t j = 0; j < s->nb_fields && nb_sel < MAX_FIELDS; j++) {
+      sel[nb_sel++] = &f.fields[s->first_field + j];
+    }
+  }
+
+  printf("time");
+  for (int j = 0; j < nb_sel; j++) {
+    printf(",%.32s", sel[j]->name);
+  }
+  printf("\n");
+  const double *times = plb_times(&f, s);
+  for (uint64_t r = plb_lower_bound(&f, s, start); r < s->nb_records && times[r] <= end; r++) {
+    printf("%.4f", times[r]);
+    for (int j = 0; j < nb_sel; j++) {
+      // arrays and strings are quoted, they may contain commas
+      bool quote = sel[j]->variable || sel[j]->array_len > 1;
+      printf(quote ? ",\"" : ",");
+      plb_print_field(stdout, &f, sel[j], r);
+      if (quote) {
+        printf("\"");
+      }
+    }
+    printf("\n");
+  }
+  plb_close(&f);
+  return 0;
+}
+
+/** Next record of a stream in the merge */
+struct Cursor {
+  double time;
+  uint64_t seq;         ///< record number in the source log of the file
+  int file;
+  uint32_t stream;
+  uint64_t record;
+};
+
+static bool cursor_before(const struct Cursor *a, const struct Cursor *b)
+{
+  if (a->time != b->time) {
+    return a->time < b->time;
+  }
+  // same time, order of the source log
+  return a->file < b->file || (a->file == b->file && a->seq < b->seq);
+}
+
+static void heap_down(struct Cursor *heap, size_t n, size_t i)
+{
+  for (;;) {
+    size_t min = i, l = 2 * i + 1, r = 2 * i + 2;
+    if (l < n && cursor_before(&heap[l], &heap[min])) { min = l; }
+    if (r < n && cursor_before(&heap[r], &heap[min])) { min = r; }
+    if (min == i) {
+      return;
+    }
+    struct Cursor tmp = heap[i];
+    heap[i] = heap[min];
+    heap[min] = tmp;
+    i = min;
+  }
+}
+
+/**
+ * k-way merge of all the streams of all the files, one pass over the
+ * columns in time order, the heap only holds the next record of each stream.
+ */
+static int cmd_merge(int argc, char **argv)
+{
+  double start = -1e300, end = 1e300;
+  int c;
+  while ((c = getopt(argc, argv, "t:")) != -1) {
+    switch (c) {
+      case 't': parse_slice(optarg, &start, &end); break;
+      default:
+        fprintf(stderr, usage, "plbquery");
+        return 1;
+    }
+  }
+  int nb_files = argc - optind;
+  if (nb_files < 1) {
+    fprintf(stderr, usage, "plbquery");
+    return 1;
+  }
+  struct PlbFile *files = calloc(nb_files, sizeof(struct PlbFile));
+  size_t nb_cursors = 0;
+  for (int i = 0; i < nb_files; i++) {
+    if (plb_open(&files[i], argv[optind + i]) < 0) {
+      return 1;
+    }
+    nb_cursors += files[i].header->nb_streams;
+  }
+  struct Cursor *heap = malloc((nb_cursors ? nb_cursors : 1) * sizeof(struct Cursor));
+  size_t n = 0;
+  for (int i = 0; i < nb_files; i++) {
+    for (uint32_t j = 0; j < files[i].header->nb_streams; j++) {
+      const struct PlbStream *s = &files[i].streams[j];
+      uint64_t r = plb_lower_bound(&files[i], s, start);
+      if (r < s->nb_records && plb_times(&files[i], s)[r] <= end) {
+        heap[n++] = (struct Cursor) { plb_times(&files[i], s)[r], plb_seqs(&files[i], s)[r], i, j, r };
+      }
+    }
+  }
+  for (size_t i = n / 2; i-- > 0;) {
+    heap_down(heap, n, i);
+  }
+
+  while (n > 0) {
+    struct Cursor *cur = &heap[0];
+    const struct PlbFile *f = &files[cur->file];
+    const struct PlbStream *s = &f->streams[cur->stream];
+    printf("%.4f %d %.32s", cur->time, s->ac_id, s->name);
+    for (uint16_t j = 0; j < s->nb_fields; j++) {
+      const struct PlbField *fd = &f->fields[s->first_field + j];
+      putchar(' ');
+      // strings and empty arrays are quoted to keep the fields separated
+      uint64_t first;
+      bool quote = fd->type == PLB_CHAR || plb_elements(f, fd, cur->record, &first) == 0;
+      if (quote) {
+        putchar('"');
+      }
+      plb_print_field(stdout, f, fd, cur->record);
+      if (quote) {
+        putchar('"');
+      }
+    }
+    putchar('\n');
+    cur->record++;
+    if (cur->record < s->nb_records && plb_times(f, s)[cur->record] <= end) {
+      cur->time = plb_times(f, s)[cur->record];
+      cur->seq = plb_seqs(f, s)[cur->record];
+    } else {
+      heap[0] = heap[--n];
+    }
+    heap_down(heap, n, 0);
+  }
+
+  for (int i = 0; i < nb_files; i++) {
+    plb_close(&files[i]);
+  }
+  free(files);
+  free(heap);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 3) {
+    fprintf(stderr, usage, argv[0]);
+    return 1;
+  }
+  const char *cmd = argv[1];
+  if (strcmp(cmd, "info") == 0 && argc == 3) {
+    return cmd_info(argv[2]);
+  } else if (strcmp(cmd, "schema") == 0 && argc == 3) {
+    return cmd_schema(argv[2]);
+  } else if (strcmp(cmd, "slice") == 0) {
+    return cmd_slice(argc - 1, argv + 1);
+  } else if (strcmp(cmd, "merge") == 0) {
+    return cmd_merge(argc - 1, argv + 1);
+  }
+  fprintf(stderr, usage, argv[0]);
+  return 1;
+}
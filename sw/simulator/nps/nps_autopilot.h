@@ -26,6 +26,7 @@ extern "C" {
 #endif
 
 #include "generated/airframe.h"
+#include "math/pprz_algebra_float.h"
 
 #include "nps_radio_control.h"
 
@@ -59,6 +60,9 @@ extern void nps_autopilot_init(enum NpsRadioControlType type, int num_script, ch
 extern void nps_autopilot_run_step(double time);
 extern void nps_autopilot_run_systime_step(void);
 
+/** Navigation tracking error (target - estimated position) in local ENU frame */
+extern void nps_autopilot_nav_error(struct FloatVect3 *err);
+
 #ifdef __cplusplus
 }
 #endif
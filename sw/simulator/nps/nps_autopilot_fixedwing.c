@@ -51,6 +51,7 @@
 
 // for launch
 #include "autopilot.h"
+#include "firmwares/fixedwing/nav.h"
 
 // for datalink_time hack
 #include "subsystems/datalink/datalink.h"
@@ -128,7 +129,7 @@ void nps_autopilot_run_step(double time)
   }
 
   if (nps_sensors_baro_available()) {
-    uint32_t now_ts = get_sys_time_usec();
+    uint32_t now_ts = nps_sensors_reading_stamp(NPS_SENSOR_BARO, time);
     float pressure = (float) sensors.baro.value;
     AbiSendMsgBARO_ABS(BARO_SIM_SENDER_ID, now_ts, pressure);
     Fbw(event_task);
@@ -155,7 +156,7 @@ void nps_autopilot_run_step(double time)
 
 #if USE_SONAR
   if (nps_sensors_sonar_available()) {
-    uint32_t now_ts = get_sys_time_usec();
+    uint32_t now_ts = nps_sensors_reading_stamp(NPS_SENSOR_SONAR, time);
     float dist = (float) sensors.sonar.value;
     AbiSendMsgAGL(AGL_SONAR_NPS_ID, now_ts, dist);
 
@@ -291,3 +292,10 @@ void sim_overwrite_ins(void)
   stateSetAccelNed_f(&ltp_accel);
 
 }
+
+void nps_autopilot_nav_error(struct FloatVect3 *err)
+{
+  err->x = desired_x - stateGetPositionEnu_f()->x;
+  err->y = desired_y - stateGetPositionEnu_f()->y;
+  err->z = nav_altitude - stateGetPositionUtm_f()->alt;
+}
@@ -33,6 +33,7 @@
 #include "state.h"
 #include "subsystems/ahrs.h"
 #include "subsystems/ins.h"
+#include "firmwares/rotorcraft/navigation.h"
 #include "math/pprz_algebra.h"
 
 #ifndef NPS_NO_MOTOR_MIXING
@@ -113,7 +114,7 @@ void nps_autopilot_run_step(double time)
   }
 
   if (nps_sensors_baro_available()) {
-    uint32_t now_ts = get_sys_time_usec();
+    uint32_t now_ts = nps_sensors_reading_stamp(NPS_SENSOR_BARO, time);
     float pressure = (float) sensors.baro.value;
     AbiSendMsgBARO_ABS(BARO_SIM_SENDER_ID, now_ts, pressure);
     main_event();
@@ -132,7 +133,7 @@ void nps_autopilot_run_step(double time)
 
 #if USE_SONAR
   if (nps_sensors_sonar_available()) {
-    uint32_t now_ts = get_sys_time_usec();
+    uint32_t now_ts = nps_sensors_reading_stamp(NPS_SENSOR_SONAR, time);
     float dist = (float) sensors.sonar.value;
     if (dist >= 0.0) {
       AbiSendMsgAGL(AGL_SONAR_NPS_ID, now_ts, dist);
@@ -205,3 +206,10 @@ void sim_overwrite_ins(void)
   stateSetAccelNed_f(&ltp_accel);
 
 }
+
+void nps_autopilot_nav_error(struct FloatVect3 *err)
+{
+  struct EnuCoor_f carrot;
+  ENU_FLOAT_OF_BFP(carrot, navigation_carrot);
+  VECT3_DIFF(*err, carrot, *stateGetPositionEnu_f());
+}
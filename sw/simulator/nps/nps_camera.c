@@ -0,0 +1,516 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_camera.c
+ * Software rendered cameras for NPS.
+ *
+ * Each pixel is ray cast against the scene: a flat ground at the FDM
+ * ground height with a checkerboard texture and per cell noise (texture
+ * for optical flow), fading with distance, a sky gradient, and the
+ * airframe primitives with a simple directional light.
+ *
+ * The scene is given in the NPS section of the airframe, positions in
+ * meters north and east of the flight plan origin, heights above ground,
+ * headings in degrees and colors in RGB (0-255):
+ *  - NPS_CAMERA_BOXES {{north, east, length, width, height, heading, r, g, b}, ...}
+ *    boxes standing on the ground
+ *  - NPS_CAMERA_POLES {{north, east, radius, height, r, g, b}, ...}
+ *  - NPS_CAMERA_GATES {{north, east, center height, heading, inner size, bar width, r, g, b}, ...}
+ *    square gates facing north for a zero heading
+ *
+ * Cameras whose name contains "bottom" look down (image top forward), the
+ * others look forward. The image is split in tiles of rows rendered by a
+ * pool of threads.
+ */
+
+#include "nps_camera.h"
+#include "nps_fdm.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "generated/airframe.h"
+#include "modules/computer_vision/cv.h"
+#include "modules/computer_vision/video_thread_nps.h"
+#include "modules/computer_vision/lib/vision/image.h"
+
+/** Default frame rate of the cameras without fps */
+#ifndef NPS_CAMERA_FPS
+#define NPS_CAMERA_FPS 30
+#endif
+
+/** Number of rendering threads, including the simulation thread */
+#ifndef NPS_CAMERA_THREADS
+#define NPS_CAMERA_THREADS 4
+#endif
+
+/** Number of image rows rendered by a thread at a time */
+#ifndef NPS_CAMERA_TILE_ROWS
+#define NPS_CAMERA_TILE_ROWS 8
+#endif
+
+/** Size of the ground checkerboard cells (m) */
+#ifndef NPS_CAMERA_GROUND_TILE
+#define NPS_CAMERA_GROUND_TILE 1.0
+#endif
+
+#ifndef NPS_CAMERA_GROUND_COLOR1
+#define NPS_CAMERA_GROUND_COLOR1 {90, 110, 60}
+#endif
+#ifndef NPS_CAMERA_GROUND_COLOR2
+#define NPS_CAMERA_GROUND_COLOR2 {140, 130, 100}
+#endif
+
+/** Distance at which the ground texture is half faded (m) */
+#ifndef NPS_CAMERA_FOG
+#define NPS_CAMERA_FOG 60.0
+#endif
+
+#define NPS_CAMERA_MAX_PRIMS 128
+
+enum PrimType {
+  PRIM_BOX,
+  PRIM_POLE
+};
+
+/** Primitive, positions in NED with z = 0 on the ground */
+struct Prim {
+  enum PrimType type;
+  float c[3];         ///< box center, pole axis
+  float h[3];         ///< box half sizes (m)
+  float cpsi, spsi;   ///< box heading
+  float r;            ///< pole radius
+  float top;          ///< pole top (z, negative)
+  float rgb[3];
+};
+
+/** Frame to render */
+struct Frame {
+  struct image_t *img;
+  float pos[3];       ///< camera position, z = 0 on the ground
+  float rows[3][3];   ///< ltp to camera rotation (x right, y down, z forward)
+  float fx, fy, cx, cy;
+};
+
+static struct Prim prims[NPS_CAMERA_MAX_PRIMS];
+static int nb_prims;
+static float ground_rgb[2][3];
+static float ground_mean[3];
+static const float sun[3] = { 0.3f, 0.42f, 0.86f };   ///< light direction (NED, normalized)
+
+static struct {
+  bool init;
+  struct image_t img[VIDEO_THREAD_MAX_CAMERAS];
+  double next_time[VIDEO_THREAD_MAX_CAMERAS];
+  bool bottom[VIDEO_THREAD_MAX_CAMERAS];
+} cams;
+
+static struct {
+  int nb;
+  pthread_t th[NPS_CAMERA_THREADS];
+  pthread_barrier_t start;
+  pthread_barrier_t done;
+  struct Frame *frame;
+  volatile int next_tile;
+  int nb_tiles;
+} pool;
+
+static void add_box(float n, float e, float z, float hl, float hw, float hh, float psi, const float *rgb)
+{
+  if (nb_prims >= NPS_CAMERA_MAX_PRIMS) {
+    return;
+  }
+  struct Prim *p = &prims[nb_prims++];
+  p->type = PRIM_BOX;
+  p->c[0] = n;
+  p->c[1] = e;
+  p->c[2] = z;
+  p->h[0] = hl;
+  p->h[1] = hw;
+  p->h[2] = hh;
+  p->cpsi = cosf(psi);
+  p->spsi = sinf(psi);
+  for (int i = 0; i < 3; i++) {
+    p->rgb[i] = rgb[i];
+  }
+}
+
+static void init_scene(void)
+{
+  const float c1[3] = NPS_CAMERA_GROUND_COLOR1;
+  const float c2[3] = NPS_CAMERA_GROUND_COLOR2;
+  for (int i = 0; i < 3; i++) {
+    ground_rgb[0][i] = c1[i];
+    ground_rgb[1][i] = c2[i];
+    ground_mean[i] = (c1[i] + c2[i]) / 2.f;
+  }
+  nb_prims = 0;
+
+#ifdef NPS_CAMERA_BOXES
+  const float boxes[][9] = NPS_CAMERA_BOXES;
+  for (unsigned int i = 0; i < sizeof(boxes) / sizeof(boxes[0]); i++) {
+    const float *b = boxes[i];
+    add_box(b[0], b[1], -b[4] / 2.f, b[2] / 2.f, b[3] / 2.f, b[4] / 2.f, RadOfDeg(b[5]), &b[6]);
+  }
+#endif
+
+#ifdef NPS_CAMERA_POLES
+  const float poles[][7] = NPS_CAMERA_POLES;
+  for (unsigned int i = 0; i < sizeof(poles) / sizeof(poles[0]) && nb_prims < NPS_CAMERA_MAX_PRIMS; i++) {
+    const float *pl = poles[i];
+    struct Prim *p = &prims[nb_prims++];
+    p->type = PRIM_POLE;
+    p->c[0] = pl[0];
+    p->c[1] = pl[1];
+    p->c[2] = 0.f;
+    p->r = pl[2];
+    p->top = -pl[3];
+    for (int j = 0; j < 3; j++) {
+      p->rgb[j] = pl[4 + j];
+    }
+  }
+#endif
+
+#ifdef NPS_CAMERA_GATES
+  // four bars in the vertical plane orthogonal to the heading
+  const float gates[][9] = NPS_CAMERA_GATES;
+  for (unsigned int i = 0; i < sizeof(gates) / sizeof(gates[0]); i++) {
+    const float *g = gates[i];
+    const float psi = RadOfDeg(g[3]);
+    const float s = g[4] / 2.f;   // half inner size
+    const float w = g[5] / 2.f;   // half bar width
+    const float z = -g[2];
+    const float ln = -sinf(psi), le = cosf(psi);   // lateral axis
+    add_box(g[0] - ln * (s + w), g[1] - le * (s + w), z, w, w, s + 2.f * w, psi, &g[6]);
+    add_box(g[0] + ln * (s + w), g[1] + le * (s + w), z, w, w, s + 2.f * w, psi, &g[6]);
+    add_box(g[0], g[1], z - s - w, w, s, w, psi, &g[6]);
+    add_box(g[0], g[1], z + s + w, w, s, w, psi, &g[6]);
+  }
+#endif
+}
+
+static inline uint32_t hash2(int32_t x, int32_t y)
+{
+  uint32_t h = (uint32_t)x * 374761393U + (uint32_t)y * 668265263U;
+  h = (h ^ (h >> 13)) * 1274126177U;
+  return h ^ (h >> 16);
+}
+
+/** Ray against a box, returns the distance or -1, normal in NED */
+static inline float hit_box(const struct Prim *p, const float *o, const float *d, float *n)
+{
+  const float dx = o[0] - p->c[0], dy = o[1] - p->c[1];
+  const float lo[3] = { p->cpsi * dx + p->spsi * dy, -p->spsi * dx + p->cpsi * dy, o[2] - p->c[2] };
+  const float ld[3] = { p->cpsi * d[0] + p->spsi * d[1], -p->spsi * d[0] + p->cpsi * d[1], d[2] };
+  float tmin = 0.f, tmax = 1e9f;
+  int axis = -1;
+  for (int i = 0; i < 3; i++) {
+    if (fabsf(ld[i]) < 1e-9f) {
+      if (fabsf(lo[i]) > p->h[i]) {
+        return -1.f;
+      }
+      continue;
+    }
+    const float inv = 1.f / ld[i];
+    float t0 = (-p->h[i] - lo[i]) * inv;
+    float t1 = (p->h[i] - lo[i]) * inv;
+    if (t0 > t1) {
+      float tmp = t0;
+      t0 = t1;
+      t1 = tmp;
+    }
+    if (t0 > tmin) {
+      tmin = t0;
+      axis = i;
+    }
+    tmax = Min(tmax, t1);
+    if (tmin > tmax) {
+      return -1.f;
+    }
+  }
+  if (axis < 0) {
+    return -1.f;  // inside
+  }
+  float ln[3] = { 0.f, 0.f, 0.f };
+  ln[axis] = ld[axis] > 0.f ? -1.f : 1.f;
+  n[0] = p->cpsi * ln[0] - p->spsi * ln[1];
+  n[1] = p->spsi * ln[0] + p->cpsi * ln[1];
+  n[2] = ln[2];
+  return tmin;
+}
+
+/** Ray against a vertical pole standing on the ground */
+static inline float hit_pole(const struct Prim *p, const float *o, const float *d, float *n)
+{
+  const float ox = o[0] - p->c[0], oy = o[1] - p->c[1];
+  const float a = d[0] * d[0] + d[1] * d[1];
+  float best = -1.f;
+  if (a > 1e-12f) {
+    const float b = ox * d[0] + oy * d[1];
+    const float c = ox * ox + oy * oy - p->r * p->r;
+    const float disc = b * b - a * c;
+    if (disc >= 0.f) {
+      const float t = (-b - sqrtf(disc)) / a;
+      const float z = o[2] + t * d[2];
+      if (t > 0.f && z >= p->top && z <= 0.f) {
+        best = t;
+        n[0] = (ox + t * d[0]) / p->r;
+        n[1] = (oy + t * d[1]) / p->r;
+        n[2] = 0.f;
+      }
+    }
+  }
+  if (best < 0.f && d[2] > 1e-9f && o[2] < p->top) {
+    // top cap, seen from above
+    const float t = (p->top - o[2]) / d[2];
+    const float x = ox + t * d[0], y = oy + t * d[1];
+    if (x * x + y * y <= p->r * p->r) {
+      best = t;
+      n[0] = 0.f;
+      n[1] = 0.f;
+      n[2] = -1.f;
+    }
+  }
+  return best;
+}
+
+/** Color seen along a ray */
+static inline void shade(const float *o, const float *d, float *rgb)
+{
+  float t = 1e9f;
+  float n[3], nn[3];
+  const struct Prim *hit = NULL;
+  for (int i = 0; i < nb_prims; i++) {
+    const struct Prim *p = &prims[i];
+    float ti = p->type == PRIM_BOX ? hit_box(p, o, d, nn) : hit_pole(p, o, d, nn);
+    if (ti > 0.f && ti < t) {
+      t = ti;
+      hit = p;
+      n[0] = nn[0];
+      n[1] = nn[1];
+      n[2] = nn[2];
+    }
+  }
+
+  const float len = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+  if (d[2] > 1e-9f && o[2] < 0.f) {
+    const float tg = -o[2] / d[2];
+    if (tg < t) {
+      const float gn = o[0] + tg * d[0], ge = o[1] + tg * d[1];
+      const float inv_tile = 1.f / NPS_CAMERA_GROUND_TILE;
+      const int32_t ix = (int32_t)floorf(gn * inv_tile), iy = (int32_t)floorf(ge * inv_tile);
+      const int32_t fx = (int32_t)floorf(gn * inv_tile * 8.f), fy = (int32_t)floorf(ge * inv_tile * 8.f);
+      const float *c = ground_rgb[(ix + iy) & 1];
+      const float k = (0.85f + 0.3f * (hash2(ix, iy) & 0xff) / 255.f) *
+                      (0.9f + 0.2f * (hash2(fx, fy) & 0xff) / 255.f);
+      const float dist = tg * len;
+      const float fade = dist / (dist + NPS_CAMERA_FOG);
+      for (int i = 0; i < 3; i++) {
+        rgb[i] = (1.f - fade) * k * c[i] + fade * ground_mean[i];
+      }
+      return;
+    }
+  }
+
+  if (hit != NULL) {
+    const float l = 0.55f + 0.45f * Max(0.f, -(n[0] * sun[0] + n[1] * sun[1] + n[2] * sun[2]));
+    for (int i = 0; i < 3; i++) {
+      rgb[i] = l * hit->rgb[i];
+    }
+    return;
+  }
+
+  // sky, from horizon to zenith
+  const float up = Max(0.f, -d[2] / len);
+  rgb[0] = 200.f - 110.f * up;
+  rgb[1] = 215.f - 75.f * up;
+  rgb[2] = 230.f - 20.f * up;
+}
+
+static inline uint8_t clip_u8(float x)
+{
+  return x <= 0.f ? 0 : (x >= 255.f ? 255 : (uint8_t)x);
+}
+
+static void render_rows(struct Frame *f, int row0, int row1)
+{
+  uint8_t *buf = (uint8_t *)f->img->buf;
+  const int w = f->img->w;
+  for (int v = row0; v < row1; v++) {
+    const float b = (v + 0.5f - f->cy) / f->fy;
+    uint8_t *out = buf + 2 * w * v;
+    for (int u = 0; u < w; u += 2) {
+      float rgb[2][3];
+      for (int k = 0; k < 2; k++) {
+        const float a = (u + k + 0.5f - f->cx) / f->fx;
+        const float d[3] = {
+          a * f->rows[0][0] + b * f->rows[1][0] + f->rows[2][0],
+          a * f->rows[0][1] + b * f->rows[1][1] + f->rows[2][1],
+          a * f->rows[0][2] + b * f->rows[1][2] + f->rows[2][2]
+        };
+        shade(f->pos, d, rgb[k]);
+      }
+      const float r = (rgb[0][0] + rgb[1][0]) / 2.f;
+      const float g = (rgb[0][1] + rgb[1][1]) / 2.f;
+      const float bl = (rgb[0][2] + rgb[1][2]) / 2.f;
+      out[0] = clip_u8(-0.148f * r - 0.291f * g + 0.439f * bl + 128.f);  // U
+      out[1] = clip_u8(0.257f * rgb[0][0] + 0.504f * rgb[0][1] + 0.098f * rgb[0][2] + 16.f); // Y
+      out[2] = clip_u8(0.439f * r - 0.368f * g - 0.071f * bl + 128.f);   // V
+      out[3] = clip_u8(0.257f * rgb[1][0] + 0.504f * rgb[1][1] + 0.098f * rgb[1][2] + 16.f); // Y
+      out += 4;
+    }
+  }
+}
+
+/** Render the remaining tiles of the current frame */
+static void render_tiles(void)
+{
+  int tile;
+  while ((tile = __sync_fetch_and_add(&pool.next_tile, 1)) < pool.nb_tiles) {
+    const int row0 = tile * NPS_CAMERA_TILE_ROWS;
+    render_rows(pool.frame, row0, Min(row0 + NPS_CAMERA_TILE_ROWS, pool.frame->img->h));
+  }
+}
+
+static void *render_thread(void *data __attribute__((unused)))
+{
+  while (true) {
+    pthread_barrier_wait(&pool.start);
+    render_tiles();
+    pthread_barrier_wait(&pool.done);
+  }
+  return NULL;
+}
+
+static void render(struct Frame *f)
+{
+  pool.frame = f;
+  pool.nb_tiles = (f->img->h + NPS_CAMERA_TILE_ROWS - 1) / NPS_CAMERA_TILE_ROWS;
+  pool.next_tile = 0;
+  if (pool.nb > 0) {
+    pthread_barrier_wait(&pool.start);
+  }
+  render_tiles();
+  if (pool.nb > 0) {
+    pthread_barrier_wait(&pool.done);
+  }
+}
+
+static void nps_camera_init(void)
+{
+  init_scene();
+
+  for (int i = 0; i < VIDEO_THREAD_MAX_CAMERAS; i++) {
+    struct video_config_t *cam = cameras[i];
+    if (cam == NULL) {
+      continue;
+    }
+#if defined NPS_CAMERA_WIDTH && defined NPS_CAMERA_HEIGHT
+    // keep the field of view of the camera
+    const float scale = (float)NPS_CAMERA_WIDTH / cam->output_size.w;
+    cam->camera_intrinsics.focal_x *= scale;
+    cam->camera_intrinsics.focal_y *= scale;
+    cam->output_size.w = NPS_CAMERA_WIDTH;
+    cam->output_size.h = NPS_CAMERA_HEIGHT;
+    cam->camera_intrinsics.center_x = NPS_CAMERA_WIDTH / 2.f;
+    cam->camera_intrinsics.center_y = NPS_CAMERA_HEIGHT / 2.f;
+#endif
+    cam->output_size.w &= ~1;   // UYVY pairs
+    cam->sensor_size = cam->output_size;
+    cam->crop.x = 0;
+    cam->crop.y = 0;
+    cam->crop.w = cam->output_size.w;
+    cam->crop.h = cam->output_size.h;
+    if (cam->fps <= 0) {
+      cam->fps = NPS_CAMERA_FPS;
+    }
+    cams.bottom[i] = strstr(cam->dev_name, "bottom") != NULL;
+    cams.next_time[i] = 0.;
+    image_create(&cams.img[i], cam->output_size.w, cam->output_size.h, IMAGE_YUV422);
+    printf("[nps_camera] Rendering %s, %dx%d at %d fps\n", cam->dev_name, cam->output_size.w,
+           cam->output_size.h, cam->fps);
+  }
+
+  pool.nb = 0;
+  if (NPS_CAMERA_THREADS > 1) {
+    pthread_barrier_init(&pool.start, NULL, NPS_CAMERA_THREADS);
+    pthread_barrier_init(&pool.done, NULL, NPS_CAMERA_THREADS);
+    for (int i = 0; i < NPS_CAMERA_THREADS - 1; i++) {
+      pthread_create(&pool.th[i], NULL, render_thread, NULL);
+    }
+    pool.nb = NPS_CAMERA_THREADS - 1;
+  }
+  cams.init = true;
+}
+
+void nps_camera_run_step(double time)
+{
+  // cameras are registered by the modules, during the autopilot init
+  if (!cams.init) {
+    nps_camera_init();
+  }
+
+  for (int i = 0; i < VIDEO_THREAD_MAX_CAMERAS; i++) {
+    struct video_config_t *cam = cameras[i];
+    if (cam == NULL || time < cams.next_time[i] || cam->cv_listener == NULL) {
+      continue;
+    }
+    // frames on a fixed period, the step doesn't have to divide it
+    cams.next_time[i] += 1. / cam->fps;
+    if (cams.next_time[i] <= time) {
+      // more than a frame late (first frame), don't render the missed ones
+      cams.next_time[i] = time + 1. / cam->fps;
+    }
+
+    struct DoubleRMat r;
+    double_rmat_of_quat(&r, &fdm.ltpprz_to_body_quat);
+    // body to camera: x right, y down, z along the optical axis
+    static const float front[3][3] = { { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f }, { 1.f, 0.f, 0.f } };
+    static const float bottom[3][3] = { { 0.f, 1.f, 0.f }, { -1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f } };
+    const float (*m)[3] = cams.bottom[i] ? bottom : front;
+
+    struct Frame f;
+    for (int j = 0; j < 3; j++) {
+      for (int k = 0; k < 3; k++) {
+        f.rows[j][k] = m[j][0] * RMAT_ELMT(r, 0, k) + m[j][1] * RMAT_ELMT(r, 1, k) + m[j][2] * RMAT_ELMT(r, 2, k);
+      }
+    }
+    f.pos[0] = fdm.ltpprz_pos.x;
+    f.pos[1] = fdm.ltpprz_pos.y;
+    f.pos[2] = -fdm.agl;
+    f.fx = cam->camera_intrinsics.focal_x;
+    f.fy = cam->camera_intrinsics.focal_y;
+    f.cx = cam->camera_intrinsics.center_x;
+    f.cy = cam->camera_intrinsics.center_y;
+    f.img = &cams.img[i];
+    render(&f);
+
+    f.img->ts.tv_sec = (time_t)time;
+    f.img->ts.tv_usec = (suseconds_t)((time - (double)f.img->ts.tv_sec) * 1e6);
+    f.img->pprz_ts = (uint32_t)(time * 1e6);
+    f.img->eulers.phi = fdm.ltpprz_to_body_eulers.phi;
+    f.img->eulers.theta = fdm.ltpprz_to_body_eulers.theta;
+    f.img->eulers.psi = fdm.ltpprz_to_body_eulers.psi;
+    cv_run_device(cam, f.img);
+  }
+}
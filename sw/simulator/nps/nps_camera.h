@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_camera.h
+ * Software rendered cameras for NPS, without Gazebo.
+ *
+ * Renders a textured ground plane, boxes, poles and gates defined in the
+ * airframe (NPS_CAMERA_ section) from the FDM pose, for each camera
+ * registered with add_video_device, and passes the UYVY frames to
+ * cv_run_device.
+ */
+
+#ifndef NPS_CAMERA_H
+#define NPS_CAMERA_H
+
+/** Render the cameras which are due at this simulation time */
+extern void nps_camera_run_step(double time);
+
+#endif /* NPS_CAMERA_H */
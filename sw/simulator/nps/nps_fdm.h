@@ -46,6 +46,9 @@ struct NpsFdm {
   double time;
   double init_dt;
   double curr_dt;
+  double step_dt;       ///< duration of the next run_step (s), init_dt unless variable_step
+  bool variable_step;   ///< set by the FDM if run_step can integrate over any step_dt
+  bool reentrant;       ///< set by the FDM if several instances can run concurrently in one process
   bool on_ground;
   int nan_count;
 
@@ -131,6 +134,15 @@ struct NpsFdm {
 
 extern struct NpsFdm fdm;
 
+/** Perturbation of the initial conditions (batch runs), applied by the FDM if supported */
+struct NpsFdmInitOffset {
+  double north;     ///< initial position offset (m)
+  double east;      ///< initial position offset (m)
+  double heading;   ///< initial heading offset (rad)
+};
+
+extern struct NpsFdmInitOffset nps_fdm_init_offset;
+
 extern void nps_fdm_init(double dt);
 extern void nps_fdm_run_step(bool launch, double *commands, int commands_nb);
 extern void nps_fdm_set_wind(double speed, double dir);
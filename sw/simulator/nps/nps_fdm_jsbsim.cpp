@@ -175,6 +175,9 @@ void nps_fdm_init(double dt)
 
   fdm.init_dt = dt;
   fdm.curr_dt = dt;
+  fdm.step_dt = dt;
+  // fixed steps of init_dt, sub-stepped near the ground
+  fdm.variable_step = false;
   //Sets up the high fidelity timestep as a multiple of the normal timestep
   for (min_dt = (1.0 / dt); min_dt < (1 / MIN_DT); min_dt += (1 / dt)) {}
   min_dt = (1 / min_dt);
@@ -607,13 +610,16 @@ static void init_jsbsim(double dt)
     // convert geodetic lat from flight plan to geocentric
     double gd_lat = RadOfDeg(NAV_LAT0 / 1e7);
     double gc_lat = gc_of_gd_lat_d(gd_lat, GROUND_ALT);
-    IC->SetLatitudeDegIC(DegOfRad(gc_lat));
-    IC->SetLongitudeDegIC(NAV_LON0 / 1e7);
+    // optional offset of the initial position, small distances only
+    double dlat = nps_fdm_init_offset.north / 6371000.;
+    double dlon = nps_fdm_init_offset.east / (6371000. * cos(gd_lat));
+    IC->SetLatitudeDegIC(DegOfRad(gc_lat + dlat));
+    IC->SetLongitudeDegIC(NAV_LON0 / 1e7 + DegOfRad(dlon));
 
     IC->SetWindNEDFpsIC(0.0, 0.0, 0.0);
     IC->SetAltitudeASLFtIC(FeetOfMeters(GROUND_ALT + 2.0));
     IC->SetTerrainElevationFtIC(FeetOfMeters(GROUND_ALT));
-    IC->SetPsiDegIC(QFU);
+    IC->SetPsiDegIC(QFU + DegOfRad(nps_fdm_init_offset.heading));
     IC->SetVgroundFpsIC(0.);
 
     lla0.lon = RadOfDeg(NAV_LON0 / 1e7);
@@ -0,0 +1,503 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_fdm_multirotor.c
+ * Lightweight multirotor Flight Dynamics Model (FDM) for NPS.
+ *
+ * Rigid body over a flat non rotating earth, integrated in the local NED
+ * frame of the initial position with a fixed step RK4.
+ * Each rotor follows its command with a first order lag, thrust is
+ * quadratic in rotor speed and the yaw torque proportional to thrust.
+ * Aerodynamics are a linear rotor drag, scaled by thrust, and a quadratic
+ * body drag on the air relative velocity.
+ * ECEF and LLA outputs are computed from the local position with the
+ * rotation and radii of curvature of the initial point.
+ *
+ * Rotor positions and directions default to the motor mixing coefficients.
+ */
+
+#include "nps_fdm.h"
+#include "nps_random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "math/pprz_algebra_float.h"
+#include "math/pprz_geodetic_double.h"
+#include "math/pprz_isa.h"
+#include "math/pprz_rk_float.h"
+#include "math/pprz_geodetic_wmm2020.h"
+
+#include "generated/airframe.h"
+#include "generated/flight_plan.h"
+
+#if !defined NPS_MULTIROTOR_ROTOR_X && !NPS_NO_MOTOR_MIXING
+#include "subsystems/actuators/motor_mixing_types.h"
+#endif
+
+/** Mass (kg) */
+#ifndef NPS_MULTIROTOR_MASS
+#define NPS_MULTIROTOR_MASS 1.0
+#endif
+
+/** Inertia (kg.m2) */
+#ifndef NPS_MULTIROTOR_IXX
+#define NPS_MULTIROTOR_IXX 0.01
+#endif
+#ifndef NPS_MULTIROTOR_IYY
+#define NPS_MULTIROTOR_IYY 0.01
+#endif
+#ifndef NPS_MULTIROTOR_IZZ
+#define NPS_MULTIROTOR_IZZ 0.018
+#endif
+
+/** Distance of the rotors to the CG when the positions come from the motor mixing (m) */
+#ifndef NPS_MULTIROTOR_ARM_LENGTH
+#define NPS_MULTIROTOR_ARM_LENGTH 0.2
+#endif
+
+/** Thrust of one rotor at full command (N), default gives hover at 70% */
+#ifndef NPS_MULTIROTOR_MAX_THRUST
+#define NPS_MULTIROTOR_MAX_THRUST (2. * NPS_MULTIROTOR_MASS * PPRZ_ISA_GRAVITY / NPS_COMMANDS_NB)
+#endif
+
+/** Yaw torque over thrust ratio of a rotor (m) */
+#ifndef NPS_MULTIROTOR_TORQUE_COEF
+#define NPS_MULTIROTOR_TORQUE_COEF 0.016
+#endif
+
+/** Time constant of the rotors (s) */
+#ifndef NPS_MULTIROTOR_MOTOR_TAU
+#define NPS_MULTIROTOR_MOTOR_TAU 0.03
+#endif
+
+/** Horizontal rotor drag at hover thrust (N/(m/s)) */
+#ifndef NPS_MULTIROTOR_ROTOR_DRAG
+#define NPS_MULTIROTOR_ROTOR_DRAG 0.2
+#endif
+
+/** Quadratic body drag (N/(m/s)^2) */
+#ifndef NPS_MULTIROTOR_DRAG_XY
+#define NPS_MULTIROTOR_DRAG_XY 0.05
+#endif
+#ifndef NPS_MULTIROTOR_DRAG_Z
+#define NPS_MULTIROTOR_DRAG_Z 0.1
+#endif
+
+/** Rotational damping (N.m/(rad/s)) */
+#ifndef NPS_MULTIROTOR_ROT_DAMPING
+#define NPS_MULTIROTOR_ROT_DAMPING 0.002
+#endif
+
+/** Gust standard deviation per turbulence severity level (m/s) and correlation time (s) */
+#ifndef NPS_MULTIROTOR_GUST_SIGMA
+#define NPS_MULTIROTOR_GUST_SIGMA 0.5
+#endif
+#ifndef NPS_MULTIROTOR_GUST_TAU
+#define NPS_MULTIROTOR_GUST_TAU 1.0
+#endif
+
+#define NB_ROTORS NPS_COMMANDS_NB
+
+/** State vector: position (NED), speed (NED), attitude quaternion, body rates, rotor speeds */
+#define X_POS   0
+#define X_SPEED 3
+#define X_QUAT  6
+#define X_RATES 10
+#define X_ROTOR 13
+#define X_SIZE  (X_ROTOR + NB_ROTORS)
+
+/// Holds all necessary NPS FDM state information
+struct NpsFdm fdm;
+
+static struct {
+  float x[NB_ROTORS];     ///< rotor positions, forward (m)
+  float y[NB_ROTORS];     ///< rotor positions, right (m)
+  float dir[NB_ROTORS];   ///< yaw torque sign
+  struct FloatVect3 wind; ///< total wind for the current step (NED)
+} model;
+
+static float state[X_SIZE];
+
+static struct LtpDef_d ltpdef;
+static struct LlaCoor_d lla0;
+static double lat_of_north;       ///< rad/m
+static double lon_of_east;        ///< rad/m
+static struct DoubleVect3 wind_mean;
+static struct DoubleVect3 gust;
+static double gust_sigma;
+static struct NpsRandomVect3 gust_rng;
+static double temp_offset;        ///< temperature offset to ISA (K)
+
+static void init_rotors(void);
+static void init_ltp(void);
+static void dynamics(float *xdot, const float *x, const int n, const float *u, const int m);
+static void ground_contact(void);
+static void fetch_state(const float *x_prev, double dt);
+
+void nps_fdm_init(double dt)
+{
+  fdm.init_dt = dt;
+  fdm.curr_dt = dt;
+  fdm.step_dt = dt;
+  fdm.variable_step = true;
+  fdm.reentrant = true;
+  fdm.nan_count = 0;
+  fdm.num_engines = Min(NB_ROTORS, FG_NET_FDM_MAX_ENGINES);
+
+  init_rotors();
+  init_ltp();
+
+  for (int i = 0; i < X_SIZE; i++) {
+    state[i] = 0.f;
+  }
+  struct FloatEulers e = { 0.f, 0.f, RadOfDeg(QFU) + nps_fdm_init_offset.heading };
+  float_quat_of_eulers((struct FloatQuat *)&state[X_QUAT], &e);
+
+  VECT3_ASSIGN(wind_mean, 0., 0., 0.);
+  VECT3_ASSIGN(gust, 0., 0., 0.);
+  gust_sigma = 0.;
+  temp_offset = 0.;
+  nps_random_vect3_init(&gust_rng, "fdm_gust");
+
+  fdm.time = 0.;
+  ground_contact();
+  fetch_state(state, dt);
+}
+
+void nps_fdm_run_step(bool launch __attribute__((unused)), double *commands, int commands_nb)
+{
+  const double dt = fdm.step_dt;
+  float u[NB_ROTORS];
+  for (int i = 0; i < NB_ROTORS; i++) {
+    u[i] = i < commands_nb ? Clip((float)commands[i], 0.f, 1.f) : 0.f;
+  }
+
+  // turbulence, first order Gauss-Markov process on each axis
+  if (gust_sigma > 0.) {
+    const double a = exp(-dt / NPS_MULTIROTOR_GUST_TAU);
+    struct DoubleVect3 std_dev;
+    const double s = gust_sigma * sqrt(1. - a * a);
+    VECT3_ASSIGN(std_dev, s, s, s);
+    VECT3_SMUL(gust, gust, a);
+    nps_random_vect3_add_noise(&gust_rng, &gust, &std_dev);
+  } else {
+    VECT3_ASSIGN(gust, 0., 0., 0.);
+  }
+  VECT3_SUM(model.wind, wind_mean, gust);
+
+  float x_prev[X_SIZE];
+  memcpy(x_prev, state, sizeof(state));
+  runge_kutta_4_float(state, state, X_SIZE, u, NB_ROTORS, dynamics, dt);
+  float_quat_normalize((struct FloatQuat *)&state[X_QUAT]);
+  for (int i = 0; i < NB_ROTORS; i++) {
+    state[X_ROTOR + i] = Clip(state[X_ROTOR + i], 0.f, 1.f);
+  }
+
+  // outputs after the ground reaction, so that the accelerometer reads the
+  // support force when landed and impacts show as a one step deceleration
+  ground_contact();
+  fetch_state(x_prev, dt);
+  fdm.time += dt;
+
+  if (isnan(state[X_POS]) || isnan(state[X_QUAT])) {
+    printf("Error: FDM simulation diverged at simulation time %f, exiting with status 1.\n", fdm.time);
+    exit(1);
+  }
+}
+
+void nps_fdm_set_wind(double speed, double dir)
+{
+  wind_mean.x = speed * cos(dir);
+  wind_mean.y = speed * sin(dir);
+  wind_mean.z = 0.;
+}
+
+void nps_fdm_set_wind_ned(double wind_north, double wind_east, double wind_down)
+{
+  VECT3_ASSIGN(wind_mean, wind_north, wind_east, wind_down);
+}
+
+void nps_fdm_set_turbulence(double wind_speed __attribute__((unused)), int turbulence_severity)
+{
+  gust_sigma = NPS_MULTIROTOR_GUST_SIGMA * turbulence_severity;
+}
+
+void nps_fdm_set_temperature(double temp, double h)
+{
+  temp_offset = (temp - PPRZ_ISA_ABS_NULL) - pprz_isa_temperature_of_altitude(h);
+}
+
+/**
+ * Rotor positions and yaw directions, from the airframe or from the
+ * roll, pitch and yaw motor mixing coefficients.
+ */
+static void init_rotors(void)
+{
+#ifdef NPS_MULTIROTOR_ROTOR_X
+  const float rx[] = NPS_MULTIROTOR_ROTOR_X;
+  const float ry[] = NPS_MULTIROTOR_ROTOR_Y;
+  const float rd[] = NPS_MULTIROTOR_ROTOR_DIR;
+  for (int i = 0; i < NB_ROTORS; i++) {
+    model.x[i] = rx[i];
+    model.y[i] = ry[i];
+    model.dir[i] = rd[i] >= 0.f ? 1.f : -1.f;
+  }
+#elif defined MOTOR_MIXING_ROLL_COEF
+  const float roll[] = MOTOR_MIXING_ROLL_COEF;
+  const float pitch[] = MOTOR_MIXING_PITCH_COEF;
+  const float yaw[] = MOTOR_MIXING_YAW_COEF;
+  float max = 0.f;
+  for (int i = 0; i < NB_ROTORS; i++) {
+    max = Max(max, sqrtf(roll[i] * roll[i] + pitch[i] * pitch[i]));
+  }
+  for (int i = 0; i < NB_ROTORS; i++) {
+    // roll moment is -y * thrust, pitch moment is x * thrust
+    model.x[i] = NPS_MULTIROTOR_ARM_LENGTH * pitch[i] / max;
+    model.y[i] = -NPS_MULTIROTOR_ARM_LENGTH * roll[i] / max;
+    model.dir[i] = yaw[i] >= 0.f ? 1.f : -1.f;
+  }
+#else
+#error "NPS multirotor FDM needs NPS_MULTIROTOR_ROTOR_X/Y/DIR or a motor mixing"
+#endif
+}
+
+/**
+ * Local frame at the initial position (flight plan origin with the
+ * optional initial offset), on the ground.
+ */
+static void init_ltp(void)
+{
+  lla0.lat = RadOfDeg(NAV_LAT0 / 1e7);
+  lla0.lon = RadOfDeg(NAV_LON0 / 1e7);
+  lla0.alt = GROUND_ALT;
+
+  // radii of curvature of the WGS84 ellipsoid
+  const double a = 6378137.0;
+  const double e2 = 6.69437999014e-3;
+  const double s = sin(lla0.lat);
+  const double w = sqrt(1. - e2 * s * s);
+  const double rn = a / w;                      // prime vertical
+  const double rm = a * (1. - e2) / (w * w * w);  // meridian
+  lla0.lat += nps_fdm_init_offset.north / (rm + lla0.alt);
+  lla0.lon += nps_fdm_init_offset.east / ((rn + lla0.alt) * cos(lla0.lat));
+  lat_of_north = 1. / (rm + lla0.alt);
+  lon_of_east = 1. / ((rn + lla0.alt) * cos(lla0.lat));
+
+  ltp_def_from_lla_d(&ltpdef, &lla0);
+  fdm.hmsl = lla0.alt;
+
+  fdm.ltp_g.x = 0.;
+  fdm.ltp_g.y = 0.;
+  fdm.ltp_g.z = PPRZ_ISA_GRAVITY;
+
+#if !NPS_CALC_GEO_MAG && defined(AHRS_H_X)
+  PRINT_CONFIG_MSG("Using magnetic field as defined in airframe file (AHRS section).")
+  fdm.ltp_h.x = AHRS_H_X;
+  fdm.ltp_h.y = AHRS_H_Y;
+  fdm.ltp_h.z = AHRS_H_Z;
+#elif !NPS_CALC_GEO_MAG && defined(INS_H_X)
+  PRINT_CONFIG_MSG("Using magnetic field as defined in airframe file (INS section).")
+  fdm.ltp_h.x = INS_H_X;
+  fdm.ltp_h.y = INS_H_Y;
+  fdm.ltp_h.z = INS_H_Z;
+#else
+  PRINT_CONFIG_MSG("Using WMM2020 model to calculate magnetic field at simulated location.")
+  double gha[MAXCOEFF];
+  int16_t nmax = extrapsh(2021.0, GEO_EPOCH, NMAX_1, NMAX_2, gha);
+  mag_calc(1, DegOfRad(lla0.lat), DegOfRad(lla0.lon), lla0.alt / 1e3, nmax, gha,
+           &fdm.ltp_h.x, &fdm.ltp_h.y, &fdm.ltp_h.z,
+           IEXT, EXT_COEFF1, EXT_COEFF2, EXT_COEFF3);
+  double_vect3_normalize(&fdm.ltp_h);
+#endif
+}
+
+/**
+ * State derivative for the RK4 integration
+ */
+static void dynamics(float *xdot, const float *x, const int n __attribute__((unused)),
+                     const float *u, const int m __attribute__((unused)))
+{
+  struct FloatQuat q = { x[X_QUAT], x[X_QUAT + 1], x[X_QUAT + 2], x[X_QUAT + 3] };
+  struct FloatRates rates = { x[X_RATES], x[X_RATES + 1], x[X_RATES + 2] };
+  struct FloatRMat r;
+  float_rmat_of_quat(&r, &q);
+
+  // rotors
+  float thrust = 0.f;
+  struct FloatVect3 moment = { 0.f, 0.f, 0.f };
+  for (int i = 0; i < NB_ROTORS; i++) {
+    const float w = x[X_ROTOR + i];
+    const float t = NPS_MULTIROTOR_MAX_THRUST * w * w;
+    thrust += t;
+    moment.x -= model.y[i] * t;
+    moment.y += model.x[i] * t;
+    moment.z += model.dir[i] * NPS_MULTIROTOR_TORQUE_COEF * t;
+    xdot[X_ROTOR + i] = (u[i] - w) / NPS_MULTIROTOR_MOTOR_TAU;
+  }
+
+  // aerodynamic forces in body frame
+  struct FloatVect3 air_ned = { x[X_SPEED] - model.wind.x, x[X_SPEED + 1] - model.wind.y,
+           x[X_SPEED + 2] - model.wind.z
+  };
+  struct FloatVect3 air;
+  float_rmat_vmult(&air, &r, &air_ned);
+  const float rotor_drag = NPS_MULTIROTOR_ROTOR_DRAG * thrust / (NPS_MULTIROTOR_MASS * PPRZ_ISA_GRAVITY);
+  struct FloatVect3 force = {
+    -rotor_drag * air.x - NPS_MULTIROTOR_DRAG_XY * fabsf(air.x) * air.x,
+    -rotor_drag * air.y - NPS_MULTIROTOR_DRAG_XY * fabsf(air.y) * air.y,
+    -thrust - NPS_MULTIROTOR_DRAG_Z * fabsf(air.z) * air.z
+  };
+
+  // translation
+  struct FloatVect3 force_ned;
+  float_rmat_transp_vmult(&force_ned, &r, &force);
+  xdot[X_POS] = x[X_SPEED];
+  xdot[X_POS + 1] = x[X_SPEED + 1];
+  xdot[X_POS + 2] = x[X_SPEED + 2];
+  xdot[X_SPEED] = force_ned.x / NPS_MULTIROTOR_MASS;
+  xdot[X_SPEED + 1] = force_ned.y / NPS_MULTIROTOR_MASS;
+  xdot[X_SPEED + 2] = force_ned.z / NPS_MULTIROTOR_MASS + PPRZ_ISA_GRAVITY;
+
+  // rotation
+  struct FloatQuat qd;
+  float_quat_derivative(&qd, &rates, &q);
+  xdot[X_QUAT] = qd.qi;
+  xdot[X_QUAT + 1] = qd.qx;
+  xdot[X_QUAT + 2] = qd.qy;
+  xdot[X_QUAT + 3] = qd.qz;
+  xdot[X_RATES] = (moment.x - NPS_MULTIROTOR_ROT_DAMPING * rates.p
+                   - (NPS_MULTIROTOR_IZZ - NPS_MULTIROTOR_IYY) * rates.q * rates.r) / NPS_MULTIROTOR_IXX;
+  xdot[X_RATES + 1] = (moment.y - NPS_MULTIROTOR_ROT_DAMPING * rates.q
+                       - (NPS_MULTIROTOR_IXX - NPS_MULTIROTOR_IZZ) * rates.p * rates.r) / NPS_MULTIROTOR_IYY;
+  xdot[X_RATES + 2] = (moment.z - NPS_MULTIROTOR_ROT_DAMPING * rates.r
+                       - (NPS_MULTIROTOR_IYY - NPS_MULTIROTOR_IXX) * rates.p * rates.q) / NPS_MULTIROTOR_IZZ;
+}
+
+/**
+ * Flat ground at the initial altitude.
+ * The vehicle stays landed, level with its heading, while the thrust is
+ * lower than its weight.
+ */
+static void ground_contact(void)
+{
+  fdm.on_ground = false;
+  if (state[X_POS + 2] < 0.f) {
+    return;
+  }
+  fdm.on_ground = true;
+  state[X_POS + 2] = 0.f;
+  if (state[X_SPEED + 2] > 0.f) {
+    state[X_SPEED + 2] = 0.f;
+  }
+  float thrust = 0.f;
+  for (int i = 0; i < NB_ROTORS; i++) {
+    thrust += NPS_MULTIROTOR_MAX_THRUST * state[X_ROTOR + i] * state[X_ROTOR + i];
+  }
+  if (thrust < NPS_MULTIROTOR_MASS * PPRZ_ISA_GRAVITY) {
+    struct FloatEulers e;
+    float_eulers_of_quat(&e, (struct FloatQuat *)&state[X_QUAT]);
+    e.phi = 0.f;
+    e.theta = 0.f;
+    float_quat_of_eulers((struct FloatQuat *)&state[X_QUAT], &e);
+    for (int i = 0; i < 3; i++) {
+      state[X_SPEED + i] = 0.f;
+      state[X_RATES + i] = 0.f;
+    }
+  }
+}
+
+/**
+ * Populates the NPS fdm struct after a simulation step.
+ */
+static void fetch_state(const float *x_prev, double dt)
+{
+  struct DoubleQuat q = { state[X_QUAT], state[X_QUAT + 1], state[X_QUAT + 2], state[X_QUAT + 3] };
+  struct DoubleRMat r;
+  double_rmat_of_quat(&r, &q);
+
+  /* position */
+  VECT3_ASSIGN(fdm.ltpprz_pos, state[X_POS], state[X_POS + 1], state[X_POS + 2]);
+  ecef_of_ned_point_d(&fdm.ecef_pos, &ltpdef, &fdm.ltpprz_pos);
+  fdm.lla_pos.lat = lla0.lat + fdm.ltpprz_pos.x * lat_of_north;
+  fdm.lla_pos.lon = lla0.lon + fdm.ltpprz_pos.y * lon_of_east;
+  fdm.lla_pos.alt = lla0.alt - fdm.ltpprz_pos.z;
+  fdm.lla_pos_pprz = fdm.lla_pos;
+  fdm.lla_pos_geod = fdm.lla_pos;
+  fdm.lla_pos_geoc = fdm.lla_pos;
+  fdm.hmsl = fdm.lla_pos.alt;
+  fdm.agl = -fdm.ltpprz_pos.z;
+
+  /* speed and accelerations, the local frame doesn't rotate */
+  VECT3_ASSIGN(fdm.ltp_ecef_vel, state[X_SPEED], state[X_SPEED + 1], state[X_SPEED + 2]);
+  VECT3_ASSIGN(fdm.ltp_ecef_accel, (state[X_SPEED] - x_prev[X_SPEED]) / dt,
+               (state[X_SPEED + 1] - x_prev[X_SPEED + 1]) / dt, (state[X_SPEED + 2] - x_prev[X_SPEED + 2]) / dt);
+  fdm.ltpprz_ecef_vel = fdm.ltp_ecef_vel;
+  fdm.ltpprz_ecef_accel = fdm.ltp_ecef_accel;
+  ecef_of_ned_vect_d(&fdm.ecef_ecef_vel, &ltpdef, &fdm.ltp_ecef_vel);
+  ecef_of_ned_vect_d(&fdm.ecef_ecef_accel, &ltpdef, &fdm.ltp_ecef_accel);
+  double_rmat_vmult(&fdm.body_ecef_vel, &r, (struct DoubleVect3 *)&fdm.ltp_ecef_vel);
+  double_rmat_vmult(&fdm.body_ecef_accel, &r, (struct DoubleVect3 *)&fdm.ltp_ecef_accel);
+  fdm.body_inertial_accel = fdm.body_ecef_accel;
+  // specific force measured by an accelerometer
+  struct DoubleVect3 sf = { fdm.ltp_ecef_accel.x, fdm.ltp_ecef_accel.y, fdm.ltp_ecef_accel.z - PPRZ_ISA_GRAVITY };
+  double_rmat_vmult(&fdm.body_accel, &r, &sf);
+
+  /* attitude */
+  fdm.ltp_to_body_quat = q;
+  double_eulers_of_quat(&fdm.ltp_to_body_eulers, &q);
+  fdm.ltpprz_to_body_quat = q;
+  fdm.ltpprz_to_body_eulers = fdm.ltp_to_body_eulers;
+  // ecef_to_body_quat: unused
+
+  /* rotational speed and accelerations */
+  RATES_ASSIGN(fdm.body_ecef_rotvel, state[X_RATES], state[X_RATES + 1], state[X_RATES + 2]);
+  RATES_ASSIGN(fdm.body_ecef_rotaccel, (state[X_RATES] - x_prev[X_RATES]) / dt,
+               (state[X_RATES + 1] - x_prev[X_RATES + 1]) / dt, (state[X_RATES + 2] - x_prev[X_RATES + 2]) / dt);
+  fdm.body_inertial_rotvel = fdm.body_ecef_rotvel;
+  fdm.body_inertial_rotaccel = fdm.body_ecef_rotaccel;
+
+  /* wind */
+  VECT3_COPY(fdm.wind, model.wind);
+
+  /* atmosphere, ISA with temperature offset */
+  fdm.pressure_sl = PPRZ_ISA_SEA_LEVEL_PRESSURE;
+  fdm.pressure = pprz_isa_pressure_of_altitude(fdm.hmsl);
+  fdm.temperature = pprz_isa_temperature_of_altitude(fdm.hmsl) + temp_offset + PPRZ_ISA_ABS_NULL;
+  const double rho = pprz_isa_density_of_pressure(fdm.pressure, fdm.temperature);
+  struct DoubleVect3 air_ned, air;
+  VECT3_DIFF(air_ned, fdm.ltp_ecef_vel, fdm.wind);
+  double_rmat_vmult(&air, &r, &air_ned);
+  const double va2 = VECT3_NORM2(air);
+  fdm.dynamic_pressure = 0.5 * rho * va2;
+  fdm.total_pressure = fdm.pressure + fdm.dynamic_pressure;
+  fdm.airspeed = sqrt(2. * fdm.dynamic_pressure / PPRZ_ISA_AIR_DENSITY);
+  fdm.aoa = atan2(air.z, air.x);
+  fdm.sideslip = va2 > 1e-6 ? asin(Clip(air.y / sqrt(va2), -1., 1.)) : 0.;
+
+  /* rotors, normalized speed mapped to the RPM field */
+  for (uint32_t i = 0; i < fdm.num_engines; i++) {
+    fdm.eng_state[i] = state[X_ROTOR + i] > 0.01f ? 1 : 0;
+    fdm.rpm[i] = state[X_ROTOR + i];
+  }
+}
@@ -88,6 +88,18 @@ void nps_ivy_init(char *ivy_bus)
 
 }
 
+void nps_ivy_stop(void)
+{
+  // the Ivy loop waits in select, which is a cancellation point
+  pthread_cancel(th_ivy_main);
+  pthread_join(th_ivy_main, NULL);
+}
+
+void nps_ivy_resume(void)
+{
+  pthread_create(&th_ivy_main, NULL, ivy_main_loop, NULL);
+}
+
 /*
  * Parse WORLD_ENV message from gaia.
  *
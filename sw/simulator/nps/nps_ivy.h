@@ -9,5 +9,9 @@ bool nps_ivy_send_world_env;
 extern void nps_ivy_init(char *ivy_bus);
 extern void nps_ivy_display(struct NpsFdm* fdm_ivy, struct NpsSensors* sensors_ivy);
 extern void nps_ivy_send_WORLD_ENV_REQ(void);
+/** Stop processing incoming Ivy messages (the bus stays open for sending) */
+extern void nps_ivy_stop(void);
+/** Process incoming Ivy messages again, e.g. in a process forked after nps_ivy_stop */
+extern void nps_ivy_resume(void);
 
 #endif /* NPS_IVY */
@@ -37,6 +37,9 @@ void nps_main_run_sim_step(void);
 void nps_set_time_factor(float time_factor);
 
 void* nps_main_loop(void* data __attribute__((unused)));
+void nps_main_lockstep_loop(void);
+bool nps_main_checkpoint(void);
+void nps_main_set_environment(void);
 void* nps_flight_gear_loop(void* data __attribute__((unused)));
 void* nps_main_display(void* data __attribute__((unused)));
 
@@ -65,6 +68,18 @@ struct NpsMain {
   bool norc;
   char *ivy_bus;
   bool nodisplay;
+  bool lockstep;    ///< run as fast as possible, outputs decimated by simulated time
+  double duration;  ///< stop after this simulated time (s), 0 to run forever
+  unsigned long seed;   ///< seed of the sensor noises
+  double noise_scale;   ///< factor applied to all the sensor noises
+  double wind_speed;    ///< initial wind speed (m/s), negative to keep the airframe value
+  double wind_dir;      ///< initial wind direction (deg)
+  int turbulence;       ///< turbulence severity, negative to keep the airframe value
+  char *results;        ///< file where the run metrics are appended, NULL if not used
+  double checkpoint;    ///< simulated time of the checkpoint (s), negative if none
+  int checkpoint_jobs;  ///< number of branches run in parallel from the checkpoint
+  int branch;           ///< branch number, -1 if not running from a checkpoint
+  char *shm;            ///< shared memory name where each step is published, NULL if not used
 };
 
 struct NpsMain nps_main;
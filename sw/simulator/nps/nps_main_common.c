@@ -29,6 +29,9 @@
 #include "nps_flightgear.h"
 
 #include "nps_ivy.h"
+#include "nps_random.h"
+
+struct NpsFdmInitOffset nps_fdm_init_offset;
 
 #ifdef __MACH__
 pthread_mutex_t clock_mutex; // mutex for clock
@@ -97,8 +100,10 @@ int nps_main_init(int argc, char **argv)
   nps_main.real_initial_time = time_to_double(&t);
   nps_main.scaled_initial_time = time_to_double(&t);
 
+  nps_random_init(nps_main.seed, nps_main.noise_scale);
   nps_fdm_init(SIM_DT);
   nps_atmosphere_init();
+  nps_main_set_environment();
   nps_sensors_init(nps_main.sim_time);
   printf("Simulating with dt of %f\n", SIM_DT);
 
@@ -110,14 +115,35 @@ int nps_main_init(int argc, char **argv)
 
   signal(SIGCONT, cont_hdl);
   signal(SIGTSTP, tstp_hdl);
-  printf("Time factor is %f. (Press Ctrl-Z to change)\n", nps_main.host_time_factor);
+  if (nps_main.lockstep) {
+    printf("Lockstep mode, running as fast as possible. (Press Ctrl-Z to pause)\n");
+  } else {
+    printf("Time factor is %f. (Press Ctrl-Z to change)\n", nps_main.host_time_factor);
+  }
 
   return 0;
 }
 
 
+/** Apply the wind and turbulence options, if set */
+void nps_main_set_environment(void)
+{
+  if (nps_main.wind_speed >= 0.) {
+    nps_atmosphere_set_wind_speed(nps_main.wind_speed);
+    nps_atmosphere_set_wind_dir(RadOfDeg(nps_main.wind_dir));
+  }
+  if (nps_main.turbulence >= 0) {
+    nps_atmosphere.turbulence_severity = nps_main.turbulence;
+  }
+}
+
+
 void nps_set_time_factor(float time_factor)
 {
+  // no wall clock in lockstep mode
+  if (nps_main.lockstep) {
+    return;
+  }
   if (time_factor < 0.0 || time_factor > 100.0) {
     return;
   }
@@ -159,6 +185,18 @@ bool nps_main_parse_options(int argc, char **argv)
   nps_main.host_time_factor = 1.0;
   nps_main.fg_fdm = 0;
   nps_main.nodisplay = false;
+  nps_main.lockstep = false;
+  nps_main.duration = 0.;
+  nps_main.seed = 0;
+  nps_main.noise_scale = 1.;
+  nps_main.wind_speed = -1.;
+  nps_main.wind_dir = 0.;
+  nps_main.turbulence = -1;
+  nps_main.results = NULL;
+  nps_main.checkpoint = -1.;
+  nps_main.checkpoint_jobs = 1;
+  nps_main.branch = -1;
+  nps_main.shm = NULL;
 
   static const char *usage =
     "Usage: %s [options]\n"
@@ -175,7 +213,21 @@ bool nps_main_parse_options(int argc, char **argv)
     "   --ivy_bus <ivy bus>                    e.g. 127.255.255.255\n"
     "   --time_factor <factor>                 e.g. 2.5\n"
     "   --nodisplay                            e.g. disable NPS ivy messages\n"
-    "   --fg_fdm";
+    "   --fg_fdm\n"
+    "   --lockstep                             run as fast as possible, no wall clock (SITL only)\n"
+    "   --duration <seconds>                   stop after this simulated time, e.g. 300\n"
+    "   --seed <seed>                          seed of the sensor noises, e.g. 42\n"
+    "   --noise_scale <factor>                 scale all the sensor noises, e.g. 1.5\n"
+    "   --wind_speed <m/s>                     e.g. 5\n"
+    "   --wind_dir <deg>                       direction the wind comes from, e.g. 270\n"
+    "   --turbulence <severity>                e.g. 3\n"
+    "   --init_offset <north,east,heading>     initial position (m) and heading (deg) offsets\n"
+    "   --results <file>                       append the run metrics to a file\n"
+    "   --checkpoint <seconds>                 keep the state at this simulated time and run branches\n"
+    "                                          from it, one per line of options read on stdin (lockstep only)\n"
+    "   --checkpoint_jobs <number>             branches run in parallel, e.g. 4 (default 1)\n"
+    "   --shm <name>                           publish the FDM and sensor data of each step in shared memory,\n"
+    "                                          e.g. /nps (SITL only)\n";
 
 
   while (1) {
@@ -193,6 +245,18 @@ bool nps_main_parse_options(int argc, char **argv)
       {"fg_fdm", 0, NULL, 0},
       {"fg_port_in", 1, NULL, 0},
       {"nodisplay", 0, NULL, 0},
+      {"lockstep", 0, NULL, 0},
+      {"duration", 1, NULL, 0},
+      {"seed", 1, NULL, 0},
+      {"noise_scale", 1, NULL, 0},
+      {"wind_speed", 1, NULL, 0},
+      {"wind_dir", 1, NULL, 0},
+      {"turbulence", 1, NULL, 0},
+      {"init_offset", 1, NULL, 0},
+      {"results", 1, NULL, 0},
+      {"checkpoint", 1, NULL, 0},
+      {"checkpoint_jobs", 1, NULL, 0},
+      {"shm", 1, NULL, 0},
       {0, 0, 0, 0}
     };
     int option_index = 0;
@@ -231,6 +295,34 @@ bool nps_main_parse_options(int argc, char **argv)
             nps_main.fg_port_in = atoi(optarg); break;
           case 11:
             nps_main.nodisplay = true; break;
+          case 12:
+            nps_main.lockstep = true; break;
+          case 13:
+            nps_main.duration = atof(optarg); break;
+          case 14:
+            nps_main.seed = strtoul(optarg, NULL, 10); break;
+          case 15:
+            nps_main.noise_scale = atof(optarg); break;
+          case 16:
+            nps_main.wind_speed = atof(optarg); break;
+          case 17:
+            nps_main.wind_dir = atof(optarg); break;
+          case 18:
+            nps_main.turbulence = atoi(optarg); break;
+          case 19: {
+            double psi = 0.;
+            sscanf(optarg, "%lf,%lf,%lf", &nps_fdm_init_offset.north, &nps_fdm_init_offset.east, &psi);
+            nps_fdm_init_offset.heading = RadOfDeg(psi);
+            break;
+          }
+          case 20:
+            nps_main.results = strdup(optarg); break;
+          case 21:
+            nps_main.checkpoint = atof(optarg); break;
+          case 22:
+            nps_main.checkpoint_jobs = Max(atoi(optarg), 1); break;
+          case 23:
+            nps_main.shm = strdup(optarg); break;
           default:
             break;
         }
@@ -251,6 +343,10 @@ bool nps_main_parse_options(int argc, char **argv)
         exit(EXIT_FAILURE);
     }
   }
+  if (nps_main.checkpoint >= 0. && !nps_main.lockstep) {
+    fprintf(stderr, "--checkpoint requires --lockstep\n");
+    return FALSE;
+  }
   return TRUE;
 }
 
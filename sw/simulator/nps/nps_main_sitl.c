@@ -25,9 +25,26 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 #include "nps_main.h"
 #include "nps_fdm.h"
+#include "nps_flightgear.h"
+#include "nps_ivy.h"
+#include "nps_random.h"
+#include "nps_results.h"
+#include "nps_shm.h"
+#if NPS_CAMERA
+#include "nps_camera.h"
+#endif
+
+/** Run the FDM and sensors only when the autopilot needs them, see nps_main_run_sim_step */
+#ifndef NPS_MULTIRATE
+#define NPS_MULTIRATE FALSE
+#endif
 
 
 
@@ -37,14 +54,27 @@ int main(int argc, char **argv)
   if (nps_main_init(argc, argv)) {
     return 1;
   }
+  if (nps_main.results) {
+    nps_results_init();
+  }
+  if (nps_main.shm && !nps_shm_init(nps_main.shm, NPS_SHM_CAPACITY, SIM_DT)) {
+    return 1;
+  }
 
-  if (nps_main.fg_host) {
-    pthread_create(&th_flight_gear, NULL, nps_flight_gear_loop, NULL);
+  if (nps_main.lockstep) {
+    nps_main_lockstep_loop();
+  } else {
+    if (nps_main.fg_host) {
+      pthread_create(&th_flight_gear, NULL, nps_flight_gear_loop, NULL);
+    }
+    pthread_create(&th_display_ivy, NULL, nps_main_display, NULL);
+    pthread_create(&th_main_loop, NULL, nps_main_loop, NULL);
+    pthread_join(th_main_loop, NULL);
   }
-  pthread_create(&th_display_ivy, NULL, nps_main_display, NULL);
-  pthread_create(&th_main_loop, NULL, nps_main_loop, NULL);
-  pthread_join(th_main_loop, NULL);
 
+  if (nps_main.results) {
+    nps_results_write(nps_main.results, nps_main.sim_time);
+  }
   return 0;
 }
 
@@ -71,18 +101,84 @@ void nps_radio_and_autopilot_init(void)
 }
 
 
+/** Tick of the next sys_time timer, i.e. of the next periodic task of the autopilot */
+static uint32_t nps_main_next_timer(void)
+{
+  uint32_t next = UINT32_MAX;
+  for (unsigned int i = 0; i < SYS_TIME_NB_TIMER; i++) {
+    if (sys_time.timer[i].in_use) {
+      next = Min(next, sys_time.timer[i].end_time);
+    }
+  }
+  return next;
+}
+
+/** Sensor time of the FDM state, the FDM runs one step ahead of the sensors */
+static double nps_main_fdm_time = -SIM_DT;
+
+/** Run the FDM up to time in a single step */
+static void nps_main_run_fdm_until(double time)
+{
+  if (time - nps_main_fdm_time < NPS_SENSORS_TIME_RES) {
+    return;
+  }
+  fdm.step_dt = time - nps_main_fdm_time;
+  nps_fdm_run_step(nps_autopilot.launch, nps_autopilot.commands, NPS_COMMANDS_NB);
+  nps_main_fdm_time = time;
+}
+
+/**
+ * Run a step of the simulation, at SIM_DT.
+ *
+ * With NPS_MULTIRATE and an FDM supporting variable steps, the steps where
+ * the autopilot has nothing to do (no periodic task, radio control or sensor
+ * reading) are only counted, and the FDM is run at the next step from sensor
+ * event to sensor event. Each sensor is read at its exact time and rate
+ * instead of the next multiple of SIM_DT, with larger FDM steps in between.
+ * The skipped steps publish no shared memory sample.
+ */
 void nps_main_run_sim_step(void)
 {
   nps_atmosphere_update(SIM_DT);
 
-  nps_autopilot_run_systime_step();
+  if (!NPS_MULTIRATE || !fdm.variable_step) {
+    nps_autopilot_run_systime_step();
 
-  nps_fdm_run_step(nps_autopilot.launch, nps_autopilot.commands, NPS_COMMANDS_NB);
+    nps_fdm_run_step(nps_autopilot.launch, nps_autopilot.commands, NPS_COMMANDS_NB);
+
+    nps_sensors_run_step(nps_main.sim_time);
+  } else {
+    uint32_t next_timer = nps_main_next_timer();
+    nps_autopilot_run_systime_step();
+
+    double time = nps_main.sim_time;
+    bool rc_due = nps_radio_control.type != NORC && time >= nps_radio_control.next_update;
+    if (sys_time.nb_tick < next_timer && !rc_due &&
+        nps_sensors_next_event() > time + NPS_SENSORS_TIME_RES) {
+      return;
+    }
+
+    double event;
+    while ((event = nps_sensors_next_event()) <= time + NPS_SENSORS_TIME_RES) {
+      nps_main_run_fdm_until(Min(event, time));
+      nps_sensors_run_step(event);
+    }
+    nps_main_run_fdm_until(time);
+  }
+
+#if NPS_CAMERA
+  nps_camera_run_step(nps_main.sim_time);
+#endif
 
-  nps_sensors_run_step(nps_main.sim_time);
+  // before the autopilot step, which clears the sensor availability flags
+  nps_shm_publish(nps_main.sim_time, &fdm, &sensors, nps_autopilot.commands, NPS_COMMANDS_NB);
 
   nps_autopilot_run_step(nps_main.sim_time);
 
+  if (nps_main.results && !nps_results_update(nps_main.sim_time)) {
+    // stop the run on crash
+    nps_main.duration = nps_main.sim_time;
+  }
 }
 
 
@@ -151,6 +247,10 @@ void *nps_main_loop(void *data __attribute__((unused)))
       cnt++;
     }
 
+    if (nps_main.duration > 0. && nps_main.sim_time >= nps_main.duration) {
+      break;
+    }
+
     // Check to make sure the simulation doesn't get too far behind real time looping
     if (cnt > (prev_cnt)) {grow_cnt++;}
     else { grow_cnt--;}
@@ -184,3 +284,176 @@ void *nps_main_loop(void *data __attribute__((unused)))
   }
   return(NULL);
 }
+
+
+/**
+ * Lockstep loop: simulation steps are run back to back, without waiting
+ * for the wall clock. sys_time only depends on the simulated steps, so
+ * the results are the same at any speed.
+ * FlightGear and Ivy display outputs are sent from this loop at the same
+ * simulated rates as the real time threads.
+ */
+void nps_main_lockstep_loop(void)
+{
+  struct timespec start, end;
+  double fg_time = 0.;
+
+  if (nps_main.fg_host) {
+    nps_flightgear_init(nps_main.fg_host, nps_main.fg_port, nps_main.fg_port_in, nps_main.fg_time_offset);
+  }
+  nps_ivy_init(nps_main.ivy_bus);
+
+  clock_get_current_time(&start);
+  while (nps_main.duration <= 0. || nps_main.sim_time < nps_main.duration) {
+    if (pauseSignal) {
+      char line[128];
+      printf("Press <enter> to continue (or CTRL-Z to suspend).\n");
+      if (fgets(line, 127, stdin) == NULL) {
+        break;
+      }
+      pauseSignal = 0;
+    }
+
+    if (nps_main.checkpoint >= 0. && nps_main.sim_time >= nps_main.checkpoint) {
+      nps_main.checkpoint = -1.;
+      if (!nps_main_checkpoint()) {
+        exit(0);
+      }
+    }
+
+    pthread_mutex_lock(&fdm_mutex);
+    nps_main_run_sim_step();
+    nps_main.sim_time += SIM_DT;
+    pthread_mutex_unlock(&fdm_mutex);
+
+    // fdm is only written by this thread, no copy needed
+    if (nps_main.fg_host && nps_main.sim_time >= fg_time) {
+      if (nps_main.fg_fdm) {
+        nps_flightgear_send_fdm();
+      } else {
+        nps_flightgear_send();
+      }
+      fg_time += DISPLAY_DT;
+    }
+    if (!nps_main.nodisplay && nps_main.sim_time >= nps_main.display_time) {
+      nps_ivy_display(&fdm, &sensors);
+      nps_main.display_time += 3 * DISPLAY_DT;
+    }
+  }
+  clock_get_current_time(&end);
+
+  double wall = ntime_to_double(&end) - ntime_to_double(&start);
+  printf("Simulated %.3f s in %.3f s (x%.1f)\n", nps_main.sim_time, wall, wall > 0. ? nps_main.sim_time / wall : 0.);
+}
+
+
+/**
+ * Options of a branch, from a line of the checkpoint input.
+ * Only the options that can change during a run are accepted.
+ */
+static void nps_main_parse_branch(char *line)
+{
+  char *save = NULL;
+  char *opt = strtok_r(line, " \t\n", &save);
+  while (opt != NULL) {
+    char *arg = strtok_r(NULL, " \t\n", &save);
+    if (arg == NULL) {
+      printf("Branch %d: missing argument for %s\n", nps_main.branch, opt);
+      break;
+    }
+    if (strcmp(opt, "--seed") == 0) {
+      nps_main.seed = strtoul(arg, NULL, 10);
+    } else if (strcmp(opt, "--noise_scale") == 0) {
+      nps_main.noise_scale = atof(arg);
+    } else if (strcmp(opt, "--wind_speed") == 0) {
+      nps_main.wind_speed = atof(arg);
+    } else if (strcmp(opt, "--wind_dir") == 0) {
+      nps_main.wind_dir = atof(arg);
+    } else if (strcmp(opt, "--turbulence") == 0) {
+      nps_main.turbulence = atoi(arg);
+    } else if (strcmp(opt, "--duration") == 0) {
+      nps_main.duration = atof(arg);
+    } else if (strcmp(opt, "--results") == 0) {
+      nps_main.results = strdup(arg);
+    } else {
+      printf("Branch %d: ignoring option %s\n", nps_main.branch, opt);
+    }
+    opt = strtok_r(NULL, " \t\n", &save);
+  }
+}
+
+/**
+ * Checkpoint of the whole simulation (FDM, sensors including random walks
+ * and delay buffers, atmosphere and autopilot) as a copy on write image of
+ * this process.
+ *
+ * The checkpoint process stops processing Ivy messages and reads branch
+ * requests on stdin, one line of options per branch (see
+ * nps_main_parse_branch), e.g. "--seed 3 --wind_speed 5 --results out.json".
+ * Each request forks a process which continues the simulation from the
+ * checkpoint with these options. Up to checkpoint_jobs branches run in
+ * parallel, the checkpoint exits when stdin is closed and all the
+ * branches are finished.
+ *
+ * Only the calling thread is duplicated: when branches are run one at a
+ * time, each one processes the Ivy messages again. Parallel branches share
+ * the Ivy and FlightGear sockets and should run without display on a
+ * private Ivy bus. They don't publish in shared memory.
+ *
+ * @return true in a branch, false in the checkpoint process when it is done
+ */
+bool nps_main_checkpoint(void)
+{
+  char line[512];
+  int running = 0;
+  int nb = 0;
+  int status;
+
+  nps_ivy_stop();
+  printf("Checkpoint at %.3f s, waiting for branches on stdin\n", nps_main.sim_time);
+  while (fgets(line, sizeof(line), stdin) != NULL) {
+    if (strspn(line, " \t\n") == strlen(line)) {
+      continue;
+    }
+    if (running >= nps_main.checkpoint_jobs) {
+      if (wait(&status) > 0) {
+        running--;
+      }
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      break;
+    }
+    if (pid == 0) {
+      // branch: continue from the checkpoint with the new options
+      int null_fd = open("/dev/null", O_RDONLY);
+      if (null_fd >= 0) {
+        dup2(null_fd, STDIN_FILENO);
+        close(null_fd);
+      }
+      nps_main.branch = nb;
+      nps_main_parse_branch(line);
+      nps_random_init(nps_main.seed, nps_main.noise_scale);
+      nps_main_set_environment();
+      if (nps_main.results && !nps_results.enabled) {
+        nps_results_init();
+      }
+      if (nps_main.checkpoint_jobs == 1) {
+        nps_ivy_resume();
+      } else {
+        // parallel branches would write in the same ring
+        nps_shm_close();
+      }
+      printf("Branch %d started at %.3f s\n", nb, nps_main.sim_time);
+      return true;
+    }
+    nb++;
+    running++;
+  }
+  while (running > 0 && wait(&status) > 0) {
+    running--;
+  }
+  printf("Checkpoint done, %d branches\n", nb);
+  return false;
+}
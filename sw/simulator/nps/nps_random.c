@@ -1,290 +1,232 @@
 #include "nps_random.h"
 
-
 #include <math.h>
-#include <limits.h>
-
 
-#if 0
 /*
- * R250
- * Kirkpatrick, S., and E. Stoll, 1981; "A Very Fast
- * Shift-Register Sequence Random Number Generator",
- * Journal of Computational Physics, V.40
+ * Philox4x32-10 counter based generator
+ * Salmon, Moraes, Dror, Shaw, 2011; "Parallel Random Numbers: As Easy as 1, 2, 3"
+ * Proceedings of SC11
  *
+ * The output block is a keyed bijection of the counter, any stream can be
+ * positioned without generating the previous numbers and streams with
+ * different keys or sub-stream numbers are independent.
  */
 
-static void         r250_init(int seed);
-//static unsigned int r250( void );
-static double       dr250(void);
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+
+static void philox4x32_10(uint32_t out[4], const uint32_t ctr[4], const uint32_t key[2])
+{
+  uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int i = 0; i < 10; i++) {
+    uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+    uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+    c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+    c1 = (uint32_t)p1;
+    c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+    c3 = (uint32_t)p0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
 
 /*
- * randclg
- * Linear Congruential Method, the "minimal standard generator"
- * Park & Miller, 1988, Comm of the ACM, 31(10), pp. 1192-1201
+ * Ziggurat method, 256 layers on 52 bits
+ * Marsaglia, G., and W. W. Tsang, 2000; "The Ziggurat Method for
+ * Generating Random Variables", Journal of Statistical Software, 5(8)
  *
+ * Layer index, sign and abscissa come from separate bits of one 64 bits
+ * draw, about 99% of the samples only need a table lookup and a compare.
  */
 
-static long              set_seed(long);
-//static long              get_seed(void);
-static unsigned long int randlcg(void);
-#endif
+#define ZIG_N 256
+#define ZIG_R 3.6541528853610088    ///< start of the tail
+#define ZIG_V 0.00492867323399      ///< area of each layer
+#define ZIG_M 4503599627370496.     ///< 2^52
 
+static uint64_t zig_k[ZIG_N];
+static double zig_w[ZIG_N];
+static double zig_f[ZIG_N];
+static bool zig_ready = false;
 
-void double_vect3_add_gaussian_noise(struct DoubleVect3 *vect, struct DoubleVect3 *std_dev)
+static void zig_init(void)
 {
-  vect->x += get_gaussian_noise() * std_dev->x;
-  vect->y += get_gaussian_noise() * std_dev->y;
-  vect->z += get_gaussian_noise() * std_dev->z;
+  double dn = ZIG_R, tn = ZIG_R;
+  const double q = ZIG_V / exp(-0.5 * dn * dn);
+  zig_k[0] = (uint64_t)((dn / q) * ZIG_M);
+  zig_k[1] = 0;
+  zig_w[0] = q / ZIG_M;
+  zig_w[ZIG_N - 1] = dn / ZIG_M;
+  zig_f[0] = 1.;
+  zig_f[ZIG_N - 1] = exp(-0.5 * dn * dn);
+  for (int i = ZIG_N - 2; i >= 1; i--) {
+    dn = sqrt(-2. * log(ZIG_V / dn + exp(-0.5 * dn * dn)));
+    zig_k[i + 1] = (uint64_t)((dn / tn) * ZIG_M);
+    tn = dn;
+    zig_f[i] = exp(-0.5 * dn * dn);
+    zig_w[i] = dn / ZIG_M;
+  }
+  zig_ready = true;
 }
 
-void float_vect3_add_gaussian_noise(struct FloatVect3 *vect, struct FloatVect3 *std_dev)
+static uint64_t seed_mix = 0;
+static double noise_scale = 1.;
+/** stream used by the functions without stream argument */
+static struct NpsRandom default_stream = { 0, 0, 0, { 0, 0, 0, 0 }, 4 };
+
+/** splitmix64 finalizer */
+static uint64_t mix64(uint64_t x)
 {
-  vect->x += get_gaussian_noise() * std_dev->x;
-  vect->y += get_gaussian_noise() * std_dev->y;
-  vect->z += get_gaussian_noise() * std_dev->z;
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
 }
 
-void float_rates_add_gaussian_noise(struct FloatRates *vect, struct FloatRates *std_dev)
+void nps_random_init(unsigned long seed, double scale)
 {
-  vect->p += get_gaussian_noise() * std_dev->p;
-  vect->q += get_gaussian_noise() * std_dev->q;
-  vect->r += get_gaussian_noise() * std_dev->r;
+  seed_mix = mix64(seed);
+  noise_scale = scale;
+  if (!zig_ready) { zig_init(); }
 }
 
-
-
-void double_vect3_get_gaussian_noise(struct DoubleVect3 *vect, struct DoubleVect3 *std_dev)
+void nps_random_stream_init(struct NpsRandom *s, const char *name, uint32_t sub)
 {
-  vect->x = get_gaussian_noise() * std_dev->x;
-  vect->y = get_gaussian_noise() * std_dev->y;
-  vect->z = get_gaussian_noise() * std_dev->z;
+  // FNV-1a hash of the name
+  uint32_t h = 2166136261U;
+  for (const char *c = name; *c != '\0'; c++) {
+    h = (h ^ (uint8_t)(*c)) * 16777619U;
+  }
+  s->id = h;
+  s->sub = sub;
+  s->counter = 0;
+  s->idx = 4;
 }
 
-
-void double_vect3_update_random_walk(struct DoubleVect3 *rw, struct DoubleVect3 *std_dev, double dt, double thau)
+void nps_random_vect3_init(struct NpsRandomVect3 *r, const char *name)
 {
-  struct DoubleVect3 drw;
-  double_vect3_get_gaussian_noise(&drw, std_dev);
-  struct DoubleVect3 tmp;
-  VECT3_SMUL(tmp, *rw, (-1. / thau));
-  VECT3_ADD(drw, tmp);
-  VECT3_SMUL(drw, drw, dt);
-  VECT3_ADD(*rw, drw);
+  for (uint32_t i = 0; i < 3; i++) {
+    nps_random_stream_init(&r->axis[i], name, i);
+  }
 }
 
-
-
-
-
-#if 0
-/*
-   http://www.taygeta.com/random/gaussian.html
-*/
-double get_gaussian_noise(void)
+uint64_t nps_random_u64(struct NpsRandom *s)
 {
-
-  double x1;
-  static int nb_call = 0;
-  static double x2, w;
-  if (nb_call == 0) { r250_init(0); }
-  nb_call++;
-  if (nb_call % 2) {
-    do {
-      x1 = 2.0 * dr250() - 1.0;
-      x2 = 2.0 * dr250() - 1.0;
-      w = x1 * x1 + x2 * x2;
-    } while (w >= 1.0);
-
-    w = sqrt((-2.0 * log(w)) / w);
-    return x1 * w;
-  } else {
-    return x2 * w;
+  if (s->idx >= 4) {
+    const uint32_t ctr[4] = { (uint32_t)s->counter, (uint32_t)(s->counter >> 32), s->sub, 0 };
+    const uint32_t key[2] = { s->id ^ (uint32_t)seed_mix, (uint32_t)(seed_mix >> 32) };
+    philox4x32_10(s->block, ctr, key);
+    s->counter++;
+    s->idx = 0;
   }
+  uint64_t v = (uint64_t)s->block[s->idx] | ((uint64_t)s->block[s->idx + 1] << 32);
+  s->idx += 2;
+  return v;
 }
-#else
-#include <gsl/gsl_rng.h>
-#include <gsl/gsl_randist.h>
-#include <stdlib.h>
-double get_gaussian_noise(void)
+
+double nps_random_uniform(struct NpsRandom *s)
 {
-  static gsl_rng *r = NULL;
-  // select random number generator
-  if (!r) { r = gsl_rng_alloc(gsl_rng_mt19937); }
-  return gsl_ran_gaussian(r, 1.);
+  return (nps_random_u64(s) >> 11) * (1. / 9007199254740992.);
 }
-#endif
-
 
-#if 0
-/*
- * R250
- * Kirkpatrick, S., and E. Stoll, 1981; "A Very Fast
- * Shift-Register Sequence Random Number Generator",
- * Journal of Computational Physics, V.40
- *
- */
-
-/* defines to allow for 16 or 32 bit integers */
-#define BITS 31
-
-
-#if WORD_BIT == 32
-#ifndef BITS
-#define BITS  32
-#endif
-#else
-#ifndef BITS
-#define BITS    16
-#endif
-#endif
-
-#if BITS == 31
-#define MSB          0x40000000L
-#define ALL_BITS     0x7fffffffL
-#define HALF_RANGE   0x20000000L
-#define STEP         7
-#endif
-
-#if BITS == 32
-#define MSB          0x80000000L
-#define ALL_BITS     0xffffffffL
-#define HALF_RANGE   0x40000000L
-#define STEP         7
-#endif
-
-#if BITS == 16
-#define MSB         0x8000
-#define ALL_BITS    0xffff
-#define HALF_RANGE  0x4000
-#define STEP        11
-#endif
-
-static unsigned int r250_buffer[ 250 ];
-static int r250_index;
-
-static void r250_init(int sd)
+double nps_random_gaussian(struct NpsRandom *s)
 {
-  int j, k;
-  unsigned int mask, msb;
-  set_seed(sd);
-
-  r250_index = 0;
-  for (j = 0; j < 250; j++) {    /* fill r250 buffer with BITS-1 bit values */
-    r250_buffer[j] = randlcg();
-  }
-
-  for (j = 0; j < 250; j++) /* set some MSBs to 1 */
-    if (randlcg() > HALF_RANGE) {
-      r250_buffer[j] |= MSB;
+  if (!zig_ready) { zig_init(); }
+  for (;;) {
+    uint64_t r = nps_random_u64(s);
+    const int i = r & 0xff;
+    r >>= 8;
+    const bool neg = r & 1;
+    const uint64_t rabs = (r >> 1) & 0x000fffffffffffffULL;
+    const double x = neg ? -(rabs * zig_w[i]) : rabs * zig_w[i];
+    if (rabs < zig_k[i]) {
+      return x;
+    }
+    if (i == 0) {
+      // tail beyond ZIG_R
+      double xt, yt;
+      do {
+        xt = -log1p(-nps_random_uniform(s)) / ZIG_R;
+        yt = -log1p(-nps_random_uniform(s));
+      } while (yt + yt < xt * xt);
+      return neg ? -(ZIG_R + xt) : ZIG_R + xt;
+    }
+    if (zig_f[i] + nps_random_uniform(s) * (zig_f[i - 1] - zig_f[i]) < exp(-0.5 * x * x)) {
+      return x;
     }
-
-  msb = MSB;          /* turn on diagonal bit */
-  mask = ALL_BITS;  /* turn off the leftmost bits */
-
-  for (j = 0; j < BITS; j++)  {
-    k = STEP * j + 3; /* select a word to operate on */
-    r250_buffer[k] &= mask; /* turn off bits left of the diagonal */
-    r250_buffer[k] |= msb;  /* turn on the diagonal bit */
-    mask >>= 1;
-    msb  >>= 1;
   }
-
 }
 
-#if 0
-/* returns a random unsigned integer */
-static unsigned int r250(void)
+double nps_random_noise(struct NpsRandom *s)
 {
-  register int  j;
-  register unsigned int new_rand;
-
-  if (r250_index >= 147) {
-    j = r250_index - 147;  /* wrap pointer around */
-  } else {
-    j = r250_index + 103;
-  }
-
-  new_rand = r250_buffer[ r250_index ] ^ r250_buffer[ j ];
-  r250_buffer[ r250_index ] = new_rand;
-
-  if (r250_index >= 249) { /* increment pointer for next time */
-    r250_index = 0;
-  } else {
-    r250_index++;
-  }
-
-  return new_rand;
-
+  return noise_scale * nps_random_gaussian(s);
 }
-#endif
 
-/* returns a random double in range 0..1 */
-static double dr250(void)
+void nps_random_vect3_add_noise(struct NpsRandomVect3 *r, struct DoubleVect3 *vect, struct DoubleVect3 *std_dev)
 {
-  register int  j;
-  register unsigned int new_rand;
-
-  if (r250_index >= 147) {
-    j = r250_index - 147;  /* wrap pointer around */
-  } else {
-    j = r250_index + 103;
-  }
-
-  new_rand = r250_buffer[ r250_index ] ^ r250_buffer[ j ];
-  r250_buffer[ r250_index ] = new_rand;
-
-  if (r250_index >= 249) { /* increment pointer for next time */
-    r250_index = 0;
-  } else {
-    r250_index++;
-  }
-
-  return (double)new_rand / ALL_BITS;
-
+  vect->x += nps_random_noise(&r->axis[0]) * std_dev->x;
+  vect->y += nps_random_noise(&r->axis[1]) * std_dev->y;
+  vect->z += nps_random_noise(&r->axis[2]) * std_dev->z;
 }
 
-/*
- * randclg
- * Linear Congruential Method, the "minimal standard generator"
- * Park & Miller, 1988, Comm of the ACM, 31(10), pp. 1192-1201
- *
- */
-
-static long int quotient  = LONG_MAX / 16807L;
-static long int my_remainder = LONG_MAX % 16807L;
-
-static long int seed_val = 1L;
-
-static long set_seed(long int sd)
+void nps_random_vect3_update_random_walk(struct NpsRandomVect3 *r, struct DoubleVect3 *rw,
+    struct DoubleVect3 *std_dev, double dt, double thau)
 {
-  return seed_val = sd;
+  struct DoubleVect3 drw;
+  VECT3_SMUL(drw, *rw, (-1. / thau));
+  nps_random_vect3_add_noise(r, &drw, std_dev);
+  VECT3_SMUL(drw, drw, dt);
+  VECT3_ADD(*rw, drw);
 }
 
-//static long get_seed(void) {
-//  return seed_val;
-//}
 
-/* returns a random unsigned integer */
-unsigned long int randlcg()
+double get_gaussian_noise(void)
 {
-  if (seed_val <= quotient) {
-    seed_val = (seed_val * 16807L) % LONG_MAX;
-  } else {
-    long int high_part = seed_val / quotient;
-    long int low_part  = seed_val % quotient;
+  return nps_random_noise(&default_stream);
+}
 
-    long int test = 16807L * low_part - my_remainder * high_part;
+void double_vect3_add_gaussian_noise(struct DoubleVect3 *vect, struct DoubleVect3 *std_dev)
+{
+  vect->x += get_gaussian_noise() * std_dev->x;
+  vect->y += get_gaussian_noise() * std_dev->y;
+  vect->z += get_gaussian_noise() * std_dev->z;
+}
 
-    if (test > 0) {
-      seed_val = test;
-    } else {
-      seed_val = test + LONG_MAX;
-    }
+void float_vect3_add_gaussian_noise(struct FloatVect3 *vect, struct FloatVect3 *std_dev)
+{
+  vect->x += get_gaussian_noise() * std_dev->x;
+  vect->y += get_gaussian_noise() * std_dev->y;
+  vect->z += get_gaussian_noise() * std_dev->z;
+}
 
-  }
+void float_rates_add_gaussian_noise(struct FloatRates *vect, struct FloatRates *std_dev)
+{
+  vect->p += get_gaussian_noise() * std_dev->p;
+  vect->q += get_gaussian_noise() * std_dev->q;
+  vect->r += get_gaussian_noise() * std_dev->r;
+}
 
-  return seed_val;
+void double_vect3_get_gaussian_noise(struct DoubleVect3 *vect, struct DoubleVect3 *std_dev)
+{
+  vect->x = get_gaussian_noise() * std_dev->x;
+  vect->y = get_gaussian_noise() * std_dev->y;
+  vect->z = get_gaussian_noise() * std_dev->z;
 }
 
-#endif /* 0*/
+void double_vect3_update_random_walk(struct DoubleVect3 *rw, struct DoubleVect3 *std_dev, double dt, double thau)
+{
+  struct DoubleVect3 drw;
+  double_vect3_get_gaussian_noise(&drw, std_dev);
+  struct DoubleVect3 tmp;
+  VECT3_SMUL(tmp, *rw, (-1. / thau));
+  VECT3_ADD(drw, tmp);
+  VECT3_SMUL(drw, drw, dt);
+  VECT3_ADD(*rw, drw);
+}
@@ -3,6 +3,56 @@
 
 #include "math/pprz_algebra_double.h"
 
+/**
+ * Counter based random stream (Philox4x32-10).
+ *
+ * Each stream is identified by a name (e.g. the sensor) and a sub-stream
+ * number (e.g. the axis), the numbers drawn from it only depend on the
+ * seed, its identity and how many numbers it already produced. Adding a
+ * sensor or changing the call order doesn't change the other streams.
+ * The key is derived from the current seed for each block, so reseeding
+ * with nps_random_init also changes the streams already initialized.
+ */
+struct NpsRandom {
+  uint32_t id;        ///< hash of the stream name
+  uint32_t sub;       ///< sub-stream number
+  uint64_t counter;   ///< next block
+  uint32_t block[4];  ///< current output block
+  uint8_t idx;        ///< next unused word of block
+};
+
+/** One independent stream per axis */
+struct NpsRandomVect3 {
+  struct NpsRandom axis[3];
+};
+
+/** Seed the noise generator and scale all the sensor noises
+ * @param seed random seed, runs with the same seed are identical
+ * @param scale factor applied to all the gaussian noises
+ */
+extern void nps_random_init(unsigned long seed, double scale);
+
+/** Initialize a stream
+ * @param name stream name, unique for each user
+ * @param sub sub-stream number
+ */
+extern void nps_random_stream_init(struct NpsRandom *s, const char *name, uint32_t sub);
+extern void nps_random_vect3_init(struct NpsRandomVect3 *r, const char *name);
+
+extern uint64_t nps_random_u64(struct NpsRandom *s);
+/** Uniform in [0, 1) */
+extern double nps_random_uniform(struct NpsRandom *s);
+/** Standard normal (ziggurat) */
+extern double nps_random_gaussian(struct NpsRandom *s);
+
+/** Sensor noise: standard normal multiplied by the global noise scale */
+extern double nps_random_noise(struct NpsRandom *s);
+extern void nps_random_vect3_add_noise(struct NpsRandomVect3 *r, struct DoubleVect3 *vect,
+                                       struct DoubleVect3 *std_dev);
+extern void nps_random_vect3_update_random_walk(struct NpsRandomVect3 *r, struct DoubleVect3 *rw,
+    struct DoubleVect3 *std_dev, double dt, double thau);
+
+/* functions below draw from a single default stream */
 extern double get_gaussian_noise(void);
 extern void double_vect3_add_gaussian_noise(struct DoubleVect3 *vect, struct DoubleVect3 *std_dev);
 extern void double_vect3_get_gaussian_noise(struct DoubleVect3 *vect, struct DoubleVect3 *std_dev);
@@ -15,4 +65,3 @@ extern void float_rates_add_gaussian_noise(struct FloatRates *vect, struct Float
 
 
 #endif /* NPS_RANDOM_H */
-
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_results.c
+ * Metrics of a simulation run.
+ *
+ * A crash is detected when the vehicle is close to the ground (FDM agl,
+ * not available with CRRCSIM) with a high vertical speed or a high tilt.
+ */
+
+#include "nps_results.h"
+#include "nps_fdm.h"
+#include "nps_autopilot.h"
+#include "autopilot.h"
+#include "state.h"
+
+#include <stdio.h>
+#include <math.h>
+
+/** Metrics sampling period (s) */
+#ifndef NPS_RESULTS_DT
+#define NPS_RESULTS_DT 0.02
+#endif
+
+/** Horizontal tracking error threshold for the settling time (m) */
+#ifndef NPS_RESULTS_SETTLE_ERROR
+#define NPS_RESULTS_SETTLE_ERROR 1.0
+#endif
+
+/** Height above ground below which a crash can be detected (m) */
+#ifndef NPS_RESULTS_CRASH_AGL
+#define NPS_RESULTS_CRASH_AGL 0.5
+#endif
+
+/** Vertical speed at ground contact considered as a crash (m/s) */
+#ifndef NPS_RESULTS_CRASH_SPEED
+#define NPS_RESULTS_CRASH_SPEED 3.0
+#endif
+
+/** Tilt angle on the ground considered as a crash (rad) */
+#ifndef NPS_RESULTS_CRASH_TILT
+#define NPS_RESULTS_CRASH_TILT RadOfDeg(60.)
+#endif
+
+struct NpsResults nps_results;
+
+static double next_sample;
+
+void nps_results_init(void)
+{
+  nps_results.enabled = true;
+  nps_results.start_time = -1.;
+  nps_results.last_above = -1.;
+  nps_results.nb = 0;
+  nps_results.track_sum2 = 0.;
+  nps_results.track_max = 0.;
+  nps_results.est_sum2 = 0.;
+  nps_results.est_max = 0.;
+  nps_results.tilt_max = 0.;
+  nps_results.crash_time = -1.;
+  next_sample = 0.;
+}
+
+bool nps_results_update(double time)
+{
+  if (!nps_results.enabled || time < next_sample) {
+    return true;
+  }
+  next_sample += NPS_RESULTS_DT;
+
+  // tilt from the z axis of the body frame
+  const struct DoubleEulers *e = &fdm.ltp_to_body_eulers;
+  const double tilt = acos(Min(Max(cos(e->phi) * cos(e->theta), -1.), 1.));
+  if (fdm.agl < NPS_RESULTS_CRASH_AGL &&
+      (fdm.ltp_ecef_vel.z > NPS_RESULTS_CRASH_SPEED || tilt > NPS_RESULTS_CRASH_TILT)) {
+    nps_results.crash_time = time;
+    nps_results.enabled = false;
+    return false;
+  }
+
+  if (!autopilot_in_flight()) {
+    return true;
+  }
+  if (nps_results.start_time < 0.) {
+    nps_results.start_time = time;
+  }
+
+  struct FloatVect3 err;
+  nps_autopilot_nav_error(&err);
+  const double track_h = sqrt(err.x * err.x + err.y * err.y);
+  const double track = sqrt(track_h * track_h + err.z * err.z);
+  if (track_h > NPS_RESULTS_SETTLE_ERROR) {
+    nps_results.last_above = time;
+  }
+
+  struct NedCoor_f *pos = stateGetPositionNed_f();
+  const double ex = pos->x - fdm.ltpprz_pos.x;
+  const double ey = pos->y - fdm.ltpprz_pos.y;
+  const double ez = pos->z - fdm.ltpprz_pos.z;
+  const double est = sqrt(ex * ex + ey * ey + ez * ez);
+
+  nps_results.nb++;
+  nps_results.track_sum2 += track * track;
+  nps_results.track_max = Max(nps_results.track_max, track);
+  nps_results.est_sum2 += est * est;
+  nps_results.est_max = Max(nps_results.est_max, est);
+  nps_results.tilt_max = Max(nps_results.tilt_max, tilt);
+  return true;
+}
+
+void nps_results_write(const char *filename, double duration)
+{
+  FILE *f = fopen(filename, "a");
+  if (f == NULL) {
+    printf("Can't write results to %s\n", filename);
+    return;
+  }
+  const double n = nps_results.nb > 0 ? nps_results.nb : 1.;
+  double settling = -1.;
+  if (nps_results.start_time >= 0.) {
+    settling = nps_results.last_above < 0. ? 0. : nps_results.last_above - nps_results.start_time;
+  }
+  fprintf(f, "{\"duration\": %.3f, \"crash\": %d, \"crash_time\": %.3f, \"flight_time\": %.3f, "
+          "\"track_rms\": %.4f, \"track_max\": %.4f, \"settling_time\": %.3f, "
+          "\"est_rms\": %.4f, \"est_max\": %.4f, \"tilt_max\": %.2f}\n",
+          duration, nps_results.crash_time >= 0. ? 1 : 0, nps_results.crash_time,
+          nps_results.start_time >= 0. ? duration - nps_results.start_time : 0.,
+          sqrt(nps_results.track_sum2 / n), nps_results.track_max, settling,
+          sqrt(nps_results.est_sum2 / n), nps_results.est_max, DegOfRad(nps_results.tilt_max));
+  fclose(f);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_results.h
+ * Metrics of a simulation run, for batch runs (see sw/simulator/nps_campaign.py).
+ *
+ * While the autopilot is in flight, the navigation tracking error, the
+ * estimation error (estimated against true position) and the settling time
+ * are computed from the simulated data. A crash stops the run.
+ * The results are written as one JSON line at the end of the run.
+ */
+
+#ifndef NPS_RESULTS_H
+#define NPS_RESULTS_H
+
+#include "std.h"
+
+struct NpsResults {
+  bool enabled;
+  double start_time;      ///< first time in flight, -1 if never
+  double last_above;      ///< last time the horizontal tracking error was above the settling threshold
+  uint32_t nb;            ///< number of in flight samples
+  double track_sum2;
+  double track_max;
+  double est_sum2;
+  double est_max;
+  double tilt_max;        ///< max tilt angle in flight (rad)
+  double crash_time;      ///< time of the crash, -1 if none
+};
+
+extern struct NpsResults nps_results;
+
+extern void nps_results_init(void);
+
+/** Update the metrics, called after each simulation step
+ * @return false if the run must stop (crash)
+ */
+extern bool nps_results_update(double time);
+
+/** Write the results in a file (one JSON line)
+ * @param filename output file, appended
+ * @param duration simulated time
+ */
+extern void nps_results_write(const char *filename, double duration);
+
+#endif /* NPS_RESULTS_H */
@@ -20,6 +20,7 @@ void nps_sensor_accel_init(struct NpsSensorAccel *accel, double time)
                NPS_ACCEL_NOISE_STD_DEV_X, NPS_ACCEL_NOISE_STD_DEV_Y, NPS_ACCEL_NOISE_STD_DEV_Z);
   VECT3_ASSIGN(accel->bias,
                NPS_ACCEL_BIAS_X, NPS_ACCEL_BIAS_Y, NPS_ACCEL_BIAS_Z);
+  nps_random_vect3_init(&accel->noise_rng, "accel");
   accel->next_update = time;
   accel->data_available = FALSE;
 }
@@ -43,7 +44,7 @@ void nps_sensor_accel_run_step(struct NpsSensorAccel *accel, double time, struct
   /* constant bias */
   VECT3_COPY(accelero_error, accel->bias);
   /* white noise   */
-  double_vect3_add_gaussian_noise(&accelero_error, &accel->noise_std_dev);
+  nps_random_vect3_add_noise(&accel->noise_rng, &accelero_error, &accel->noise_std_dev);
   /* scale */
   struct DoubleVect3 gain = {accel->sensitivity.m[0], accel->sensitivity.m[4], accel->sensitivity.m[8]};
   VECT3_EW_MUL(accelero_error, accelero_error, gain);
@@ -5,6 +5,7 @@
 #include "math/pprz_algebra_double.h"
 #include "math/pprz_algebra_float.h"
 #include "std.h"
+#include "nps_random.h"
 
 struct NpsSensorAccel {
   struct DoubleVect3  value;
@@ -14,6 +15,7 @@ struct NpsSensorAccel {
   struct DoubleVect3  neutral;
   struct DoubleVect3  noise_std_dev;
   struct DoubleVect3  bias;
+  struct NpsRandomVect3 noise_rng;
   double       next_update;
   bool       data_available;
 };
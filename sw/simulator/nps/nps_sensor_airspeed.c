@@ -55,6 +55,7 @@ void nps_sensor_airspeed_init(struct NpsSensorAirspeed *airspeed, double time)
   airspeed->value = 0.;
   airspeed->offset = NPS_AIRSPEED_OFFSET;
   airspeed->noise_std_dev = NPS_AIRSPEED_NOISE_STD_DEV;
+  nps_random_stream_init(&airspeed->noise_rng, "airspeed", 0);
   airspeed->next_update = time;
   airspeed->data_available = FALSE;
 }
@@ -70,7 +71,7 @@ void nps_sensor_airspeed_run_step(struct NpsSensorAirspeed *airspeed, double tim
   /* equivalent airspeed + sensor offset */
   airspeed->value = fdm.airspeed + airspeed->offset;
   /* add noise with std dev meters/second */
-  airspeed->value += get_gaussian_noise() * airspeed->noise_std_dev;
+  airspeed->value += nps_random_noise(&airspeed->noise_rng) * airspeed->noise_std_dev;
   /* can't be negative, min is zero */
   if (airspeed->value < 0) {
     airspeed->value = 0.0;
@@ -54,6 +54,7 @@ void nps_sensor_aoa_init(struct NpsSensorAngleOfAttack *aoa, double time)
   aoa->value = 0.;
   aoa->offset = NPS_AOA_OFFSET;
   aoa->noise_std_dev = NPS_AOA_NOISE_STD_DEV;
+  nps_random_stream_init(&aoa->noise_rng, "aoa", 0);
   aoa->next_update = time;
   aoa->data_available = FALSE;
 }
@@ -69,7 +70,7 @@ void nps_sensor_aoa_run_step(struct NpsSensorAngleOfAttack *aoa, double time)
   /* equivalent airspeed + sensor offset */
   aoa->value = fdm.aoa + aoa->offset;
   /* add noise with std dev rad */
-  aoa->value += get_gaussian_noise() * aoa->noise_std_dev;
+  aoa->value += nps_random_noise(&aoa->noise_rng) * aoa->noise_std_dev;
 
   aoa->next_update += NPS_AOA_DT;
   aoa->data_available = TRUE;
@@ -32,11 +32,13 @@
 #include "math/pprz_algebra_double.h"
 #include "math/pprz_algebra_float.h"
 #include "std.h"
+#include "nps_random.h"
 
 struct NpsSensorAngleOfAttack {
   double value;          ///< angle of attack reading in radian
   double offset;         ///< offset in meters/second
   double noise_std_dev;  ///< noise standard deviation
+  struct NpsRandom noise_rng; ///< noise stream
   double next_update;
   bool data_available;
 };
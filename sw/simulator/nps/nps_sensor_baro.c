@@ -15,6 +15,7 @@ void nps_sensor_baro_init(struct NpsSensorBaro *baro, double time)
 {
   baro->value = 0.;
   baro->noise_std_dev = NPS_BARO_NOISE_STD_DEV;
+  nps_random_stream_init(&baro->noise_rng, "baro", 0);
   baro->next_update = time;
   baro->data_available = FALSE;
 }
@@ -29,7 +30,7 @@ void nps_sensor_baro_run_step(struct NpsSensorBaro *baro, double time)
   /* pressure in Pascal */
   baro->value = fdm.pressure;
   /* add noise with std dev Pascal */
-  baro->value += get_gaussian_noise() * baro->noise_std_dev;
+  baro->value += nps_random_noise(&baro->noise_rng) * baro->noise_std_dev;
 
   baro->next_update += NPS_BARO_DT;
   baro->data_available = TRUE;
@@ -4,7 +4,6 @@
 #include "generated/airframe.h"
 #include "nps_fdm.h"
 #include "nps_random.h"
-#include "nps_sensors_utils.h"
 #include NPS_SENSORS_PARAMS
 
 void nps_sensor_gps_init(struct NpsSensorGps *gps, double time)
@@ -25,10 +24,29 @@ void nps_sensor_gps_init(struct NpsSensorGps *gps, double time)
                NPS_GPS_POS_BIAS_RANDOM_WALK_STD_DEV_Y,
                NPS_GPS_POS_BIAS_RANDOM_WALK_STD_DEV_Z);
   FLOAT_VECT3_ZERO(gps->pos_bias_random_walk_value);
+  nps_random_vect3_init(&gps->pos_noise_rng, "gps_pos");
+  nps_random_vect3_init(&gps->speed_noise_rng, "gps_speed");
+  nps_random_vect3_init(&gps->pos_bias_rng, "gps_pos_bias");
+  gps->pos_history = NULL;
+  gps->speed_history = NULL;
   gps->next_update = time;
+  gps->next_pos_sample = time - gps->pos_latency;
+  gps->next_speed_sample = time - gps->speed_latency;
   gps->data_available = FALSE;
 }
 
+/** Position reading, reported pos_latency after it is sampled */
+struct NpsGpsPosReading {
+  struct EcefCoor_d ecef_pos;
+  struct LlaCoor_d lla_pos;
+  double hmsl;
+};
+
+double nps_sensor_gps_next_event(struct NpsSensorGps *gps)
+{
+  return Min(gps->next_update, Min(gps->next_pos_sample, gps->next_speed_sample));
+}
+
 /*
  * WARNING!
  * noise and bias is currently added in ECEF frame
@@ -38,59 +56,71 @@ void nps_sensor_gps_init(struct NpsSensorGps *gps, double time)
 
 void nps_sensor_gps_run_step(struct NpsSensorGps *gps, double time)
 {
-  if (time < gps->next_update) {
-    return;
-  }
-
   /*
-   * simulate speed sensor
+   * The readings are sampled at their latency before they are reported,
+   * so that the latency is exact whatever the update period
    */
-  struct DoubleVect3 cur_speed_reading;
-  VECT3_COPY(cur_speed_reading, fdm.ecef_ecef_vel);
-  /* add a gaussian noise */
-  double_vect3_add_gaussian_noise(&cur_speed_reading, &gps->speed_noise_std_dev);
-
-  /* store that for later and retrieve a previously stored data */
-  UpdateSensorLatency(time, &cur_speed_reading, &gps->speed_history, gps->speed_latency, &gps->ecef_vel);
-
 
   /*
-   * simulate position sensor
+   * simulate speed sensor
    */
-  /* compute gps error readings */
-  struct DoubleVect3 pos_error;
-  VECT3_COPY(pos_error, gps->pos_bias_initial);
-  /* add a gaussian noise */
-  double_vect3_add_gaussian_noise(&pos_error, &gps->pos_noise_std_dev);
-  /* update random walk bias and add it to error*/
-  double_vect3_update_random_walk(&gps->pos_bias_random_walk_value, &gps->pos_bias_random_walk_std_dev, NPS_GPS_DT, 5.);
-  VECT3_ADD(pos_error, gps->pos_bias_random_walk_value);
-
-  /* add error to current pos reading */
-  struct DoubleVect3 cur_pos_reading;
-  VECT3_COPY(cur_pos_reading, fdm.ecef_pos);
-  VECT3_ADD(cur_pos_reading, pos_error);
-
-  /* store that for later and retrieve a previously stored data */
-  UpdateSensorLatency(time, &cur_pos_reading, &gps->pos_history, gps->pos_latency, &gps->ecef_pos);
-
+  if (time >= gps->next_speed_sample) {
+    struct EcefCoor_d *speed = g_new(struct EcefCoor_d, 1);
+    VECT3_COPY(*speed, fdm.ecef_ecef_vel);
+    /* add a gaussian noise */
+    nps_random_vect3_add_noise(&gps->speed_noise_rng, (struct DoubleVect3 *)speed, &gps->speed_noise_std_dev);
+    gps->speed_history = g_slist_append(gps->speed_history, speed);
+    gps->next_speed_sample += NPS_GPS_DT;
+  }
 
   /*
-   * simulate lla pos
+   * simulate position sensor
    */
-  /* convert current ecef reading to lla */
-  struct LlaCoor_d cur_lla_reading;
-  lla_of_ecef_d(&cur_lla_reading, (struct EcefCoor_d *) &cur_pos_reading);
+  if (time >= gps->next_pos_sample) {
+    /* compute gps error readings */
+    struct DoubleVect3 pos_error;
+    VECT3_COPY(pos_error, gps->pos_bias_initial);
+    /* add a gaussian noise */
+    nps_random_vect3_add_noise(&gps->pos_noise_rng, &pos_error, &gps->pos_noise_std_dev);
+    /* update random walk bias and add it to error*/
+    nps_random_vect3_update_random_walk(&gps->pos_bias_rng, &gps->pos_bias_random_walk_value,
+                                        &gps->pos_bias_random_walk_std_dev, NPS_GPS_DT, 5.);
+    VECT3_ADD(pos_error, gps->pos_bias_random_walk_value);
+
+    /* add error to current pos reading */
+    struct NpsGpsPosReading *pos = g_new(struct NpsGpsPosReading, 1);
+    VECT3_COPY(pos->ecef_pos, fdm.ecef_pos);
+    VECT3_ADD(pos->ecef_pos, pos_error);
+    /* convert current ecef reading to lla */
+    lla_of_ecef_d(&pos->lla_pos, &pos->ecef_pos);
+    pos->hmsl = fdm.hmsl;
+    gps->pos_history = g_slist_append(gps->pos_history, pos);
+    gps->next_pos_sample += NPS_GPS_DT;
+  }
 
-  /* store that for later and retrieve a previously stored data */
-  UpdateSensorLatency(time, &cur_lla_reading, &gps->lla_history, gps->pos_latency, &gps->lla_pos);
+  if (time < gps->next_update) {
+    return;
+  }
 
-  double cur_hmsl_reading = fdm.hmsl;
-  UpdateSensorLatency_Single(time, &cur_hmsl_reading, &gps->hmsl_history, gps->pos_latency, &gps->hmsl);
+  /* report the oldest readings, sampled a latency ago */
+  if (gps->speed_history) {
+    GSList *first = gps->speed_history;
+    VECT3_COPY(gps->ecef_vel, *(struct EcefCoor_d *)first->data);
+    g_free(first->data);
+    gps->speed_history = g_slist_delete_link(gps->speed_history, first);
+  }
+  if (gps->pos_history) {
+    GSList *first = gps->pos_history;
+    struct NpsGpsPosReading *pos = (struct NpsGpsPosReading *)first->data;
+    VECT3_COPY(gps->ecef_pos, pos->ecef_pos);
+    gps->lla_pos = pos->lla_pos;
+    gps->hmsl = pos->hmsl;
+    g_free(pos);
+    gps->pos_history = g_slist_delete_link(gps->pos_history, first);
+  }
 
   gps->next_update += NPS_GPS_DT;
 #ifndef NPS_NO_GPS
   gps->data_available = TRUE;
 #endif
 }
-
@@ -9,6 +9,7 @@
 #include "math/pprz_geodetic_double.h"
 
 #include "std.h"
+#include "nps_random.h"
 
 struct NpsSensorGps {
   struct EcefCoor_d ecef_pos;
@@ -20,12 +21,15 @@ struct NpsSensorGps {
   struct DoubleVect3  pos_bias_initial;
   struct DoubleVect3  pos_bias_random_walk_std_dev;
   struct DoubleVect3  pos_bias_random_walk_value;
+  struct NpsRandomVect3 pos_noise_rng;
+  struct NpsRandomVect3 speed_noise_rng;
+  struct NpsRandomVect3 pos_bias_rng;
   double pos_latency;
   double speed_latency;
-  GSList *hmsl_history;
-  GSList *pos_history;
-  GSList *lla_history;
-  GSList *speed_history;
+  GSList *pos_history;      ///< position readings waiting for their latency
+  GSList *speed_history;    ///< speed readings waiting for their latency
+  double next_pos_sample;   ///< pos_latency before next_update
+  double next_speed_sample; ///< speed_latency before next_update
   double next_update;
   bool data_available;
 };
@@ -33,5 +37,7 @@ struct NpsSensorGps {
 
 extern void nps_sensor_gps_init(struct NpsSensorGps *gps, double time);
 extern void nps_sensor_gps_run_step(struct NpsSensorGps *gps, double time);
+/** Time of the next reading or sampling of the gps */
+extern double nps_sensor_gps_next_event(struct NpsSensorGps *gps);
 
 #endif /* NPS_SENSOR_GPS_H */
@@ -24,6 +24,8 @@ void  nps_sensor_gyro_init(struct NpsSensorGyro *gyro, double time)
                NPS_GYRO_BIAS_RANDOM_WALK_STD_DEV_Q,
                NPS_GYRO_BIAS_RANDOM_WALK_STD_DEV_R);
   FLOAT_VECT3_ZERO(gyro->bias_random_walk_value);
+  nps_random_vect3_init(&gyro->noise_rng, "gyro");
+  nps_random_vect3_init(&gyro->bias_rng, "gyro_bias");
   gyro->next_update = time;
   gyro->data_available = FALSE;
 }
@@ -45,9 +47,9 @@ void nps_sensor_gyro_run_step(struct NpsSensorGyro *gyro, double time, struct Do
   /* compute gyro error readings */
   struct DoubleVect3 gyro_error;
   VECT3_COPY(gyro_error, gyro->bias_initial);
-  double_vect3_add_gaussian_noise(&gyro_error, &gyro->noise_std_dev);
-  double_vect3_update_random_walk(&gyro->bias_random_walk_value, &gyro->bias_random_walk_std_dev,
-                                  NPS_GYRO_DT, 5.);
+  nps_random_vect3_add_noise(&gyro->noise_rng, &gyro_error, &gyro->noise_std_dev);
+  nps_random_vect3_update_random_walk(&gyro->bias_rng, &gyro->bias_random_walk_value,
+                                      &gyro->bias_random_walk_std_dev, NPS_GYRO_DT, 5.);
   VECT3_ADD(gyro_error, gyro->bias_random_walk_value);
 
   struct DoubleVect3 gain = {gyro->sensitivity.m[0], gyro->sensitivity.m[4], gyro->sensitivity.m[8]};
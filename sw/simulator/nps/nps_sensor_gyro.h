@@ -5,6 +5,7 @@
 #include "math/pprz_algebra_double.h"
 #include "math/pprz_algebra_float.h"
 #include "std.h"
+#include "nps_random.h"
 
 struct NpsSensorGyro {
   struct DoubleVect3  value;
@@ -16,6 +17,8 @@ struct NpsSensorGyro {
   struct DoubleVect3  bias_initial;
   struct DoubleVect3  bias_random_walk_std_dev;
   struct DoubleVect3  bias_random_walk_value;
+  struct NpsRandomVect3 noise_rng;
+  struct NpsRandomVect3 bias_rng;
   double       next_update;
   bool       data_available;
 };
@@ -55,6 +55,7 @@ void nps_sensor_sideslip_init(struct NpsSensorSideSlip *sideslip, double time)
   sideslip->value = 0.;
   sideslip->offset = NPS_SIDESLIP_OFFSET;
   sideslip->noise_std_dev = NPS_SIDESLIP_NOISE_STD_DEV;
+  nps_random_stream_init(&sideslip->noise_rng, "sideslip", 0);
   sideslip->next_update = time;
   sideslip->data_available = FALSE;
 }
@@ -70,7 +71,7 @@ void nps_sensor_sideslip_run_step(struct NpsSensorSideSlip *sideslip, double tim
   /* equivalent airspeed + sensor offset */
   sideslip->value = fdm.sideslip + sideslip->offset;
   /* add noise with std dev rad */
-  sideslip->value += get_gaussian_noise() * sideslip->noise_std_dev;
+  sideslip->value += nps_random_noise(&sideslip->noise_rng) * sideslip->noise_std_dev;
 
   sideslip->next_update += NPS_SIDESLIP_DT;
   sideslip->data_available = TRUE;
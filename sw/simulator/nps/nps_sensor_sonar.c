@@ -55,6 +55,7 @@ void nps_sensor_sonar_init(struct NpsSensorSonar *sonar, double time)
   sonar->value = 0.;
   sonar->offset = NPS_SONAR_OFFSET;
   sonar->noise_std_dev = NPS_SONAR_NOISE_STD_DEV;
+  nps_random_stream_init(&sonar->noise_rng, "sonar", 0);
   sonar->next_update = time;
   sonar->data_available = FALSE;
 }
@@ -70,7 +71,7 @@ void nps_sensor_sonar_run_step(struct NpsSensorSonar *sonar, double time)
   /* agl in meters */
   sonar->value = fdm.agl + sonar->offset;
   /* add noise with std dev meters */
-  sonar->value += get_gaussian_noise() * sonar->noise_std_dev;
+  sonar->value += nps_random_noise(&sonar->noise_rng) * sonar->noise_std_dev;
 
   sonar->next_update += NPS_SONAR_DT;
   sonar->data_available = TRUE;
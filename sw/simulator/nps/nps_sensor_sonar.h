@@ -33,11 +33,13 @@
 #include "math/pprz_algebra_double.h"
 #include "math/pprz_algebra_float.h"
 #include "std.h"
+#include "nps_random.h"
 
 struct NpsSensorSonar {
   double value;          ///< sonar reading in meters
   double offset;         ///< offset in meters
   double noise_std_dev;  ///< noise standard deviation
+  struct NpsRandom noise_rng; ///< noise stream
   double next_update;
   bool data_available;
 };
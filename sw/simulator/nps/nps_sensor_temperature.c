@@ -20,6 +20,7 @@ void nps_sensor_temperature_init(struct NpsSensorTemperature *temperature, doubl
 {
   temperature->value = 0.;
   temperature->noise_std_dev = NPS_TEMPERATURE_NOISE_STD_DEV;
+  nps_random_stream_init(&temperature->noise_rng, "temperature", 0);
   temperature->next_update = time;
   temperature->data_available = FALSE;
 }
@@ -34,7 +35,7 @@ void nps_sensor_temperature_run_step(struct NpsSensorTemperature *temperature, d
   /* termperature in degrees Celcius */
   temperature->value = fdm.temperature;
   /* add noise with std dev */
-  temperature->value += get_gaussian_noise() * temperature->noise_std_dev;
+  temperature->value += nps_random_noise(&temperature->noise_rng) * temperature->noise_std_dev;
 
   temperature->next_update += NPS_TEMPERATURE_DT;
   temperature->data_available = TRUE;
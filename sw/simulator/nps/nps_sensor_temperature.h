@@ -5,10 +5,12 @@
 #include "math/pprz_algebra_double.h"
 #include "math/pprz_algebra_float.h"
 #include "std.h"
+#include "nps_random.h"
 
 struct NpsSensorTemperature {
   double  value;          ///< temperature in degrees Celcius
   double  noise_std_dev;  ///< noise standard deviation
+  struct NpsRandom noise_rng; ///< noise stream
   double  next_update;
   bool  data_available;
 };
@@ -1,10 +1,93 @@
 #include "nps_sensors.h"
 
 #include "generated/airframe.h"
+#include "mcu_periph/sys_time.h"
 #include NPS_SENSORS_PARAMS
 
 struct NpsSensors sensors;
 
+/**
+ * Sensor events, in a priority queue ordered by time.
+ * Each sensor runs at its own rate and latency, only when it is due.
+ */
+static struct {
+  double time[NPS_SENSOR_NB];       ///< time of the next event of each sensor
+  double reading[NPS_SENSOR_NB];    ///< time of the last reading of each sensor
+  double *next_update[NPS_SENSOR_NB];
+  enum NpsSensorId heap[NPS_SENSOR_NB];
+} nps_sensors_events;
+
+static double nps_sensors_event_time(enum NpsSensorId id)
+{
+  if (id == NPS_SENSOR_GPS) {
+    return nps_sensor_gps_next_event(&sensors.gps);
+  }
+  return *nps_sensors_events.next_update[id];
+}
+
+static void nps_sensors_run_sensor(enum NpsSensorId id, double time)
+{
+  switch (id) {
+    case NPS_SENSOR_GYRO:
+      nps_sensor_gyro_run_step(&sensors.gyro, time, &sensors.body_to_imu_rmat);
+      break;
+    case NPS_SENSOR_ACCEL:
+      nps_sensor_accel_run_step(&sensors.accel, time, &sensors.body_to_imu_rmat);
+      break;
+    case NPS_SENSOR_MAG:
+      nps_sensor_mag_run_step(&sensors.mag, time, &sensors.body_to_imu_rmat);
+      break;
+    case NPS_SENSOR_BARO:
+      nps_sensor_baro_run_step(&sensors.baro, time);
+      break;
+    case NPS_SENSOR_GPS:
+      nps_sensor_gps_run_step(&sensors.gps, time);
+      break;
+    case NPS_SENSOR_SONAR:
+      nps_sensor_sonar_run_step(&sensors.sonar, time);
+      break;
+    case NPS_SENSOR_AIRSPEED:
+      nps_sensor_airspeed_run_step(&sensors.airspeed, time);
+      break;
+    case NPS_SENSOR_TEMPERATURE:
+      nps_sensor_temperature_run_step(&sensors.temp, time);
+      break;
+    case NPS_SENSOR_AOA:
+      nps_sensor_aoa_run_step(&sensors.aoa, time);
+      break;
+    case NPS_SENSOR_SIDESLIP:
+      nps_sensor_sideslip_run_step(&sensors.sideslip, time);
+      break;
+    default:
+      break;
+  }
+}
+
+/** Move down the event at position i of the heap */
+static void nps_sensors_sift_down(int i)
+{
+  enum NpsSensorId *heap = nps_sensors_events.heap;
+  double *time = nps_sensors_events.time;
+  while (true) {
+    int min = i;
+    int l = 2 * i + 1;
+    int r = l + 1;
+    if (l < NPS_SENSOR_NB && time[heap[l]] < time[heap[min]]) {
+      min = l;
+    }
+    if (r < NPS_SENSOR_NB && time[heap[r]] < time[heap[min]]) {
+      min = r;
+    }
+    if (min == i) {
+      return;
+    }
+    enum NpsSensorId tmp = heap[i];
+    heap[i] = heap[min];
+    heap[min] = tmp;
+    i = min;
+  }
+}
+
 void nps_sensors_init(double time)
 {
 
@@ -22,21 +105,54 @@ void nps_sensors_init(double time)
   nps_sensor_temperature_init(&sensors.temp, time);
   nps_sensor_aoa_init(&sensors.aoa, time);
   nps_sensor_sideslip_init(&sensors.sideslip,time);
+
+  nps_sensors_events.next_update[NPS_SENSOR_GYRO] = &sensors.gyro.next_update;
+  nps_sensors_events.next_update[NPS_SENSOR_ACCEL] = &sensors.accel.next_update;
+  nps_sensors_events.next_update[NPS_SENSOR_MAG] = &sensors.mag.next_update;
+  nps_sensors_events.next_update[NPS_SENSOR_BARO] = &sensors.baro.next_update;
+  nps_sensors_events.next_update[NPS_SENSOR_GPS] = &sensors.gps.next_update;
+  nps_sensors_events.next_update[NPS_SENSOR_SONAR] = &sensors.sonar.next_update;
+  nps_sensors_events.next_update[NPS_SENSOR_AIRSPEED] = &sensors.airspeed.next_update;
+  nps_sensors_events.next_update[NPS_SENSOR_TEMPERATURE] = &sensors.temp.next_update;
+  nps_sensors_events.next_update[NPS_SENSOR_AOA] = &sensors.aoa.next_update;
+  nps_sensors_events.next_update[NPS_SENSOR_SIDESLIP] = &sensors.sideslip.next_update;
+  for (int i = 0; i < NPS_SENSOR_NB; i++) {
+    nps_sensors_events.heap[i] = i;
+    nps_sensors_events.time[i] = nps_sensors_event_time(i);
+    nps_sensors_events.reading[i] = time;
+  }
+  for (int i = NPS_SENSOR_NB / 2 - 1; i >= 0; i--) {
+    nps_sensors_sift_down(i);
+  }
 }
 
 
 void nps_sensors_run_step(double time)
 {
-  nps_sensor_gyro_run_step(&sensors.gyro, time, &sensors.body_to_imu_rmat);
-  nps_sensor_accel_run_step(&sensors.accel, time, &sensors.body_to_imu_rmat);
-  nps_sensor_mag_run_step(&sensors.mag, time, &sensors.body_to_imu_rmat);
-  nps_sensor_baro_run_step(&sensors.baro, time);
-  nps_sensor_gps_run_step(&sensors.gps, time);
-  nps_sensor_sonar_run_step(&sensors.sonar, time);
-  nps_sensor_airspeed_run_step(&sensors.airspeed, time);
-  nps_sensor_temperature_run_step(&sensors.temp, time);
-  nps_sensor_aoa_run_step(&sensors.aoa, time);
-  nps_sensor_sideslip_run_step(&sensors.sideslip,time);
+  while (nps_sensors_events.time[nps_sensors_events.heap[0]] <= time + NPS_SENSORS_TIME_RES) {
+    enum NpsSensorId id = nps_sensors_events.heap[0];
+    double event = nps_sensors_events.time[id];
+    double next_update = *nps_sensors_events.next_update[id];
+    nps_sensors_run_sensor(id, event);
+    if (*nps_sensors_events.next_update[id] != next_update) {
+      nps_sensors_events.reading[id] = event;
+    }
+    nps_sensors_events.time[id] = nps_sensors_event_time(id);
+    nps_sensors_sift_down(0);
+  }
+}
+
+
+double nps_sensors_next_event(void)
+{
+  return nps_sensors_events.time[nps_sensors_events.heap[0]];
+}
+
+
+uint32_t nps_sensors_reading_stamp(enum NpsSensorId id, double time)
+{
+  // readings are at most one step old, during which the sensor time is offset from the sys_time
+  return get_sys_time_usec() - (uint32_t)((time - nps_sensors_events.reading[id]) * 1e6 + 0.5);
 }
 
 
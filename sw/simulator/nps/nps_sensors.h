@@ -29,8 +29,30 @@ struct NpsSensors {
 
 extern struct NpsSensors sensors;
 
+enum NpsSensorId {
+  NPS_SENSOR_GYRO,
+  NPS_SENSOR_ACCEL,
+  NPS_SENSOR_MAG,
+  NPS_SENSOR_BARO,
+  NPS_SENSOR_GPS,
+  NPS_SENSOR_SONAR,
+  NPS_SENSOR_AIRSPEED,
+  NPS_SENSOR_TEMPERATURE,
+  NPS_SENSOR_AOA,
+  NPS_SENSOR_SIDESLIP,
+  NPS_SENSOR_NB
+};
+
+/** Events closer than this are at the same time (s), resolution of the autopilot time */
+#define NPS_SENSORS_TIME_RES 1e-6
+
 extern void nps_sensors_init(double time);
+/** Run the sensor events due at time, in time order and each at its own time */
 extern void nps_sensors_run_step(double time);
+/** Time of the next sensor event (reading, or sampling of a sensor with latency) */
+extern double nps_sensors_next_event(void);
+/** Autopilot timestamp (us) of the last reading of a sensor, during the step at time */
+extern uint32_t nps_sensors_reading_stamp(enum NpsSensorId id, double time);
 
 extern bool nps_sensors_gyro_available();
 extern bool nps_sensors_mag_available();
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_shm.c
+ * Publication of the FDM and sensor data with the ring writer.
+ */
+
+#include "nps_shm.h"
+#include "nps_shm_writer.h"
+
+#include <stdio.h>
+
+bool nps_shm_init(const char *name, uint32_t capacity, double dt)
+{
+  if (!nps_shm_writer_init(name, capacity, dt)) {
+    return false;
+  }
+  printf("Publishing simulation data in shared memory %s (%u samples)\n", name, capacity);
+  return true;
+}
+
+void nps_shm_close(void)
+{
+  nps_shm_writer_close();
+}
+
+#define COPY3(_a, _v) { _a[0] = (_v).x; _a[1] = (_v).y; _a[2] = (_v).z; }
+
+/** Fill a sample, directly in its slot */
+static void nps_shm_fill(struct NpsShmSample *s, struct NpsFdm *f, struct NpsSensors *ss,
+                         double *commands, int commands_nb)
+{
+  COPY3(s->ecef_pos, f->ecef_pos);
+  COPY3(s->ned_pos, f->ltpprz_pos);
+  s->lla_pos[0] = f->lla_pos.lat;
+  s->lla_pos[1] = f->lla_pos.lon;
+  s->lla_pos[2] = f->lla_pos.alt;
+  s->hmsl = f->hmsl;
+  s->agl = f->agl;
+  COPY3(s->ned_vel, f->ltpprz_ecef_vel);
+  COPY3(s->ned_accel, f->ltpprz_ecef_accel);
+  COPY3(s->body_accel, f->body_accel);
+  s->quat[0] = f->ltpprz_to_body_quat.qi;
+  s->quat[1] = f->ltpprz_to_body_quat.qx;
+  s->quat[2] = f->ltpprz_to_body_quat.qy;
+  s->quat[3] = f->ltpprz_to_body_quat.qz;
+  s->eulers[0] = f->ltpprz_to_body_eulers.phi;
+  s->eulers[1] = f->ltpprz_to_body_eulers.theta;
+  s->eulers[2] = f->ltpprz_to_body_eulers.psi;
+  s->rates[0] = f->body_ecef_rotvel.p;
+  s->rates[1] = f->body_ecef_rotvel.q;
+  s->rates[2] = f->body_ecef_rotvel.r;
+  s->rotaccel[0] = f->body_ecef_rotaccel.p;
+  s->rotaccel[1] = f->body_ecef_rotaccel.q;
+  s->rotaccel[2] = f->body_ecef_rotaccel.r;
+  COPY3(s->wind, f->wind);
+  s->airspeed = f->airspeed;
+  s->pressure = f->pressure;
+  s->temperature = f->temperature;
+
+  s->commands_nb = Min(commands_nb, NPS_SHM_COMMANDS_MAX);
+  for (uint32_t i = 0; i < s->commands_nb; i++) {
+    s->commands[i] = commands[i];
+  }
+  s->on_ground = f->on_ground;
+
+  s->sensors_updated = (ss->gyro.data_available ? NPS_SHM_GYRO : 0) |
+                       (ss->accel.data_available ? NPS_SHM_ACCEL : 0) |
+                       (ss->mag.data_available ? NPS_SHM_MAG : 0) |
+                       (ss->baro.data_available ? NPS_SHM_BARO : 0) |
+                       (ss->gps.data_available ? NPS_SHM_GPS : 0) |
+                       (ss->sonar.data_available ? NPS_SHM_SONAR : 0) |
+                       (ss->airspeed.data_available ? NPS_SHM_AIRSPEED : 0);
+  COPY3(s->gyro, ss->gyro.value);
+  COPY3(s->accel, ss->accel.value);
+  COPY3(s->mag, ss->mag.value);
+  s->baro = ss->baro.value;
+  COPY3(s->gps_ecef_pos, ss->gps.ecef_pos);
+  COPY3(s->gps_ecef_vel, ss->gps.ecef_vel);
+  s->sonar = ss->sonar.value;
+  s->airspeed_sensor = ss->airspeed.value;
+}
+
+void nps_shm_publish(double time, struct NpsFdm *fdm_shm, struct NpsSensors *sensors_shm,
+                     double *commands, int commands_nb)
+{
+  struct NpsShmSample *s = nps_shm_writer_begin(time);
+  if (s == NULL) {
+    return;
+  }
+  nps_shm_fill(s, fdm_shm, sensors_shm, commands, commands_nb);
+  nps_shm_writer_end();
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_shm.h
+ * Publication of the FDM and sensor data in a shared memory ring, at
+ * each simulation step (see nps_shm_layout.h for the binary layout and
+ * nps_shm_reader.h to read it).
+ *
+ * The writer never waits for the readers: a reader which is too slow
+ * loses the oldest samples.
+ */
+
+#ifndef NPS_SHM_H
+#define NPS_SHM_H
+
+#include "std.h"
+#include "nps_fdm.h"
+#include "nps_sensors.h"
+
+/** Default number of samples in the ring (16s at 512Hz) */
+#define NPS_SHM_CAPACITY 8192
+
+/** Create the shared memory ring
+ * @param name POSIX shared memory name, e.g. "/nps"
+ * @param capacity number of samples
+ * @param dt simulation step (s)
+ * @return false if the ring could not be created
+ */
+extern bool nps_shm_init(const char *name, uint32_t capacity, double dt);
+
+/** Publish the data of a simulation step */
+extern void nps_shm_publish(double time, struct NpsFdm *fdm_shm, struct NpsSensors *sensors_shm,
+                            double *commands, int commands_nb);
+
+/** Stop publishing, the ring is left for the readers */
+extern void nps_shm_close(void);
+
+#endif /* NPS_SHM_H */
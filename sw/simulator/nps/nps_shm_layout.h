@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_shm_layout.h
+ * Binary layout of the NPS shared memory telemetry ring.
+ *
+ * The shared memory object starts with a header followed by a ring of
+ * fixed size slots, one sample per simulation step of the FDM and sensors.
+ * With NPS_MULTIRATE, the steps where nothing is simulated are skipped: the
+ * step field gives the step of each sample (time / dt), consecutive samples
+ * can be several steps apart. All the fields are in host byte order. Only
+ * standard types are used, so that tools can read the ring without the
+ * paparazzi headers (see nps_shm_reader.h).
+ *
+ * Slot i holds sample n (the n-th published sample) when n % capacity == i.
+ * Its sequence number is odd while the slot is written and 2 * (n + 1) when
+ * sample n is complete.
+ */
+
+#ifndef NPS_SHM_LAYOUT_H
+#define NPS_SHM_LAYOUT_H
+
+#include <stdint.h>
+
+#define NPS_SHM_MAGIC   0x4d53504eU   ///< "NPSM"
+#define NPS_SHM_VERSION 2
+
+/** Max number of commands in a sample */
+#define NPS_SHM_COMMANDS_MAX 16
+
+/** Bits of NpsShmSample.sensors_updated */
+#define NPS_SHM_GYRO     (1 << 0)
+#define NPS_SHM_ACCEL    (1 << 1)
+#define NPS_SHM_MAG      (1 << 2)
+#define NPS_SHM_BARO     (1 << 3)
+#define NPS_SHM_GPS      (1 << 4)
+#define NPS_SHM_SONAR    (1 << 5)
+#define NPS_SHM_AIRSPEED (1 << 6)
+
+struct NpsShmSample {
+  uint64_t step;              ///< simulation step number, time / dt
+  double time;                ///< simulated time (s)
+
+  /* truth from the FDM */
+  double ecef_pos[3];         ///< position in ECEF (m)
+  double ned_pos[3];          ///< position in the local frame of the flight plan (m)
+  double lla_pos[3];          ///< latitude, longitude (rad) and altitude (m)
+  double hmsl;                ///< height above mean sea level (m)
+  double agl;                 ///< height above ground (m)
+  double ned_vel[3];          ///< speed in the local frame (m/s)
+  double ned_accel[3];        ///< acceleration in the local frame (m/s2)
+  double body_accel[3];       ///< specific force in body frame (m/s2)
+  double quat[4];             ///< local to body quaternion (qi, qx, qy, qz)
+  double eulers[3];           ///< local to body euler angles (rad)
+  double rates[3];            ///< body rates (rad/s)
+  double rotaccel[3];         ///< body angular acceleration (rad/s2)
+  double wind[3];             ///< wind in the local frame (m/s)
+  double airspeed;            ///< equivalent airspeed (m/s)
+  double pressure;            ///< static pressure (Pa)
+  double temperature;         ///< temperature (deg C)
+
+  /* inputs of the FDM */
+  double commands[NPS_SHM_COMMANDS_MAX];
+  uint32_t commands_nb;
+  uint32_t on_ground;
+
+  /* simulated sensor outputs, raw sensor units as sent to the autopilot */
+  uint32_t sensors_updated;   ///< NPS_SHM_* bits of the sensors updated at this step
+  uint32_t pad;
+  double gyro[3];
+  double accel[3];
+  double mag[3];
+  double baro;                ///< pressure (Pa)
+  double gps_ecef_pos[3];     ///< (m)
+  double gps_ecef_vel[3];     ///< (m/s)
+  double sonar;               ///< (m)
+  double airspeed_sensor;     ///< (m/s)
+};
+
+struct NpsShmSlot {
+  volatile uint64_t seq;
+  uint64_t pad;
+  struct NpsShmSample sample;
+};
+
+struct NpsShmHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t sample_size;       ///< sizeof(struct NpsShmSample) of the writer
+  uint32_t capacity;          ///< number of slots
+  double dt;                  ///< simulation step (s)
+  volatile uint64_t count;    ///< number of published samples, can be lower than the number of steps
+  uint64_t pad[4];
+};
+
+/** Size of a ring of a given capacity (bytes) */
+#define NPS_SHM_SIZE(_capacity) (sizeof(struct NpsShmHeader) + (size_t)(_capacity) * sizeof(struct NpsShmSlot))
+
+#endif /* NPS_SHM_LAYOUT_H */
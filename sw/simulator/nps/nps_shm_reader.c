@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_shm_reader.c
+ * Reader of the NPS shared memory telemetry ring.
+ */
+
+#include "nps_shm_reader.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+int nps_shm_reader_open(struct NpsShmReader *r, const char *name)
+{
+  memset(r, 0, sizeof(*r));
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct NpsShmHeader)) {
+    close(fd);
+    return -1;
+  }
+  void *mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    return -1;
+  }
+  const struct NpsShmHeader *h = (const struct NpsShmHeader *)mem;
+  __sync_synchronize();
+  if (h->magic != NPS_SHM_MAGIC || h->version != NPS_SHM_VERSION ||
+      h->sample_size != sizeof(struct NpsShmSample) || h->capacity == 0 ||
+      (size_t)st.st_size < NPS_SHM_SIZE(h->capacity)) {
+    munmap(mem, st.st_size);
+    return -1;
+  }
+  r->header = h;
+  r->slots = (const struct NpsShmSlot *)(h + 1);
+  r->size = st.st_size;
+  uint64_t count = h->count;
+  r->next = count > h->capacity ? count - h->capacity : 0;
+  return 0;
+}
+
+int nps_shm_reader_next(struct NpsShmReader *r, struct NpsShmSample *sample)
+{
+  const uint64_t capacity = r->header->capacity;
+  while (1) {
+    uint64_t count = r->header->count;
+    __sync_synchronize();
+    if (r->next >= count) {
+      return 0;
+    }
+    if (count - r->next > capacity) {
+      // the writer went around the ring
+      r->lost += count - capacity - r->next;
+      r->next = count - capacity;
+    }
+    const struct NpsShmSlot *slot = &r->slots[r->next % capacity];
+    uint64_t seq = slot->seq;
+    __sync_synchronize();
+    if (seq != 2 * (r->next + 1)) {
+      // overwritten by a newer sample, skip forward
+      continue;
+    }
+    memcpy(sample, (const void *)&slot->sample, sizeof(struct NpsShmSample));
+    __sync_synchronize();
+    if (slot->seq != seq) {
+      continue;
+    }
+    r->next++;
+    return 1;
+  }
+}
+
+int nps_shm_reader_latest(struct NpsShmReader *r, struct NpsShmSample *sample)
+{
+  uint64_t count = r->header->count;
+  if (count == 0) {
+    return 0;
+  }
+  // skipped samples are not counted as lost
+  if (count - 1 > r->next) {
+    r->next = count - 1;
+  }
+  return nps_shm_reader_next(r, sample);
+}
+
+void nps_shm_reader_close(struct NpsShmReader *r)
+{
+  if (r->header != NULL) {
+    munmap((void *)r->header, r->size);
+    r->header = NULL;
+    r->slots = NULL;
+  }
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_shm_reader.h
+ * Reader of the NPS shared memory telemetry ring (simulator started with
+ * --shm <name>).
+ *
+ * Standalone, only depends on nps_shm_layout.h, e.g. for a tool:
+ * @code
+ * gcc -I sw/simulator/nps my_tool.c sw/simulator/nps/nps_shm_reader.c -lrt
+ *
+ * struct NpsShmReader r;
+ * struct NpsShmSample s;
+ * if (nps_shm_reader_open(&r, "/nps") == 0) {
+ *   while (running) {
+ *     if (nps_shm_reader_next(&r, &s) > 0) { ... } else { usleep(1000); }
+ *   }
+ *   nps_shm_reader_close(&r);
+ * }
+ * @endcode
+ * Any number of readers can follow the same ring, they never block the
+ * simulation.
+ */
+
+#ifndef NPS_SHM_READER_H
+#define NPS_SHM_READER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "nps_shm_layout.h"
+
+struct NpsShmReader {
+  const struct NpsShmHeader *header;
+  const struct NpsShmSlot *slots;
+  size_t size;
+  uint64_t next;    ///< next sample to read
+  uint64_t lost;    ///< number of samples overwritten before they were read
+};
+
+/** Open a ring, the first sample read is the oldest one still available
+ * @return 0 on success, -1 if the ring doesn't exist or has another layout
+ */
+extern int nps_shm_reader_open(struct NpsShmReader *r, const char *name);
+
+/** Read the next sample
+ * @return 1 if a sample was read, 0 if no new sample is available
+ */
+extern int nps_shm_reader_next(struct NpsShmReader *r, struct NpsShmSample *sample);
+
+/** Skip to the last published sample, e.g. for a display
+ * @return 1 if a sample was read, 0 if the ring is empty
+ */
+extern int nps_shm_reader_latest(struct NpsShmReader *r, struct NpsShmSample *sample);
+
+extern void nps_shm_reader_close(struct NpsShmReader *r);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NPS_SHM_READER_H */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_shm_writer.c
+ * Writer of the NPS shared memory telemetry ring.
+ */
+
+#include "nps_shm_writer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static struct NpsShmHeader *shm_header = NULL;
+static struct NpsShmSlot *shm_slots = NULL;
+static size_t shm_size;
+
+bool nps_shm_writer_init(const char *name, uint32_t capacity, double dt)
+{
+  if (capacity == 0) {
+    return false;
+  }
+  // start from a new object, readers of a previous run see it as unlinked
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+  if (fd < 0) {
+    perror("nps_shm: shm_open");
+    return false;
+  }
+  shm_size = NPS_SHM_SIZE(capacity);
+  if (ftruncate(fd, shm_size) < 0) {
+    perror("nps_shm: ftruncate");
+    close(fd);
+    return false;
+  }
+  void *mem = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    perror("nps_shm: mmap");
+    return false;
+  }
+
+  shm_header = (struct NpsShmHeader *)mem;
+  shm_slots = (struct NpsShmSlot *)(shm_header + 1);
+  // ftruncate gives a zeroed object: all slots are empty
+  shm_header->version = NPS_SHM_VERSION;
+  shm_header->sample_size = sizeof(struct NpsShmSample);
+  shm_header->capacity = capacity;
+  shm_header->dt = dt;
+  shm_header->count = 0;
+  __sync_synchronize();
+  // readers check the magic last
+  shm_header->magic = NPS_SHM_MAGIC;
+  return true;
+}
+
+struct NpsShmSample *nps_shm_writer_begin(double time)
+{
+  if (shm_header == NULL) {
+    return NULL;
+  }
+  uint64_t n = shm_header->count;
+  struct NpsShmSlot *slot = &shm_slots[n % shm_header->capacity];
+
+  slot->seq = 2 * n + 1;
+  __sync_synchronize();
+  // idle steps are not published with NPS_MULTIRATE, stamp the actual step
+  slot->sample.step = (uint64_t)llround(time / shm_header->dt);
+  slot->sample.time = time;
+  return &slot->sample;
+}
+
+void nps_shm_writer_end(void)
+{
+  if (shm_header == NULL) {
+    return;
+  }
+  uint64_t n = shm_header->count;
+  struct NpsShmSlot *slot = &shm_slots[n % shm_header->capacity];
+
+  __sync_synchronize();
+  slot->seq = 2 * (n + 1);
+  shm_header->count = n + 1;
+}
+
+void nps_shm_writer_close(void)
+{
+  if (shm_header != NULL) {
+    munmap(shm_header, shm_size);
+    shm_header = NULL;
+    shm_slots = NULL;
+  }
+}
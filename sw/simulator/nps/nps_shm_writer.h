@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_shm_writer.h
+ * Writer of the NPS shared memory telemetry ring (see nps_shm_layout.h).
+ *
+ * Standalone as the reader, nps_shm.c fills the samples from the FDM and
+ * the sensors. There is a single writer per ring, it never waits for the
+ * readers.
+ */
+
+#ifndef NPS_SHM_WRITER_H
+#define NPS_SHM_WRITER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include "nps_shm_layout.h"
+
+/** Create the shared memory ring, replacing a previous one with the same name
+ * @param name POSIX shared memory name, e.g. "/nps"
+ * @param capacity number of samples
+ * @param dt simulation step (s)
+ * @return false if the ring could not be created
+ */
+extern bool nps_shm_writer_init(const char *name, uint32_t capacity, double dt);
+
+/** Start writing the next sample, its slot is marked as being written
+ * @param time simulated time (s), the step is stamped as time / dt
+ * @return the sample to fill, NULL if the ring is not open
+ */
+extern struct NpsShmSample *nps_shm_writer_begin(double time);
+
+/** Publish the sample started by nps_shm_writer_begin */
+extern void nps_shm_writer_end(void);
+
+/** Stop writing, the ring is left for the readers */
+extern void nps_shm_writer_close(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NPS_SHM_WRITER_H */
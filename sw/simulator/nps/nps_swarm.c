@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_swarm.c
+ * Swarm host: runs several NPS vehicles in a single process.
+ *
+ * The vehicles are listed in a file, one per line: the vehicle library
+ * (simsitl.so of an aircraft built with NPS_SWARM=1) followed by its NPS
+ * options, e.g.
+ * @code
+ * var/aircrafts/Quad1/nps/simsitl.so --seed 1 --results q1.json
+ * var/aircrafts/Quad2/nps/simsitl.so --seed 2 --init_offset 10,0,0
+ * @endcode
+ * (see conf/simulator/nps/swarm_vehicles.example).
+ * Each vehicle is loaded from a private copy of its library, so several
+ * lines can use the same aircraft, but they share its AC_ID.
+ *
+ * All the vehicles are stepped with a shared simulated clock, as fast as
+ * possible. Only the position of each vehicle is routed in memory, to the
+ * traffic_info module of the others at a fixed period, as the server does
+ * with ACINFO_LLA: modules that only read traffic_info (potential, follow,
+ * the TCAS conflict detection, ...) see the other vehicles without Ivy.
+ * The vehicle to vehicle messages (TCAS_RA/TCAS_RESOLVE coordination,
+ * FORMATION_SLOT/FORMATION_STATUS) are not routed by the host, they still
+ * need the server and the normal datalink.
+ *
+ * Vehicles are stepped on one thread by default. With --jobs, a pool of
+ * threads steps them concurrently; this is only allowed if the FDM of every
+ * vehicle is re-entrant (the multirotor FDM is, JSBSim keeps static state
+ * in the shared JSBSim library).
+ */
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "nps_swarm.h"
+
+#define NPS_SWARM_MAX_ARGS 64
+
+struct NpsSwarmVehicle {
+  void *lib;
+  double (*init)(int argc, char **argv);
+  bool (*step)(void);
+  void (*get_traffic)(struct NpsSwarmTraffic *traffic);
+  void (*set_traffic)(struct NpsSwarmTraffic *traffic);
+  bool (*reentrant)(void);
+  void (*finish)(void);
+  bool running;
+  struct NpsSwarmTraffic traffic;
+};
+
+static struct {
+  struct NpsSwarmVehicle *vehicles;
+  int nb;
+  int jobs;
+  bool stop;
+  pthread_barrier_t start;
+  pthread_barrier_t done;
+} swarm;
+
+/**
+ * Load a private copy of a vehicle library.
+ * dlopen returns the same handle for the same file, and RTLD_LOCAL keeps
+ * the symbols of each copy out of the global scope.
+ */
+static bool nps_swarm_load(struct NpsSwarmVehicle *v, const char *path)
+{
+  char copy[] = "/tmp/nps_swarm_XXXXXX";
+  int out = mkstemp(copy);
+  if (out < 0) {
+    perror("mkstemp");
+    return false;
+  }
+  int in = open(path, O_RDONLY);
+  if (in < 0) {
+    perror(path);
+    close(out);
+    unlink(copy);
+    return false;
+  }
+  char buf[65536];
+  ssize_t n;
+  bool ok = true;
+  while ((n = read(in, buf, sizeof(buf))) > 0) {
+    if (write(out, buf, n) != n) {
+      ok = false;
+      break;
+    }
+  }
+  ok = ok && n == 0;
+  close(in);
+  close(out);
+
+  if (ok) {
+    v->lib = dlopen(copy, RTLD_NOW | RTLD_LOCAL);
+    if (v->lib == NULL) {
+      fprintf(stderr, "%s: %s\n", path, dlerror());
+    }
+  }
+  // the mapping stays after unlink
+  unlink(copy);
+  if (v->lib == NULL) {
+    return false;
+  }
+
+  *(void **)(&v->init) = dlsym(v->lib, "nps_swarm_vehicle_init");
+  *(void **)(&v->step) = dlsym(v->lib, "nps_swarm_vehicle_step");
+  *(void **)(&v->get_traffic) = dlsym(v->lib, "nps_swarm_vehicle_get_traffic");
+  *(void **)(&v->set_traffic) = dlsym(v->lib, "nps_swarm_vehicle_set_traffic");
+  *(void **)(&v->reentrant) = dlsym(v->lib, "nps_swarm_vehicle_reentrant");
+  *(void **)(&v->finish) = dlsym(v->lib, "nps_swarm_vehicle_finish");
+  if (!v->init || !v->step || !v->get_traffic || !v->set_traffic || !v->reentrant || !v->finish) {
+    fprintf(stderr, "%s: not an NPS vehicle library\n", path);
+    return false;
+  }
+  return true;
+}
+
+/** Load and initialize the vehicle of a line of the vehicles file */
+static bool nps_swarm_add(char *line, const char *duration, double *dt)
+{
+  char *argv[NPS_SWARM_MAX_ARGS + 5];
+  int argc = 0;
+  char *save = NULL;
+  char *tok = strtok_r(line, " \t\n", &save);
+  if (tok == NULL || tok[0] == '#') {
+    return true;
+  }
+  argv[argc++] = tok;
+  argv[argc++] = "--lockstep";
+  argv[argc++] = "--nodisplay";
+  if (duration) {
+    argv[argc++] = "--duration";
+    argv[argc++] = (char *)duration;
+  }
+  while ((tok = strtok_r(NULL, " \t\n", &save)) != NULL && argc < NPS_SWARM_MAX_ARGS + 4) {
+    argv[argc++] = tok;
+  }
+  argv[argc] = NULL;
+
+  swarm.vehicles = realloc(swarm.vehicles, (swarm.nb + 1) * sizeof(struct NpsSwarmVehicle));
+  struct NpsSwarmVehicle *v = &swarm.vehicles[swarm.nb];
+  memset(v, 0, sizeof(*v));
+  if (!nps_swarm_load(v, argv[0])) {
+    return false;
+  }
+  printf("Vehicle %d: %s\n", swarm.nb, argv[0]);
+  double vdt = v->init(argc, argv);
+  if (vdt <= 0.) {
+    return false;
+  }
+  if (*dt > 0. && vdt != *dt) {
+    fprintf(stderr, "%s: simulation step %f differs from the other vehicles (%f)\n", argv[0], vdt, *dt);
+    return false;
+  }
+  *dt = vdt;
+  v->running = true;
+  swarm.nb++;
+  return true;
+}
+
+/** Worker: steps the vehicles w, w + jobs, w + 2 * jobs, ... at each step of the clock */
+static void *nps_swarm_worker(void *data)
+{
+  int w = (int)(intptr_t)data;
+  while (true) {
+    pthread_barrier_wait(&swarm.start);
+    if (swarm.stop) {
+      break;
+    }
+    for (int i = w; i < swarm.nb; i += swarm.jobs) {
+      if (swarm.vehicles[i].running) {
+        swarm.vehicles[i].running = swarm.vehicles[i].step();
+      }
+    }
+    pthread_barrier_wait(&swarm.done);
+  }
+  return NULL;
+}
+
+/** Give the position of each vehicle to all the others, workers are waiting */
+static void nps_swarm_route_traffic(void)
+{
+  for (int i = 0; i < swarm.nb; i++) {
+    swarm.vehicles[i].get_traffic(&swarm.vehicles[i].traffic);
+  }
+  for (int j = 0; j < swarm.nb; j++) {
+    for (int i = 0; i < swarm.nb; i++) {
+      struct NpsSwarmTraffic *t = &swarm.vehicles[i].traffic;
+      if (i != j && t->valid && t->ac_id != swarm.vehicles[j].traffic.ac_id) {
+        swarm.vehicles[j].set_traffic(t);
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  char *vehicles = NULL;
+  char *duration = NULL;
+  double traffic_period = 0.25;
+  swarm.jobs = 1;
+
+  static const char *usage =
+    "Usage: %s [options]\n"
+    " Options :\n"
+    "   -h                          Display this help\n"
+    "   --vehicles <file>           one vehicle per line: library followed by its NPS options\n"
+    "   --duration <seconds>        stop after this simulated time, e.g. 300\n"
+    "   --jobs <number>             number of threads (default 1), only with re-entrant FDMs\n"
+    "   --traffic_period <seconds>  period of the traffic info routing (default 0.25)\n";
+
+  static struct option long_options[] = {
+    {"vehicles", 1, NULL, 'v'},
+    {"duration", 1, NULL, 'd'},
+    {"jobs", 1, NULL, 'j'},
+    {"traffic_period", 1, NULL, 't'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+    switch (c) {
+      case 'v':
+        vehicles = optarg; break;
+      case 'd':
+        duration = optarg; break;
+      case 'j':
+        swarm.jobs = atoi(optarg); break;
+      case 't':
+        traffic_period = atof(optarg); break;
+      case 'h':
+        fprintf(stderr, usage, argv[0]);
+        return 0;
+      default:
+        fprintf(stderr, usage, argv[0]);
+        return 1;
+    }
+  }
+  if (vehicles == NULL) {
+    fprintf(stderr, usage, argv[0]);
+    return 1;
+  }
+
+  setbuf(stdout, NULL);
+
+  FILE *f = fopen(vehicles, "r");
+  if (f == NULL) {
+    perror(vehicles);
+    return 1;
+  }
+  char line[1024];
+  double dt = 0.;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (!nps_swarm_add(line, duration, &dt)) {
+      fclose(f);
+      return 1;
+    }
+  }
+  fclose(f);
+  if (swarm.nb == 0) {
+    fprintf(stderr, "No vehicle in %s\n", vehicles);
+    return 1;
+  }
+
+  if (swarm.jobs < 1) {
+    swarm.jobs = 1;
+  }
+  if (swarm.jobs > swarm.nb) {
+    swarm.jobs = swarm.nb;
+  }
+  if (swarm.jobs > 1) {
+    for (int i = 0; i < swarm.nb; i++) {
+      if (!swarm.vehicles[i].reentrant()) {
+        fprintf(stderr, "Vehicle %d: FDM is not re-entrant, can't run with --jobs %d\n", i, swarm.jobs);
+        return 1;
+      }
+    }
+  }
+  printf("Running %d vehicles on %d threads\n", swarm.nb, swarm.jobs);
+
+  pthread_barrier_init(&swarm.start, NULL, swarm.jobs + 1);
+  pthread_barrier_init(&swarm.done, NULL, swarm.jobs + 1);
+  pthread_t *threads = malloc(swarm.jobs * sizeof(pthread_t));
+  for (int w = 0; w < swarm.jobs; w++) {
+    pthread_create(&threads[w], NULL, nps_swarm_worker, (void *)(intptr_t)w);
+  }
+
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  double time = 0.;
+  double traffic_time = 0.;
+  while (true) {
+    pthread_barrier_wait(&swarm.start);
+    pthread_barrier_wait(&swarm.done);
+    bool running = false;
+    for (int i = 0; i < swarm.nb; i++) {
+      running |= swarm.vehicles[i].running;
+    }
+    if (!running) {
+      break;
+    }
+    time += dt;
+    if (time >= traffic_time) {
+      nps_swarm_route_traffic();
+      traffic_time += traffic_period;
+    }
+  }
+  swarm.stop = true;
+  pthread_barrier_wait(&swarm.start);
+  for (int w = 0; w < swarm.jobs; w++) {
+    pthread_join(threads[w], NULL);
+  }
+  gettimeofday(&end, NULL);
+
+  for (int i = 0; i < swarm.nb; i++) {
+    swarm.vehicles[i].finish();
+  }
+  double wall = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 1e-6;
+  printf("Simulated %d vehicles for %.3f s in %.3f s (x%.1f)\n", swarm.nb, time, wall,
+         wall > 0. ? time / wall : 0.);
+
+  free(threads);
+  free(swarm.vehicles);
+  return 0;
+}
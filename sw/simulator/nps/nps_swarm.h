@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_swarm.h
+ * Interface between the swarm host (nps_swarm.c) and the vehicles
+ * (nps_swarm_vehicle.c).
+ *
+ * A vehicle is the NPS SITL of an aircraft built as a shared library
+ * (configure NPS_SWARM=1, gives simsitl.so next to simsitl). The host
+ * loads each vehicle from its own copy of the library, so that all the
+ * globals of the autopilot, FDM and sensors are private to the vehicle.
+ *
+ * Only standard types are used, the host doesn't include the airborne
+ * headers.
+ */
+
+#ifndef NPS_SWARM_H
+#define NPS_SWARM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Position and speed of a vehicle, as relayed to the others (ACINFO_LLA) */
+struct NpsSwarmTraffic {
+  bool valid;         ///< false if the vehicle has no global position yet
+  uint8_t ac_id;
+  int32_t lat;        ///< latitude (1e7 deg)
+  int32_t lon;        ///< longitude (1e7 deg)
+  int32_t alt;        ///< altitude above ellipsoid (mm)
+  int16_t course;     ///< course (decideg, CW from north)
+  uint16_t gspeed;    ///< ground speed (cm/s)
+  int16_t climb;      ///< climb rate (cm/s)
+};
+
+/** Functions exported by a vehicle library */
+
+/** Initialize the vehicle with NPS options, as for simsitl
+ * @return simulation step (s), negative on error
+ */
+extern double nps_swarm_vehicle_init(int argc, char **argv);
+
+/** Run one simulation step
+ * @return false when the vehicle is done (end of duration or crash)
+ */
+extern bool nps_swarm_vehicle_step(void);
+
+/** Position of the vehicle from its own state estimate */
+extern void nps_swarm_vehicle_get_traffic(struct NpsSwarmTraffic *traffic);
+
+/** Position of another vehicle, ignored without the traffic_info module */
+extern void nps_swarm_vehicle_set_traffic(struct NpsSwarmTraffic *traffic);
+
+/** True if the vehicle can be stepped concurrently with the others
+ * Each vehicle has its own copy of the library globals, but not of the
+ * external libraries (e.g. JSBSim), so this depends on the FDM.
+ */
+extern bool nps_swarm_vehicle_reentrant(void);
+
+/** End of the run, writes the results if requested */
+extern void nps_swarm_vehicle_finish(void);
+
+#endif /* NPS_SWARM_H */
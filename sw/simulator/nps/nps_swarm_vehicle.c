@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_swarm_vehicle.c
+ * NPS SITL entry points for the swarm host (see nps_swarm.h).
+ *
+ * The vehicle runs in lockstep without Ivy display and FlightGear output,
+ * the host gives the clock. The autopilot telemetry and datalink are the
+ * same as for simsitl.
+ */
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+
+#include "nps_swarm.h"
+#include "nps_main.h"
+#include "nps_fdm.h"
+#include "nps_results.h"
+#include "nps_shm.h"
+
+#include "generated/airframe.h"
+#include "state.h"
+
+#ifdef TRAFFIC_INFO
+#include "modules/multi/traffic_info.h"
+#endif
+
+double nps_swarm_vehicle_init(int argc, char **argv)
+{
+  // getopt state is shared by all the vehicles, which are initialized one after the other
+  optind = 0;
+  if (nps_main_init(argc, argv)) {
+    return -1.;
+  }
+  // the host handles the pause, not the vehicles
+  signal(SIGTSTP, SIG_DFL);
+  signal(SIGCONT, SIG_DFL);
+  nps_main.lockstep = true;
+
+  if (nps_main.results) {
+    nps_results_init();
+  }
+  if (nps_main.shm && !nps_shm_init(nps_main.shm, NPS_SHM_CAPACITY, SIM_DT)) {
+    return -1.;
+  }
+  return SIM_DT;
+}
+
+bool nps_swarm_vehicle_step(void)
+{
+  if (nps_main.duration > 0. && nps_main.sim_time >= nps_main.duration) {
+    return false;
+  }
+  nps_main_run_sim_step();
+  nps_main.sim_time += SIM_DT;
+  return true;
+}
+
+void nps_swarm_vehicle_get_traffic(struct NpsSwarmTraffic *traffic)
+{
+  traffic->ac_id = AC_ID;
+  traffic->valid = stateIsGlobalCoordinateValid();
+  if (!traffic->valid) {
+    return;
+  }
+  struct LlaCoor_i *lla = stateGetPositionLla_i();
+  traffic->lat = lla->lat;
+  traffic->lon = lla->lon;
+  traffic->alt = lla->alt;
+  traffic->course = (int16_t)(DegOfRad(stateGetHorizontalSpeedDir_f()) * 10.f);
+  traffic->gspeed = (uint16_t)(stateGetHorizontalSpeedNorm_f() * 100.f);
+  traffic->climb = (int16_t)(-stateGetSpeedNed_f()->z * 100.f);
+}
+
+void nps_swarm_vehicle_set_traffic(struct NpsSwarmTraffic *traffic __attribute__((unused)))
+{
+#ifdef TRAFFIC_INFO
+  set_ac_info_lla(traffic->ac_id, traffic->lat, traffic->lon, traffic->alt,
+                  traffic->course, traffic->gspeed, traffic->climb,
+                  gps_tow_from_sys_ticks(sys_time.nb_tick));
+#endif
+}
+
+bool nps_swarm_vehicle_reentrant(void)
+{
+  return fdm.reentrant;
+}
+
+void nps_swarm_vehicle_finish(void)
+{
+  if (nps_main.results) {
+    nps_results_write(nps_main.results, nps_main.sim_time);
+  }
+  nps_shm_close();
+}
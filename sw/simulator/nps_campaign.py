@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2021 The Paparazzi Team
+#
+# This file is part of paparazzi.
+#
+# paparazzi is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# paparazzi is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with paparazzi; see the file COPYING.  If not, see
+# <http://www.gnu.org/licenses/>.
+#
+
+"""
+Monte Carlo campaign of NPS simulations.
+
+Runs many headless NPS SITL instances (lockstep mode) in parallel, each with
+its own seed, random wind, turbulence, sensor noise scale and initial
+position/heading offsets. Each instance writes its metrics (see
+sw/simulator/nps/nps_results.c), the campaign aggregates them.
+
+The aircraft must be built for the nps target, with a flight plan that
+takes off and flies without ground station or RC.
+
+With --branch_at, a single simulation flies the common beginning of the
+mission and all the runs are branched from its state at the given time
+(see --checkpoint option of the simulator), the parameters are applied
+at the branch time and the initial offsets are not used.
+
+example: nps_campaign.py -a Microjet -n 1000 -d 300 -o /tmp/campaign
+Extra arguments after -- are passed to every simulation.
+"""
+
+from __future__ import print_function
+
+import argparse
+import csv
+import json
+import math
+import os
+import random
+import subprocess
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+
+METRICS = ["track_rms", "track_max", "settling_time", "est_rms", "est_max", "tilt_max", "flight_time"]
+PARAMS = ["seed", "wind_speed", "wind_dir", "turbulence", "noise_scale", "north", "east", "heading"]
+
+
+def draw_params(args, run):
+    """ Random parameters of a run, only depend on the campaign seed and the run number """
+    rng = random.Random("%d-%d" % (args.seed, run))
+    return {
+        "seed": rng.randrange(1, 2 ** 31),
+        "wind_speed": rng.uniform(0., args.wind_max),
+        "wind_dir": rng.uniform(0., 360.),
+        "turbulence": rng.randint(0, args.turbulence_max),
+        "noise_scale": rng.uniform(args.noise_min, args.noise_max),
+        "north": rng.uniform(-args.offset_max, args.offset_max),
+        "east": rng.uniform(-args.offset_max, args.offset_max),
+        "heading": rng.uniform(-args.heading_max, args.heading_max),
+    }
+
+
+def run_sim(args, simsitl, run, params):
+    """ Run one simulation, return the metrics or None """
+    base = os.path.join(args.output, "run_%05d" % run)
+    results = base + ".json"
+    if os.path.exists(results):
+        os.remove(results)
+    cmd = [simsitl, "--lockstep", "--nodisplay", "--norc",
+           "--duration", str(args.duration),
+           # one Ivy bus per instance, so that they don't see each other
+           "--ivy_bus", "127.255.255.255:%d" % (args.ivy_port + run),
+           "--seed", str(params["seed"]),
+           "--noise_scale", "%.4f" % params["noise_scale"],
+           "--wind_speed", "%.3f" % params["wind_speed"],
+           "--wind_dir", "%.1f" % params["wind_dir"],
+           "--turbulence", str(params["turbulence"]),
+           "--init_offset", "%.3f,%.3f,%.2f" % (params["north"], params["east"], params["heading"]),
+           "--results", results] + args.sim_args
+    with open(base + ".log", "w") as log:
+        try:
+            subprocess.call(cmd, stdout=log, stderr=subprocess.STDOUT, timeout=args.timeout)
+        except subprocess.TimeoutExpired:
+            return None
+    try:
+        with open(results) as f:
+            return json.loads(f.readline())
+    except (IOError, ValueError):
+        return None
+
+
+def run_branches(args, simsitl, runs):
+    """ Run all the simulations as branches of a checkpoint, return the list of metrics """
+    cmd = [simsitl, "--lockstep", "--nodisplay", "--norc",
+           "--duration", str(args.duration),
+           "--ivy_bus", "127.255.255.255:%d" % args.ivy_port,
+           "--seed", str(args.seed),
+           "--checkpoint", str(args.branch_at),
+           "--checkpoint_jobs", str(args.jobs)] + args.sim_args
+    requests = []
+    for run, params in runs:
+        results = os.path.join(args.output, "run_%05d.json" % run)
+        if os.path.exists(results):
+            os.remove(results)
+        requests.append("--seed %d --noise_scale %.4f --wind_speed %.3f --wind_dir %.1f --turbulence %d --results %s\n" % (
+            params["seed"], params["noise_scale"], params["wind_speed"], params["wind_dir"], params["turbulence"], results))
+    timeout = args.timeout * (1 + len(runs) // max(args.jobs, 1))
+    with open(os.path.join(args.output, "checkpoint.log"), "w") as log:
+        proc = subprocess.Popen(cmd, stdin=subprocess.PIPE, stdout=log, stderr=subprocess.STDOUT, universal_newlines=True)
+        try:
+            proc.communicate("".join(requests), timeout=timeout)
+        except subprocess.TimeoutExpired:
+            proc.kill()
+    res = []
+    for run, _ in runs:
+        try:
+            with open(os.path.join(args.output, "run_%05d.json" % run)) as f:
+                res.append(json.loads(f.readline()))
+        except (IOError, ValueError):
+            res.append(None)
+    return res
+
+
+def stats(values):
+    """ mean, median, 95th percentile and max """
+    if not values:
+        return [float("nan")] * 4
+    v = sorted(values)
+    pct = lambda p: v[min(len(v) - 1, int(math.ceil(p * len(v))) - 1)]
+    return [sum(v) / len(v), pct(0.5), pct(0.95), v[-1]]
+
+
+def report(rows, nb_failed):
+    nb = len(rows)
+    crashes = [r for r in rows if r["crash"]]
+    print("\n%d runs, %d failed to run" % (nb + nb_failed, nb_failed))
+    if nb == 0:
+        return
+    print("crash rate: %.2f %% (%d runs)" % (100. * len(crashes) / nb, len(crashes)))
+    ok = [r for r in rows if not r["crash"]]
+    print("\n%-14s %10s %10s %10s %10s   (runs without crash)" % ("metric", "mean", "median", "p95", "max"))
+    for m in METRICS:
+        values = [r[m] for r in ok if r[m] >= 0.]
+        print("%-14s %10.3f %10.3f %10.3f %10.3f" % tuple([m] + stats(values)))
+    worst = sorted(ok, key=lambda r: -r["track_rms"])[:5]
+    if crashes or worst:
+        print("\nruns to look at (replay with the same parameters):")
+        for r in crashes[:5] + worst:
+            print("  run %5d seed %10d wind %4.1f m/s %3.0f deg turb %d noise x%.2f%s" % (
+                r["run"], r["seed"], r["wind_speed"], r["wind_dir"], r["turbulence"], r["noise_scale"],
+                "  CRASH at %.1f s" % r["crash_time"] if r["crash"] else "  track rms %.2f m" % r["track_rms"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-a", "--aircraft", required=True, help="aircraft name")
+    parser.add_argument("-n", "--runs", type=int, default=100, help="number of runs (default 100)")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), help="parallel runs (default: nb of cores)")
+    parser.add_argument("-d", "--duration", type=float, default=120., help="simulated time per run in s (default 120)")
+    parser.add_argument("-s", "--seed", type=int, default=0, help="campaign seed (default 0)")
+    parser.add_argument("-o", "--output", default="nps_campaign", help="output directory")
+    parser.add_argument("--timeout", type=float, default=600., help="wall time limit per run in s")
+    parser.add_argument("--ivy_port", type=int, default=20000, help="first Ivy port, one per run")
+    parser.add_argument("--wind_max", type=float, default=5., help="max wind speed in m/s")
+    parser.add_argument("--turbulence_max", type=int, default=0, help="max turbulence severity")
+    parser.add_argument("--noise_min", type=float, default=1., help="min sensor noise scale")
+    parser.add_argument("--noise_max", type=float, default=1., help="max sensor noise scale")
+    parser.add_argument("--offset_max", type=float, default=0., help="max initial position offset in m")
+    parser.add_argument("--heading_max", type=float, default=0., help="max initial heading offset in deg")
+    parser.add_argument("--branch_at", type=float, default=-1., help="branch all runs from the state at this simulated time")
+    parser.add_argument("sim_args", nargs="*", help="extra arguments for the simulator (after --)")
+    args = parser.parse_args()
+
+    paparazzi_home = os.environ.get("PAPARAZZI_HOME", os.path.join(os.path.dirname(os.path.abspath(__file__)), "../.."))
+    simsitl = os.path.join(paparazzi_home, "var", "aircrafts", args.aircraft, "nps", "simsitl")
+    if not os.path.isfile(simsitl):
+        print("Error: %s is missing, build the nps target of %s first" % (simsitl, args.aircraft))
+        sys.exit(1)
+    if not os.path.isdir(args.output):
+        os.makedirs(args.output)
+
+    start = time.time()
+    rows = []
+    nb_failed = 0
+
+    def add_result(run, params, res):
+        if res is None:
+            return 1
+        row = dict(params, run=run)
+        row.update(res)
+        rows.append(row)
+        return 0
+
+    if args.branch_at >= 0.:
+        # initial offsets can't be applied to branches
+        runs = [(run, dict(draw_params(args, run), north=0., east=0., heading=0.)) for run in range(args.runs)]
+        for (run, params), res in zip(runs, run_branches(args, simsitl, runs)):
+            nb_failed += add_result(run, params, res)
+        sys.stdout.write("%d runs done" % args.runs)
+    else:
+        with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+            jobs = {}
+            for run in range(args.runs):
+                params = draw_params(args, run)
+                jobs[pool.submit(run_sim, args, simsitl, run, params)] = (run, params)
+            for i, job in enumerate(as_completed(jobs)):
+                run, params = jobs[job]
+                nb_failed += add_result(run, params, job.result())
+                sys.stdout.write("\r%d/%d runs done" % (i + 1, args.runs))
+                sys.stdout.flush()
+    print(" in %.1f s" % (time.time() - start))
+
+    rows.sort(key=lambda r: r["run"])
+    with open(os.path.join(args.output, "campaign.csv"), "w") as f:
+        w = csv.DictWriter(f, fieldnames=["run"] + PARAMS + ["duration", "crash", "crash_time"] + METRICS)
+        w.writeheader()
+        for r in rows:
+            w.writerow(r)
+    report(rows, nb_failed)
+
+
+if __name__ == "__main__":
+    main()
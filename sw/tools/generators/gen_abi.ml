@@ -105,6 +105,15 @@ module Gen_onboard = struct
     Printf.fprintf h "(uint8_t sender_id";
     args h fields
 
+  (* Print messages names, indexed by message ID *)
+  let print_names = fun h messages ->
+    Printf.fprintf h "\n/* Messages names */\n";
+    Printf.fprintf h "#define ABI_MESSAGES_NAMES { \\\n";
+    List.iter (fun msg ->
+      Printf.fprintf h "  [ABI_%s_ID] = \"%s\", \\\n" (Compat.capitalize_ascii msg.name) msg.name
+    ) messages;
+    Printf.fprintf h "}\n"
+
   (* Print callbacks prototypes for all messages *)
   let print_callbacks = fun h messages ->
     Printf.fprintf h "\n/* Callbacks */\n";
@@ -129,8 +138,8 @@ module Gen_onboard = struct
     (* print arguments *)
     let rec args = fun h l ->
       match l with
-          [] -> Printf.fprintf h ");\n"
-        | [(n,_)] -> Printf.fprintf h ", %s);\n" n
+          [] -> Printf.fprintf h "));\n"
+        | [(n,_)] -> Printf.fprintf h ", %s));\n" n
         | (n,_)::l' -> Printf.fprintf h ", %s" n; args h l'
     in
     let name = Compat.capitalize_ascii msg.name in
@@ -141,7 +150,7 @@ module Gen_onboard = struct
     Printf.fprintf h "  ABI_FOREACH(abi_queues[ABI_%s_ID],e) {\n" name;
     Printf.fprintf h "    if (e->id == ABI_BROADCAST || e->id == sender_id) {\n";
     Printf.fprintf h "      abi_callback%s cb = (abi_callback%s)(e->cb);\n" name name;
-    Printf.fprintf h "      cb(sender_id";
+    Printf.fprintf h "      ABI_CALLBACK(ABI_%s_ID, e, cb(sender_id" name;
     args h msg.fields;
     Printf.fprintf h "    }\n";
     Printf.fprintf h "  }\n";
@@ -190,6 +199,9 @@ let () =
     (** Print general structure definition *)
     Gen_onboard.print_struct h highest_id;
 
+    (** Print messages names *)
+    Gen_onboard.print_names h messages;
+
     (** Print Messages callbacks definition *)
     Gen_onboard.print_callbacks h messages;
 
@@ -213,12 +213,39 @@ let print_init_functions = fun out modules ->
   lprintf out "}\n"
 
 
-let print_periodic = fun out functions_modulo task modules ->
+(** Periodic functions are profiled when the task_profiler module is loaded *)
+let profiler = ref false
+
+(** Print a periodic function call, profiled if needed
+ * the profiler index is the position in the global functions list *)
+let print_periodic_call = fun out all_functions func name ->
+  let function_name = ExtXml.attrib func "fun" in
+  if !profiler then begin
+    let rec index = fun i l ->
+      match l with
+      | [] -> failwith "Gen_modules: periodic function not found"
+      | ((f, n, _), _) :: l' -> if f == func && n = name then i else index (i+1) l'
+    in
+    lprintf out "TaskProfilerPeriodic(%d, %s);\n" (index 0 all_functions) function_name
+  end
+  else
+    lprintf out "%s;\n" function_name
+
+let print_profiler_names = fun out functions_modulo ->
+  fprintf out "\n";
+  lprintf out "#define MODULES_PROFILER_NB %d\n" (List.length functions_modulo);
+  lprintf out "#define MODULES_PROFILER_NAMES { \\\n";
+  List.iter (fun ((func, name, _), _) ->
+    lprintf out "  \"%s.%s\", \\\n" name (get_status_shortname func)
+  ) functions_modulo;
+  lprintf out "}\n"
+
+let print_periodic = fun out all_functions task modules ->
   (* filter for a given task *)
   let functions_modulo = List.filter (fun m ->
     let (_, name, _), _ = m in
     List.exists (fun m' -> m'.Module.name = name) modules
-  ) functions_modulo in
+  ) all_functions in
   (* start printing *)
   lprintf out "\nstatic inline void modules_%s_periodic_task(void) {\n" task;
   right ();
@@ -264,16 +291,15 @@ let print_periodic = fun out functions_modulo task modules ->
   fprintf out "\n";
   List.iter (fun ((func, name, delay), (p, m)) ->
     if (List.exists (fun _module -> _module.Module.name = name) modules) then begin
-      let function_name = ExtXml.attrib func "fun" in
       let p, f = get_period_and_freq func in
       if f = "(MODULES_FREQUENCY)" then
         begin
           if (is_status_lock func) then
-            lprintf out "%s;\n" function_name
+            print_periodic_call out all_functions func name
           else begin
             lprintf out "if (%s == MODULES_RUN) {\n" (get_status_name func name);
             right ();
-            lprintf out "%s;\n" function_name;
+            print_periodic_call out all_functions func name;
             left ();
             lprintf out "}\n";
           end
@@ -285,7 +311,7 @@ let print_periodic = fun out functions_modulo task modules ->
           in
           lprintf out "if (i%d == (uint32_t)(%ff * PRESCALER_%d)%s) {\n" m delay m run;
           right ();
-          lprintf out "%s;\n" function_name;
+          print_periodic_call out all_functions func name;
           left ();
           lprintf out "}\n"
         end;
@@ -354,6 +380,7 @@ let parse_modules out modules =
   let functions_modulo = get_functions_modulos modules in
   print_function_prescalers out functions_modulo;
   print_status out modules;
+  if !profiler then print_profiler_names out functions_modulo;
   fprintf out "\n";
   print_init_functions out modules;
   print_periodic_functions out functions_modulo modules;
@@ -423,6 +450,7 @@ let h_name = "MODULES_H"
 
 let generate = fun modules xml_file out_file ->
   let out = open_out out_file in
+  profiler := List.exists (fun m -> m.Module.name = "task_profiler") modules;
 
   begin_out out xml_file h_name;
   define_out out "MODULES_IDLE " "0";
@@ -84,6 +84,9 @@ let output_modes = fun out_h process_name telem_type modes ->
           let message_name = ExtXml.attrib message "name" in
           lprintf out_h "if (i%d == (uint32_t)(TELEMETRY_FREQUENCY*%s*%f)) {\n" i p _phase;
           right ();
+          fprintf out_h "#if USE_TELEMETRY_SCHEDULER\n";
+          lprintf out_h "j = telemetry_scheduler_push(&telemetry_sched_%s, telemetry, TELEMETRY_%s_MSG_%s_IDX);\n" process_name telem_type message_name;
+          fprintf out_h "#else\n";
           lprintf out_h "for (j = 0; j < TELEMETRY_NB_CBS; j++) {\n";
           right ();
           lprintf out_h "if (telemetry->cbs[TELEMETRY_%s_MSG_%s_IDX].slots[j] != NULL)\n" telem_type message_name;
@@ -93,6 +96,7 @@ let output_modes = fun out_h process_name telem_type modes ->
           lprintf out_h "else break;\n";
           left ();
           lprintf out_h "}\n";
+          fprintf out_h "#endif\n";
           fprintf out_h "#if USE_PERIODIC_TELEMETRY_REPORT\n";
           lprintf out_h "if (j == 0) periodic_telemetry_err_report(TELEMETRY_PROCESS_%s, telemetry_mode_%s, %s_MSG_ID_%s);\n" process_name process_name telem_type message_name;
           fprintf out_h "#endif\n";
@@ -173,13 +177,26 @@ let print_process_send = fun out_h xml ->
       fprintf out_h "#define TELEMETRY_MODE_%s 0\n" (Compat.uppercase_ascii process_name);
       fprintf out_h "#endif\n";
       fprintf out_h "uint8_t telemetry_mode_%s = TELEMETRY_MODE_%s;\n" process_name (Compat.uppercase_ascii process_name);
+      fprintf out_h "#if USE_TELEMETRY_SCHEDULER\n";
+      fprintf out_h "#ifndef TELEMETRY_SCHEDULER_BANDWIDTH_%s\n" (Compat.uppercase_ascii process_name);
+      fprintf out_h "#define TELEMETRY_SCHEDULER_BANDWIDTH_%s TELEMETRY_SCHEDULER_BANDWIDTH\n" (Compat.uppercase_ascii process_name);
+      fprintf out_h "#endif\n";
+      fprintf out_h "static struct telemetry_sched_msg telemetry_sched_msgs_%s[TELEMETRY_%s_NB_MSG];\n" process_name telem_type;
+      fprintf out_h "struct telemetry_scheduler telemetry_sched_%s = TELEMETRY_SCHEDULER_INIT(telemetry_sched_msgs_%s, TELEMETRY_%s_NB_MSG, TELEMETRY_FREQUENCY, TELEMETRY_SCHEDULER_BANDWIDTH_%s);\n" process_name process_name telem_type (Compat.uppercase_ascii process_name);
+      fprintf out_h "#endif\n";
       fprintf out_h "#else /* PERIODIC_C_%s not defined (general header) */\n" (Compat.uppercase_ascii process_name);
       fprintf out_h "extern uint8_t telemetry_mode_%s;\n" process_name;
+      fprintf out_h "#if USE_TELEMETRY_SCHEDULER\n";
+      fprintf out_h "extern struct telemetry_scheduler telemetry_sched_%s;\n" process_name;
+      fprintf out_h "#endif\n";
       fprintf out_h "#endif /* PERIODIC_C_%s */\n" (Compat.uppercase_ascii process_name);
 
       lprintf out_h "static inline void periodic_telemetry_send_%s(struct periodic_telemetry *telemetry, struct transport_tx *trans, struct link_device *dev) {\n" process_name;
       right ();
       output_modes out_h process_name telem_type modes;
+      fprintf out_h "#if USE_TELEMETRY_SCHEDULER\n";
+      lprintf out_h "telemetry_scheduler_run(&telemetry_sched_%s, telemetry, trans, dev);\n" process_name;
+      fprintf out_h "#endif\n";
       left ();
       lprintf out_h "}\n"
     )
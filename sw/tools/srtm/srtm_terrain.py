@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2021 The Paparazzi Team
+#
+# This file is part of paparazzi.
+#
+# paparazzi is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# paparazzi is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with paparazzi; see the file COPYING.  If not, see
+# <http://www.gnu.org/licenses/>.
+#
+
+"""
+Convert SRTM tiles (.hgt or .hgt.zip, as downloaded in data/srtm) to the
+terrain tiles used onboard by the terrain_tiles module.
+
+Each 1x1 degree tile is split in blocks x blocks square blocks, rows from
+south to north, with the last row and column shared with the next block.
+Blocks are aligned on pages so that they can be memory mapped one by one.
+See sw/airborne/modules/nav/terrain_tiles.c for the format.
+
+example: srtm_terrain.py -o terrain data/srtm/N43E001.hgt.zip
+"""
+
+from __future__ import print_function
+
+import argparse
+import array
+import os
+import re
+import struct
+import sys
+import zipfile
+
+MAGIC = b"PPRZTER1"
+HEADER = "<8shhHHIIh6x"
+NODATA = -32768
+
+
+def read_hgt(filename):
+    """ return tile name and heights (big endian int16, rows from north to south) """
+    if filename.endswith(".zip"):
+        with zipfile.ZipFile(filename) as z:
+            name = [n for n in z.namelist() if n.endswith(".hgt")][0]
+            data = z.read(name)
+    else:
+        name = filename
+        with open(filename, "rb") as f:
+            data = f.read()
+    heights = array.array("h")
+    heights.frombytes(data)
+    if sys.byteorder == "little":
+        heights.byteswap()
+    return os.path.basename(name)[:7], heights
+
+
+def tile_origin(name):
+    m = re.match(r"([NS])(\d\d)([EW])(\d\d\d)", name)
+    if m is None:
+        raise ValueError("invalid SRTM tile name: %s" % name)
+    lat = int(m.group(2)) * (1 if m.group(1) == "N" else -1)
+    lon = int(m.group(4)) * (1 if m.group(3) == "E" else -1)
+    return lat, lon
+
+
+def convert(filename, out_dir, blocks, page):
+    name, heights = read_hgt(filename)
+    lat, lon = tile_origin(name)
+    size = int(round(len(heights) ** 0.5))
+    if size * size != len(heights) or (size - 1) % blocks != 0:
+        raise ValueError("%s: %d samples can't be split in %d blocks" % (filename, len(heights), blocks))
+    samples = (size - 1) // blocks + 1
+    block_size = samples * samples * 2
+    stride = (block_size + page - 1) // page * page
+
+    out_name = os.path.join(out_dir, name + ".ter")
+    with open(out_name, "wb") as out:
+        header = struct.pack(HEADER, MAGIC, lat, lon, samples, blocks, page, stride, NODATA)
+        out.write(header + b"\0" * (page - len(header)))
+        for bj in range(blocks):
+            for bi in range(blocks):
+                block = array.array("h")
+                for r in range(samples):
+                    # hgt rows go from north to south
+                    row = size - 1 - (bj * (samples - 1) + r)
+                    start = row * size + bi * (samples - 1)
+                    block.extend(heights[start:start + samples])
+                if sys.byteorder == "big":
+                    block.byteswap()
+                out.write(block.tobytes() + b"\0" * (stride - block_size))
+    return out_name
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("files", nargs="+", help="SRTM tiles (.hgt or .hgt.zip)")
+    parser.add_argument("-o", "--output", default=".", help="output directory")
+    parser.add_argument("-b", "--blocks", type=int, default=8, help="blocks per tile side (default 8)")
+    parser.add_argument("-p", "--page", type=int, default=4096, help="page size of the target (default 4096)")
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.output):
+        os.makedirs(args.output)
+    for f in args.files:
+        print(convert(f, args.output, args.blocks, args.page))
+
+
+if __name__ == "__main__":
+    main()
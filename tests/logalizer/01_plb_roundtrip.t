@@ -0,0 +1,88 @@
+#!/usr/bin/perl -w
+
+#
+# Converts the sample ground log of sw/misc/log_parser to the binary columnar
+# format with log2plb, prints it back with plbquery merge and compares with
+# the original .data file: same messages in the same order, including the
+# messages with the same timestamp, and same values (up to the float format).
+#
+
+use Test::More tests => 8;
+use File::Temp qw(tempdir);
+use File::Copy;
+
+$|++;
+
+my $src = $ENV{'PAPARAZZI_SRC'};
+my $tmp = tempdir(CLEANUP => 1);
+my $logalizer = "$src/sw/logalizer";
+my $log = "09_05_13__14_38_13";
+
+ok(system("cc -O2 -Wall -std=gnu99 -o $tmp/log2plb $logalizer/log2plb.c $logalizer/plb.c") == 0 &&
+   system("cc -O2 -Wall -std=gnu99 -o $tmp/plbquery $logalizer/plbquery.c $logalizer/plb.c") == 0,
+   "log2plb and plbquery build");
+
+copy("$src/sw/misc/log_parser/$log.log", "$tmp/$log.log") or die;
+copy("$src/sw/misc/log_parser/$log.data", "$tmp/$log.data") or die;
+open(my $f, '<', "$tmp/$log.data") or die;
+my @original = <$f>;
+close($f);
+
+my $output = `$tmp/log2plb $tmp/$log.log 2>&1`;
+ok($? == 0 && $output =~ /: (\d+) messages in \d+ streams.*, 0 lines or frames skipped/ && $1 == @original,
+   "All the lines are converted");
+
+my @merged = `$tmp/plbquery merge $tmp/$log.plb 2>&1`;
+is(scalar(@merged), scalar(@original), "Merge prints all the messages");
+
+# time, aircraft and message of each line
+sub key { my @t = split(' ', shift); return sprintf("%.4f %s %s", $t[0], $t[1], $t[2]); }
+my @order_errors = grep { key($original[$_]) ne key($merged[$_] // '') } 0 .. $#original;
+ok(@order_errors == 0, "Messages in the original order (" . scalar(@order_errors) . " lines differ)");
+
+# fields compared as numbers, float fields are stored in single precision
+sub same_field
+{
+  my ($a, $b) = @_;
+  $a =~ s/"//g;
+  $b =~ s/"//g;
+  my @a = split(/,/, $a, -1);
+  my @b = split(/,/, $b, -1);
+  return 0 if @a != @b;
+  for my $i (0 .. $#a) {
+    if ($a[$i] =~ /^-?[\d.]+(e[-+]?\d+)?$/ && $b[$i] =~ /^-?[\d.]+(e[-+]?\d+)?$/) {
+      return 0 if abs($a[$i] - $b[$i]) > 1e-6 * (1 + abs($a[$i]));
+    } elsif ($a[$i] ne $b[$i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+my $value_errors = 0;
+for my $i (0 .. $#original) {
+  my @a = split(' ', $original[$i]);
+  my @b = split(' ', $merged[$i] // '');
+  if (@a != @b || grep { !same_field($a[$_], $b[$_]) } 3 .. $#a) {
+    $value_errors++;
+  }
+}
+ok($value_errors == 0, "Same values ($value_errors lines differ)");
+
+# invalid lines are skipped, not truncated
+open($f, '>>', "$tmp/$log.data") or die;
+print $f "70.0 61 BAT 0 35 0 1 17 0 0 42\n";      # extra field
+print $f "70.1 61 FBW_STATUS 2 1 99999\n";        # out of range uint8
+print $f "70.2 61 FBW_STATUS 2 1 35\n";
+close($f);
+$output = `$tmp/log2plb $tmp/$log.log 2>&1`;
+ok($? == 0 && $output =~ /: (\d+) messages.*, 2 lines or frames skipped/ && $1 == @original + 1,
+   "Lines with extra fields or out of range values are skipped");
+
+# corrupted files are refused
+copy("$tmp/$log.plb", "$tmp/truncated.plb") or die;
+truncate("$tmp/truncated.plb", (-s "$tmp/$log.plb") - 64) or die;
+$output = `$tmp/plbquery info $tmp/truncated.plb 2>&1`;
+ok($? != 0 && $output =~ /corrupted stream/, "Truncated file refused");
+
+$output = `$tmp/plbquery merge -t 70:71 $tmp/$log.plb 2>&1`;
+like($output, '/^70.2000 61 FBW_STATUS 2 1 35$/m', "Time slice of the merge");
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file bench_pprz_math.c
+ * @brief Native timing benchmarks of the Paparazzi math functions.
+ *
+ * Runs the benchmarks of test/math/pprz_math_bench.c and prints ns/call
+ * and cycles/call (from the time stamp counter on x86).
+ * Results are compared with a baseline file (one "name ns_per_call" per line),
+ * the program returns an error if a function is slower than the baseline
+ * by more than the tolerance.
+ *
+ * usage: bench_pprz_math [-n calls] [-b baseline] [-t tolerance_pct] [-w new_baseline]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#else
+#define BENCH_HAS_TSC 0
+#endif
+
+#include "test/math/pprz_math_bench.h"
+
+#define BENCH_NAME_LEN 64
+
+struct bench_baseline {
+  char name[BENCH_NAME_LEN];
+  float ns;
+};
+
+static uint32_t bench_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+#if BENCH_HAS_TSC
+static uint32_t bench_tsc(void)
+{
+  return (uint32_t)__rdtsc();
+}
+#endif
+
+static int read_baseline(const char *filename, struct bench_baseline *base, int max)
+{
+  FILE *f = fopen(filename, "r");
+  if (f == NULL) {
+    return -1;
+  }
+  char line[256];
+  int nb = 0;
+  while (nb < max && fgets(line, sizeof(line), f) != NULL) {
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    if (sscanf(line, "%63s %f", base[nb].name, &base[nb].ns) == 2) {
+      nb++;
+    }
+  }
+  fclose(f);
+  return nb;
+}
+
+static float find_baseline(struct bench_baseline *base, int nb, const char *name)
+{
+  int i;
+  for (i = 0; i < nb; i++) {
+    if (strcmp(base[i].name, name) == 0) {
+      return base[i].ns;
+    }
+  }
+  return -1.f;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t n = 100000;
+  const char *baseline = NULL;
+  const char *output = NULL;
+  float tolerance = 25.f;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:b:t:w:")) != -1) {
+    switch (opt) {
+      case 'n': n = (uint32_t)strtoul(optarg, NULL, 10); break;
+      case 'b': baseline = optarg; break;
+      case 't': tolerance = strtof(optarg, NULL); break;
+      case 'w': output = optarg; break;
+      default:
+        fprintf(stderr, "usage: %s [-n calls] [-b baseline] [-t tolerance_pct] [-w new_baseline]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  struct bench_baseline base[256];
+  int nb_base = 0;
+  if (baseline != NULL) {
+    nb_base = read_baseline(baseline, base, 256);
+    if (nb_base < 0) {
+      fprintf(stderr, "can't read baseline file %s\n", baseline);
+      return 2;
+    }
+  }
+
+  FILE *out = NULL;
+  if (output != NULL) {
+    out = fopen(output, "w");
+    if (out == NULL) {
+      fprintf(stderr, "can't write baseline file %s\n", output);
+      return 2;
+    }
+    fprintf(out, "# pprz math benchmark baseline, ns/call\n");
+    fprintf(out, "# generated with: bench_pprz_math -n %u -w %s\n", n, output);
+  }
+
+  pprz_math_bench_init();
+
+  int nb_regressions = 0;
+  uint8_t i;
+  printf("%-24s %12s %12s %12s %8s\n", "function", "ns/call", "cycles/call", "baseline", "diff %");
+  for (i = 0; i < pprz_math_bench_nb; i++) {
+    const char *name = pprz_math_bench_list[i].name;
+    float ns = pprz_math_bench_measure(i, n, bench_ns);
+#if BENCH_HAS_TSC
+    float cycles = pprz_math_bench_measure(i, n, bench_tsc);
+#else
+    float cycles = 0.f;
+#endif
+    float ref = find_baseline(base, nb_base, name);
+    if (ref > 0.f) {
+      float diff = 100.f * (ns - ref) / ref;
+      const char *flag = "";
+      if (diff > tolerance) {
+        flag = "  REGRESSION";
+        nb_regressions++;
+      }
+      printf("%-24s %12.2f %12.1f %12.2f %+8.1f%s\n", name, ns, cycles, ref, diff, flag);
+    } else {
+      printf("%-24s %12.2f %12.1f %12s %8s\n", name, ns, cycles, "-", "-");
+    }
+    if (out != NULL) {
+      fprintf(out, "%s %.2f\n", name, ns);
+    }
+  }
+
+  if (out != NULL) {
+    fclose(out);
+  }
+  if (nb_regressions > 0) {
+    printf("%d function(s) slower than baseline by more than %.0f%%\n", nb_regressions, tolerance);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_discrete_ekf.c
+ * @brief Tests for the relative localization EKF updates.
+ *
+ * Both filters solve the gain with the Cholesky factor of the innovation
+ * covariance. When it is not positive definite, the correction is skipped
+ * and the state must be the prediction, consistent with the covariance.
+ *
+ * Using libtap to create a TAP (TestAnythingProtocol) producer:
+ * https://github.com/zorgnax/libtap
+ */
+
+#include <stdbool.h>
+#include "tap.h"
+#include "modules/relative_localization_filter/discrete_ekf.h"
+
+static bool vect_equal(float *a, float *b, int n)
+{
+  int i;
+  for (i = 0; i < n; i++) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void test_discrete_ekf(void)
+{
+  note("--- discrete_ekf");
+  struct discrete_ekf ekf;
+  discrete_ekf_new(&ekf);
+  ekf.X[2] = 1.f; // relative velocity, so that the prediction moves
+  float Z[EKF_M] = { 1.5f, 1.f, 0.f, 0.f, 0.f, 0.f };
+
+  discrete_ekf_predict(&ekf);
+  discrete_ekf_update(&ekf, Z);
+  ok(vect_equal(ekf.X, ekf.Xp, EKF_N) == false && isfinite(ekf.X[0]), "discrete_ekf update corrects the prediction");
+
+  // negative range noise, E is not positive definite
+  ekf.R[0][0] = -1e6f;
+  float X0[EKF_N];
+  memcpy(X0, ekf.X, sizeof(X0));
+  discrete_ekf_predict(&ekf);
+  discrete_ekf_update(&ekf, Z);
+  ok(vect_equal(ekf.X, ekf.Xp, EKF_N) && !vect_equal(ekf.X, X0, EKF_N),
+     "discrete_ekf keeps the prediction when E is not positive definite");
+}
+
+#undef EKF_N
+#undef EKF_M
+#include "modules/relative_localization_filter/discrete_ekf_no_north.h"
+
+static void test_discrete_ekf_no_north(void)
+{
+  note("--- discrete_ekf_no_north");
+  struct discrete_ekf_no_north ekf;
+  discrete_ekf_no_north_new(&ekf);
+  float U[EKF_L] = { 0.5f, -0.2f, 0.1f, 0.3f, 0.f, 0.f };
+  float Z[EKF_M] = { 1.5f, 0.f, 0.f, -1.f, -1.f, 0.f, 0.f };
+
+  discrete_ekf_no_north_predict(&ekf, U);
+  discrete_ekf_no_north_update(&ekf, Z);
+  ok(vect_equal(ekf.X, ekf.Xp, EKF_N) == false && isfinite(ekf.X[0]),
+     "discrete_ekf_no_north update corrects the prediction");
+
+  ekf.R[0][0] = -1e6f;
+  float X0[EKF_N];
+  memcpy(X0, ekf.X, sizeof(X0));
+  discrete_ekf_no_north_predict(&ekf, U);
+  discrete_ekf_no_north_update(&ekf, Z);
+  ok(vect_equal(ekf.X, ekf.Xp, EKF_N) && !vect_equal(ekf.X, X0, EKF_N),
+     "discrete_ekf_no_north keeps the prediction when E is not positive definite");
+}
+
+int main()
+{
+  note("running relative localization EKF tests");
+  plan(4);
+
+  test_discrete_ekf();
+  test_discrete_ekf_no_north();
+
+  done_testing();
+}
@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_geofence_zones.c
+ * @brief Tests for the geofence zones grid index.
+ *
+ * Random concave zones are checked against a brute force point in polygon
+ * test over all the vertices. Points closer than 1 mm to a boundary are
+ * ignored, both tests may round differently there.
+ * The margin of the periodic function is checked against the distance to
+ * the nearest edge along a random walk, with the evaluations it skips.
+ *
+ * Using libtap to create a TAP (TestAnythingProtocol) producer:
+ * https://github.com/zorgnax/libtap
+ */
+
+#include "tap.h"
+#include "modules/nav/geofence_zones.h"
+#include "state.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define NB_ZONES 200
+#define NB_VERTICES 8
+#define NB_POINTS 20000
+#define EPS 1e-3
+
+/* waypoints are not used here */
+float waypoint_get_x(uint8_t wp_id __attribute__((unused))) { return 0.f; }
+float waypoint_get_y(uint8_t wp_id __attribute__((unused))) { return 0.f; }
+
+struct RefZone {
+  bool used;
+  uint8_t type;
+  float x[NB_VERTICES], y[NB_VERTICES];
+  double cx, cy;      ///< center, always inside
+};
+
+static struct RefZone ref[NB_ZONES];
+
+static double frand(double min, double max)
+{
+  return min + (max - min) * rand() / (double)RAND_MAX;
+}
+
+/** Crossing number over all edges, also returns the distance to the boundary */
+static bool ref_contains(const struct RefZone *z, double x, double y, double *dist)
+{
+  bool inside = false;
+  for (int i = 0, j = NB_VERTICES - 1; i < NB_VERTICES; j = i++) {
+    const double ax = z->x[j], ay = z->y[j];
+    const double dx = z->x[i] - ax, dy = z->y[i] - ay;
+    if ((ay > y) != (z->y[i] > y) && x < ax + (y - ay) * dx / dy) {
+      inside = !inside;
+    }
+    double t = ((x - ax) * dx + (y - ay) * dy) / (dx * dx + dy * dy);
+    t = t < 0. ? 0. : (t > 1. ? 1. : t);
+    *dist = fmin(*dist, hypot(x - ax - t * dx, y - ay - t * dy));
+  }
+  return inside;
+}
+
+static bool ref_violation(double x, double y, double *dist)
+{
+  bool keep_in = false, in_keep_in = false, in_keep_out = false;
+  *dist = 1e9;
+  for (int z = 0; z < NB_ZONES; z++) {
+    if (!ref[z].used) {
+      continue;
+    }
+    bool inside = ref_contains(&ref[z], x, y, dist);
+    if (ref[z].type == GEOFENCE_ZONES_KEEP_IN) {
+      keep_in = true;
+      in_keep_in |= inside;
+    } else {
+      in_keep_out |= inside;
+    }
+  }
+  return in_keep_out || (keep_in && !in_keep_in);
+}
+
+/** Random star shaped (generally concave) polygon */
+static int add_random_zone(int z, uint8_t type, double cx, double cy, double r)
+{
+  for (int i = 0; i < NB_VERTICES; i++) {
+    double a = 2. * M_PI * (i + frand(0.1, 0.9)) / NB_VERTICES;
+    double ri = r * frand(0.3, 1.);
+    ref[z].x[i] = cx + ri * cos(a);
+    ref[z].y[i] = cy + ri * sin(a);
+  }
+  ref[z].cx = cx;
+  ref[z].cy = cy;
+  ref[z].type = type;
+  ref[z].used = true;
+  return geofence_zones_add(ref[z].x, ref[z].y, NB_VERTICES, type);
+}
+
+/** Compare with the reference at random points
+ * @return number of mismatches away from the boundaries
+ */
+static int compare(int nb_points)
+{
+  int errors = 0;
+  for (int k = 0; k < nb_points; k++) {
+    double x = frand(-1100., 1100.), y = frand(-1100., 1100.), dist;
+    bool v = ref_violation(x, y, &dist);
+    if (dist > EPS && v != geofence_zones_check(x, y)) {
+      errors++;
+    }
+  }
+  return errors;
+}
+
+/** Run the periodic function at a position */
+static void move_to(double x, double y)
+{
+  struct EnuCoor_f pos = { x, y, 0.f };
+  stateSetPositionEnu_f(&pos);
+  geofence_zones_periodic();
+}
+
+/** Random walk, mostly small steps with some jumps
+ * @param margin_errors number of margins larger than the distance to the nearest edge
+ * @param skipped number of steps without evaluation
+ * @return number of wrong violations away from the boundaries
+ */
+static int walk(int nb_steps, int *margin_errors, int *skipped)
+{
+  int errors = 0;
+  double x = 0., y = 0.;
+  *margin_errors = 0;
+  *skipped = 0;
+  for (int k = 0; k < nb_steps; k++) {
+    float last_margin = geofence_zones.margin;
+    double nx, ny;
+    if (rand() % 10 == 0) {
+      nx = frand(-1100., 1100.);
+      ny = frand(-1100., 1100.);
+    } else {
+      nx = x + frand(-5., 5.);
+      ny = y + frand(-5., 5.);
+    }
+    const double moved = hypot(nx - x, ny - y);
+    x = nx;
+    y = ny;
+    move_to(x, y);
+    if (k > 0 && moved < last_margin) {
+      (*skipped)++;
+    }
+    double dist;
+    bool v = ref_violation(x, y, &dist);
+    if (geofence_zones.margin > dist + EPS) {
+      (*margin_errors)++;
+    }
+    if (dist > EPS && v != geofence_zones.violation) {
+      errors++;
+    }
+  }
+  return errors;
+}
+
+int main()
+{
+  note("running geofence zones tests");
+  plan(9);
+  srand(42);
+
+  geofence_zones_init();
+  // a large keep-in zone, the others are keep-out obstacles
+  add_random_zone(0, GEOFENCE_ZONES_KEEP_IN, 0., 0., 1000.);
+  bool ids_ok = true;
+  for (int z = 1; z < NB_ZONES; z++) {
+    ids_ok &= add_random_zone(z, GEOFENCE_ZONES_KEEP_OUT, frand(-900., 900.), frand(-900., 900.), 60.) == z;
+  }
+  ok(ids_ok && geofence_zones.nb_zones == NB_ZONES, "%d zones added", NB_ZONES);
+
+  int errors = compare(NB_POINTS);
+  ok(errors == 0, "grid matches brute force with %d zones (%d errors)", NB_ZONES, errors);
+
+  int margin_errors, skipped;
+  errors = walk(NB_POINTS, &margin_errors, &skipped);
+  ok(margin_errors == 0 && skipped > NB_POINTS / 4,
+     "margin is a lower bound of the distance to the zones (%d errors, %d evaluations skipped)", margin_errors, skipped);
+  ok(errors == 0, "periodic status matches brute force along the walk (%d errors)", errors);
+
+  // skipped while moving less than the margin, evaluated again beyond
+  double dist;
+  double fx, fy;
+  do {
+    fx = frand(-900., 900.);
+    fy = frand(-900., 900.);
+  } while (ref_violation(fx, fy, &dist) || dist < 10.);
+  move_to(fx, fy);
+  const float margin = geofence_zones.margin;
+  move_to(fx + margin / 2., fy);
+  bool skip_ok = !geofence_zones.violation && fabsf(geofence_zones.margin - margin / 2.f) < 1e-3f;
+  // jump to the center of the nearest keep-out zone
+  int zn = 1;
+  for (int z = 2; z < NB_ZONES; z++) {
+    if (hypot(ref[z].cx - fx, ref[z].cy - fy) < hypot(ref[zn].cx - fx, ref[zn].cy - fy)) {
+      zn = z;
+    }
+  }
+  bool in_zone = ref_violation(ref[zn].cx, ref[zn].cy, &dist) && dist > EPS;
+  move_to(ref[zn].cx, ref[zn].cy);
+  ok(skip_ok && in_zone && geofence_zones.violation && geofence_zones.margin <= dist + EPS,
+     "evaluation skipped within the margin (%f m), done again beyond it", margin);
+
+  // remove one zone out of three, including the last ones
+  bool removed_ok = true;
+  for (int z = 1; z < NB_ZONES - 1; z += 3) {
+    removed_ok &= geofence_zones_remove(z);
+    ref[z].used = false;
+  }
+  removed_ok &= geofence_zones_remove(NB_ZONES - 1) && !geofence_zones_remove(NB_ZONES - 1);
+  ref[NB_ZONES - 1].used = false;
+  ok(removed_ok, "zones removed, removing twice fails");
+
+  errors = compare(NB_POINTS);
+  ok(errors == 0, "grid matches brute force after removals (%d errors)", errors);
+
+  // freed slots are reused
+  int id = add_random_zone(1, GEOFENCE_ZONES_KEEP_OUT, 0., 0., 200.);
+  errors = compare(NB_POINTS);
+  ok(id == 1 && errors == 0, "freed slot reused, grid matches brute force (%d errors)", errors);
+
+  geofence_zones_clear();
+  ok(geofence_zones.nb_zones == 0 && !geofence_zones_check(0., 0.), "no violation without zones");
+
+  done_testing();
+}
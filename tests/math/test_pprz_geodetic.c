@@ -32,6 +32,7 @@
 #include "math/pprz_geodetic_int.h"
 #include "math/pprz_geodetic_float.h"
 #include "math/pprz_geodetic_double.h"
+#include "math/pprz_geodetic_wmm2020.h"
 
 /*
  * toulouse lat 43.6052765, lon 1.4427764, alt 180.123019274324 -> x 4624497.0 y 116475.0 z 4376563.0
@@ -376,10 +377,219 @@ static void test_lla_of_ecef(void)
   cmp_ok(lla_i.alt, "==", lla_ref_i.alt, "altitude (int) matches reference");
 }
 
+static void test_batch_conversions(void)
+{
+#define NB_BATCH 64
+  note("--- Compare batch conversions vs. single point double");
+
+  struct EcefCoor_d ref_coor_d = { 4624497.0, 116475.0, 4376563.0};
+  struct LtpDef_d ltp_def_d;
+  ltp_def_from_ecef_d(&ltp_def_d, &ref_coor_d);
+  struct LtpDef_f ltp_def_f;
+  LLA_COPY(ltp_def_f.lla, ltp_def_d.lla);
+  VECT3_COPY(ltp_def_f.ecef, ltp_def_d.ecef);
+  RMAT_COPY(ltp_def_f.ltp_of_ecef, ltp_def_d.ltp_of_ecef);
+  ltp_def_f.hmsl = ltp_def_d.hmsl;
+
+  double ex[NB_BATCH], ey[NB_BATCH], ez[NB_BATCH];
+  double lat[NB_BATCH], lon[NB_BATCH], alt[NB_BATCH];
+  double nx[NB_BATCH], ny[NB_BATCH], nz[NB_BATCH];
+  double ux[NB_BATCH], uy[NB_BATCH], uz[NB_BATCH];
+  double cx[NB_BATCH], cy[NB_BATCH], cz[NB_BATCH];
+  float fx[NB_BATCH], fy[NB_BATCH], fz[NB_BATCH];
+  float flat[NB_BATCH], flon[NB_BATCH], falt[NB_BATCH];
+  float gx[NB_BATCH], gy[NB_BATCH], gz[NB_BATCH];
+  struct Vect3Array_d ecef = { ex, ey, ez };
+  struct LlaArray_d lla = { lat, lon, alt };
+  struct Vect3Array_d ned = { nx, ny, nz };
+  struct Vect3Array_d enu = { ux, uy, uz };
+  struct Vect3Array_d ecef_check = { cx, cy, cz };
+  struct LlaArray_f lla_f = { flat, flon, falt };
+  struct Vect3Array_f ned_f = { fx, fy, fz };
+  struct Vect3Array_f ecef_f = { gx, gy, gz };
+
+  /* points up to 20km away from the reference */
+  int i;
+  for (i = 0; i < NB_BATCH; i++) {
+    ex[i] = ref_coor_d.x + 20000. * sin(0.7 * i);
+    ey[i] = ref_coor_d.y + 15000. * cos(1.3 * i);
+    ez[i] = ref_coor_d.z + 300. * i - 10000.;
+  }
+
+  lla_of_ecef_points_d(&lla, &ecef, NB_BATCH);
+  ned_of_ecef_points_d(&ned, &ltp_def_d, &ecef, NB_BATCH);
+  enu_of_lla_points_d(&enu, &ltp_def_d, &lla, NB_BATCH);
+  ecef_of_ned_points_d(&ecef_check, &ltp_def_d, &ned, NB_BATCH);
+
+  double max_lla = 0, max_ned = 0, max_enu = 0, max_ecef = 0;
+  for (i = 0; i < NB_BATCH; i++) {
+    struct EcefCoor_d e = { ex[i], ey[i], ez[i] };
+    struct LlaCoor_d l;
+    lla_of_ecef_d(&l, &e);
+    max_lla = Max(max_lla, fabs(l.lat - lat[i]) * 6378137.0);
+    max_lla = Max(max_lla, fabs(l.lon - lon[i]) * 6378137.0);
+    max_lla = Max(max_lla, fabs(l.alt - alt[i]));
+    struct NedCoor_d n;
+    ned_of_ecef_point_d(&n, &ltp_def_d, &e);
+    max_ned = Max(max_ned, fabs(n.x - nx[i]) + fabs(n.y - ny[i]) + fabs(n.z - nz[i]));
+    max_enu = Max(max_enu, fabs(n.y - ux[i]) + fabs(n.x - uy[i]) + fabs(-n.z - uz[i]));
+    max_ecef = Max(max_ecef, fabs(e.x - cx[i]) + fabs(e.y - cy[i]) + fabs(e.z - cz[i]));
+  }
+  note("max error: lla %g m, ned %g m, enu (from lla) %g m, ecef %g m", max_lla, max_ned, max_enu, max_ecef);
+  ok(max_lla < 1e-6 && max_ned < 1e-6 && max_ecef < 1e-6, "double batch ECEF -> LLA/NED -> ECEF matches single point");
+  ok(max_enu < 1e-6, "double batch LLA -> ENU matches ECEF -> ENU");
+
+  /* float version on the same LLA points, relative to the reference */
+  for (i = 0; i < NB_BATCH; i++) {
+    flat[i] = lat[i];
+    flon[i] = lon[i];
+    falt[i] = alt[i];
+  }
+  ned_of_lla_points_f(&ned_f, &ltp_def_f, &lla_f, NB_BATCH);
+  ecef_of_lla_points_f(&ecef_f, &lla_f, NB_BATCH);
+  double max_ned_f = 0, max_ecef_f = 0;
+  for (i = 0; i < NB_BATCH; i++) {
+    max_ned_f = Max(max_ned_f, fabs(nx[i] - fx[i]) + fabs(ny[i] - fy[i]) + fabs(nz[i] - fz[i]));
+    max_ecef_f = Max(max_ecef_f, fabs(ex[i] - gx[i]) + fabs(ey[i] - gy[i]) + fabs(ez[i] - gz[i]));
+  }
+  note("max error float: ned (from lla) %g m, ecef %g m", max_ned_f, max_ecef_f);
+  ok(max_ned_f < 10. && max_ecef_f < 10., "float batch LLA -> NED/ECEF within 10m of double");
+}
+
+static void test_batch_conversions_float(void)
+{
+  note("--- Compare float batch conversions vs. single point float");
+
+  struct EcefCoor_f ref_coor_f = { 4624497.0, 116475.0, 4376563.0};
+  struct LtpDef_f ltp_def_f;
+  ltp_def_from_ecef_f(&ltp_def_f, &ref_coor_f);
+
+  float ex[NB_BATCH], ey[NB_BATCH], ez[NB_BATCH];
+  float lat[NB_BATCH], lon[NB_BATCH], alt[NB_BATCH];
+  float ux[NB_BATCH], uy[NB_BATCH], uz[NB_BATCH];
+  float nx[NB_BATCH], ny[NB_BATCH], nz[NB_BATCH];
+  float lux[NB_BATCH], luy[NB_BATCH], luz[NB_BATCH];
+  float lnx[NB_BATCH], lny[NB_BATCH], lnz[NB_BATCH];
+  float cx[NB_BATCH], cy[NB_BATCH], cz[NB_BATCH];
+  float dx[NB_BATCH], dy[NB_BATCH], dz[NB_BATCH];
+  float gx[NB_BATCH], gy[NB_BATCH], gz[NB_BATCH];
+  struct Vect3Array_f ecef = { ex, ey, ez };
+  struct LlaArray_f lla = { lat, lon, alt };
+  struct Vect3Array_f enu = { ux, uy, uz };
+  struct Vect3Array_f ned = { nx, ny, nz };
+  struct Vect3Array_f enu_lla = { lux, luy, luz };
+  struct Vect3Array_f ned_lla = { lnx, lny, lnz };
+  struct Vect3Array_f ecef_enu = { cx, cy, cz };
+  struct Vect3Array_f ecef_ned = { dx, dy, dz };
+  struct Vect3Array_f ecef_lla = { gx, gy, gz };
+
+  /* float ECEF coordinates have a resolution of 0.5m, tolerances are a few ulp */
+  int i;
+  for (i = 0; i < NB_BATCH; i++) {
+    ex[i] = ref_coor_f.x + 20000.f * sinf(0.7f * i);
+    ey[i] = ref_coor_f.y + 15000.f * cosf(1.3f * i);
+    ez[i] = ref_coor_f.z + 300.f * i - 10000.f;
+  }
+
+  lla_of_ecef_points_f(&lla, &ecef, NB_BATCH);
+  enu_of_ecef_points_f(&enu, &ltp_def_f, &ecef, NB_BATCH);
+  ned_of_ecef_points_f(&ned, &ltp_def_f, &ecef, NB_BATCH);
+  enu_of_lla_points_f(&enu_lla, &ltp_def_f, &lla, NB_BATCH);
+  ned_of_lla_points_f(&ned_lla, &ltp_def_f, &lla, NB_BATCH);
+  ecef_of_enu_points_f(&ecef_enu, &ltp_def_f, &enu, NB_BATCH);
+  ecef_of_ned_points_f(&ecef_ned, &ltp_def_f, &ned, NB_BATCH);
+  ecef_of_lla_points_f(&ecef_lla, &lla, NB_BATCH);
+
+  double max_lla = 0, max_enu = 0, max_ned = 0, max_enu_lla = 0, max_ned_lla = 0;
+  double max_ecef_enu = 0, max_ecef_ned = 0, max_ecef_lla = 0;
+  for (i = 0; i < NB_BATCH; i++) {
+    struct EcefCoor_f e = { ex[i], ey[i], ez[i] };
+    struct LlaCoor_f l;
+    lla_of_ecef_f(&l, &e);
+    max_lla = Max(max_lla, fabs(l.lat - lat[i]) * 6378137.0);
+    max_lla = Max(max_lla, fabs(l.lon - lon[i]) * 6378137.0);
+    max_lla = Max(max_lla, fabs(l.alt - alt[i]));
+
+    struct EnuCoor_f u;
+    enu_of_ecef_point_f(&u, &ltp_def_f, &e);
+    max_enu = Max(max_enu, fabs(u.x - ux[i]) + fabs(u.y - uy[i]) + fabs(u.z - uz[i]));
+    struct NedCoor_f n;
+    ned_of_ecef_point_f(&n, &ltp_def_f, &e);
+    max_ned = Max(max_ned, fabs(n.x - nx[i]) + fabs(n.y - ny[i]) + fabs(n.z - nz[i]));
+
+    /* from the batch LLA output, so that only the LLA -> local step is compared */
+    struct LlaCoor_f lb = { lat[i], lon[i], alt[i] };
+    enu_of_lla_point_f(&u, &ltp_def_f, &lb);
+    max_enu_lla = Max(max_enu_lla, fabs(u.x - lux[i]) + fabs(u.y - luy[i]) + fabs(u.z - luz[i]));
+    ned_of_lla_point_f(&n, &ltp_def_f, &lb);
+    max_ned_lla = Max(max_ned_lla, fabs(n.x - lnx[i]) + fabs(n.y - lny[i]) + fabs(n.z - lnz[i]));
+
+    struct EcefCoor_f c;
+    struct EnuCoor_f ub = { ux[i], uy[i], uz[i] };
+    ecef_of_enu_point_f(&c, &ltp_def_f, &ub);
+    max_ecef_enu = Max(max_ecef_enu, fabs(c.x - cx[i]) + fabs(c.y - cy[i]) + fabs(c.z - cz[i]));
+    struct NedCoor_f nb = { nx[i], ny[i], nz[i] };
+    ecef_of_ned_point_f(&c, &ltp_def_f, &nb);
+    max_ecef_ned = Max(max_ecef_ned, fabs(c.x - dx[i]) + fabs(c.y - dy[i]) + fabs(c.z - dz[i]));
+    ecef_of_lla_f(&c, &lb);
+    max_ecef_lla = Max(max_ecef_lla, fabs(c.x - gx[i]) + fabs(c.y - gy[i]) + fabs(c.z - gz[i]));
+  }
+  note("max error: lla %g m, enu %g m, ned %g m, enu (from lla) %g m, ned (from lla) %g m",
+       max_lla, max_enu, max_ned, max_enu_lla, max_ned_lla);
+  note("max error: ecef (from enu) %g m, ecef (from ned) %g m, ecef (from lla) %g m",
+       max_ecef_enu, max_ecef_ned, max_ecef_lla);
+  ok(max_lla < 2., "float batch ECEF -> LLA matches single point");
+  ok(max_enu < 0.1 && max_ned < 0.1, "float batch ECEF -> ENU/NED matches single point");
+  ok(max_enu_lla < 2. && max_ned_lla < 2., "float batch LLA -> ENU/NED matches single point");
+  ok(max_ecef_enu < 2. && max_ecef_ned < 2. && max_ecef_lla < 2., "float batch ENU/NED/LLA -> ECEF matches single point");
+}
+
+static void test_wmm2020_cache(void)
+{
+  note("--- Compare cached WMM2020 vs. direct evaluation");
+
+  double date = 2021.5;
+  double gha[MAXCOEFF];
+  int16_t nmax = extrapsh(date, GEO_EPOCH, NMAX_1, NMAX_2, gha);
+  struct Wmm2020Cache cache;
+  wmm2020_cache_init(&cache, date);
+
+  /* straight flight from Toulouse to the north east, climbing */
+  int i, nb_eval = 0, max_eval = 0;
+  double max_err = 0;
+  for (i = 0; i < 200; i++) {
+    float lat = 43.6f + 0.01f * i;
+    float lon = 1.44f + 0.013f * i;
+    float alt = 0.2f + 0.01f * i;
+    struct FloatVect3 h;
+    int n = wmm2020_cache_get(&cache, &h, lat, lon, alt);
+    nb_eval += n;
+    if (i > 0) {
+      max_eval = Max(max_eval, n);
+    }
+    double x, y, z;
+    mag_calc(1, lat, lon, alt, nmax, gha, &x, &y, &z, IEXT, EXT_COEFF1, EXT_COEFF2, EXT_COEFF3);
+    double err = sqrt((x - h.x) * (x - h.x) + (y - h.y) * (y - h.y) + (z - h.z) * (z - h.z));
+    max_err = Max(max_err, err / sqrt(x * x + y * y + z * z));
+  }
+  note("max relative error %g, %d evaluations for 200 points, max %d per call after the first one",
+       max_err, nb_eval, max_eval);
+  ok(max_err < 1e-3, "cached WMM2020 within 0.1%% of direct evaluation");
+  ok(max_eval <= 1 && nb_eval < 60, "cached WMM2020 corners are prepared ahead, at most one evaluation per call");
+
+  /* jump to a cell that was not prepared, corners computed at once */
+  struct FloatVect3 h;
+  int n = wmm2020_cache_get(&cache, &h, -33.9f, 151.2f, 0.1f);
+  double x, y, z;
+  mag_calc(1, -33.9, 151.2, 0.1, nmax, gha, &x, &y, &z, IEXT, EXT_COEFF1, EXT_COEFF2, EXT_COEFF3);
+  double err = sqrt((x - h.x) * (x - h.x) + (y - h.y) * (y - h.y) + (z - h.z) * (z - h.z)) / sqrt(x * x + y * y + z * z);
+  ok(n == 8 && err < 1e-3, "cached WMM2020 computes all corners of a cell that was not prepared");
+}
+
 int main()
 {
   note("runing geodetic math tests");
-  plan(13);
+  plan(23);
 
   test_ecef_of_ned_int();
   test_enu_of_ecef_int();
@@ -387,6 +597,9 @@ int main()
   test_ecef_to_enu_to_ecef_float();
   test_lla_of_utm();
   test_lla_of_ecef();
+  test_batch_conversions();
+  test_batch_conversions_float();
+  test_wmm2020_cache();
 
   done_testing();
 }
@@ -30,11 +30,12 @@
 #include "tap.h"
 #include "math/pprz_algebra_int.h"
 #include "math/pprz_algebra_float.h"
+#include "math/pprz_matrix_fixed_float.h"
 
 int main()
 {
   note("running algebra math tests");
-  plan(3);
+  plan(6);
 
   /* test int32_vect2_normalize */
   struct Int32Vect2 v = {2300, -4200};
@@ -58,5 +59,46 @@ int main()
      "float_quat_of_eulers_zxy(float_eulers_of_quat_zxy(0.9266,   -0.2317,    0.1165,    0.2722)) returned [%f, %f, %f, %f]", quat_zxy.qi, quat_zxy.qx, quat_zxy.qy, quat_zxy.qz);
 
 
+  /* test fixed size matrices: A = M*M' + I is positive definite */
+  float M[4][4] = {{1, 2, 0, -1}, {0.5, 1, 3, 0}, {-2, 0, 1, 1}, {0, 1, -1, 2}};
+  float A[4][4], L[4][4], D[4];
+  float_mat_fixed_mul_t(&A[0][0], &M[0][0], &M[0][0], 4, 4, 4);
+  int i, j;
+  for (i = 0; i < 4; i++) {
+    A[i][i] += 1.f;
+  }
+  float b[4] = {1, -2, 3, 0.5}, x[4], y[4];
+
+  bool chol_ok = float_mat_fixed_cholesky(&L[0][0], &A[0][0], 4);
+  float_mat_fixed_cholesky_solve(x, &L[0][0], b, 4);
+  float_mat_fixed_vmul(y, &A[0][0], x, 4, 4);
+  float err = 0.f;
+  for (i = 0; i < 4; i++) {
+    err = Max(err, fabsf(y[i] - b[i]));
+  }
+  ok(chol_ok && err < 1e-4, "float_mat_fixed_cholesky_solve residual %g", err);
+
+  bool ldlt_ok = float_mat_fixed_ldlt(&L[0][0], D, &A[0][0], 4);
+  float_mat_fixed_ldlt_solve(x, &L[0][0], D, b, 4);
+  float_mat_fixed_vmul(y, &A[0][0], x, 4, 4);
+  err = 0.f;
+  for (i = 0; i < 4; i++) {
+    err = Max(err, fabsf(y[i] - b[i]));
+  }
+  ok(ldlt_ok && err < 1e-4, "float_mat_fixed_ldlt_solve residual %g", err);
+
+  /* multiple right hand sides: A * X = A gives identity */
+  float X[4][4];
+  float_mat_fixed_cholesky(&L[0][0], &A[0][0], 4);
+  memcpy(X, A, sizeof(X));
+  float_mat_fixed_cholesky_solve_mat(&X[0][0], &L[0][0], 4, 4);
+  err = 0.f;
+  for (i = 0; i < 4; i++) {
+    for (j = 0; j < 4; j++) {
+      err = Max(err, fabsf(X[i][j] - (i == j ? 1.f : 0.f)));
+    }
+  }
+  ok(err < 1e-4, "float_mat_fixed_cholesky_solve_mat residual %g", err);
+
   done_testing();
 }
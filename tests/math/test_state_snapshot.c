@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_state_snapshot.c
+ * @brief Tests for the published state snapshots (USE_STATE_SNAPSHOT).
+ *
+ * A writer thread publishes states where the position and the acceleration
+ * hold the same counter, while the main thread reads the snapshots and
+ * checks that no copy mixes two publications.
+ *
+ * Using libtap to create a TAP (TestAnythingProtocol) producer:
+ * https://github.com/zorgnax/libtap
+ */
+
+#include "tap.h"
+#include "state.h"
+#include "mcu_periph/sys_time.h"
+#include <pthread.h>
+
+#define NB_PUBLISH 1000000
+
+struct sys_time sys_time = { .cpu_ticks_per_sec = 1000000 };
+
+static volatile bool writer_done;
+
+/** Position and acceleration set to the same counter */
+static void set_state(int32_t k)
+{
+  struct NedCoor_i pos = { k, -k, k / 2 };
+  struct NedCoor_i accel = { k, k, -k };
+  stateSetPositionNed_i(&pos);
+  stateSetAccelNed_i(&accel);
+}
+
+static void *writer(void *data __attribute__((unused)))
+{
+  for (int32_t k = 1; k <= NB_PUBLISH; k++) {
+    set_state(k);
+    stateSnapshotPublish();
+  }
+  writer_done = true;
+  return NULL;
+}
+
+int main()
+{
+  note("running state snapshot tests");
+  plan(5);
+
+  stateInit();
+  state.ned_initialized_i = true;
+  state.ned_initialized_f = true;
+
+  struct StateSnapshot snap;
+  ok(!stateSnapshotRead(&snap), "no snapshot before the first publication");
+
+  set_state(0);
+  stateSnapshotPublish();
+  bool read = stateSnapshotRead(&snap);
+  ok(read && snap.cycle == 1 && snap.state.ned_pos_i.y == 0 && bit_is_set(snap.state.pos_status, POS_NED_F),
+     "snapshot published with the converted representations");
+
+  // concurrent reads while publishing
+  pthread_t th;
+  writer_done = false;
+  pthread_create(&th, NULL, writer, NULL);
+  uint32_t nb_reads = 0, nb_torn = 0, nb_back = 0, last_cycle = 0;
+  bool valid = true;
+  while (!writer_done) {
+    valid &= stateSnapshotRead(&snap);
+    const struct NedCoor_i *pos = &snap.state.ned_pos_i, *accel = &snap.state.ned_accel_i;
+    int32_t k = pos->x;
+    if (pos->y != -k || pos->z != k / 2 || accel->x != k || accel->y != k || accel->z != -k ||
+        snap.cycle != (uint32_t)k + 1 || snap.state.ned_pos_f.x != POS_FLOAT_OF_BFP(k)) {
+      nb_torn++;
+    }
+    if (snap.cycle < last_cycle) {
+      nb_back++;
+    }
+    last_cycle = snap.cycle;
+    nb_reads++;
+  }
+  pthread_join(th, NULL);
+  note("%u reads during %d publications", nb_reads, NB_PUBLISH);
+  ok(valid && nb_torn == 0, "no torn snapshot (%u)", nb_torn);
+  ok(nb_back == 0, "snapshots are read in publication order (%u back)", nb_back);
+
+  read = stateSnapshotRead(&snap);
+  ok(read && snap.cycle == NB_PUBLISH + 1 && snap.state.ned_accel_i.z == -NB_PUBLISH, "last publication is read");
+
+  done_testing();
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_terrain_tiles.c
+ * @brief Tests for the terrain tiles converter and onboard lookup.
+ *
+ * A synthetic SRTM tile with a linear height field is converted with
+ * sw/tools/srtm/srtm_terrain.py, then the file layout, the interpolated
+ * heights, the block LRU and the segment prefetch are checked.
+ * mmap is wrapped (-Wl,--wrap=mmap) to count the mapped blocks.
+ *
+ * Using libtap to create a TAP (TestAnythingProtocol) producer:
+ * https://github.com/zorgnax/libtap
+ */
+
+#include "tap.h"
+#include "modules/nav/terrain_tiles.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TILE_LAT 43
+#define TILE_LON 1
+#define SIZE 121
+#define BLOCKS 4
+#define SAMPLES ((SIZE - 1) / BLOCKS + 1)
+#define PAGE 4096
+
+/* waypoints are not used here */
+float waypoint_get_x(uint8_t wp_id __attribute__((unused))) { return 0.f; }
+float waypoint_get_y(uint8_t wp_id __attribute__((unused))) { return 0.f; }
+
+static int nb_mmap;
+
+void *__real_mmap(void *addr, size_t len, int prot, int flags, int fd, off_t offset);
+void *__wrap_mmap(void *addr, size_t len, int prot, int flags, int fd, off_t offset)
+{
+  nb_mmap++;
+  return __real_mmap(addr, len, prot, flags, fd, offset);
+}
+
+/** Height of sample x (east) y (north) from the south-west corner */
+static int16_t height(int x, int y)
+{
+  return 100 + 10 * x + 3 * y;
+}
+
+/** Position in blocks from the south-west corner of the tile */
+static struct LlaCoor_i lla_of_block(double bx, double by)
+{
+  struct LlaCoor_i lla = {
+    .lat = TILE_LAT * 10000000 + (int32_t)(by * 1e7 / BLOCKS),
+    .lon = TILE_LON * 10000000 + (int32_t)(bx * 1e7 / BLOCKS),
+    .alt = 0
+  };
+  return lla;
+}
+
+/** Write the SRTM tile, rows from north to south, big endian */
+static bool write_hgt(const char *name)
+{
+  FILE *f = fopen(name, "wb");
+  if (f == NULL) {
+    return false;
+  }
+  for (int row = 0; row < SIZE; row++) {
+    for (int col = 0; col < SIZE; col++) {
+      int16_t h = height(col, SIZE - 1 - row);
+      uint8_t be[2] = { (uint8_t)((uint16_t)h >> 8), (uint8_t)h };
+      fwrite(be, 1, 2, f);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static int16_t le16(const uint8_t *p)
+{
+  return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void test_converter(const char *ter)
+{
+  note("--- srtm_terrain.py output");
+  FILE *f = fopen(ter, "rb");
+  uint8_t hdr[32] = { 0 };
+  bool hdr_ok = f != NULL && fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr) &&
+                memcmp(hdr, "PPRZTER1", 8) == 0 && le16(&hdr[8]) == TILE_LAT && le16(&hdr[10]) == TILE_LON &&
+                le16(&hdr[12]) == SAMPLES && le16(&hdr[14]) == BLOCKS &&
+                le32(&hdr[16]) == PAGE && le32(&hdr[20]) == PAGE && le16(&hdr[24]) == -32768;
+  ok(hdr_ok, "header: %d blocks of %d samples, page aligned", BLOCKS, SAMPLES);
+
+  // every sample of every block, rows from south to north
+  int errors = 0;
+  int16_t block[SAMPLES * SAMPLES];
+  for (int bj = 0; bj < BLOCKS && f != NULL; bj++) {
+    for (int bi = 0; bi < BLOCKS; bi++) {
+      fseek(f, PAGE + (bj * BLOCKS + bi) * PAGE, SEEK_SET);
+      uint8_t raw[sizeof(block)];
+      if (fread(raw, 1, sizeof(raw), f) != sizeof(raw)) {
+        errors++;
+        continue;
+      }
+      for (int k = 0; k < SAMPLES * SAMPLES; k++) {
+        block[k] = le16(&raw[2 * k]);
+      }
+      for (int r = 0; r < SAMPLES; r++) {
+        for (int c = 0; c < SAMPLES; c++) {
+          if (block[r * SAMPLES + c] != height(bi * (SAMPLES - 1) + c, bj * (SAMPLES - 1) + r)) {
+            errors++;
+          }
+        }
+      }
+    }
+  }
+  ok(f != NULL && errors == 0, "blocks match the SRTM samples, borders shared (%d errors)", errors);
+  if (f != NULL) {
+    fclose(f);
+  }
+}
+
+static void test_lookup(void)
+{
+  note("--- lookup");
+  terrain_tiles_init();
+  float max_err = 0.f;
+  bool valid = true;
+  for (int k = 0; k < 1000; k++) {
+    double x = (SIZE - 1) * (rand() / (double)RAND_MAX);
+    double y = (SIZE - 1) * (rand() / (double)RAND_MAX);
+    struct LlaCoor_i lla = lla_of_block(x / (SAMPLES - 1), y / (SAMPLES - 1));
+    // exact sample position of the truncated coordinates
+    double xs = (lla.lon - TILE_LON * 1e7) * (SIZE - 1) / 1e7;
+    double ys = (lla.lat - TILE_LAT * 1e7) * (SIZE - 1) / 1e7;
+    float h;
+    valid &= terrain_tiles_height(&h, &lla);
+    max_err = fmaxf(max_err, (float)fabs(h - (100. + 10. * xs + 3. * ys)));
+  }
+  ok(valid && max_err < 0.05f, "interpolated heights match the linear terrain (max err %f m)", max_err);
+
+  struct LlaCoor_i outside = lla_of_block(-0.5, 1.5);
+  float h;
+  ok(!terrain_tiles_height(&h, &outside), "no height without a tile file");
+}
+
+static void test_lru(void)
+{
+  note("--- block LRU");
+  float h;
+  terrain_tiles_init();
+  nb_mmap = 0;
+  // fill the cache with blocks 0 to 7
+  for (int b = 0; b < 8; b++) {
+    struct LlaCoor_i p = lla_of_block(b % BLOCKS + 0.5, b / BLOCKS + 0.5);
+    terrain_tiles_height(&h, &p);
+  }
+  ok(nb_mmap == 8, "one mapping per new block (%d)", nb_mmap);
+
+  struct LlaCoor_i b0 = lla_of_block(0.5, 0.5);
+  struct LlaCoor_i b1 = lla_of_block(1.5, 0.5);
+  struct LlaCoor_i b2 = lla_of_block(2.5, 0.5);
+  struct LlaCoor_i b8 = lla_of_block(0.5, 2.5);
+  nb_mmap = 0;
+  terrain_tiles_height(&h, &b0);
+  terrain_tiles_height(&h, &b8);  // evicts block 1, the least recently used
+  terrain_tiles_height(&h, &b0);
+  terrain_tiles_height(&h, &b2);
+  ok(nb_mmap == 1, "cached blocks are not mapped again (%d)", nb_mmap);
+  terrain_tiles_height(&h, &b1);
+  ok(nb_mmap == 2, "least recently used block evicted (%d)", nb_mmap);
+}
+
+static void test_prefetch(void)
+{
+  note("--- segment prefetch");
+  terrain_tiles_init();
+  nb_mmap = 0;
+  // crosses block (1, 0) only through its north-west corner
+  struct LlaCoor_i from = lla_of_block(0.1, 0.9);
+  struct LlaCoor_i to = lla_of_block(1.7, 1.06);
+  terrain_tiles_prefetch_segment(&from, &to);
+  int nb_prefetch = nb_mmap;
+  float h;
+  struct LlaCoor_i corner = lla_of_block(1.05, 0.997);
+  terrain_tiles_height(&h, &corner);
+  ok(nb_prefetch == 3 && nb_mmap == 3, "blocks clipped by a corner are prefetched (%d, %d)", nb_prefetch, nb_mmap);
+}
+
+int main()
+{
+  note("running terrain tiles tests");
+  plan(8);
+
+  const char *src = getenv("PAPARAZZI_SRC");
+  char cmd[1024];
+  mkdir(TERRAIN_TILES_PATH, 0755);
+  if (!write_hgt(TERRAIN_TILES_PATH "/N43E001.hgt")) {
+    BAIL_OUT("can't write the SRTM tile");
+  }
+  snprintf(cmd, sizeof(cmd), "python3 %s/sw/tools/srtm/srtm_terrain.py -b %d -p %d -o %s %s/N43E001.hgt > /dev/null",
+           src ? src : "../..", BLOCKS, PAGE, TERRAIN_TILES_PATH, TERRAIN_TILES_PATH);
+  if (system(cmd) != 0) {
+    BAIL_OUT("srtm_terrain.py failed");
+  }
+
+  test_converter(TERRAIN_TILES_PATH "/N43E001.ter");
+  test_lookup();
+  test_lru();
+  test_prefetch();
+
+  unlink(TERRAIN_TILES_PATH "/N43E001.hgt");
+  unlink(TERRAIN_TILES_PATH "/N43E001.ter");
+  rmdir(TERRAIN_TILES_PATH);
+
+  done_testing();
+}
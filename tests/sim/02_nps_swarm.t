@@ -0,0 +1,53 @@
+#!/usr/bin/perl -w
+
+#
+# Runs the NPS swarm host with a stub vehicle library (nps_swarm_stub_vehicle.c)
+# loaded several times: checks that each copy has its own globals, that the
+# traffic is routed to the other vehicles and that --jobs > 1 is refused
+# unless all the vehicles are re-entrant.
+#
+
+use Test::More tests => 9;
+use File::Temp qw(tempdir);
+
+$|++;
+
+my $src = $ENV{'PAPARAZZI_SRC'};
+my $tmp = tempdir(CLEANUP => 1);
+my $host = "$tmp/nps_swarm";
+my $stub = "$tmp/stub.so";
+
+ok(system("cc -O2 -Wall -std=gnu99 -I$src/sw/simulator/nps -o $host $src/sw/simulator/nps/nps_swarm.c -ldl -lpthread") == 0,
+   "The swarm host builds");
+ok(system("cc -O2 -Wall -std=gnu99 -fPIC -shared -I$src/sw/simulator/nps -o $stub $src/tests/sim/nps_swarm_stub_vehicle.c") == 0,
+   "The stub vehicle library builds");
+
+sub write_vehicles
+{
+  my $name = shift;
+  open(my $f, '>', "$tmp/$name") or die;
+  print $f "# stub vehicles\n\n";
+  print $f "$stub $_\n" foreach @_;
+  close($f);
+  return "$tmp/$name";
+}
+
+# three copies of the same library, traffic every 10 steps
+my $vehicles = write_vehicles("vehicles", "--ac_id 1", "--ac_id 2", "--ac_id 3");
+my $output = `$host --vehicles $vehicles --duration 1 --traffic_period 0.1 2>&1`;
+is($?, 0, "The host runs three vehicles");
+like($output, '/Running 3 vehicles on 1 threads/', "One thread by default");
+my %stubs = $output =~ /^stub (\d+) (.*)$/mg;
+is(scalar(keys %stubs), 3, "All the vehicles finished");
+ok((grep { $stubs{$_} =~ /^steps 100 / } keys %stubs) == 3, "Each copy of the library counted its own steps");
+# each vehicle sees the two others, last routed at the last step (1 s)
+ok($stubs{1} =~ /seen c 2:100 3:100$/ && $stubs{2} =~ /seen a 1:100 3:100$/ && $stubs{3} =~ /seen 6 1:100 2:100$/,
+   "Traffic is routed to the other vehicles only");
+
+$output = `$host --vehicles $vehicles --duration 1 --jobs 2 2>&1`;
+ok($? != 0 && $output =~ /not re-entrant/, "--jobs 2 refused with non re-entrant vehicles");
+
+$vehicles = write_vehicles("vehicles_mt", "--ac_id 1 --reentrant", "--ac_id 2 --reentrant", "--ac_id 3 --reentrant");
+$output = `$host --vehicles $vehicles --duration 1 --jobs 2 2>&1`;
+ok($? == 0 && $output =~ /Running 3 vehicles on 2 threads/ && (() = $output =~ /^stub \d+ steps 100 /mg) == 3,
+   "--jobs 2 runs re-entrant vehicles");
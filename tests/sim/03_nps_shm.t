@@ -0,0 +1,38 @@
+#!/usr/bin/perl -w
+
+#
+# Runs the NPS shared memory ring writer and reader (nps_shm_writer.c,
+# nps_shm_reader.c) with nps_shm_ring_test.c: checks the lost count when the
+# writer laps a reader, nps_shm_reader_latest, and the order and the step
+# stamps of the samples read while a writer thread publishes them.
+#
+
+use Test::More tests => 9;
+use File::Temp qw(tempdir);
+
+$|++;
+
+my $src = $ENV{'PAPARAZZI_SRC'};
+my $tmp = tempdir(CLEANUP => 1);
+my $test = "$tmp/nps_shm_ring_test";
+my $nps = "$src/sw/simulator/nps";
+
+ok(system("cc -O2 -Wall -std=gnu99 -I$nps -o $test $src/tests/sim/nps_shm_ring_test.c $nps/nps_shm_writer.c $nps/nps_shm_reader.c -lrt -lpthread -lm") == 0,
+   "The ring test builds");
+
+# capacity of 16 samples, single thread
+my $output = `$test /nps_shm_test_$$ lost 2>&1`;
+is($?, 0, "The writer and the readers open the ring");
+like($output, '/^empty 0$/m', "Nothing to read in an empty ring");
+like($output, '/^first 3 lost 0$/m', "Samples read in order");
+like($output, '/^lapped 16 in_order 16 lost 21$/m', "Overwritten samples are counted as lost");
+like($output, '/^oldest 29 lost 0$/m', "A new reader starts from the oldest sample");
+like($output, '/^latest 44 read 1 next 0 lost 21$/m', "Latest skips to the last sample without losing any");
+
+# writer thread alternating paced phases and bursts, the reader is lapped
+$output = `$test /nps_shm_test_$$ stress 2>&1`;
+my ($read, $lost, $total, $torn, $back, $last) =
+  $output =~ /^read (\d+) lost (\d+) total (\d+) torn (\d+) back (\d+) last (\d+)$/m;
+ok($? == 0 && defined($read) && $read > 0 && $lost > 0 && $total == 2000000 && $last == 1999999,
+   "Every sample is read or counted as lost");
+ok(defined($torn) && $torn == 0 && $back == 0, "Samples are whole, in order and stamped with their step");
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_shm_ring_test.c
+ * Writer and readers of the NPS shared memory ring, for 03_nps_shm.t.
+ *
+ * Usage: nps_shm_ring_test <shm name> <lost|stress>
+ *  - lost: single thread, checks the lost count when the writer laps the
+ *    reader, the first sample of a new reader and nps_shm_reader_latest
+ *  - stress: a writer thread publishes samples while the main thread reads
+ *    them, checks the order, the step stamps, that no copy mixes two
+ *    samples and that every sample is either read or counted as lost
+ * Sample k is published at step 3k (idle steps skipped) with all its
+ * payload set to k. Results are printed as "key value" lines.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "nps_shm_writer.h"
+#include "nps_shm_reader.h"
+
+#define DT (1. / 512.)
+#define CAPACITY 16
+#define STRESS_CAPACITY 64
+#define STRESS_NB 2000000
+#define STEP_OF(_k) (3 * (uint64_t)(_k))
+
+static const char *name;
+static volatile int writer_done;
+
+static void publish(uint64_t k)
+{
+  struct NpsShmSample *s = nps_shm_writer_begin(STEP_OF(k) * DT);
+  for (int i = 0; i < 3; i++) {
+    s->ned_pos[i] = k;
+    s->gyro[i] = k;
+  }
+  s->commands_nb = 1;
+  s->commands[0] = k;
+  nps_shm_writer_end();
+}
+
+/** Sample index from the payload, -1 if the copy is torn or badly stamped */
+static int64_t index_of(const struct NpsShmSample *s)
+{
+  double k = s->ned_pos[0];
+  for (int i = 0; i < 3; i++) {
+    if (s->ned_pos[i] != k || s->gyro[i] != k) {
+      return -1;
+    }
+  }
+  if (s->commands_nb != 1 || s->commands[0] != k || s->step != STEP_OF(k) || s->time != STEP_OF(k) * DT) {
+    return -1;
+  }
+  return (int64_t)k;
+}
+
+static int test_lost(void)
+{
+  struct NpsShmReader r, r2;
+  struct NpsShmSample s;
+  uint64_t k = 0;
+  if (!nps_shm_writer_init(name, CAPACITY, DT) || nps_shm_reader_open(&r, name) != 0) {
+    return 1;
+  }
+  printf("empty %d\n", nps_shm_reader_next(&r, &s) + nps_shm_reader_latest(&r, &s));
+
+  for (; k < 10; k++) {
+    publish(k);
+  }
+  int first = 0;
+  for (int i = 0; i < 3 && nps_shm_reader_next(&r, &s) == 1; i++) {
+    first += index_of(&s) == i;
+  }
+  printf("first %d lost %llu\n", first, (unsigned long long)r.lost);
+
+  // the writer laps the reader, samples 3 to 23 are overwritten
+  for (; k < 40; k++) {
+    publish(k);
+  }
+  int nb = 0, in_order = 0;
+  while (nps_shm_reader_next(&r, &s) == 1) {
+    in_order += index_of(&s) == 24 + nb;
+    nb++;
+  }
+  printf("lapped %d in_order %d lost %llu\n", nb, in_order, (unsigned long long)r.lost);
+
+  // a new reader starts from the oldest available sample
+  for (; k < 45; k++) {
+    publish(k);
+  }
+  if (nps_shm_reader_open(&r2, name) != 0) {
+    return 1;
+  }
+  nps_shm_reader_next(&r2, &s);
+  printf("oldest %lld lost %llu\n", (long long)index_of(&s), (unsigned long long)r2.lost);
+
+  // latest skips the unread samples without counting them as lost
+  int latest = nps_shm_reader_latest(&r, &s);
+  int64_t idx = index_of(&s);
+  int next = nps_shm_reader_next(&r, &s);
+  printf("latest %lld read %d next %d lost %llu\n", (long long)idx, latest, next, (unsigned long long)r.lost);
+
+  nps_shm_reader_close(&r);
+  nps_shm_reader_close(&r2);
+  nps_shm_writer_close();
+  return 0;
+}
+
+static void *writer(void *data __attribute__((unused)))
+{
+  for (uint64_t k = 0; k < STRESS_NB; k++) {
+    publish(k);
+    // alternate paced phases, where the reader keeps up, and bursts lapping it
+    if ((k / 10000) % 2 == 0 && k % 16 == 0) {
+      sched_yield();
+    }
+  }
+  writer_done = 1;
+  return NULL;
+}
+
+static int test_stress(void)
+{
+  struct NpsShmReader r;
+  struct NpsShmSample s;
+  if (!nps_shm_writer_init(name, STRESS_CAPACITY, DT) || nps_shm_reader_open(&r, name) != 0) {
+    return 1;
+  }
+  pthread_t th;
+  pthread_create(&th, NULL, writer, NULL);
+  uint64_t nb = 0, torn = 0, back = 0;
+  int64_t last = -1;
+  while (1) {
+    // read the last samples after the writer is done
+    int done = writer_done;
+    while (nps_shm_reader_next(&r, &s) == 1) {
+      int64_t k = index_of(&s);
+      if (k < 0) {
+        torn++;
+      } else if (k <= last) {
+        back++;
+      } else {
+        last = k;
+      }
+      nb++;
+    }
+    if (done) {
+      break;
+    }
+    sched_yield();
+  }
+  pthread_join(th, NULL);
+  printf("read %llu lost %llu total %llu torn %llu back %llu last %lld\n", (unsigned long long)nb,
+         (unsigned long long)r.lost, (unsigned long long)(nb + r.lost), (unsigned long long)torn,
+         (unsigned long long)back, (long long)last);
+  nps_shm_reader_close(&r);
+  nps_shm_writer_close();
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s <shm name> <lost|stress>\n", argv[0]);
+    return 1;
+  }
+  name = argv[1];
+  int ret = strcmp(argv[2], "lost") == 0 ? test_lost() : test_stress();
+  shm_unlink(name);
+  return ret;
+}
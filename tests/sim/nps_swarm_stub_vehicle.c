@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 The Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nps_swarm_stub_vehicle.c
+ * Stub vehicle library for the swarm host test (02_nps_swarm.t).
+ *
+ * Options: --ac_id <id>, --reentrant and the --duration given by the host.
+ * The state is in globals, as for a real vehicle, and is printed at the end:
+ * number of steps, and ids and last position of the traffic received.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nps_swarm.h"
+
+#define STUB_DT 0.01
+
+static int ac_id;
+static bool reentrant;
+static double duration;
+static int steps;
+static uint32_t seen;        ///< bit mask of the received ac ids
+static int32_t last_lat[32]; ///< last received latitude per ac id
+
+double nps_swarm_vehicle_init(int argc, char **argv)
+{
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--ac_id") == 0 && i + 1 < argc) {
+      ac_id = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+      duration = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--reentrant") == 0) {
+      reentrant = true;
+    }
+  }
+  return ac_id > 0 && ac_id < 32 ? STUB_DT : -1.;
+}
+
+bool nps_swarm_vehicle_step(void)
+{
+  if (steps * STUB_DT >= duration - STUB_DT / 2) {
+    return false;
+  }
+  steps++;
+  return true;
+}
+
+void nps_swarm_vehicle_get_traffic(struct NpsSwarmTraffic *traffic)
+{
+  memset(traffic, 0, sizeof(*traffic));
+  traffic->valid = true;
+  traffic->ac_id = ac_id;
+  // position encodes the sender and its step
+  traffic->lat = ac_id * 100000 + steps;
+}
+
+void nps_swarm_vehicle_set_traffic(struct NpsSwarmTraffic *traffic)
+{
+  if (traffic->ac_id < 32) {
+    seen |= 1u << traffic->ac_id;
+    last_lat[traffic->ac_id] = traffic->lat;
+  }
+}
+
+bool nps_swarm_vehicle_reentrant(void)
+{
+  return reentrant;
+}
+
+void nps_swarm_vehicle_finish(void)
+{
+  printf("stub %d steps %d seen %x", ac_id, steps, seen);
+  for (int i = 0; i < 32; i++) {
+    if (seen & (1u << i)) {
+      printf(" %d:%d", i, last_lat[i] - i * 100000);
+    }
+  }
+  printf("\n");
+}